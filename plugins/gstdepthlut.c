@@ -0,0 +1,774 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:element-depthlut
+ *
+ * Converts 10 to 16-bit frames (GRAY16_LE, or bayer with 16-bit samples) to
+ * 8 bits through a lookup table, applying a tone curve on the way.
+ *
+ * The samples are expected in the low bits of each 16-bit word, as the
+ * cameras deliver them. A window of input values (windowlow to windowhigh,
+ * by default the whole range of bitdepth bits) is stretched over the output
+ * range and shaped by a linear, gamma or log curve. The table is built once
+ * for every combination of the properties, so the curve costs nothing per
+ * pixel, and the properties can be changed while playing - the next frame
+ * uses the new table, without waiting for the frame that is being converted.
+ *
+ * Frames are split into stripes of rows that are converted in parallel, and
+ * the lookups are done with AVX2 gathers on CPUs that have them.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 videotestsrc ! video/x-raw,format=GRAY16_LE ! depthlut curve=gamma gamma=2.2 bitdepth=16 ! videoconvert ! xvimagesink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstdepthlut.h"
+#include <gst/gst.h>
+#include <math.h>
+#include <string.h>
+
+#ifdef HAVE_AVX2
+#include <immintrin.h>
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (gst_depth_lut_debug_category);
+#define GST_CAT_DEFAULT gst_depth_lut_debug_category
+
+/* One entry for every 16-bit value. The gathers read 4 bytes at a time, so the table is padded. */
+#define LUT_SIZE 65536
+#define LUT_PADDING 3
+#define MAX_THREADS 64
+#define MIN_STRIPE_ROWS 32
+
+/* Bayer formats with 16-bit samples, and the significant bits in each */
+static const struct {
+  const gchar *suffix;
+  guint depth;
+} bayerDepths[] = {
+  { "10le", 10 },
+  { "12le", 12 },
+  { "14le", 14 },
+  { "16le", 0 }
+};
+#define NUM_BAYER_DEPTHS (sizeof(bayerDepths) / sizeof(bayerDepths[0]))
+
+static void gst_depth_lut_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_depth_lut_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_depth_lut_finalize (GObject * object);
+
+static GstCaps *gst_depth_lut_transform_caps (GstBaseTransform * trans,
+    GstPadDirection direction, GstCaps * caps, GstCaps * filter);
+static gboolean gst_depth_lut_get_unit_size (GstBaseTransform * trans,
+    GstCaps * caps, gsize * size);
+static gboolean gst_depth_lut_set_caps (GstBaseTransform * trans,
+    GstCaps * incaps, GstCaps * outcaps);
+static gboolean gst_depth_lut_start (GstBaseTransform * trans);
+static gboolean gst_depth_lut_stop (GstBaseTransform * trans);
+static GstFlowReturn gst_depth_lut_transform (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer * outbuf);
+
+static void gst_depth_lut_update (GstDepthLut * filter);
+static void gst_depth_lut_map_stripe (GstDepthLutStripe * stripe);
+static void gst_depth_lut_stripe_func (gpointer data, gpointer user_data);
+
+enum
+{
+  PROP_0,
+  PROP_CURVE,
+  PROP_GAMMA,
+  PROP_LOGSCALE,
+  PROP_BITDEPTH,
+  PROP_WINDOWLOW,
+  PROP_WINDOWHIGH,
+  PROP_THREADS,
+  PROP_SIMD
+};
+
+static GstStaticPadTemplate gst_depth_lut_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw, format=(string)GRAY16_LE, width=(int)[1,MAX], height=(int)[1,MAX], framerate=(fraction)[0/1,MAX]; "
+        "video/x-bayer, format=(string){bggr10le,gbrg10le,grbg10le,rggb10le,bggr12le,gbrg12le,grbg12le,rggb12le,bggr14le,gbrg14le,grbg14le,rggb14le,bggr16le,gbrg16le,grbg16le,rggb16le}, width=(int)[1,MAX], height=(int)[1,MAX], framerate=(fraction)[0/1,MAX]")
+    );
+
+static GstStaticPadTemplate gst_depth_lut_src_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("video/x-raw, format=(string)GRAY8, width=(int)[1,MAX], height=(int)[1,MAX], framerate=(fraction)[0/1,MAX]; "
+        "video/x-bayer, format=(string){bggr,gbrg,grbg,rggb}, width=(int)[1,MAX], height=(int)[1,MAX], framerate=(fraction)[0/1,MAX]")
+    );
+
+G_DEFINE_TYPE_WITH_CODE (GstDepthLut, gst_depth_lut, GST_TYPE_BASE_TRANSFORM,
+  GST_DEBUG_CATEGORY_INIT (gst_depth_lut_debug_category, "depthlut", 0,
+  "debug category for depthlut element"));
+
+static void
+gst_depth_lut_class_init (GstDepthLutClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstBaseTransformClass *base_transform_class = GST_BASE_TRANSFORM_CLASS (klass);
+
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
+      gst_static_pad_template_get (&gst_depth_lut_src_template));
+  gst_element_class_add_pad_template (GST_ELEMENT_CLASS(klass),
+      gst_static_pad_template_get (&gst_depth_lut_sink_template));
+
+  gst_element_class_set_static_metadata (GST_ELEMENT_CLASS(klass),
+      "High bit depth to 8-bit converter", "Filter/Converter/Video", "Maps 10 to 16-bit frames to 8 bits through a lookup table with a gamma, log or linear curve",
+      "Ingmars Melkis <contact@zingmars.me>");
+
+  gobject_class->set_property = gst_depth_lut_set_property;
+  gobject_class->get_property = gst_depth_lut_get_property;
+  gobject_class->finalize = gst_depth_lut_finalize;
+  base_transform_class->transform_caps = GST_DEBUG_FUNCPTR(gst_depth_lut_transform_caps);
+  base_transform_class->get_unit_size = GST_DEBUG_FUNCPTR(gst_depth_lut_get_unit_size);
+  base_transform_class->set_caps = GST_DEBUG_FUNCPTR(gst_depth_lut_set_caps);
+  base_transform_class->start = GST_DEBUG_FUNCPTR(gst_depth_lut_start);
+  base_transform_class->stop = GST_DEBUG_FUNCPTR(gst_depth_lut_stop);
+  base_transform_class->transform = GST_DEBUG_FUNCPTR(gst_depth_lut_transform);
+
+  g_object_class_install_property (gobject_class, PROP_CURVE,
+      g_param_spec_string ("curve", "Tone curve", "(linear, gamma, log) Curve the window of input values is mapped to the output through. \"gamma\" raises it to 1/gamma, \"log\" brightens the shadows by logscale.", "linear",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_GAMMA,
+      g_param_spec_double ("gamma", "Gamma", "(Number) Gamma of the gamma curve. Values above 1 brighten the shadows.", 0.1, 10.0, 2.2,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_LOGSCALE,
+      g_param_spec_double ("logscale", "Log curve scale", "(Number) Strength of the log curve, the output is log(1 + logscale * x) / log(1 + logscale).", 0.01, 1000000.0, 100.0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_BITDEPTH,
+      g_param_spec_uint ("bitdepth", "Bit depth", "(8-16) Significant bits in the GRAY16_LE and 16le bayer formats, i.e. 12 for a camera's Mono12. The other formats tell their own.", 8, 16, 12,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_WINDOWLOW,
+      g_param_spec_uint ("windowlow", "Window low", "(Number) Input value that becomes black, and everything below it.", 0, 65535, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_WINDOWHIGH,
+      g_param_spec_uint ("windowhigh", "Window high", "(Number) Input value that becomes white, and everything above it. 0 uses the highest value of the bit depth.", 0, 65535, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_THREADS,
+      g_param_spec_uint ("threads", "Threads", "(0-64) Number of stripes each frame is split into and converted in parallel. 0 uses one per CPU core. Takes effect when the element is started.", 0, MAX_THREADS, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_SIMD,
+      g_param_spec_boolean ("simd", "Use SIMD", "(true/false) Look the pixels up with AVX2 gathers when the CPU supports them. Takes effect when the element is started.", TRUE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+}
+
+static void
+gst_depth_lut_init (GstDepthLut * filter)
+{
+  filter->curve = g_strdup("linear");
+  filter->gamma = 2.2;
+  filter->logScale = 100.0;
+  filter->bitDepth = 12;
+  filter->windowLow = 0;
+  filter->windowHigh = 0;
+  filter->threads = 0;
+  filter->simd = TRUE;
+
+  filter->lut = NULL;
+  filter->lutGeneration = 0;
+  filter->lutBuilt = 0;
+  filter->capsDepth = 0;
+  filter->pool = NULL;
+  filter->stripes = NULL;
+  filter->numStripes = 0;
+  filter->pending = 0;
+  filter->avx2 = FALSE;
+  g_mutex_init(&filter->lock);
+  g_cond_init(&filter->cond);
+
+  gst_depth_lut_update(filter);
+}
+
+void
+gst_depth_lut_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (object);
+
+  GST_OBJECT_LOCK(filter);
+  switch (property_id) {
+    case PROP_CURVE:
+      g_free(filter->curve);
+      filter->curve = g_value_dup_string(value);
+      break;
+    case PROP_GAMMA:
+      filter->gamma = g_value_get_double(value);
+      break;
+    case PROP_LOGSCALE:
+      filter->logScale = g_value_get_double(value);
+      break;
+    case PROP_BITDEPTH:
+      filter->bitDepth = g_value_get_uint(value);
+      break;
+    case PROP_WINDOWLOW:
+      filter->windowLow = g_value_get_uint(value);
+      break;
+    case PROP_WINDOWHIGH:
+      filter->windowHigh = g_value_get_uint(value);
+      break;
+    case PROP_THREADS:
+      filter->threads = g_value_get_uint(value);
+      break;
+    case PROP_SIMD:
+      filter->simd = g_value_get_boolean(value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK(filter);
+
+  // The table is rebuilt here rather than in the streaming thread, which keeps using the old one until the new one is ready
+  if(property_id != PROP_THREADS && property_id != PROP_SIMD) {
+    gst_depth_lut_update(filter);
+  }
+}
+
+void
+gst_depth_lut_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (object);
+
+  GST_OBJECT_LOCK(filter);
+  switch (property_id) {
+    case PROP_CURVE:
+      g_value_set_string(value, filter->curve);
+      break;
+    case PROP_GAMMA:
+      g_value_set_double(value, filter->gamma);
+      break;
+    case PROP_LOGSCALE:
+      g_value_set_double(value, filter->logScale);
+      break;
+    case PROP_BITDEPTH:
+      g_value_set_uint(value, filter->bitDepth);
+      break;
+    case PROP_WINDOWLOW:
+      g_value_set_uint(value, filter->windowLow);
+      break;
+    case PROP_WINDOWHIGH:
+      g_value_set_uint(value, filter->windowHigh);
+      break;
+    case PROP_THREADS:
+      g_value_set_uint(value, filter->threads);
+      break;
+    case PROP_SIMD:
+      g_value_set_boolean(value, filter->simd);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK(filter);
+}
+
+static void
+gst_depth_lut_finalize (GObject * object)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (object);
+
+  if(filter->lut) {
+    g_bytes_unref(filter->lut);
+  }
+  g_free(filter->curve);
+  g_mutex_clear(&filter->lock);
+  g_cond_clear(&filter->cond);
+
+  G_OBJECT_CLASS (gst_depth_lut_parent_class)->finalize (object);
+}
+
+/* Builds the table from the current properties and swaps it in. Tables built at the same time from different threads are swapped in the order the properties were read in. */
+static void
+gst_depth_lut_update (GstDepthLut * filter)
+{
+  guint8 *table = g_malloc(LUT_SIZE + LUT_PADDING);
+  GBytes *lut, *old = NULL;
+  guint generation, depth, low, high, v;
+  gdouble gamma, logScale, x, y;
+  enum { CURVE_LINEAR, CURVE_GAMMA, CURVE_LOG } curve = CURVE_LINEAR;
+  gboolean unknown = FALSE;
+
+  GST_OBJECT_LOCK(filter);
+  generation = ++filter->lutGeneration;
+  // No curve at all is a linear one
+  if(g_strcmp0(filter->curve, "gamma") == 0) {
+    curve = CURVE_GAMMA;
+  } else if(g_strcmp0(filter->curve, "log") == 0) {
+    curve = CURVE_LOG;
+  } else if(filter->curve != NULL && strcmp(filter->curve, "linear") != 0) {
+    unknown = TRUE;
+  }
+  gamma = filter->gamma;
+  logScale = filter->logScale;
+  depth = filter->capsDepth > 0 ? filter->capsDepth : filter->bitDepth;
+  low = filter->windowLow;
+  high = filter->windowHigh > 0 ? filter->windowHigh : (1u << depth) - 1;
+  GST_OBJECT_UNLOCK(filter);
+
+  if(unknown) {
+    GST_WARNING_OBJECT(filter, "Unknown curve, using a linear one. Available values are: linear, gamma, log.");
+  }
+  if(high <= low) {
+    GST_WARNING_OBJECT(filter, "The window (%u to %u) is empty, everything above %u becomes white.", low, high, low);
+    high = low + 1;
+  }
+
+  for(v = 0; v < LUT_SIZE; v++) {
+    x = v <= low ? 0.0 : v >= high ? 1.0 : (gdouble) (v - low) / (high - low);
+    switch(curve) {
+      case CURVE_GAMMA:
+        y = pow(x, 1.0 / gamma);
+        break;
+      case CURVE_LOG:
+        y = log1p(logScale * x) / log1p(logScale);
+        break;
+      default:
+        y = x;
+        break;
+    }
+    table[v] = (guint8) CLAMP(y * 255.0 + 0.5, 0.0, 255.0);
+  }
+  memset(table + LUT_SIZE, 0, LUT_PADDING);
+  lut = g_bytes_new_take(table, LUT_SIZE + LUT_PADDING);
+
+  GST_OBJECT_LOCK(filter);
+  if(generation > filter->lutBuilt) {
+    old = filter->lut;
+    filter->lut = lut;
+    filter->lutBuilt = generation;
+    lut = NULL;
+  }
+  GST_OBJECT_UNLOCK(filter);
+
+  if(lut) {
+    // A newer table got in first
+    g_bytes_unref(lut);
+  } else {
+    GST_DEBUG_OBJECT(filter, "New table: %u-bit input, window %u to %u, curve %d.", depth, low, high, curve);
+  }
+  if(old) {
+    g_bytes_unref(old);
+  }
+}
+
+/* Maps the format of one side to the other's. Returns the number of formats written to out, at most NUM_BAYER_DEPTHS. */
+static guint
+gst_depth_lut_map_format (const gchar * format, GstPadDirection direction, const gchar ** out)
+{
+  static const gchar *bayerIn[] = { "bggr10le", "gbrg10le", "grbg10le", "rggb10le", "bggr12le", "gbrg12le", "grbg12le", "rggb12le", "bggr14le", "gbrg14le", "grbg14le", "rggb14le", "bggr16le", "gbrg16le", "grbg16le", "rggb16le" };
+  static const gchar *bayerOut[] = { "bggr", "gbrg", "grbg", "rggb" };
+  guint i, j;
+
+  if(direction == GST_PAD_SINK) {
+    if(strcmp(format, "GRAY16_LE") == 0) {
+      out[0] = "GRAY8";
+      return 1;
+    }
+    for(i = 0; i < G_N_ELEMENTS(bayerIn); i++) {
+      if(strcmp(format, bayerIn[i]) == 0) {
+        out[0] = bayerOut[i % G_N_ELEMENTS(bayerOut)];
+        return 1;
+      }
+    }
+  } else {
+    if(strcmp(format, "GRAY8") == 0) {
+      out[0] = "GRAY16_LE";
+      return 1;
+    }
+    for(i = 0; i < G_N_ELEMENTS(bayerOut); i++) {
+      if(strcmp(format, bayerOut[i]) == 0) {
+        for(j = 0; j < NUM_BAYER_DEPTHS; j++) {
+          out[j] = bayerIn[j * G_N_ELEMENTS(bayerOut) + i];
+        }
+        return NUM_BAYER_DEPTHS;
+      }
+    }
+  }
+  return 0;
+}
+
+/* The 10, 12, 14 and 16-bit formats of a bayer pattern all map to the same 8-bit one, it's only listed once */
+static void
+gst_depth_lut_append_format (GValue * list, const gchar * format)
+{
+  GValue item = G_VALUE_INIT;
+  guint i;
+
+  for(i = 0; i < gst_value_list_get_size(list); i++) {
+    if(strcmp(g_value_get_string(gst_value_list_get_value(list, i)), format) == 0) {
+      return;
+    }
+  }
+  g_value_init(&item, G_TYPE_STRING);
+  g_value_set_static_string(&item, format);
+  gst_value_list_append_value(list, &item);
+  g_value_unset(&item);
+}
+
+/* Same caps, with the format swapped for the 8-bit (or the 16-bit) one of the same kind and bayer pattern */
+static GstCaps *
+gst_depth_lut_transform_caps (GstBaseTransform * trans, GstPadDirection direction, GstCaps * caps, GstCaps * filter)
+{
+  GstCaps *result = gst_caps_new_empty();
+  const gchar *mapped[NUM_BAYER_DEPTHS];
+  guint i, j, k, n;
+
+  for(i = 0; i < gst_caps_get_size(caps); i++) {
+    GstStructure *s = gst_structure_copy(gst_caps_get_structure(caps, i));
+    const GValue *formats = gst_structure_get_value(s, "format");
+    GValue list = G_VALUE_INIT;
+
+    if(!formats) {
+      // No format, anything of the same kind the other side takes goes
+      GstCaps *templCaps = gst_pad_template_get_caps(gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(trans), direction == GST_PAD_SINK ? "src" : "sink"));
+
+      for(j = 0; j < gst_caps_get_size(templCaps); j++) {
+        if(gst_structure_has_name(gst_caps_get_structure(templCaps, j), gst_structure_get_name(s))) {
+          gst_structure_set_value(s, "format", gst_structure_get_value(gst_caps_get_structure(templCaps, j), "format"));
+          gst_caps_append_structure(result, gst_structure_copy(s));
+        }
+      }
+      gst_caps_unref(templCaps);
+      gst_structure_free(s);
+      continue;
+    }
+
+    g_value_init(&list, GST_TYPE_LIST);
+    if(G_VALUE_HOLDS_STRING(formats)) {
+      n = gst_depth_lut_map_format(g_value_get_string(formats), direction, mapped);
+      for(k = 0; k < n; k++) {
+        gst_depth_lut_append_format(&list, mapped[k]);
+      }
+    } else if(GST_VALUE_HOLDS_LIST(formats)) {
+      for(j = 0; j < gst_value_list_get_size(formats); j++) {
+        const GValue *format = gst_value_list_get_value(formats, j);
+
+        if(!G_VALUE_HOLDS_STRING(format)) {
+          continue;
+        }
+        n = gst_depth_lut_map_format(g_value_get_string(format), direction, mapped);
+        for(k = 0; k < n; k++) {
+          gst_depth_lut_append_format(&list, mapped[k]);
+        }
+      }
+    }
+
+    // Formats we don't convert are left out
+    if(gst_value_list_get_size(&list) == 1) {
+      gst_structure_set_value(s, "format", gst_value_list_get_value(&list, 0));
+      gst_caps_append_structure(result, s);
+    } else if(gst_value_list_get_size(&list) > 1) {
+      gst_structure_set_value(s, "format", &list);
+      gst_caps_append_structure(result, s);
+    } else {
+      gst_structure_free(s);
+    }
+    g_value_unset(&list);
+  }
+
+  if(filter) {
+    GstCaps *intersection = gst_caps_intersect_full(filter, result, GST_CAPS_INTERSECT_FIRST);
+
+    gst_caps_unref(result);
+    result = intersection;
+  }
+  GST_DEBUG_OBJECT(trans, "Transformed %" GST_PTR_FORMAT " into %" GST_PTR_FORMAT, caps, result);
+  return result;
+}
+
+/* Reads the size and sample size of the frames, the rows are padded to 4 bytes like GstVideoInfo does */
+static gboolean
+gst_depth_lut_parse_caps (GstCaps * caps, guint * width, guint * height, gsize * stride, guint * depth)
+{
+  GstStructure *s = gst_caps_get_structure(caps, 0);
+  const gchar *format = gst_structure_get_string(s, "format");
+  gint w, h;
+  guint i, bytes = 1;
+
+  if(!format || !gst_structure_get_int(s, "width", &w) || !gst_structure_get_int(s, "height", &h)) {
+    return FALSE;
+  }
+
+  *depth = 0;
+  if(strcmp(format, "GRAY16_LE") == 0) {
+    bytes = 2;
+  } else if(strlen(format) > 4) {
+    for(i = 0; i < NUM_BAYER_DEPTHS; i++) {
+      if(strcmp(format + 4, bayerDepths[i].suffix) == 0) {
+        bytes = 2;
+        *depth = bayerDepths[i].depth;
+      }
+    }
+  }
+
+  *width = w;
+  *height = h;
+  *stride = GST_ROUND_UP_4(w * bytes);
+  return TRUE;
+}
+
+static gboolean
+gst_depth_lut_get_unit_size (GstBaseTransform * trans, GstCaps * caps, gsize * size)
+{
+  guint width, height, depth;
+  gsize stride;
+
+  if(!gst_depth_lut_parse_caps(caps, &width, &height, &stride, &depth)) {
+    return FALSE;
+  }
+  *size = stride * height;
+  return TRUE;
+}
+
+static gboolean
+gst_depth_lut_set_caps (GstBaseTransform * trans, GstCaps * incaps, GstCaps * outcaps)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (trans);
+  guint width, height, depth, outWidth, outHeight, outDepth;
+  gboolean changed;
+
+  if(!gst_depth_lut_parse_caps(incaps, &width, &height, &filter->inStride, &depth) || !gst_depth_lut_parse_caps(outcaps, &outWidth, &outHeight, &filter->outStride, &outDepth) || width != outWidth || height != outHeight) {
+    GST_ERROR_OBJECT(filter, "Unsupported caps: %" GST_PTR_FORMAT " to %" GST_PTR_FORMAT, incaps, outcaps);
+    return FALSE;
+  }
+  filter->width = width;
+  filter->height = height;
+
+  // The 10, 12 and 14-bit formats say how many bits are used
+  GST_OBJECT_LOCK(filter);
+  changed = filter->capsDepth != depth;
+  filter->capsDepth = depth;
+  GST_OBJECT_UNLOCK(filter);
+  if(changed) {
+    gst_depth_lut_update(filter);
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_depth_lut_start (GstBaseTransform * trans)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (trans);
+  GError *error = NULL;
+  guint threads;
+  gboolean simd;
+
+  GST_OBJECT_LOCK(filter);
+  threads = filter->threads > 0 ? filter->threads : MIN(g_get_num_processors(), MAX_THREADS);
+  simd = filter->simd;
+  GST_OBJECT_UNLOCK(filter);
+
+  filter->avx2 = FALSE;
+#ifdef HAVE_AVX2
+  filter->avx2 = simd && __builtin_cpu_supports("avx2");
+#endif
+  GST_DEBUG_OBJECT(filter, "Converting in %u stripes%s.", threads, filter->avx2 ? " with AVX2" : "");
+
+  // The pool's threads are kept around, so that the frames don't wait for new threads to start
+  filter->numStripes = threads;
+  filter->stripes = g_new0(GstDepthLutStripe, threads);
+  if(threads > 1) {
+    filter->pool = g_thread_pool_new(gst_depth_lut_stripe_func, filter, threads - 1, TRUE, &error);
+    if(!filter->pool) {
+      GST_WARNING_OBJECT(filter, "Couldn't start the threads, converting in the streaming thread: %s", error->message);
+      g_error_free(error);
+      filter->numStripes = 1;
+    }
+  }
+  return TRUE;
+}
+
+static gboolean
+gst_depth_lut_stop (GstBaseTransform * trans)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (trans);
+
+  if(filter->pool) {
+    g_thread_pool_free(filter->pool, FALSE, TRUE);
+    filter->pool = NULL;
+  }
+  g_free(filter->stripes);
+  filter->stripes = NULL;
+  filter->numStripes = 0;
+  return TRUE;
+}
+
+static inline void
+gst_depth_lut_map_row (const guint8 * lut, const guint16 * in, guint8 * out, guint width)
+{
+  guint x;
+
+  for(x = 0; x < width; x++) {
+    out[x] = lut[GUINT16_FROM_LE(in[x])];
+  }
+}
+
+#ifdef HAVE_AVX2
+/* Looks up 16 pixels at a time. Each gather reads 4 bytes of the table at the pixel's value, of which the first one is the pixel's. */
+__attribute__((target("avx2"))) static void
+gst_depth_lut_map_row_avx2 (const guint8 * lut, const guint16 * in, guint8 * out, guint width)
+{
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  guint x;
+
+  for(x = 0; x + 16 <= width; x += 16) {
+    __m256i pixels = _mm256_loadu_si256((const __m256i *) (in + x));
+    __m256i lo = _mm256_cvtepu16_epi32(_mm256_castsi256_si128(pixels));
+    __m256i hi = _mm256_cvtepu16_epi32(_mm256_extracti128_si256(pixels, 1));
+    __m256i words;
+
+    lo = _mm256_and_si256(_mm256_i32gather_epi32((const int *) lut, lo, 1), mask);
+    hi = _mm256_and_si256(_mm256_i32gather_epi32((const int *) lut, hi, 1), mask);
+    // The packs work within 128-bit lanes, put the pixels back in order before narrowing them to bytes
+    words = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+    _mm_storeu_si128((__m128i *) (out + x), _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1)));
+  }
+  gst_depth_lut_map_row(lut, in + x, out + x, width - x);
+}
+#endif
+
+static void
+gst_depth_lut_map_stripe (GstDepthLutStripe * stripe)
+{
+  guint y;
+
+  for(y = 0; y < stripe->rows; y++) {
+    const guint16 *in = (const guint16 *) (stripe->in + y * stripe->inStride);
+    guint8 *out = stripe->out + y * stripe->outStride;
+
+#ifdef HAVE_AVX2
+    if(stripe->filter->avx2) {
+      gst_depth_lut_map_row_avx2(stripe->lut, in, out, stripe->width);
+      continue;
+    }
+#endif
+    gst_depth_lut_map_row(stripe->lut, in, out, stripe->width);
+  }
+}
+
+static void
+gst_depth_lut_stripe_func (gpointer data, gpointer user_data)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (user_data);
+
+  gst_depth_lut_map_stripe((GstDepthLutStripe *) data);
+
+  g_mutex_lock(&filter->lock);
+  if(--filter->pending == 0) {
+    g_cond_signal(&filter->cond);
+  }
+  g_mutex_unlock(&filter->lock);
+}
+
+static GstFlowReturn
+gst_depth_lut_transform (GstBaseTransform * trans, GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstDepthLut *filter = GST_DEPTHLUT (trans);
+  GstMapInfo inMap, outMap;
+  GBytes *lut;
+  guint numStripes, rows, row, i;
+
+  if(!gst_buffer_map(inbuf, &inMap, GST_MAP_READ)) {
+    GST_ELEMENT_ERROR(filter, STREAM, FAILED, ("Couldn't map the input buffer."), (NULL));
+    return GST_FLOW_ERROR;
+  }
+  if(!gst_buffer_map(outbuf, &outMap, GST_MAP_WRITE)) {
+    gst_buffer_unmap(inbuf, &inMap);
+    GST_ELEMENT_ERROR(filter, STREAM, FAILED, ("Couldn't map the output buffer."), (NULL));
+    return GST_FLOW_ERROR;
+  }
+
+  // Hold on to the current table, a new one may be swapped in meanwhile
+  GST_OBJECT_LOCK(filter);
+  lut = g_bytes_ref(filter->lut);
+  GST_OBJECT_UNLOCK(filter);
+
+  // Small frames aren't worth waking the threads up for
+  numStripes = CLAMP(filter->height / MIN_STRIPE_ROWS, 1, filter->pool ? filter->numStripes : 1);
+  rows = (filter->height + numStripes - 1) / numStripes;
+  for(i = 0, row = 0; i < numStripes; i++, row += rows) {
+    GstDepthLutStripe *stripe = &filter->stripes[i];
+
+    stripe->filter = filter;
+    stripe->lut = g_bytes_get_data(lut, NULL);
+    stripe->in = inMap.data + row * filter->inStride;
+    stripe->out = outMap.data + row * filter->outStride;
+    stripe->inStride = filter->inStride;
+    stripe->outStride = filter->outStride;
+    stripe->width = filter->width;
+    stripe->rows = MIN(rows, filter->height - row);
+  }
+
+  filter->pending = numStripes - 1;
+  for(i = 1; i < numStripes; i++) {
+    g_thread_pool_push(filter->pool, &filter->stripes[i], NULL);
+  }
+  gst_depth_lut_map_stripe(&filter->stripes[0]);
+
+  g_mutex_lock(&filter->lock);
+  while(filter->pending > 0) {
+    g_cond_wait(&filter->cond, &filter->lock);
+  }
+  g_mutex_unlock(&filter->lock);
+
+  g_bytes_unref(lut);
+  gst_buffer_unmap(outbuf, &outMap);
+  gst_buffer_unmap(inbuf, &inMap);
+  return GST_FLOW_OK;
+}
+
+static gboolean
+plugin_init (GstPlugin * plugin)
+{
+  return gst_element_register (plugin, "depthlut", GST_RANK_NONE,
+      GST_TYPE_DEPTHLUT);
+}
+
+#ifndef VERSION
+#define VERSION "1.1.0"
+#endif
+#ifndef PACKAGE
+#define PACKAGE "gstpylon"
+#endif
+#ifndef PACKAGE_NAME
+#define PACKAGE_NAME "gstpylon"
+#endif
+#ifndef GST_PACKAGE_ORIGIN
+#define GST_PACKAGE_ORIGIN "http://www.playgineering.com/"
+#endif
+
+GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
+    GST_VERSION_MINOR,
+    depthlut,
+    "A plugin that converts high bit depth frames to 8 bits through a lookup table.",
+    plugin_init, VERSION, "LGPL", PACKAGE_NAME, GST_PACKAGE_ORIGIN);
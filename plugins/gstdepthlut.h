@@ -0,0 +1,86 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_DEPTHLUT_H_
+#define _GST_DEPTHLUT_H_
+
+#include <gst/base/gstbasetransform.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_DEPTHLUT   (gst_depth_lut_get_type())
+#define GST_DEPTHLUT(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_DEPTHLUT,GstDepthLut))
+#define GST_DEPTHLUT_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_DEPTHLUT,GstDepthLutClass))
+#define GST_IS_DEPTHLUT(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_DEPTHLUT))
+#define GST_IS_DEPTHLUT_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_DEPTHLUT))
+
+typedef struct _GstDepthLut GstDepthLut;
+typedef struct _GstDepthLutClass GstDepthLutClass;
+
+/* Rows of a frame mapped by one thread */
+typedef struct _GstDepthLutStripe
+{
+  GstDepthLut *filter;
+  const guint8 *lut;
+  const guint8 *in;
+  guint8 *out;
+  gsize inStride, outStride;
+  guint width, rows;
+} GstDepthLutStripe;
+
+struct _GstDepthLut
+{
+  GstBaseTransform parent;
+
+  // The table every 16-bit value is looked up in. Replaced as a whole under the object lock, so a frame always uses one table and the properties can change without waiting for it.
+  GBytes *lut;
+  guint lutGeneration, lutBuilt;
+
+  // Negotiated frames
+  guint width, height;
+  gsize inStride, outStride;
+  guint capsDepth; // Significant bits given by the format, 0 if the bitdepth property decides.
+
+  // Stripes processed in parallel, the streaming thread takes the first one
+  GThreadPool *pool;
+  GstDepthLutStripe *stripes;
+  guint numStripes;
+  GMutex lock;
+  GCond cond;
+  guint pending; // Stripes the pool hasn't finished yet.
+  gboolean avx2;
+
+  // Plugin parameters
+  gchar *curve;
+  gdouble gamma, logScale;
+  guint bitDepth, windowLow, windowHigh;
+  guint threads;
+  gboolean simd;
+};
+
+struct _GstDepthLutClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_depth_lut_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,644 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+/**
+ * SECTION:tracer-flowstats
+ *
+ * A tracer that measures how buffers move through every link of a pipeline,
+ * without having to insert any elements into it.
+ *
+ * For every source pad that pushes buffers (or sink pad that pulls them) it
+ * counts buffers and bytes, and measures how long the downstream element spent
+ * processing each buffer (time spent in pushes further downstream from the same
+ * thread is not counted). If the downstream element is a queue, its fill level
+ * is sampled as well. Counters are kept per thread and are only ever written
+ * by the thread that owns them, so the streaming threads never wait on each
+ * other. When a thread exits, its counters are added to the tracer's totals
+ * and its record is freed. Every period milliseconds (default - 1000) the
+ * counters are summed up and a "flowstats" record is logged for every link.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * GST_TRACERS="flowstats(period=500)" GST_DEBUG=GST_TRACER:7 gst-launch-1.0 pylonsrc ! queue ! videoconvert ! fakesink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstflowstats.h"
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_flow_stats_debug);
+#define GST_CAT_DEFAULT gst_flow_stats_debug
+
+#define MAX_LINKS 64 // Links a single thread can push buffers through.
+#define MAX_DEPTH 32 // Pushes a single thread can be nested in.
+#define NAME_LENGTH 96
+
+/* Counters are written by their own thread only, these just keep the dumping thread from seeing torn values. */
+#define STAT_LOAD(x) __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STAT_STORE(x, v) __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+
+typedef struct
+{
+  gsize id; // Id of the link's source pad. Pads can be freed and their memory reused by new ones before we dump, ids never are.
+  gchar src[NAME_LENGTH], sink[NAME_LENGTH];
+  gboolean hasLevel; // Downstream element is a queue.
+
+  guint64 buffers, bytes, proctime; // Totals since the link was first seen.
+  GstClockTime procmax;
+  guint procepoch;
+
+  guint levelbuffers, levelbytes;
+  guint64 leveltime;
+  guint levelepoch;
+} FlowStatsLink;
+
+typedef struct
+{
+  FlowStatsLink *link;
+  GstPad *pad;
+  GstClockTime start, child;
+  guint64 buffers, bytes;
+} FlowStatsFrame;
+
+struct _GstFlowStatsThread
+{
+  GstFlowStatsThread *next;
+  GstFlowStatsTracer *tracer; // Cleared if the tracer is finalized before the thread exits, protected by flow_stats_exit.
+  guint links; // Number of links in use, published atomically after the link has been filled in.
+  FlowStatsLink link[MAX_LINKS];
+  FlowStatsFrame stack[MAX_DEPTH];
+  guint depth;
+};
+
+typedef struct
+{
+  FlowStatsLink *link;
+  guint64 buffers, bytes, proctime;
+  GstClockTime procmax;
+  gboolean hasLevel;
+  guint levelbuffers, levelbytes;
+  guint64 leveltime;
+} FlowStatsTotals;
+
+static void flow_stats_thread_exit (gpointer data);
+
+static GPrivate thread_stats = G_PRIVATE_INIT (flow_stats_thread_exit);
+G_LOCK_DEFINE_STATIC (flow_stats_exit);
+static GstTracerRecord *tr_flowstats;
+static GQuark pad_id_quark;
+static gsize last_pad_id = 0;
+
+#define gst_flow_stats_tracer_parent_class parent_class
+G_DEFINE_TYPE (GstFlowStatsTracer, gst_flow_stats_tracer, GST_TYPE_TRACER);
+
+static void gst_flow_stats_tracer_constructed (GObject * object);
+static void gst_flow_stats_tracer_finalize (GObject * object);
+
+static void flow_stats_dump (GstFlowStatsTracer * self, GstClockTime ts);
+
+/* Thread local counters */
+static GstFlowStatsThread *
+flow_stats_get_thread (GstFlowStatsTracer * self)
+{
+  GstFlowStatsThread *thread = g_private_get (&thread_stats);
+
+  if (G_UNLIKELY (thread == NULL)) {
+    thread = g_new0 (GstFlowStatsThread, 1);
+    thread->tracer = self;
+    do {
+      thread->next = g_atomic_pointer_get (&self->threads);
+    } while (!g_atomic_pointer_compare_and_exchange (&self->threads, thread->next, thread));
+    g_private_set (&thread_stats, thread);
+  }
+
+  return thread;
+}
+
+/* Adds the counters of a link to the retired ones of the same link. Called with dumpLock held. */
+static void
+flow_stats_retire_link (GstFlowStatsTracer * self, FlowStatsLink * link)
+{
+  FlowStatsLink *retired = g_hash_table_lookup (self->retired, GSIZE_TO_POINTER (link->id));
+
+  if (!retired) {
+    retired = g_new (FlowStatsLink, 1);
+    *retired = *link;
+    g_hash_table_insert (self->retired, GSIZE_TO_POINTER (link->id), retired);
+    return;
+  }
+
+  retired->buffers += link->buffers;
+  retired->bytes += link->bytes;
+  retired->proctime += link->proctime;
+  if (link->procepoch != G_MAXUINT && (retired->procepoch == G_MAXUINT || link->procepoch > retired->procepoch ||
+          (link->procepoch == retired->procepoch && link->procmax > retired->procmax))) {
+    retired->procmax = link->procmax;
+    retired->procepoch = link->procepoch;
+  }
+  if (link->levelepoch != G_MAXUINT && (retired->levelepoch == G_MAXUINT || link->levelepoch >= retired->levelepoch)) {
+    retired->hasLevel = link->hasLevel;
+    retired->levelbuffers = link->levelbuffers;
+    retired->levelbytes = link->levelbytes;
+    retired->leveltime = link->leveltime;
+    retired->levelepoch = link->levelepoch;
+  }
+}
+
+/* Called when a thread that has pushed buffers exits. Its counters are folded into the retired ones and its record
+ * is freed, so pipelines that keep creating threads don't leave a record behind for every one of them. */
+static void
+flow_stats_thread_exit (gpointer data)
+{
+  GstFlowStatsThread *thread = data, **prev;
+  GstFlowStatsTracer *self;
+  guint i;
+
+  G_LOCK (flow_stats_exit);
+  self = thread->tracer;
+  if (self) {
+    g_mutex_lock (&self->dumpLock);
+    for (i = 0; i < thread->links; i++) {
+      flow_stats_retire_link (self, &thread->link[i]);
+    }
+    // New threads only ever replace the head, everything else is only changed with dumpLock held
+    if (!g_atomic_pointer_compare_and_exchange (&self->threads, thread, thread->next)) {
+      for (prev = &self->threads; *prev != thread; prev = &(*prev)->next);
+      *prev = thread->next;
+    }
+    g_mutex_unlock (&self->dumpLock);
+  }
+  G_UNLOCK (flow_stats_exit);
+
+  g_free (thread);
+}
+
+/* Gives every pad an id the first time a buffer goes through it */
+static gsize
+flow_stats_pad_id (GstPad * pad)
+{
+  gsize id = GPOINTER_TO_SIZE (g_object_get_qdata (G_OBJECT (pad), pad_id_quark));
+
+  if (G_UNLIKELY (id == 0)) {
+    id = (gsize) __atomic_add_fetch (&last_pad_id, 1, __ATOMIC_RELAXED);
+    // Another thread may have pushed through the same pad first
+    if (!g_object_replace_qdata (G_OBJECT (pad), pad_id_quark, NULL, GSIZE_TO_POINTER (id), NULL, NULL)) {
+      id = GPOINTER_TO_SIZE (g_object_get_qdata (G_OBJECT (pad), pad_id_quark));
+    }
+  }
+
+  return id;
+}
+
+static void
+flow_stats_pad_name (GstPad * pad, gchar * name)
+{
+  if (pad) {
+    g_snprintf (name, NAME_LENGTH, "%s:%s", GST_DEBUG_PAD_NAME (pad));
+  } else {
+    g_strlcpy (name, "(none)", NAME_LENGTH);
+  }
+}
+
+static FlowStatsLink *
+flow_stats_get_link (GstFlowStatsThread * thread, GstPad * srcpad, GstPad * sinkpad, gboolean pull)
+{
+  FlowStatsLink *link;
+  GstElement *element;
+  gsize id = flow_stats_pad_id (srcpad);
+  guint i;
+
+  for (i = 0; i < thread->links; i++) {
+    if (thread->link[i].id == id) {
+      return &thread->link[i];
+    }
+  }
+
+  if (thread->links == MAX_LINKS) {
+    return NULL;
+  }
+
+  // First buffer through this link on this thread
+  link = &thread->link[thread->links];
+  link->id = id;
+  flow_stats_pad_name (srcpad, link->src);
+  flow_stats_pad_name (sinkpad, link->sink);
+  link->hasLevel = FALSE;
+  if (!pull && sinkpad) {
+    element = gst_pad_get_parent_element (sinkpad);
+    if (element) {
+      link->hasLevel = g_object_class_find_property (G_OBJECT_GET_CLASS (element), "current-level-buffers") != NULL;
+      gst_object_unref (element);
+    }
+  }
+  link->procepoch = G_MAXUINT;
+  link->levelepoch = G_MAXUINT;
+  g_atomic_int_set (&thread->links, thread->links + 1);
+
+  return link;
+}
+
+static void
+flow_stats_sample_level (FlowStatsLink * link, GstPad * pad, guint epoch)
+{
+  GstPad *peer = gst_pad_get_peer (pad);
+  GstElement *element;
+  guint buffers = 0, bytes = 0;
+  guint64 time = 0;
+
+  if (!peer) {
+    return;
+  }
+
+  element = gst_pad_get_parent_element (peer);
+  if (element) {
+    g_object_get (element, "current-level-buffers", &buffers, "current-level-bytes", &bytes, "current-level-time", &time, NULL);
+    gst_object_unref (element);
+  }
+  gst_object_unref (peer);
+
+  STAT_STORE (link->levelbuffers, buffers);
+  STAT_STORE (link->levelbytes, bytes);
+  STAT_STORE (link->leveltime, time);
+  STAT_STORE (link->levelepoch, epoch);
+}
+
+/* Called before a buffer is pushed or pulled through a link */
+static void
+flow_stats_enter (GstFlowStatsTracer * self, GstClockTime ts, GstPad * pad, GstPad * srcpad, GstPad * sinkpad, gboolean pull, guint64 buffers, guint64 bytes)
+{
+  GstFlowStatsThread *thread = flow_stats_get_thread (self);
+  FlowStatsFrame *frame;
+
+  if (thread->depth++ >= MAX_DEPTH) {
+    return;
+  }
+
+  frame = &thread->stack[thread->depth - 1];
+  frame->link = srcpad ? flow_stats_get_link (thread, srcpad, sinkpad, pull) : NULL;
+  frame->pad = pad;
+  frame->start = ts;
+  frame->child = 0;
+  frame->buffers = buffers;
+  frame->bytes = bytes;
+}
+
+/* Called after the push or pull has returned */
+static void
+flow_stats_leave (GstFlowStatsTracer * self, GstClockTime ts, guint64 buffers, guint64 bytes)
+{
+  GstFlowStatsThread *thread = flow_stats_get_thread (self);
+  FlowStatsFrame *frame;
+  FlowStatsLink *link;
+  GstClockTime total, proc;
+  guint epoch;
+
+  if (thread->depth == 0) { // The tracer was loaded while this thread was in the middle of a push
+    return;
+  }
+  if (--thread->depth >= MAX_DEPTH) {
+    return;
+  }
+
+  frame = &thread->stack[thread->depth];
+  total = ts > frame->start ? ts - frame->start : 0;
+  proc = total > frame->child ? total - frame->child : 0;
+  if (thread->depth > 0) {
+    thread->stack[thread->depth - 1].child += total;
+  }
+
+  link = frame->link;
+  if (link) {
+    epoch = g_atomic_int_get (&self->epoch);
+    STAT_STORE (link->buffers, link->buffers + frame->buffers + buffers);
+    STAT_STORE (link->bytes, link->bytes + frame->bytes + bytes);
+    STAT_STORE (link->proctime, link->proctime + proc);
+    if (link->procepoch != epoch || proc > link->procmax) {
+      STAT_STORE (link->procmax, proc);
+      STAT_STORE (link->procepoch, epoch);
+    }
+    if (link->hasLevel && link->levelepoch != epoch) {
+      flow_stats_sample_level (link, frame->pad, epoch);
+    }
+  }
+
+  if (ts > STAT_LOAD (self->lastTs)) {
+    STAT_STORE (self->lastTs, ts);
+  }
+  if (ts >= STAT_LOAD (self->nextDump) && g_mutex_trylock (&self->dumpLock)) {
+    if (ts >= self->nextDump) {
+      flow_stats_dump (self, ts);
+    }
+    g_mutex_unlock (&self->dumpLock);
+  }
+}
+
+/* Hooks */
+static void
+do_push_buffer_pre (GstFlowStatsTracer * self, GstClockTime ts, GstPad * pad, GstBuffer * buffer)
+{
+  flow_stats_enter (self, ts, pad, pad, GST_PAD_PEER (pad), FALSE, 1, gst_buffer_get_size (buffer));
+}
+
+static void
+do_push_buffer_list_pre (GstFlowStatsTracer * self, GstClockTime ts, GstPad * pad, GstBufferList * list)
+{
+  guint i, length = gst_buffer_list_length (list);
+  guint64 bytes = 0;
+
+  for (i = 0; i < length; i++) {
+    bytes += gst_buffer_get_size (gst_buffer_list_get (list, i));
+  }
+
+  flow_stats_enter (self, ts, pad, pad, GST_PAD_PEER (pad), FALSE, length, bytes);
+}
+
+static void
+do_push_buffer_post (GstFlowStatsTracer * self, GstClockTime ts, GstPad * pad, GstFlowReturn res)
+{
+  flow_stats_leave (self, ts, 0, 0);
+}
+
+static void
+do_pull_range_pre (GstFlowStatsTracer * self, GstClockTime ts, GstPad * pad, guint64 offset, guint size)
+{
+  flow_stats_enter (self, ts, pad, GST_PAD_PEER (pad), pad, TRUE, 0, 0);
+}
+
+static void
+do_pull_range_post (GstFlowStatsTracer * self, GstClockTime ts, GstPad * pad, GstBuffer * buffer, GstFlowReturn res)
+{
+  if (res == GST_FLOW_OK && buffer) {
+    flow_stats_leave (self, ts, 1, gst_buffer_get_size (buffer));
+  } else {
+    flow_stats_leave (self, ts, 0, 0);
+  }
+}
+
+static void
+flow_stats_add_link (GHashTable * current, FlowStatsLink * link, guint epoch)
+{
+  FlowStatsTotals *totals = g_hash_table_lookup (current, GSIZE_TO_POINTER (link->id));
+
+  if (!totals) {
+    totals = g_new0 (FlowStatsTotals, 1);
+    totals->link = link;
+    g_hash_table_insert (current, GSIZE_TO_POINTER (link->id), totals);
+  }
+
+  totals->buffers += STAT_LOAD (link->buffers);
+  totals->bytes += STAT_LOAD (link->bytes);
+  totals->proctime += STAT_LOAD (link->proctime);
+  if (STAT_LOAD (link->procepoch) == epoch) {
+    totals->procmax = MAX (totals->procmax, STAT_LOAD (link->procmax));
+  }
+  if (link->hasLevel && STAT_LOAD (link->levelepoch) == epoch) {
+    totals->hasLevel = TRUE;
+    totals->levelbuffers = STAT_LOAD (link->levelbuffers);
+    totals->levelbytes = STAT_LOAD (link->levelbytes);
+    totals->leveltime = STAT_LOAD (link->leveltime);
+  }
+}
+
+/* Sums up the counters of all threads and logs a record for every link. Called with dumpLock held. */
+static void
+flow_stats_dump (GstFlowStatsTracer * self, GstClockTime ts)
+{
+  GHashTable *current = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  GstFlowStatsThread *thread;
+  FlowStatsTotals *totals, *previous;
+  FlowStatsLink *link;
+  GHashTableIter iter;
+  GstClockTime elapsed = ts - self->lastDump;
+  guint epoch = g_atomic_int_get (&self->epoch);
+  guint i, links;
+
+  for (thread = g_atomic_pointer_get (&self->threads); thread; thread = thread->next) {
+    links = g_atomic_int_get (&thread->links);
+    for (i = 0; i < links; i++) {
+      flow_stats_add_link (current, &thread->link[i], epoch);
+    }
+  }
+  // Counters of the threads that have exited
+  g_hash_table_iter_init (&iter, self->retired);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & link)) {
+    flow_stats_add_link (current, link, epoch);
+  }
+
+  g_hash_table_iter_init (&iter, current);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & totals)) {
+    guint64 buffers = totals->buffers, bytes = totals->bytes, proctime = totals->proctime;
+
+    previous = self->previous ? g_hash_table_lookup (self->previous, GSIZE_TO_POINTER (totals->link->id)) : NULL;
+    if (previous) {
+      buffers -= previous->buffers;
+      bytes -= previous->bytes;
+      proctime -= previous->proctime;
+    }
+
+    gst_tracer_record_log (tr_flowstats, totals->link->src, totals->link->sink, buffers,
+        elapsed > 0 ? (gdouble) buffers * GST_SECOND / elapsed : 0.0,
+        elapsed > 0 ? (gdouble) bytes * GST_SECOND / elapsed : 0.0,
+        buffers > 0 ? proctime / buffers : (guint64) 0, totals->procmax,
+        totals->levelbuffers, totals->levelbytes, totals->leveltime);
+  }
+
+  if (self->previous) {
+    g_hash_table_unref (self->previous);
+  }
+  self->previous = current;
+  self->lastDump = ts;
+  STAT_STORE (self->nextDump, ts + self->period);
+  g_atomic_int_inc (&self->epoch);
+}
+
+/* GObject */
+static void
+gst_flow_stats_tracer_class_init (GstFlowStatsTracerClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->constructed = gst_flow_stats_tracer_constructed;
+  gobject_class->finalize = gst_flow_stats_tracer_finalize;
+
+  tr_flowstats = gst_tracer_record_new ("flowstats.class",
+      "src", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_PAD,
+          NULL),
+      "sink", GST_TYPE_STRUCTURE, gst_structure_new ("scope",
+          "type", G_TYPE_GTYPE, G_TYPE_STRING,
+          "related", GST_TYPE_TRACER_VALUE_SCOPE, GST_TRACER_VALUE_SCOPE_PAD,
+          NULL),
+      "buffers", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Buffers that went through the link since the previous record",
+          NULL),
+      "rate", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_DOUBLE,
+          "description", G_TYPE_STRING, "Buffers per second",
+          NULL),
+      "bytes-per-second", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_DOUBLE,
+          "description", G_TYPE_STRING, "Bytes per second",
+          NULL),
+      "proc-mean", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Average time the downstream element spent processing a buffer in ns",
+          NULL),
+      "proc-max", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Longest time the downstream element spent processing a buffer in ns",
+          NULL),
+      "queue-buffers", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT,
+          "description", G_TYPE_STRING, "Buffers in the downstream queue (0 if it's not a queue)",
+          NULL),
+      "queue-bytes", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT,
+          "description", G_TYPE_STRING, "Bytes in the downstream queue (0 if it's not a queue)",
+          NULL),
+      "queue-time", GST_TYPE_STRUCTURE, gst_structure_new ("value",
+          "type", G_TYPE_GTYPE, G_TYPE_UINT64,
+          "description", G_TYPE_STRING, "Amount of data in the downstream queue in ns (0 if it's not a queue)",
+          NULL),
+      NULL);
+#if GST_CHECK_VERSION(1, 10, 0)
+  GST_OBJECT_FLAG_SET (tr_flowstats, GST_OBJECT_FLAG_MAY_BE_LEAKED);
+#endif
+}
+
+static void
+gst_flow_stats_tracer_init (GstFlowStatsTracer * self)
+{
+  GstTracer *tracer = GST_TRACER (self);
+
+  // The hooks get the time since gst_init(), which is before any tracer is created
+  self->period = GST_SECOND;
+  self->lastDump = 0;
+  self->nextDump = self->period;
+  self->lastTs = 0;
+  self->epoch = 0;
+  self->threads = NULL;
+  self->previous = NULL;
+  self->retired = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  g_mutex_init (&self->dumpLock);
+
+  gst_tracing_register_hook (tracer, "pad-push-pre", G_CALLBACK (do_push_buffer_pre));
+  gst_tracing_register_hook (tracer, "pad-push-list-pre", G_CALLBACK (do_push_buffer_list_pre));
+  gst_tracing_register_hook (tracer, "pad-push-post", G_CALLBACK (do_push_buffer_post));
+  gst_tracing_register_hook (tracer, "pad-push-list-post", G_CALLBACK (do_push_buffer_post));
+  gst_tracing_register_hook (tracer, "pad-pull-range-pre", G_CALLBACK (do_pull_range_pre));
+  gst_tracing_register_hook (tracer, "pad-pull-range-post", G_CALLBACK (do_pull_range_post));
+}
+
+static void
+gst_flow_stats_tracer_constructed (GObject * object)
+{
+  GstFlowStatsTracer *self = GST_FLOWSTATS_TRACER (object);
+  GstStructure *params = NULL;
+  gchar *paramString = NULL, *tmp;
+  gint period;
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  // Parameters are passed as GST_TRACERS="flowstats(period=500)"
+  g_object_get (self, "params", &paramString, NULL);
+  if (paramString) {
+    tmp = g_strdup_printf ("flowstats,%s", paramString);
+    params = gst_structure_from_string (tmp, NULL);
+    g_free (tmp);
+    g_free (paramString);
+  }
+
+  if (params) {
+    if (gst_structure_get_int (params, "period", &period) && period > 0) {
+      self->period = period * GST_MSECOND;
+      self->nextDump = self->lastDump + self->period;
+    }
+    gst_structure_free (params);
+  }
+
+  GST_INFO_OBJECT (self, "Dumping flow statistics every %" GST_TIME_FORMAT, GST_TIME_ARGS (self->period));
+}
+
+static void
+gst_flow_stats_tracer_finalize (GObject * object)
+{
+  GstFlowStatsTracer *self = GST_FLOWSTATS_TRACER (object);
+  GstFlowStatsThread *thread, *next;
+
+  // GST_TRACER_TS isn't public, so the last record covers the time up to the last buffer we saw
+  g_mutex_lock (&self->dumpLock);
+  flow_stats_dump (self, MAX (STAT_LOAD (self->lastTs), self->lastDump));
+  g_mutex_unlock (&self->dumpLock);
+
+  // Tracers are only finalized in gst_deinit(), when no streaming threads are left to push buffers. Threads that
+  // are still alive free their own record when they exit.
+  G_LOCK (flow_stats_exit);
+  for (thread = g_atomic_pointer_get (&self->threads); thread; thread = next) {
+    next = thread->next;
+    if (thread == g_private_get (&thread_stats)) {
+      g_private_set (&thread_stats, NULL);
+      g_free (thread);
+    } else {
+      thread->tracer = NULL;
+    }
+  }
+  self->threads = NULL;
+  G_UNLOCK (flow_stats_exit);
+  g_hash_table_unref (self->previous);
+  g_hash_table_unref (self->retired);
+  g_mutex_clear (&self->dumpLock);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gboolean
+plugin_init (GstPlugin * plugin)
+{
+  GST_DEBUG_CATEGORY_INIT (gst_flow_stats_debug, "flowstats", 0, "flowstats tracer");
+  pad_id_quark = g_quark_from_static_string ("flowstats-pad-id");
+
+  return gst_tracer_register (plugin, "flowstats", GST_TYPE_FLOWSTATS_TRACER);
+}
+
+/* GStreamer version definitions. */
+#ifndef VERSION
+#define VERSION "1.1.0"
+#endif
+#ifndef PACKAGE
+#define PACKAGE "gstpylon"
+#endif
+#ifndef PACKAGE_NAME
+#define PACKAGE_NAME "gstpylon"
+#endif
+#ifndef GST_PACKAGE_ORIGIN
+#define GST_PACKAGE_ORIGIN "http://www.playgineering.com/"
+#endif
+
+GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
+    GST_VERSION_MINOR,
+    flowstats,
+    "A tracer that measures buffer rates, processing times and queue levels of every link in a pipeline.",
+    plugin_init, VERSION, "LGPL", PACKAGE_NAME, GST_PACKAGE_ORIGIN);
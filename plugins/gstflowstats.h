@@ -0,0 +1,65 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_FLOWSTATS_H_
+#define _GST_FLOWSTATS_H_
+
+#ifndef GST_USE_UNSTABLE_API
+#define GST_USE_UNSTABLE_API // The tracer API is marked unstable
+#endif
+
+#include <gst/gst.h>
+#include <gst/gsttracer.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_FLOWSTATS_TRACER   (gst_flow_stats_tracer_get_type())
+#define GST_FLOWSTATS_TRACER(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_FLOWSTATS_TRACER,GstFlowStatsTracer))
+#define GST_FLOWSTATS_TRACER_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_FLOWSTATS_TRACER,GstFlowStatsTracerClass))
+#define GST_IS_FLOWSTATS_TRACER(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_FLOWSTATS_TRACER))
+#define GST_IS_FLOWSTATS_TRACER_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_FLOWSTATS_TRACER))
+
+typedef struct _GstFlowStatsTracer GstFlowStatsTracer;
+typedef struct _GstFlowStatsTracerClass GstFlowStatsTracerClass;
+typedef struct _GstFlowStatsThread GstFlowStatsThread;
+
+struct _GstFlowStatsTracer
+{
+  GstTracer parent;
+
+  GstClockTime period; // Time between dumps.
+  GstClockTime nextDump, lastDump; // Only touched by the thread holding dumpLock, read atomically by the others.
+  GstClockTime lastTs; // Latest time a hook was called at, used for the final dump.
+  guint epoch; // Incremented on every dump, tells the threads to restart their per period maximums.
+  GstFlowStatsThread *threads; // Lock free list of per thread counters, new threads are prepended.
+  GMutex dumpLock;
+  GHashTable *previous; // Totals as of the previous dump, keyed by source pad id.
+  GHashTable *retired; // Counters of the links threads that have exited pushed through, keyed by source pad id. Protected by dumpLock.
+};
+
+struct _GstFlowStatsTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+GType gst_flow_stats_tracer_get_type (void);
+
+G_END_DECLS
+
+#endif
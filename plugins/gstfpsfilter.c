@@ -45,6 +45,20 @@
  *
  * A gstreamer element that calculates the FPS value of the stream.
  *
+ * Frame intervals are taken from the buffer timestamps (or the time the buffers
+ * arrive at the element, if they have none) and kept in a rolling window. Every
+ * reporttime milliseconds the element updates its read only statistics
+ * properties and posts an element message named "fpsfilter" containing the
+ * same fields (fps, mininterval, maxinterval, meaninterval, p50interval,
+ * p99interval and jitter, with the intervals in nanoseconds).
+ *
+ * Frames coming from pylonsrc carry the time their exposure started. For those
+ * the element also measures the latency from the start of the exposure until
+ * the frame reaches it, and adds minlatency, maxlatency, meanlatency,
+ * p50latency, p99latency and a histogram of the latencies during the report
+ * period (latencybuckets holds the upper bound of each bin in nanoseconds,
+ * latencyhistogram the number of frames in it) to the reports.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -58,8 +72,11 @@
 #endif
 
 #include <gst/gst.h>
+#include <math.h>
+#include <string.h>
 
 #include "gstfpsfilter.h"
+#include "gstpylonmeta.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_fps_filter_debug);
 #define GST_CAT_DEFAULT gst_fps_filter_debug
@@ -75,9 +92,28 @@ enum
 enum
 {
   PROP_0,
-  PROP_REPORTTIME
+  PROP_REPORTTIME,
+  PROP_WINDOW,
+  PROP_USEPTS,
+  PROP_POSTMESSAGES,
+  PROP_FPS,
+  PROP_MININTERVAL,
+  PROP_MAXINTERVAL,
+  PROP_MEANINTERVAL,
+  PROP_P50INTERVAL,
+  PROP_P99INTERVAL,
+  PROP_JITTER,
+  PROP_MINLATENCY,
+  PROP_MAXLATENCY,
+  PROP_MEANLATENCY,
+  PROP_P50LATENCY,
+  PROP_P99LATENCY,
+  PROP_LATENCYHISTOGRAM
 };
 
+#define DEFAULT_WINDOW 120
+#define MAX_WINDOW 100000
+
 /* the capabilities of the inputs and outputs.
  *
  * describe the real formats here.
@@ -101,6 +137,8 @@ static void gst_fps_filter_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec);
 static void gst_fps_filter_get_property (GObject * object, guint prop_id,
     GValue * value, GParamSpec * pspec);
+static void gst_fps_filter_finalize (GObject * object);
+static GstStateChangeReturn gst_fps_filter_change_state (GstElement * element, GstStateChange transition);
 
 static gboolean gst_fps_filter_sink_event (GstPad * pad, GstObject * parent, GstEvent * event);
 static GstFlowReturn gst_fps_filter_chain (GstPad * pad, GstObject * parent, GstBuffer * buf);
@@ -119,6 +157,8 @@ gst_fps_filter_class_init (GstFpsFilterClass * klass)
 
   gobject_class->set_property = gst_fps_filter_set_property;
   gobject_class->get_property = gst_fps_filter_get_property;
+  gobject_class->finalize = gst_fps_filter_finalize;
+  gstelement_class->change_state = GST_DEBUG_FUNCPTR (gst_fps_filter_change_state);
 
   gst_element_class_set_details_simple(gstelement_class,
     "FPS counter",
@@ -135,6 +175,116 @@ gst_fps_filter_class_init (GstFpsFilterClass * klass)
       g_param_spec_uint64("reporttime", "reporttime", "(Number) Time between fps reports in miliseconds (default - 1000)",
           0, G_MAXUINT64, 1000,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_WINDOW,
+      g_param_spec_uint("window", "window", "(Number) Number of most recent frame intervals the statistics are calculated from (default - 120)",
+          1, MAX_WINDOW, DEFAULT_WINDOW,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_USEPTS,
+      g_param_spec_boolean("usepts", "usepts", "(true/false) Measure frame intervals using buffer timestamps. If disabled, or if the buffers have no timestamps, the time the buffers arrive at this element is used instead (default - true)",
+          TRUE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_POSTMESSAGES,
+      g_param_spec_boolean("postmessages", "postmessages", "(true/false) Post an element message with the statistics on the bus every reporttime miliseconds (default - true)",
+          TRUE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_FPS,
+      g_param_spec_double("fps", "fps", "(Read only) Framerate during the last report period",
+          0.0, G_MAXDOUBLE, 0.0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MININTERVAL,
+      g_param_spec_uint64("mininterval", "mininterval", "(Read only) Shortest frame interval in the window, in nanoseconds",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MAXINTERVAL,
+      g_param_spec_uint64("maxinterval", "maxinterval", "(Read only) Longest frame interval in the window, in nanoseconds",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MEANINTERVAL,
+      g_param_spec_uint64("meaninterval", "meaninterval", "(Read only) Average frame interval in the window, in nanoseconds",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_P50INTERVAL,
+      g_param_spec_uint64("p50interval", "p50interval", "(Read only) Median frame interval in the window, in nanoseconds",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_P99INTERVAL,
+      g_param_spec_uint64("p99interval", "p99interval", "(Read only) 99th percentile of the frame intervals in the window, in nanoseconds",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_JITTER,
+      g_param_spec_uint64("jitter", "jitter", "(Read only) Standard deviation of the frame intervals in the window, in nanoseconds",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MINLATENCY,
+      g_param_spec_uint64("minlatency", "minlatency", "(Read only) Lowest latency from the start of the exposure in the window, in nanoseconds. Only measured for frames from pylonsrc",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MAXLATENCY,
+      g_param_spec_uint64("maxlatency", "maxlatency", "(Read only) Highest latency from the start of the exposure in the window, in nanoseconds. Only measured for frames from pylonsrc",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_MEANLATENCY,
+      g_param_spec_uint64("meanlatency", "meanlatency", "(Read only) Average latency from the start of the exposure in the window, in nanoseconds. Only measured for frames from pylonsrc",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_P50LATENCY,
+      g_param_spec_uint64("p50latency", "p50latency", "(Read only) Median latency from the start of the exposure in the window, in nanoseconds. Only measured for frames from pylonsrc",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_P99LATENCY,
+      g_param_spec_uint64("p99latency", "p99latency", "(Read only) 99th percentile of the latencies from the start of the exposure in the window, in nanoseconds. Only measured for frames from pylonsrc",
+          0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property(gobject_class, PROP_LATENCYHISTOGRAM,
+      g_param_spec_boxed("latencyhistogram", "latencyhistogram", "(Read only) Histogram of the latencies during the last report period. Contains the latencybuckets (upper bound of each bin in nanoseconds) and latencyhistogram (frames in each bin) arrays",
+          GST_TYPE_STRUCTURE,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+}
+
+/* Forget the previous frame, so that the next interval isn't measured across a pause or a flush */
+static void
+gst_fps_filter_restart (GstFpsFilter * filter)
+{
+  filter->frames = 0;
+  filter->elapsedtime = 0;
+  filter->lastframetime = GST_CLOCK_TIME_NONE;
+  filter->lastpts = GST_CLOCK_TIME_NONE;
+}
+
+/* Drop all collected intervals and statistics */
+static void
+gst_fps_filter_reset (GstFpsFilter * filter)
+{
+  gst_fps_filter_restart(filter);
+  filter->filled = 0;
+  filter->next = 0;
+  filter->fps = 0.0;
+  filter->mininterval = 0;
+  filter->maxinterval = 0;
+  filter->meaninterval = 0;
+  filter->p50interval = 0;
+  filter->p99interval = 0;
+  filter->jitter = 0;
+  filter->latencyfilled = 0;
+  filter->latencynext = 0;
+  filter->minlatency = 0;
+  filter->maxlatency = 0;
+  filter->meanlatency = 0;
+  filter->p50latency = 0;
+  filter->p99latency = 0;
+  memset(filter->histogram, 0, sizeof(filter->histogram));
+  memset(filter->reportedhistogram, 0, sizeof(filter->reportedhistogram));
+}
+
+/* (Re)allocates the interval window. Must be called with the object lock held. */
+static void
+gst_fps_filter_alloc_window (GstFpsFilter * filter, guint window)
+{
+  filter->intervals = g_renew(GstClockTime, filter->intervals, window);
+  filter->latencies = g_renew(GstClockTime, filter->latencies, window);
+  filter->scratch = g_renew(GstClockTime, filter->scratch, window);
+  filter->window = window;
+  gst_fps_filter_reset(filter);
 }
 
 /* initialize the new element
@@ -157,10 +307,47 @@ gst_fps_filter_init (GstFpsFilter * filter)
   GST_PAD_SET_PROXY_CAPS (filter->srcpad);
   gst_element_add_pad (GST_ELEMENT (filter), filter->srcpad);
 
-  filter->frames = 0;
-  filter->lastframetime = 0;
-  filter->elapsedtime = 0;
   filter->reporttime = 1000;
+  filter->usepts = TRUE;
+  filter->postmessages = TRUE;
+  filter->intervals = NULL;
+  filter->latencies = NULL;
+  filter->scratch = NULL;
+  gst_fps_filter_alloc_window(filter, DEFAULT_WINDOW);
+}
+
+static void
+gst_fps_filter_finalize (GObject * object)
+{
+  GstFpsFilter *filter = GST_FPSFILTER (object);
+
+  g_free(filter->intervals);
+  g_free(filter->latencies);
+  g_free(filter->scratch);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* Adds the latencybuckets and latencyhistogram arrays to the structure */
+static void
+gst_fps_filter_add_histogram (GstStructure * structure, const guint64 * histogram)
+{
+  GValue buckets = G_VALUE_INIT, counts = G_VALUE_INIT, item = G_VALUE_INIT;
+  guint i;
+
+  g_value_init(&buckets, GST_TYPE_ARRAY);
+  g_value_init(&counts, GST_TYPE_ARRAY);
+  g_value_init(&item, G_TYPE_UINT64);
+  for(i = 0; i < FPSFILTER_HISTOGRAM_BINS; i++) {
+    g_value_set_uint64(&item, i < FPSFILTER_HISTOGRAM_BINS - 1 ? (G_GUINT64_CONSTANT(1) << i) * GST_MSECOND : G_MAXUINT64);
+    gst_value_array_append_value(&buckets, &item);
+    g_value_set_uint64(&item, histogram[i]);
+    gst_value_array_append_value(&counts, &item);
+  }
+  g_value_unset(&item);
+
+  gst_structure_take_value(structure, "latencybuckets", &buckets);
+  gst_structure_take_value(structure, "latencyhistogram", &counts);
 }
 
 static void
@@ -169,14 +356,27 @@ gst_fps_filter_set_property (GObject * object, guint prop_id,
 {
   GstFpsFilter *filter = GST_FPSFILTER (object);
 
+  GST_OBJECT_LOCK(filter);
   switch (prop_id) {
     case PROP_REPORTTIME:
       filter->reporttime = g_value_get_uint64(value);
       break;
+    case PROP_WINDOW:
+      if(g_value_get_uint(value) != filter->window) {
+        gst_fps_filter_alloc_window(filter, g_value_get_uint(value));
+      }
+      break;
+    case PROP_USEPTS:
+      filter->usepts = g_value_get_boolean(value);
+      break;
+    case PROP_POSTMESSAGES:
+      filter->postmessages = g_value_get_boolean(value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK(filter);
 }
 
 static void
@@ -185,14 +385,91 @@ gst_fps_filter_get_property (GObject * object, guint prop_id,
 {
   GstFpsFilter *filter = GST_FPSFILTER (object);
 
+  GST_OBJECT_LOCK(filter);
   switch (prop_id) {
     case PROP_REPORTTIME:
       g_value_set_uint64(value, filter->reporttime);
       break;
+    case PROP_WINDOW:
+      g_value_set_uint(value, filter->window);
+      break;
+    case PROP_USEPTS:
+      g_value_set_boolean(value, filter->usepts);
+      break;
+    case PROP_POSTMESSAGES:
+      g_value_set_boolean(value, filter->postmessages);
+      break;
+    case PROP_FPS:
+      g_value_set_double(value, filter->fps);
+      break;
+    case PROP_MININTERVAL:
+      g_value_set_uint64(value, filter->mininterval);
+      break;
+    case PROP_MAXINTERVAL:
+      g_value_set_uint64(value, filter->maxinterval);
+      break;
+    case PROP_MEANINTERVAL:
+      g_value_set_uint64(value, filter->meaninterval);
+      break;
+    case PROP_P50INTERVAL:
+      g_value_set_uint64(value, filter->p50interval);
+      break;
+    case PROP_P99INTERVAL:
+      g_value_set_uint64(value, filter->p99interval);
+      break;
+    case PROP_JITTER:
+      g_value_set_uint64(value, filter->jitter);
+      break;
+    case PROP_MINLATENCY:
+      g_value_set_uint64(value, filter->minlatency);
+      break;
+    case PROP_MAXLATENCY:
+      g_value_set_uint64(value, filter->maxlatency);
+      break;
+    case PROP_MEANLATENCY:
+      g_value_set_uint64(value, filter->meanlatency);
+      break;
+    case PROP_P50LATENCY:
+      g_value_set_uint64(value, filter->p50latency);
+      break;
+    case PROP_P99LATENCY:
+      g_value_set_uint64(value, filter->p99latency);
+      break;
+    case PROP_LATENCYHISTOGRAM:
+    {
+      GstStructure *histogram = gst_structure_new_empty("latencyhistogram");
+      gst_fps_filter_add_histogram(histogram, filter->reportedhistogram);
+      g_value_take_boxed(value, histogram);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  GST_OBJECT_UNLOCK(filter);
+}
+
+static GstStateChangeReturn
+gst_fps_filter_change_state (GstElement * element, GstStateChange transition)
+{
+  GstFpsFilter *filter = GST_FPSFILTER (element);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      GST_OBJECT_LOCK(filter);
+      gst_fps_filter_reset(filter);
+      GST_OBJECT_UNLOCK(filter);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      GST_OBJECT_LOCK(filter);
+      gst_fps_filter_restart(filter);
+      GST_OBJECT_UNLOCK(filter);
+      break;
+    default:
+      break;
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
 }
 
 /* GstElement vmethod implementations */
@@ -221,6 +498,12 @@ gst_fps_filter_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
       ret = gst_pad_event_default (pad, parent, event);
       break;
     }
+    case GST_EVENT_FLUSH_STOP:
+      GST_OBJECT_LOCK(filter);
+      gst_fps_filter_restart(filter);
+      GST_OBJECT_UNLOCK(filter);
+      ret = gst_pad_event_default (pad, parent, event);
+      break;
     default:
       ret = gst_pad_event_default (pad, parent, event);
       break;
@@ -228,6 +511,93 @@ gst_fps_filter_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return ret;
 }
 
+/* Moves the k-th smallest of the values to values[k], with smaller ones before it and larger ones after it.
+ * Works in place, so that the percentiles can be found without allocating anything. */
+static GstClockTime
+gst_fps_filter_select (GstClockTime * values, guint n, guint k)
+{
+  guint left = 0, right = n - 1;
+
+  while(left < right) {
+    GstClockTime pivot = values[left + (right - left) / 2];
+    guint i = left, j = right;
+
+    while(i <= j) {
+      while(values[i] < pivot) i++;
+      while(values[j] > pivot) j--;
+      if(i <= j) {
+        GstClockTime tmp = values[i];
+        values[i] = values[j];
+        values[j] = tmp;
+        i++;
+        if(j == 0) break;
+        j--;
+      }
+    }
+
+    if(k <= j) {
+      right = j;
+    } else if(k >= i) {
+      left = i;
+    } else {
+      break;
+    }
+  }
+
+  return values[k];
+}
+
+/* Calculates the statistics of n values, using scratch (which must fit n values) to find the percentiles */
+static void
+gst_fps_filter_calculate (const GstClockTime * values, guint n, GstClockTime * scratch, GstClockTime * min, GstClockTime * max,
+    GstClockTime * mean, GstClockTime * p50, GstClockTime * p99, GstClockTime * deviation)
+{
+  guint i, p50index, p99index;
+  gdouble sum = 0.0, average, variance = 0.0;
+
+  *min = G_MAXUINT64;
+  *max = 0;
+  for(i = 0; i < n; i++) {
+    *min = MIN(*min, values[i]);
+    *max = MAX(*max, values[i]);
+    sum += values[i];
+    scratch[i] = values[i];
+  }
+  average = sum / n;
+  for(i = 0; i < n; i++) {
+    gdouble diff = values[i] - average;
+    variance += diff * diff;
+  }
+
+  // p99 is searched for only in the upper part of the array that's left after finding p50
+  p50index = (n - 1) * 50 / 100;
+  p99index = (n - 1) * 99 / 100;
+  *p50 = gst_fps_filter_select(scratch, n, p50index);
+  *p99 = gst_fps_filter_select(scratch + p50index, n - p50index, p99index - p50index);
+
+  *mean = (GstClockTime) (average + 0.5);
+  *deviation = (GstClockTime) (sqrt(variance / n) + 0.5);
+}
+
+/* Recalculates the statistics from the current windows. Must be called with the object lock held. */
+static void
+gst_fps_filter_update_stats (GstFpsFilter * filter)
+{
+  GstClockTime deviation;
+
+  gst_fps_filter_calculate(filter->intervals, filter->filled, filter->scratch, &filter->mininterval, &filter->maxinterval,
+    &filter->meaninterval, &filter->p50interval, &filter->p99interval, &filter->jitter);
+  filter->fps = filter->elapsedtime > 0 ? (gdouble) filter->frames * GST_SECOND / filter->elapsedtime : 0.0;
+
+  if(filter->latencyfilled > 0) {
+    gst_fps_filter_calculate(filter->latencies, filter->latencyfilled, filter->scratch, &filter->minlatency, &filter->maxlatency,
+      &filter->meanlatency, &filter->p50latency, &filter->p99latency, &deviation);
+  }
+
+  memcpy(filter->reportedhistogram, filter->histogram, sizeof(filter->histogram));
+  memset(filter->histogram, 0, sizeof(filter->histogram));
+}
+
 /* chain function
  * this function does the actual processing
  */
@@ -235,31 +605,97 @@ static GstFlowReturn
 gst_fps_filter_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
 {
   GstFpsFilter *filter;
+  GstMessage *message = NULL;
   filter = GST_FPSFILTER (parent);
 
   if(GST_STATE(filter) == GST_STATE_PLAYING) {
-    filter->frames = filter->frames + 1;
-    #pragma GCC diagnostic ignored "-Wincompatible-pointer-types"
-    gint64 time = GST_TIME_AS_MSECONDS(gst_clock_get_time(gst_element_get_clock(filter)));
-    #pragma GCC diagnostic pop
-    filter->elapsedtime = filter->elapsedtime + (time-filter->lastframetime);
-
-    if(filter->elapsedtime >= filter->reporttime) {
-      int64_t frames = filter->frames;
-      int64_t elapsedtime = filter->elapsedtime;
-      
-      if(filter->elapsedtime != filter->reporttime) { //Most of the time our frame won't tick right on the dot. In those cases we're already processing a frame in the next cycle.
-        frames=frames-1;
-        elapsedtime = filter->elapsedtime-filter->elapsedtime%filter->reporttime;
+    GstClockTime now = gst_util_get_timestamp();
+    GstClockTime pts = GST_BUFFER_PTS(buf);
+    GstPylonMeta *meta;
+
+    GST_OBJECT_LOCK(filter);
+    if(GST_CLOCK_TIME_IS_VALID(filter->lastframetime)) {
+      GstClockTime interval = now - filter->lastframetime;
+
+      if(filter->usepts && GST_CLOCK_TIME_IS_VALID(pts) && GST_CLOCK_TIME_IS_VALID(filter->lastpts) && pts >= filter->lastpts) {
+        interval = pts - filter->lastpts;
       }
 
-      GST_MESSAGE_OBJECT(filter, "FPS: %.0f (Calculated time per frame: %.1fms)", frames/((float)elapsedtime/1000), (float)elapsedtime/frames);
+      filter->intervals[filter->next] = interval;
+      filter->next = (filter->next + 1) % filter->window;
+      if(filter->filled < filter->window) {
+        filter->filled++;
+      }
 
-      filter->frames = filter->frames-frames;
-      filter->elapsedtime = filter->elapsedtime-elapsedtime; //Carry over the extra time spent on the previous frame.
+      filter->frames = filter->frames + 1;
+      filter->elapsedtime = filter->elapsedtime + (now - filter->lastframetime);
     }
+    filter->lastframetime = now;
+    filter->lastpts = pts;
+
+    // Measure the latency of frames that carry their capture time
+    meta = gst_buffer_get_pylon_meta(buf);
+    if(meta && GST_ELEMENT_CLOCK(filter)) {
+      GstClockTime captured = GST_CLOCK_TIME_IS_VALID(meta->exposurestart) ? meta->exposurestart : meta->grabtime;
+      GstClockTime clocktime = gst_clock_get_time(GST_ELEMENT_CLOCK(filter));
+
+      if(GST_CLOCK_TIME_IS_VALID(captured) && clocktime >= captured) {
+        GstClockTime latency = clocktime - captured;
+        guint64 ms = latency / GST_MSECOND;
+        guint bin = ms == 0 ? 0 : MIN(g_bit_storage(ms), FPSFILTER_HISTOGRAM_BINS - 1);
+
+        filter->latencies[filter->latencynext] = latency;
+        filter->latencynext = (filter->latencynext + 1) % filter->window;
+        if(filter->latencyfilled < filter->window) {
+          filter->latencyfilled++;
+        }
+        filter->histogram[bin]++;
+      }
+    }
+
+    if(filter->frames > 0 && filter->elapsedtime >= filter->reporttime * GST_MSECOND) {
+      gst_fps_filter_update_stats(filter);
 
-    filter->lastframetime = time;
+      GST_MESSAGE_OBJECT(filter, "FPS: %.1f (Frame interval min/mean/p50/p99/max: %.3f/%.3f/%.3f/%.3f/%.3fms, jitter: %.3fms)", filter->fps,
+        (gdouble) filter->mininterval / GST_MSECOND, (gdouble) filter->meaninterval / GST_MSECOND, (gdouble) filter->p50interval / GST_MSECOND,
+        (gdouble) filter->p99interval / GST_MSECOND, (gdouble) filter->maxinterval / GST_MSECOND, (gdouble) filter->jitter / GST_MSECOND);
+      if(filter->latencyfilled > 0) {
+        GST_MESSAGE_OBJECT(filter, "Latency since exposure min/mean/p50/p99/max: %.3f/%.3f/%.3f/%.3f/%.3fms",
+          (gdouble) filter->minlatency / GST_MSECOND, (gdouble) filter->meanlatency / GST_MSECOND, (gdouble) filter->p50latency / GST_MSECOND,
+          (gdouble) filter->p99latency / GST_MSECOND, (gdouble) filter->maxlatency / GST_MSECOND);
+      }
+
+      if(filter->postmessages) {
+        GstStructure *structure = gst_structure_new("fpsfilter",
+          "fps", G_TYPE_DOUBLE, filter->fps,
+          "mininterval", G_TYPE_UINT64, filter->mininterval,
+          "maxinterval", G_TYPE_UINT64, filter->maxinterval,
+          "meaninterval", G_TYPE_UINT64, filter->meaninterval,
+          "p50interval", G_TYPE_UINT64, filter->p50interval,
+          "p99interval", G_TYPE_UINT64, filter->p99interval,
+          "jitter", G_TYPE_UINT64, filter->jitter,
+          NULL);
+        if(filter->latencyfilled > 0) {
+          gst_structure_set(structure,
+            "minlatency", G_TYPE_UINT64, filter->minlatency,
+            "maxlatency", G_TYPE_UINT64, filter->maxlatency,
+            "meanlatency", G_TYPE_UINT64, filter->meanlatency,
+            "p50latency", G_TYPE_UINT64, filter->p50latency,
+            "p99latency", G_TYPE_UINT64, filter->p99latency,
+            NULL);
+          gst_fps_filter_add_histogram(structure, filter->reportedhistogram);
+        }
+        message = gst_message_new_element(GST_OBJECT(filter), structure);
+      }
+
+      filter->frames = 0;
+      filter->elapsedtime = 0;
+    }
+    GST_OBJECT_UNLOCK(filter);
+
+    if(message) {
+      gst_element_post_message(GST_ELEMENT(filter), message);
+    }
   }
 
   return gst_pad_push (filter->srcpad, buf);
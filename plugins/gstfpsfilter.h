@@ -63,6 +63,9 @@ G_BEGIN_DECLS
 #define GST_IS_FPSFILTER_CLASS(klass) \
   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_FPSFILTER))
 
+/* Latency histogram bin i counts latencies below 2^i ms, the last one counts everything else */
+#define FPSFILTER_HISTOGRAM_BINS 16
+
 typedef struct _GstFpsFilter      GstFpsFilter;
 typedef struct _GstFpsFilterClass GstFpsFilterClass;
 
@@ -71,6 +74,19 @@ struct _GstFpsFilter
   GstElement element;
   guint64 frames, lastframetime, elapsedtime, reporttime;
   GstPad *sinkpad, *srcpad;
+
+  /* Rolling windows of frame intervals and capture latencies (ns), and a scratch copy used to find the percentiles */
+  GstClockTime *intervals, *latencies, *scratch;
+  guint window, filled, next, latencyfilled, latencynext;
+  GstClockTime lastpts;
+  gboolean usepts, postmessages;
+  guint64 histogram[FPSFILTER_HISTOGRAM_BINS]; // Latencies seen during the current report period
+
+  /* Statistics as of the last report */
+  gdouble fps;
+  GstClockTime mininterval, maxinterval, meaninterval, p50interval, p99interval, jitter;
+  GstClockTime minlatency, maxlatency, meanlatency, p50latency, p99latency;
+  guint64 reportedhistogram[FPSFILTER_HISTOGRAM_BINS];
 };
 
 struct _GstFpsFilterClass 
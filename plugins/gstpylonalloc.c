@@ -0,0 +1,356 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Allocation of the buffers the camera grabs frames into.
+ *
+ * The buffers are mapped directly instead of coming from malloc, so that they
+ * can be backed by huge pages, locked into memory, placed on the NUMA node
+ * of the USB controller the camera is attached to, and backed by a memfd that
+ * other processes can map. Every step falls back to
+ * the next best thing when the system doesn't allow it, and the result is
+ * recorded in the GstPylonGrabMemory. The pages are touched once while
+ * allocating, so that grabbing doesn't page fault on them later.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylonalloc.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+GST_DEBUG_CATEGORY_STATIC (gst_pylon_alloc_debug_category);
+#define GST_CAT_DEFAULT gst_pylon_alloc_debug_category
+
+// Linux's mbind() policy, defined here to not depend on libnuma for a single syscall
+#define PYLON_MPOL_PREFERRED 1
+
+// Basler's USB vendor id
+#define BASLER_USB_VENDOR "2676"
+
+#define DEFAULT_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static gsize
+gst_pylon_page_size (void)
+{
+  static gsize pageSize = 0;
+
+  if(pageSize == 0) {
+    pageSize = (gsize) sysconf(_SC_PAGESIZE);
+  }
+  return pageSize;
+}
+
+/* Size of the pages MAP_HUGETLB gives out */
+static gsize
+gst_pylon_huge_page_size (void)
+{
+  gchar *meminfo = NULL, *line;
+  gsize size = DEFAULT_HUGE_PAGE_SIZE;
+
+  if(g_file_get_contents("/proc/meminfo", &meminfo, NULL, NULL)) {
+    line = strstr(meminfo, "Hugepagesize:");
+    if(line) {
+      size = g_ascii_strtoull(line + strlen("Hugepagesize:"), NULL, 10) * 1024;
+    }
+    g_free(meminfo);
+  }
+  return size > 0 ? size : DEFAULT_HUGE_PAGE_SIZE;
+}
+
+/* Size of a transparent huge page, which the mapping has to be aligned to */
+static gsize
+gst_pylon_transparent_page_size (void)
+{
+  gchar *contents = NULL;
+  gsize size = DEFAULT_HUGE_PAGE_SIZE;
+
+  if(g_file_get_contents("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &contents, NULL, NULL)) {
+    size = g_ascii_strtoull(contents, NULL, 10);
+    g_free(contents);
+  }
+  return size > 0 ? size : DEFAULT_HUGE_PAGE_SIZE;
+}
+
+/* Maps size bytes (of fd, or anonymous memory if it's -1) aligned to alignment by reserving more and unmapping the excess on both ends */
+static guint8 *
+gst_pylon_map_aligned (gsize size, gsize alignment, gint fd)
+{
+  guint8 *mapping, *aligned;
+  gsize head;
+
+  mapping = mmap(NULL, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(mapping == MAP_FAILED) {
+    return NULL;
+  }
+
+  aligned = (guint8 *) (((guintptr) mapping + alignment - 1) & ~((guintptr) alignment - 1));
+  if(fd >= 0 && mmap(aligned, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(mapping, size + alignment);
+    return NULL;
+  }
+  head = aligned - mapping;
+  if(head > 0) {
+    munmap(mapping, head);
+  }
+  if(alignment - head > 0) {
+    munmap(aligned + size, alignment - head);
+  }
+  return aligned;
+}
+
+/* Closes the buffer's memfd. Other processes it was handed to (and GstFdMemory, which dup()s it) keep the memory alive. */
+static void
+gst_pylon_grab_memory_close (GstPylonGrabMemory * mem)
+{
+  if(mem->fd >= 0) {
+    close(mem->fd);
+    mem->fd = -1;
+  }
+}
+
+gboolean
+gst_pylon_grab_memory_alloc (GstPylonGrabMemory * mem, gsize size, const GstPylonAllocParams * params)
+{
+  static gsize debugInitialised = 0;
+  gsize pageSize;
+
+  if(g_once_init_enter(&debugInitialised)) {
+    GST_DEBUG_CATEGORY_INIT (gst_pylon_alloc_debug_category, "pylonalloc", 0, "grab buffer allocation");
+    g_once_init_leave(&debugInitialised, 1);
+  }
+
+  memset(mem, 0, sizeof(*mem));
+  mem->size = size;
+  mem->numaNode = -1;
+  mem->fd = -1;
+
+#ifdef MAP_HUGETLB
+  if(params->pages == GST_PYLON_PAGES_HUGE) {
+    pageSize = gst_pylon_huge_page_size();
+    mem->mapped = (size + pageSize - 1) / pageSize * pageSize;
+    if(params->shared) {
+      mem->fd = gst_pylon_memfd_create("pylongrab", TRUE);
+      if(mem->fd >= 0 && ftruncate(mem->fd, mem->mapped) == 0) {
+        mem->data = mmap(NULL, mem->mapped, PROT_READ | PROT_WRITE, MAP_SHARED, mem->fd, 0);
+      } else {
+        mem->data = MAP_FAILED;
+      }
+    } else {
+      mem->data = mmap(NULL, mem->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if(mem->data != MAP_FAILED) {
+      mem->pages = GST_PYLON_PAGES_HUGE;
+    } else {
+      GST_DEBUG("No huge pages left in the pool (%s), trying transparent huge pages.", g_strerror(errno));
+      mem->data = NULL;
+      gst_pylon_grab_memory_close(mem);
+    }
+  }
+#endif
+
+  if(!mem->data && params->shared) {
+    mem->fd = gst_pylon_memfd_create("pylongrab", FALSE);
+    if(mem->fd < 0) {
+      GST_DEBUG("Couldn't create a memfd (%s).", g_strerror(errno));
+      return FALSE;
+    }
+  }
+
+#ifdef MADV_HUGEPAGE
+  // For a memfd this depends on /sys/kernel/mm/transparent_hugepage/shmem_enabled
+  if(!mem->data && params->pages != GST_PYLON_PAGES_NORMAL) {
+    pageSize = gst_pylon_transparent_page_size();
+    mem->mapped = (size + pageSize - 1) / pageSize * pageSize;
+    if(mem->fd < 0 || ftruncate(mem->fd, mem->mapped) == 0) {
+      mem->data = gst_pylon_map_aligned(mem->mapped, pageSize, mem->fd);
+    }
+    if(mem->data) {
+      if(madvise(mem->data, mem->mapped, MADV_HUGEPAGE) == 0) {
+        mem->pages = GST_PYLON_PAGES_TRANSPARENT;
+      } else {
+        GST_DEBUG("Transparent huge pages aren't available (%s).", g_strerror(errno));
+      }
+    }
+  }
+#endif
+
+  if(!mem->data) {
+    pageSize = gst_pylon_page_size();
+    mem->mapped = (size + pageSize - 1) / pageSize * pageSize;
+    if(mem->fd >= 0) {
+      mem->data = ftruncate(mem->fd, mem->mapped) == 0 ? mmap(NULL, mem->mapped, PROT_READ | PROT_WRITE, MAP_SHARED, mem->fd, 0) : MAP_FAILED;
+    } else {
+      mem->data = mmap(NULL, mem->mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    if(mem->data == MAP_FAILED) {
+      mem->data = NULL;
+      gst_pylon_grab_memory_close(mem);
+      return FALSE;
+    }
+    mem->pages = GST_PYLON_PAGES_NORMAL;
+  }
+
+  // The node has to be chosen before the pages are touched for the first time
+#if defined(__linux__) && defined(SYS_mbind)
+  if(params->numaNode >= 0 && params->numaNode < (gint) (8 * sizeof(unsigned long))) {
+    unsigned long nodeMask = 1UL << params->numaNode;
+
+    if(syscall(SYS_mbind, mem->data, mem->mapped, PYLON_MPOL_PREFERRED, &nodeMask, 8 * sizeof(nodeMask), 0) == 0) {
+      mem->numaNode = params->numaNode;
+    } else {
+      GST_DEBUG("Couldn't bind the buffer to NUMA node %d (%s).", params->numaNode, g_strerror(errno));
+    }
+  }
+#endif
+
+  // Locking faults all of the pages in, otherwise touch them ourselves
+  if(params->lock) {
+    if(mlock(mem->data, mem->mapped) == 0) {
+      mem->locked = TRUE;
+    } else {
+      GST_DEBUG("Couldn't lock the buffer into memory (%s). Raising RLIMIT_MEMLOCK (ulimit -l) should help.", g_strerror(errno));
+    }
+  }
+  if(!mem->locked) {
+    memset(mem->data, 0, mem->mapped);
+  }
+
+  return TRUE;
+}
+
+void
+gst_pylon_grab_memory_free (GstPylonGrabMemory * mem)
+{
+  if(mem->data) {
+    if(mem->locked) {
+      munlock(mem->data, mem->mapped);
+    }
+    munmap(mem->data, mem->mapped);
+  }
+  gst_pylon_grab_memory_close(mem);
+  memset(mem, 0, sizeof(*mem));
+  mem->numaNode = -1;
+  mem->fd = -1;
+}
+
+const gchar *
+gst_pylon_pages_get_name (GstPylonPages pages)
+{
+  switch(pages) {
+    case GST_PYLON_PAGES_TRANSPARENT:
+      return "transparent";
+    case GST_PYLON_PAGES_HUGE:
+      return "huge";
+    default:
+      return "normal";
+  }
+}
+
+static gboolean
+gst_pylon_read_sysfs (const gchar * dir, const gchar * name, gchar ** value)
+{
+  gchar *path = g_build_filename(dir, name, NULL);
+  gboolean found = g_file_get_contents(path, value, NULL, NULL);
+
+  g_free(path);
+  if(found) {
+    g_strstrip(*value);
+  }
+  return found;
+}
+
+/* Looks a Basler camera up by its serial number among the USB devices in sysfs. Returns the resolved path of its device directory, or NULL if it isn't there. */
+gchar *
+gst_pylon_usb_device_path (const gchar * serial)
+{
+  const gchar *devices = "/sys/bus/usb/devices", *entry;
+  gchar *vendor, *deviceSerial, *path, *real, *found = NULL;
+  GDir *dir;
+
+  if(!serial || !*serial) {
+    return NULL;
+  }
+  dir = g_dir_open(devices, 0, NULL);
+  if(!dir) {
+    return NULL;
+  }
+
+  while(!found && (entry = g_dir_read_name(dir)) != NULL) {
+    path = g_build_filename(devices, entry, NULL);
+    if(gst_pylon_read_sysfs(path, "idVendor", &vendor)) {
+      if(g_ascii_strcasecmp(vendor, BASLER_USB_VENDOR) == 0 && gst_pylon_read_sysfs(path, "serial", &deviceSerial)) {
+        if(strcmp(deviceSerial, serial) == 0 && (real = realpath(path, NULL)) != NULL) {
+          found = g_strdup(real);
+          free(real);
+        }
+        g_free(deviceSerial);
+      }
+      g_free(vendor);
+    }
+    g_free(path);
+  }
+  g_dir_close(dir);
+
+  return found;
+}
+
+/* Finds the NUMA node of the USB controller a Basler camera is attached to, by walking up from the camera's sysfs directory to the first parent (normally the PCI device of the controller) that knows its node. Returns -1 if the node can't be determined. */
+gint
+gst_pylon_usb_numa_node (const gchar * serial)
+{
+  gchar *path, *value, *slash;
+  gint node = -1;
+
+  path = gst_pylon_usb_device_path(serial);
+  while(path && (slash = strrchr(path, '/')) != NULL && slash != path) {
+    if(gst_pylon_read_sysfs(path, "numa_node", &value)) {
+      node = (gint) g_ascii_strtoll(value, NULL, 10);
+      g_free(value);
+      break;
+    }
+    *slash = '\0';
+  }
+  g_free(path);
+
+  return node;
+}
+
+/* Creates an anonymous file (of huge pages if huge is set), whose memory can be mapped by other processes the file descriptor is passed to. Returns -1 on failure. */
+gint
+gst_pylon_memfd_create (const gchar * name, gboolean huge)
+{
+#if defined(HAVE_MEMFD_CREATE)
+  return memfd_create(name, MFD_CLOEXEC | (huge ? MFD_HUGETLB : 0));
+#elif defined(__linux__) && defined(SYS_memfd_create)
+  return (gint) syscall(SYS_memfd_create, name, 1 | (huge ? 4 : 0)); // MFD_CLOEXEC, MFD_HUGETLB
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
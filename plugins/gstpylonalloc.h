@@ -0,0 +1,62 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONALLOC_H_
+#define _GST_PYLONALLOC_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GST_PYLON_PAGES_NORMAL,
+  GST_PYLON_PAGES_TRANSPARENT, // Transparent huge pages, if the kernel has them enabled.
+  GST_PYLON_PAGES_HUGE // Pages from the hugetlbfs pool, falling back to transparent huge pages when the pool is empty.
+} GstPylonPages;
+
+/* How the grab buffers should be allocated */
+typedef struct _GstPylonAllocParams
+{
+  GstPylonPages pages;
+  gboolean lock; // Keep the buffers from being swapped out.
+  gint numaNode; // NUMA node to put the buffers on, -1 to leave it to the kernel.
+  gboolean shared; // Back the buffers with a memfd, so that they can be handed to other processes.
+} GstPylonAllocParams;
+
+/* A grab buffer, along with what its allocation actually achieved */
+typedef struct _GstPylonGrabMemory
+{
+  guint8 *data;
+  gsize size, mapped; // Requested size, and the size of the mapping, rounded up to the page size.
+  GstPylonPages pages;
+  gboolean locked;
+  gint numaNode;
+  gint fd; // memfd backing the buffer, -1 if it isn't shared.
+} GstPylonGrabMemory;
+
+gboolean gst_pylon_grab_memory_alloc (GstPylonGrabMemory * mem, gsize size, const GstPylonAllocParams * params);
+void gst_pylon_grab_memory_free (GstPylonGrabMemory * mem);
+const gchar *gst_pylon_pages_get_name (GstPylonPages pages);
+gchar *gst_pylon_usb_device_path (const gchar * serial);
+gint gst_pylon_usb_numa_node (const gchar * serial);
+gint gst_pylon_memfd_create (const gchar * name, gboolean huge);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,388 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * USB bandwidth planning for cameras sharing a host controller.
+ *
+ * Every camera's own link can carry its frames, but the cameras behind one
+ * USB host controller share its bandwidth, and when they need more than it
+ * has, frames get lost on all of them. The planner keeps track of the cameras
+ * of every pylonsrc in the process, grouped by the controller they are
+ * attached to, and when a group needs more than its controller's budget it
+ * divides the budget between the cameras: the ones that need the least get
+ * everything they need, and the rest share what is left evenly. The shares
+ * are set as the cameras' DeviceLinkThroughputLimit, which makes the cameras
+ * lower their framerate to fit. Cameras whose limit can't be changed (for
+ * example because they are already grabbing) keep what they use, and the
+ * others are planned around them.
+ *
+ * A camera is only ever touched from its own element's threads: the camera
+ * joining or leaving the plan is limited right away, while the new limits of
+ * the other cameras on the controller are left pending until their streaming
+ * threads pick them up with gst_pylon_bandwidth_apply_pending().
+ *
+ * The controllers are found through sysfs. For testing, or when sysfs isn't
+ * available, PYLONSRC_USB_TOPOLOGY can describe the topology instead as a
+ * list of serial=controller pairs, e.g. "22000000=xhci0,22000001=xhci0".
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylonbandwidth.h"
+#include "gstpylonalloc.h"
+
+#include <string.h>
+#include <inttypes.h>
+
+GST_DEBUG_CATEGORY_STATIC (gst_pylon_bandwidth_debug_category);
+#define GST_CAT_DEFAULT gst_pylon_bandwidth_debug_category
+
+static struct
+{
+  GMutex lock;
+  GPtrArray *cameras; // Cameras of the started pylonsrc elements.
+} planner;
+
+/* Finds the host controller a camera is attached to. The controller of a USB device in sysfs is the parent of its root hub (usbN). */
+gchar *
+gst_pylon_usb_controller (const gchar * serial)
+{
+  const gchar *topology = g_getenv("PYLONSRC_USB_TOPOLOGY");
+  gchar **pairs, **components, *path, *controller = NULL;
+  guint i;
+
+  if(!serial || !*serial) {
+    return NULL;
+  }
+
+  if(topology) {
+    pairs = g_strsplit(topology, ",", -1);
+    for(i = 0; pairs[i] && !controller; i++) {
+      gchar *separator = strchr(pairs[i], '=');
+      if(separator && (gsize) (separator - pairs[i]) == strlen(serial) && strncmp(pairs[i], serial, separator - pairs[i]) == 0) {
+        controller = g_strdup(separator + 1);
+      }
+    }
+    g_strfreev(pairs);
+    return controller;
+  }
+
+  path = gst_pylon_usb_device_path(serial);
+  if(!path) {
+    return NULL;
+  }
+  components = g_strsplit(path, "/", -1);
+  for(i = 0; components[i] && !controller; i++) {
+    if(g_str_has_prefix(components[i], "usb") && g_ascii_isdigit(components[i][3])) {
+      controller = g_strdup(i > 0 && *components[i - 1] ? components[i - 1] : components[i]);
+    }
+  }
+  g_strfreev(components);
+  g_free(path);
+
+  return controller;
+}
+
+/* Divides budget between the cameras, setting their granted share. Cameras that are fixed always get what they need. Returns TRUE if every camera gets what it needs. Doesn't touch the cameras themselves, so it can be tried out on made up ones. */
+gboolean
+gst_pylon_bandwidth_plan (GstPylonBandwidthCamera ** cameras, guint count, int64_t budget)
+{
+  int64_t total = 0, left = budget, share;
+  guint i, flexible = 0;
+  gboolean changed = TRUE;
+
+  for(i = 0; i < count; i++) {
+    total += cameras[i]->need;
+    cameras[i]->granted = -1;
+    if(cameras[i]->fixed) {
+      cameras[i]->granted = cameras[i]->need;
+      left -= cameras[i]->need;
+    } else {
+      flexible++;
+    }
+  }
+
+  // An unknown budget can't be planned for
+  if(total <= budget || budget <= 0) {
+    for(i = 0; i < count; i++) {
+      cameras[i]->granted = cameras[i]->need;
+    }
+    return TRUE;
+  }
+
+  // Give the cameras that need less than an even share what they need, until the rest all need more than that
+  while(changed && flexible > 0) {
+    changed = FALSE;
+    share = MAX(left, 0) / flexible;
+    for(i = 0; i < count; i++) {
+      if(cameras[i]->granted < 0 && cameras[i]->need <= share) {
+        cameras[i]->granted = cameras[i]->need;
+        left -= cameras[i]->need;
+        flexible--;
+        changed = TRUE;
+      }
+    }
+  }
+  for(i = 0; i < count; i++) {
+    if(cameras[i]->granted < 0) {
+      cameras[i]->granted = MAX(left, 0) / flexible;
+    }
+  }
+
+  return FALSE;
+}
+
+/* Describes the plan, with the framerate each camera can reach with its share */
+gchar *
+gst_pylon_bandwidth_report (GstPylonBandwidthCamera ** cameras, guint count, int64_t budget)
+{
+  GString *report = g_string_new(NULL);
+  int64_t total = 0;
+  guint i;
+
+  for(i = 0; i < count; i++) {
+    total += cameras[i]->need;
+  }
+  g_string_append_printf(report, "USB controller %s can carry %.1lf MB/s, its %u camera(s) need %.1lf MB/s.", cameras[0]->controller, (double)budget/1000000, count, (double)total/1000000);
+  for(i = 0; i < count; i++) {
+    GstPylonBandwidthCamera *camera = cameras[i];
+    double payload = camera->payload > 0 ? (double)camera->payload : 1.0;
+
+    g_string_append_printf(report, "\n  Camera %s needs %.1lf MB/s (%.1lf fps), gets %.1lf MB/s (%.1lf fps)%s.", camera->serial, (double)camera->need/1000000, camera->need/payload, (double)camera->granted/1000000, camera->granted/payload, camera->fixed ? ", its limit can't be changed" : "");
+  }
+
+  return g_string_free(report, FALSE);
+}
+
+/* Collects the cameras on the controller, along with the budget they share */
+static guint
+gst_pylon_bandwidth_group (const gchar * controller, GstPylonBandwidthCamera * extra, GstPylonBandwidthCamera ** group, int64_t * budget)
+{
+  GstPylonBandwidthCamera *camera;
+  int64_t linkSpeed = 0;
+  guint i, count = 0;
+
+  *budget = 0;
+  for(i = 0; i <= planner.cameras->len; i++) {
+    camera = i < planner.cameras->len ? g_ptr_array_index(planner.cameras, i) : extra;
+    if(!camera || strcmp(camera->controller, controller) != 0) {
+      continue;
+    }
+    group[count++] = camera;
+    if(camera->budget > 0 && (*budget == 0 || camera->budget < *budget)) {
+      *budget = camera->budget;
+    }
+    if(camera->linkSpeed > 0 && (linkSpeed == 0 || camera->linkSpeed < linkSpeed)) {
+      linkSpeed = camera->linkSpeed;
+    }
+  }
+  if(*budget == 0) {
+    *budget = linkSpeed;
+  }
+
+  return count;
+}
+
+/* Sets the camera's limit on the camera, or its own settings if the limit is 0. Only called from the thread of the camera's element. */
+static gboolean
+gst_pylon_bandwidth_set_limit (GstPylonBandwidthCamera * camera)
+{
+  GENAPIC_RESULT res;
+
+  if(camera->limit == 0) {
+    PylonDeviceSetIntegerFeature(camera->deviceHandle, "DeviceLinkThroughputLimit", camera->savedLimit);
+    PylonDeviceFeatureFromString(camera->deviceHandle, "DeviceLinkThroughputLimitMode", camera->savedLimitMode);
+    GST_DEBUG_OBJECT(camera->owner, "Camera %s no longer needs to be limited.", camera->serial);
+    return TRUE;
+  }
+
+  res = PylonDeviceFeatureFromString(camera->deviceHandle, "DeviceLinkThroughputLimitMode", "On");
+  if(res == GENAPI_E_OK) {
+    res = PylonDeviceSetIntegerFeature(camera->deviceHandle, "DeviceLinkThroughputLimit", camera->limit);
+  }
+  if(res != GENAPI_E_OK) {
+    GST_WARNING_OBJECT(camera->owner, "Couldn't limit camera %s to %"PRId64" B/s (%#08x), planning around it.", camera->serial, camera->limit, (unsigned int) res);
+    return FALSE;
+  }
+  GST_DEBUG_OBJECT(camera->owner, "Limited camera %s to %"PRId64" B/s.", camera->serial, camera->limit);
+  return TRUE;
+}
+
+/* Gives the cameras their planned shares as throughput limits. Cameras that don't need limiting go back to their own settings. Only self is set right away, the others are left pending for their own threads. Returns FALSE if self had to be fixed, in which case the plan has to be redone. */
+static gboolean
+gst_pylon_bandwidth_apply (GstPylonBandwidthCamera ** group, guint count, GstPylonBandwidthCamera * self)
+{
+  GstPylonBandwidthCamera *camera;
+  int64_t limit;
+  gboolean applied = TRUE;
+  guint i;
+
+  for(i = 0; i < count; i++) {
+    camera = group[i];
+    limit = camera->granted < camera->need ? camera->granted : 0;
+    if(camera->fixed || camera->limit == limit) {
+      continue;
+    }
+
+    camera->limit = limit;
+    if(camera != self) {
+      g_atomic_int_set(&camera->pending, TRUE);
+      GST_DEBUG_OBJECT(camera->owner, "Camera %s will be limited to %"PRId64" B/s (0 - not limited).", camera->serial, limit);
+    } else if(!gst_pylon_bandwidth_set_limit(camera)) {
+      camera->limit = 0;
+      camera->fixed = TRUE;
+      applied = FALSE;
+    }
+  }
+
+  return applied;
+}
+
+/* Plans the group again and applies the plan until self no longer turns out to be fixed */
+static gboolean
+gst_pylon_bandwidth_replan (GstPylonBandwidthCamera ** group, guint count, int64_t budget, GstPylonBandwidthCamera * self)
+{
+  gboolean fits;
+
+  do {
+    fits = gst_pylon_bandwidth_plan(group, count, budget);
+  } while(!gst_pylon_bandwidth_apply(group, count, self));
+
+  return fits;
+}
+
+/* Adds a started camera to the plan of its controller. The camera's need, payload, link speed and budget have to be filled in. If the cameras on the controller need more than its budget, they are limited to fit it, or if failShort is set, the camera isn't added and FALSE is returned. report is set to a description of the plan when the cameras don't fit, NULL otherwise. */
+gboolean
+gst_pylon_bandwidth_add (GstPylonBandwidthCamera * camera, gboolean failShort, gchar ** report)
+{
+  static gsize debugInitialised = 0;
+  GstPylonBandwidthCamera **group;
+  int64_t budget;
+  guint count;
+  size_t siz = sizeof(camera->savedLimitMode);
+  gboolean fits;
+
+  if(g_once_init_enter(&debugInitialised)) {
+    GST_DEBUG_CATEGORY_INIT (gst_pylon_bandwidth_debug_category, "pylonbandwidth", 0, "USB bandwidth planner shared by the pylonsrc elements");
+    planner.cameras = g_ptr_array_new();
+    g_once_init_leave(&debugInitialised, 1);
+  }
+
+  *report = NULL;
+  camera->granted = camera->need;
+  camera->limit = 0;
+  camera->pending = FALSE;
+  camera->fixed = FALSE;
+  if(!camera->controller) {
+    return TRUE;
+  }
+  if(PylonDeviceGetIntegerFeature(camera->deviceHandle, "DeviceLinkThroughputLimit", &camera->savedLimit) != GENAPI_E_OK || PylonDeviceFeatureToString(camera->deviceHandle, "DeviceLinkThroughputLimitMode", camera->savedLimitMode, &siz) != GENAPI_E_OK) {
+    // Without its settings the camera couldn't be put back the way it was, so don't touch it
+    camera->fixed = TRUE;
+  }
+
+  g_mutex_lock(&planner.lock);
+  group = g_new(GstPylonBandwidthCamera *, planner.cameras->len + 1);
+  count = gst_pylon_bandwidth_group(camera->controller, camera, group, &budget);
+
+  fits = gst_pylon_bandwidth_plan(group, count, budget);
+  if(!fits && failShort) {
+    *report = gst_pylon_bandwidth_report(group, count, budget);
+    g_free(group);
+    g_mutex_unlock(&planner.lock);
+    return FALSE;
+  }
+
+  if(!fits) {
+    gst_pylon_bandwidth_replan(group, count, budget, camera);
+    *report = gst_pylon_bandwidth_report(group, count, budget);
+  }
+  g_ptr_array_add(planner.cameras, camera);
+  GST_DEBUG_OBJECT(camera->owner, "Camera %s is on USB controller %s with %u other camera(s), sharing %"PRId64" B/s.", camera->serial, camera->controller, count - 1, budget);
+  g_free(group);
+  g_mutex_unlock(&planner.lock);
+
+  return TRUE;
+}
+
+/* Takes a camera out of the plan, before its device is closed. The camera gets its own throughput limit back, and the cameras left on its controller are planned again, which can raise their limits. */
+void
+gst_pylon_bandwidth_remove (GstPylonBandwidthCamera * camera)
+{
+  GstPylonBandwidthCamera **group;
+  int64_t budget;
+  guint count;
+
+  if(!planner.cameras) {
+    return;
+  }
+
+  g_mutex_lock(&planner.lock);
+  if(!g_ptr_array_remove(planner.cameras, camera)) {
+    g_mutex_unlock(&planner.lock);
+    return;
+  }
+
+  // A limit that is still pending was never set
+  if(camera->limit > 0 || g_atomic_int_get(&camera->pending)) {
+    camera->limit = 0;
+    gst_pylon_bandwidth_set_limit(camera);
+  }
+  g_atomic_int_set(&camera->pending, FALSE);
+
+  group = g_new(GstPylonBandwidthCamera *, planner.cameras->len + 1);
+  count = gst_pylon_bandwidth_group(camera->controller, NULL, group, &budget);
+  if(count > 0) {
+    gst_pylon_bandwidth_replan(group, count, budget, NULL);
+  }
+  g_free(group);
+  g_mutex_unlock(&planner.lock);
+}
+
+/* Sets a limit the planner changed while another camera joined or left the plan. Called from the streaming thread of the camera's element. Returns TRUE if the camera's limit changed, so that its framerate has to be read again. */
+gboolean
+gst_pylon_bandwidth_apply_pending (GstPylonBandwidthCamera * camera)
+{
+  GstPylonBandwidthCamera **group;
+  int64_t budget;
+  guint count;
+  gboolean changed = TRUE;
+
+  if(!g_atomic_int_get(&camera->pending)) {
+    return FALSE;
+  }
+
+  g_mutex_lock(&planner.lock);
+  g_atomic_int_set(&camera->pending, FALSE);
+  if(!gst_pylon_bandwidth_set_limit(camera)) {
+    // The others have to make room for what this one keeps using
+    camera->limit = 0;
+    camera->fixed = TRUE;
+    changed = FALSE;
+    group = g_new(GstPylonBandwidthCamera *, planner.cameras->len);
+    count = gst_pylon_bandwidth_group(camera->controller, NULL, group, &budget);
+    gst_pylon_bandwidth_replan(group, count, budget, NULL);
+    g_free(group);
+  }
+  g_mutex_unlock(&planner.lock);
+
+  return changed;
+}
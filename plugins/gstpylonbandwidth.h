@@ -0,0 +1,60 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONBANDWIDTH_H_
+#define _GST_PYLONBANDWIDTH_H_
+
+#include <gst/gst.h>
+#include "pylonc/PylonC.h"
+
+G_BEGIN_DECLS
+
+/* A camera taking part in the bandwidth plan of its USB controller. All throughputs are in B/s. */
+typedef struct _GstPylonBandwidthCamera
+{
+  GstObject *owner; // Element the camera belongs to, for logging.
+  PYLON_DEVICE_HANDLE deviceHandle;
+  gchar *serial;
+  gchar *controller; // Host controller the camera is attached to, NULL if it isn't known.
+
+  int64_t need; // Throughput at the framerate the camera is configured for.
+  int64_t payload; // Size of a frame, to turn throughputs into framerates.
+  int64_t linkSpeed;
+  int64_t budget; // Throughput the controller can handle, 0 to use the slowest link speed of its cameras.
+
+  int64_t granted; // Share of the controller's budget given to the camera.
+  int64_t limit; // Throughput limit the planner set (or asked the owner to set) on the camera, 0 if it didn't.
+  gint pending; // The limit was changed while another camera joined or left, and waits for the owner's streaming thread to set it.
+  gboolean fixed; // The limit couldn't be changed, so the camera keeps what it needs.
+  int64_t savedLimit; // Throughput limit settings from before the planner touched them, restored when the camera leaves.
+  gchar savedLimitMode[16];
+} GstPylonBandwidthCamera;
+
+gchar *gst_pylon_usb_controller (const gchar * serial);
+
+gboolean gst_pylon_bandwidth_plan (GstPylonBandwidthCamera ** cameras, guint count, int64_t budget);
+gchar *gst_pylon_bandwidth_report (GstPylonBandwidthCamera ** cameras, guint count, int64_t budget);
+
+gboolean gst_pylon_bandwidth_add (GstPylonBandwidthCamera * camera, gboolean failShort, gchar ** report);
+void gst_pylon_bandwidth_remove (GstPylonBandwidthCamera * camera);
+gboolean gst_pylon_bandwidth_apply_pending (GstPylonBandwidthCamera * camera);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,395 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/**
+ * SECTION:provider-pylondeviceprovider
+ *
+ * The pylondeviceprovider lists the Basler cameras for GstDeviceMonitor.
+ *
+ * The cameras are listed from their device info, without opening them, so
+ * listing them is cheap and cameras that are in use (by this or another
+ * process) are listed as well. The list is shared by all of the providers in
+ * the process and kept for a second, so an application can poll the cameras
+ * as often as it likes. While the provider is started it looks for cameras
+ * that were plugged in or out every couple of seconds and posts device-added
+ * and device-removed messages on its bus.
+ *
+ * Every device creates a pylonsrc with its serial property set to the
+ * camera's serial number, so the element opens that camera no matter in which
+ * order the cameras are enumerated. The device's properties hold the serial
+ * number (device.serial), the vendor, the model, the user defined name and
+ * the device class (BaslerUsb or BaslerGigE) of the camera.
+ *
+ * <refsect2>
+ * <title>Example</title>
+ * |[
+ * gst-device-monitor-1.0 -f Video/Source
+ * ]|
+ * Lists the cameras, and keeps printing the cameras that are plugged in or out.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylondeviceprovider.h"
+#include "pylonc/PylonC.h"
+
+#include <string.h> //strcmp
+
+#if GST_CHECK_VERSION(1, 4, 0)
+
+/* debug category */
+GST_DEBUG_CATEGORY_STATIC (gst_pylon_device_provider_debug_category);
+#define GST_CAT_DEFAULT gst_pylon_device_provider_debug_category
+
+#define CACHE_TIME G_USEC_PER_SEC // How long an enumeration is reused for.
+#define POLL_INTERVAL (2 * G_USEC_PER_SEC) // How often a started provider looks for new cameras.
+
+/* The last enumeration, shared by every provider in the process */
+static struct
+{
+  GMutex lock;
+  GArray *cameras; // PylonDeviceInfo_t of each camera, replaced rather than changed.
+  gint64 time;
+  gboolean initialized;
+} cache;
+
+/* Caps of the formats pylonsrc can be set to, the actual resolution isn't known without opening the camera */
+static GstStaticCaps gst_pylon_device_caps = GST_STATIC_CAPS ("video/x-raw, format=(string){ GRAY8, RGB, BGR, YUY2 }; video/x-bayer, format=(string){ rggb, grbg, gbrg, bggr }");
+
+/* prototypes */
+static GList *gst_pylon_device_provider_probe (GstDeviceProvider * provider);
+static gboolean gst_pylon_device_provider_start (GstDeviceProvider * provider);
+static void gst_pylon_device_provider_stop (GstDeviceProvider * provider);
+static void gst_pylon_device_provider_finalize (GObject * object);
+
+static GstElement *gst_pylon_device_create_element (GstDevice * device,
+    const gchar * name);
+static gboolean gst_pylon_device_reconfigure_element (GstDevice * device,
+    GstElement * element);
+static void gst_pylon_device_finalize (GObject * object);
+
+/* class initialisation */
+G_DEFINE_TYPE_WITH_CODE (GstPylonDeviceProvider, gst_pylon_device_provider, GST_TYPE_DEVICE_PROVIDER,
+  GST_DEBUG_CATEGORY_INIT (gst_pylon_device_provider_debug_category, "pylondeviceprovider", 0,
+  "debug category for the Basler camera provider"));
+G_DEFINE_TYPE (GstPylonDevice, gst_pylon_device, GST_TYPE_DEVICE);
+
+static void
+gst_pylon_device_provider_class_init (GstPylonDeviceProviderClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstDeviceProviderClass *provider_class = GST_DEVICE_PROVIDER_CLASS (klass);
+
+  gst_device_provider_class_set_static_metadata (provider_class,
+      "Basler camera provider", "Source/Video", "Lists the Basler cameras without opening them",
+      "Ingmars Melkis <contact@zingmars.me>");
+
+  gobject_class->finalize = gst_pylon_device_provider_finalize;
+  provider_class->probe = GST_DEBUG_FUNCPTR (gst_pylon_device_provider_probe);
+  provider_class->start = GST_DEBUG_FUNCPTR (gst_pylon_device_provider_start);
+  provider_class->stop = GST_DEBUG_FUNCPTR (gst_pylon_device_provider_stop);
+}
+
+static void
+gst_pylon_device_provider_init (GstPylonDeviceProvider * provider)
+{
+  provider->thread = NULL;
+  provider->quit = FALSE;
+  provider->devices = NULL;
+  g_mutex_init(&provider->lock);
+  g_cond_init(&provider->cond);
+}
+
+static void
+gst_pylon_device_provider_finalize (GObject * object)
+{
+  GstPylonDeviceProvider *provider = GST_PYLON_DEVICE_PROVIDER (object);
+
+  g_list_free_full(provider->devices, gst_object_unref);
+  g_mutex_clear(&provider->lock);
+  g_cond_clear(&provider->cond);
+
+  G_OBJECT_CLASS (gst_pylon_device_provider_parent_class)->finalize (object);
+}
+
+/* Returns the cameras that are connected, enumerating them again if the last enumeration is too old or refresh is set */
+static GArray *
+gst_pylon_device_provider_enumerate (gboolean refresh)
+{
+  GArray *cameras;
+  PylonDeviceInfo_t info;
+  size_t numDevices = 0, i;
+  GENAPIC_RESULT res;
+
+  g_mutex_lock(&cache.lock);
+  if(!refresh && cache.cameras && g_get_monotonic_time() - cache.time < CACHE_TIME) {
+    cameras = g_array_ref(cache.cameras);
+    g_mutex_unlock(&cache.lock);
+    return cameras;
+  }
+
+  // Pylon stays initialised for the rest of the process, loading the transport layers again on every enumeration would cost more than the enumeration
+  if(!cache.initialized) {
+    PylonInitialize();
+    cache.initialized = TRUE;
+  }
+
+  cameras = g_array_new(FALSE, TRUE, sizeof(PylonDeviceInfo_t));
+  res = PylonEnumerateDevices(&numDevices);
+  if(res != GENAPI_E_OK) {
+    GST_WARNING("Couldn't enumerate the cameras (%#08x).", (unsigned int) res);
+    numDevices = 0;
+  }
+  for(i = 0; i < numDevices; i++) {
+    if(PylonGetDeviceInfo(i, &info) == GENAPI_E_OK) {
+      g_array_append_val(cameras, info);
+    }
+  }
+  GST_DEBUG("Found %u camera(s).", cameras->len);
+
+  if(cache.cameras) {
+    g_array_unref(cache.cameras);
+  }
+  cache.cameras = g_array_ref(cameras);
+  cache.time = g_get_monotonic_time();
+  g_mutex_unlock(&cache.lock);
+
+  return cameras;
+}
+
+static GstDevice *
+gst_pylon_device_new (const PylonDeviceInfo_t * info)
+{
+  GstPylonDevice *device;
+  GstCaps *caps = gst_static_caps_get(&gst_pylon_device_caps);
+  GstStructure *properties;
+  gchar *name;
+
+  if(strcmp(info->UserDefinedName, "") != 0) {
+    name = g_strdup_printf("%s %s (%s)", info->VendorName, info->ModelName, info->UserDefinedName);
+  } else {
+    name = g_strdup_printf("%s %s (%s)", info->VendorName, info->ModelName, info->SerialNumber);
+  }
+  properties = gst_structure_new("pylon-device-properties",
+      "device.api", G_TYPE_STRING, "pylon",
+      "device.serial", G_TYPE_STRING, info->SerialNumber,
+      "device.vendor", G_TYPE_STRING, info->VendorName,
+      "device.model", G_TYPE_STRING, info->ModelName,
+      "device.user-id", G_TYPE_STRING, info->UserDefinedName,
+      "device.class", G_TYPE_STRING, info->DeviceClass,
+      "device.version", G_TYPE_STRING, info->DeviceVersion,
+      "device.full-name", G_TYPE_STRING, info->FullName,
+      NULL);
+
+  device = g_object_new(GST_TYPE_PYLON_DEVICE, "display-name", name, "caps", caps, "device-class", "Video/Source", "properties", properties, NULL);
+  device->serial = g_strdup(info->SerialNumber);
+
+  g_free(name);
+  gst_caps_unref(caps);
+  gst_structure_free(properties);
+  return GST_DEVICE(device);
+}
+
+static GList *
+gst_pylon_device_provider_probe (GstDeviceProvider * provider)
+{
+  GArray *cameras = gst_pylon_device_provider_enumerate(FALSE);
+  GList *devices = NULL;
+  guint i;
+
+  for(i = 0; i < cameras->len; i++) {
+    devices = g_list_prepend(devices, gst_object_ref_sink(gst_pylon_device_new(&g_array_index(cameras, PylonDeviceInfo_t, i))));
+  }
+  g_array_unref(cameras);
+
+  return g_list_reverse(devices);
+}
+
+/* Adds the cameras that were plugged in and removes the ones that were unplugged. The provider keeps its own list of the devices, as gst_device_provider_get_devices() waits for start() and stop() to return, and stop() waits for the thread that calls this. */
+static void
+gst_pylon_device_provider_update (GstPylonDeviceProvider * provider, GArray * cameras)
+{
+  GstDeviceProvider *deviceProvider = GST_DEVICE_PROVIDER(provider);
+  GList *added = NULL, *removed = NULL, *item, *next;
+  gboolean *known = g_new0(gboolean, cameras->len + 1);
+  guint i;
+
+  g_mutex_lock(&provider->lock);
+  for(item = provider->devices; item; item = next) {
+    GstPylonDevice *device = GST_PYLON_DEVICE(item->data);
+    gboolean present = FALSE;
+
+    next = item->next;
+    for(i = 0; i < cameras->len; i++) {
+      if(strcmp(g_array_index(cameras, PylonDeviceInfo_t, i).SerialNumber, device->serial) == 0) {
+        known[i] = TRUE;
+        present = TRUE;
+      }
+    }
+    if(!present) {
+      provider->devices = g_list_remove_link(provider->devices, item);
+      removed = g_list_concat(item, removed);
+    }
+  }
+  for(i = 0; i < cameras->len; i++) {
+    if(!known[i]) {
+      GstDevice *device = gst_object_ref_sink(gst_pylon_device_new(&g_array_index(cameras, PylonDeviceInfo_t, i)));
+
+      provider->devices = g_list_append(provider->devices, device);
+      added = g_list_prepend(added, gst_object_ref(device));
+    }
+  }
+  g_mutex_unlock(&provider->lock);
+  g_free(known);
+
+  // The messages are posted without holding the lock
+  for(item = removed; item; item = item->next) {
+    GST_INFO_OBJECT(provider, "Camera %s was unplugged.", GST_PYLON_DEVICE(item->data)->serial);
+    gst_device_provider_device_remove(deviceProvider, GST_DEVICE(item->data));
+  }
+  g_list_free_full(removed, gst_object_unref);
+  added = g_list_reverse(added);
+  for(item = added; item; item = item->next) {
+    GST_INFO_OBJECT(provider, "Camera %s was plugged in.", GST_PYLON_DEVICE(item->data)->serial);
+    gst_device_provider_device_add(deviceProvider, GST_DEVICE(item->data));
+  }
+  g_list_free_full(added, gst_object_unref);
+}
+
+static gpointer
+gst_pylon_device_provider_monitor (gpointer data)
+{
+  GstPylonDeviceProvider *provider = GST_PYLON_DEVICE_PROVIDER (data);
+  GArray *cameras;
+  gint64 endTime;
+
+  g_mutex_lock(&provider->lock);
+  while(!provider->quit) {
+    endTime = g_get_monotonic_time() + POLL_INTERVAL;
+    while(!provider->quit && g_cond_wait_until(&provider->cond, &provider->lock, endTime)) {
+    }
+    if(provider->quit) {
+      break;
+    }
+    g_mutex_unlock(&provider->lock);
+
+    cameras = gst_pylon_device_provider_enumerate(TRUE);
+    gst_pylon_device_provider_update(provider, cameras);
+    g_array_unref(cameras);
+
+    g_mutex_lock(&provider->lock);
+  }
+  g_mutex_unlock(&provider->lock);
+
+  return NULL;
+}
+
+static gboolean
+gst_pylon_device_provider_start (GstDeviceProvider * deviceProvider)
+{
+  GstPylonDeviceProvider *provider = GST_PYLON_DEVICE_PROVIDER (deviceProvider);
+  GArray *cameras;
+
+  // The cameras that are there already are listed before start returns
+  cameras = gst_pylon_device_provider_enumerate(FALSE);
+  gst_pylon_device_provider_update(provider, cameras);
+  g_array_unref(cameras);
+
+  provider->quit = FALSE;
+  provider->thread = g_thread_new("pylondeviceprovider", gst_pylon_device_provider_monitor, provider);
+  return TRUE;
+}
+
+static void
+gst_pylon_device_provider_stop (GstDeviceProvider * deviceProvider)
+{
+  GstPylonDeviceProvider *provider = GST_PYLON_DEVICE_PROVIDER (deviceProvider);
+
+  if(!provider->thread) {
+    return;
+  }
+  g_mutex_lock(&provider->lock);
+  provider->quit = TRUE;
+  g_cond_signal(&provider->cond);
+  g_mutex_unlock(&provider->lock);
+  g_thread_join(provider->thread);
+  provider->thread = NULL;
+
+  // GstDeviceProvider drops the devices once stop() returns, the next start() adds them again
+  g_mutex_lock(&provider->lock);
+  g_list_free_full(provider->devices, gst_object_unref);
+  provider->devices = NULL;
+  g_mutex_unlock(&provider->lock);
+}
+
+/* Devices */
+static void
+gst_pylon_device_class_init (GstPylonDeviceClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstDeviceClass *device_class = GST_DEVICE_CLASS (klass);
+
+  gobject_class->finalize = gst_pylon_device_finalize;
+  device_class->create_element = GST_DEBUG_FUNCPTR (gst_pylon_device_create_element);
+  device_class->reconfigure_element = GST_DEBUG_FUNCPTR (gst_pylon_device_reconfigure_element);
+}
+
+static void
+gst_pylon_device_init (GstPylonDevice * device)
+{
+  device->serial = NULL;
+}
+
+static void
+gst_pylon_device_finalize (GObject * object)
+{
+  GstPylonDevice *device = GST_PYLON_DEVICE (object);
+
+  g_free(device->serial);
+
+  G_OBJECT_CLASS (gst_pylon_device_parent_class)->finalize (object);
+}
+
+static GstElement *
+gst_pylon_device_create_element (GstDevice * device, const gchar * name)
+{
+  GstElement *element = gst_element_factory_make("pylonsrc", name);
+
+  if(element) {
+    g_object_set(element, "serial", GST_PYLON_DEVICE(device)->serial, NULL);
+  }
+  return element;
+}
+
+static gboolean
+gst_pylon_device_reconfigure_element (GstDevice * device, GstElement * element)
+{
+  GstElementFactory *factory = gst_element_get_factory(element);
+
+  if(!factory || strcmp(GST_OBJECT_NAME(factory), "pylonsrc") != 0) {
+    return FALSE;
+  }
+  g_object_set(element, "serial", GST_PYLON_DEVICE(device)->serial, NULL);
+  return TRUE;
+}
+
+#endif
@@ -0,0 +1,74 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONDEVICEPROVIDER_H_
+#define _GST_PYLONDEVICEPROVIDER_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_PYLON_DEVICE_PROVIDER   (gst_pylon_device_provider_get_type())
+#define GST_PYLON_DEVICE_PROVIDER(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PYLON_DEVICE_PROVIDER,GstPylonDeviceProvider))
+#define GST_IS_PYLON_DEVICE_PROVIDER(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PYLON_DEVICE_PROVIDER))
+
+#define GST_TYPE_PYLON_DEVICE   (gst_pylon_device_get_type())
+#define GST_PYLON_DEVICE(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PYLON_DEVICE,GstPylonDevice))
+#define GST_IS_PYLON_DEVICE(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PYLON_DEVICE))
+
+typedef struct _GstPylonDeviceProvider GstPylonDeviceProvider;
+typedef struct _GstPylonDeviceProviderClass GstPylonDeviceProviderClass;
+typedef struct _GstPylonDevice GstPylonDevice;
+typedef struct _GstPylonDeviceClass GstPylonDeviceClass;
+
+struct _GstPylonDeviceProvider
+{
+  GstDeviceProvider parent;
+
+  GThread *thread; // Looks for cameras that were plugged in or out, runs while the provider is started.
+  GMutex lock;
+  GCond cond; // Signalled to stop the thread.
+  gboolean quit;
+  GList *devices; // The devices this provider added, protected by lock.
+};
+
+struct _GstPylonDeviceProviderClass
+{
+  GstDeviceProviderClass parent_class;
+};
+
+/* A camera, creates a pylonsrc bound to its serial number */
+struct _GstPylonDevice
+{
+  GstDevice parent;
+
+  gchar *serial;
+};
+
+struct _GstPylonDeviceClass
+{
+  GstDeviceClass parent_class;
+};
+
+GType gst_pylon_device_provider_get_type (void);
+GType gst_pylon_device_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,310 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Grab engine shared by all of the pylonsrc elements in the process.
+ *
+ * Without it every pylonsrc waits for its camera's frames in its own streaming
+ * thread, so each camera costs a thread that wakes up on its own. The engine
+ * instead puts the wait objects of many cameras into one PylonWaitObjects set
+ * per engine thread, and a single wait services whichever camera is ready. The
+ * results are moved into the camera's ring, from where pylonsrc picks them up.
+ *
+ * The number of engine threads is independent of the number of cameras. New
+ * cameras are given to the thread serving the fewest, and the threads are
+ * stopped once the last camera is removed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylongrabengine.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_pylon_grab_engine_debug_category);
+#define GST_CAT_DEFAULT gst_pylon_grab_engine_debug_category
+
+// A wait object set holds at most 64 objects, one of them is used to wake the thread up
+#define MAX_CAMERAS_PER_THREAD 63
+
+struct _GstPylonGrabThread
+{
+  GThread *thread;
+  PYLON_WAITOBJECTS_HANDLE waitObjects;
+  PYLON_WAITOBJECT_HANDLE wake; // Signalled when the thread has to look at its cameras again.
+  GPtrArray *rings; // Cameras the thread serves, protected by the engine lock.
+  gboolean changed; // The cameras changed and the thread hasn't picked the change up yet.
+  gboolean quit;
+};
+
+static struct
+{
+  GMutex lock;
+  GCond cond; // Signalled when a thread picks up a change to its cameras.
+  GstPylonGrabThread *threads[GST_PYLON_GRAB_ENGINE_MAX_THREADS];
+  guint numThreads, numRings;
+} engine;
+
+/* Rings */
+void
+gst_pylon_grab_ring_init (GstPylonGrabRing * ring, PYLON_STREAMGRABBER_HANDLE streamGrabber, PYLON_WAITOBJECT_HANDLE waitObject, guint capacity)
+{
+  ring->streamGrabber = streamGrabber;
+  ring->waitObject = waitObject;
+  ring->thread = NULL;
+  g_mutex_init(&ring->lock);
+  g_cond_init(&ring->cond);
+  ring->results = g_new0(PylonGrabResult_t, capacity);
+  ring->head = 0;
+  ring->count = 0;
+  ring->capacity = capacity;
+}
+
+void
+gst_pylon_grab_ring_clear (GstPylonGrabRing * ring)
+{
+  g_free(ring->results);
+  ring->results = NULL;
+  ring->capacity = 0;
+  g_cond_clear(&ring->cond);
+  g_mutex_clear(&ring->lock);
+}
+
+/* Takes the oldest grab result off the ring, waiting up to timeout milliseconds for one. remaining is set to the number of results still waiting. */
+gboolean
+gst_pylon_grab_ring_pop (GstPylonGrabRing * ring, PylonGrabResult_t * result, guint timeout, guint * remaining)
+{
+  gint64 endTime = g_get_monotonic_time() + (gint64) timeout * G_TIME_SPAN_MILLISECOND;
+
+  g_mutex_lock(&ring->lock);
+  while(ring->count == 0) {
+    if(!g_cond_wait_until(&ring->cond, &ring->lock, endTime)) {
+      g_mutex_unlock(&ring->lock);
+      return FALSE;
+    }
+  }
+  *result = ring->results[ring->head];
+  ring->head = (ring->head + 1) % ring->capacity;
+  ring->count--;
+  if(remaining) {
+    *remaining = ring->count;
+  }
+  g_mutex_unlock(&ring->lock);
+
+  return TRUE;
+}
+
+/* Hands a buffer back to the stream grabber */
+GENAPIC_RESULT
+gst_pylon_grab_ring_queue (GstPylonGrabRing * ring, PYLON_STREAMBUFFER_HANDLE buffer, const void * context)
+{
+  GENAPIC_RESULT res;
+
+  g_mutex_lock(&ring->lock);
+  res = PylonStreamGrabberQueueBuffer(ring->streamGrabber, buffer, context);
+  g_mutex_unlock(&ring->lock);
+
+  return res;
+}
+
+/* Moves all of the camera's finished grabs into its ring, returns how many there were */
+guint
+gst_pylon_grab_ring_retrieve (GstPylonGrabRing * ring)
+{
+  PylonGrabResult_t result;
+  _Bool ready = TRUE;
+  guint added = 0;
+
+  g_mutex_lock(&ring->lock);
+  while(ring->count < ring->capacity) {
+    if(PylonStreamGrabberRetrieveResult(ring->streamGrabber, &result, &ready) != GENAPI_E_OK || !ready) {
+      break;
+    }
+    ring->results[(ring->head + ring->count) % ring->capacity] = result;
+    ring->count++;
+    added++;
+  }
+  if(added > 0) {
+    g_cond_signal(&ring->cond);
+  }
+  g_mutex_unlock(&ring->lock);
+
+  return added;
+}
+
+/* Engine */
+static gpointer
+gst_pylon_grab_engine_thread (gpointer data)
+{
+  GstPylonGrabThread *thread = data;
+  GstPylonGrabRing *rings[MAX_CAMERAS_PER_THREAD];
+  guint numRings = 0, i;
+  size_t index;
+  _Bool ready;
+  GENAPIC_RESULT res;
+
+  while(TRUE) {
+    // Pick up the cameras that were added or removed
+    g_mutex_lock(&engine.lock);
+    if(thread->quit) {
+      g_mutex_unlock(&engine.lock);
+      break;
+    }
+    if(thread->changed) {
+      PylonWaitObjectReset(thread->wake);
+      PylonWaitObjectsRemoveAll(thread->waitObjects);
+      PylonWaitObjectsAdd(thread->waitObjects, thread->wake, NULL);
+      numRings = thread->rings->len;
+      for(i = 0; i < numRings; i++) {
+        rings[i] = g_ptr_array_index(thread->rings, i);
+        PylonWaitObjectsAdd(thread->waitObjects, rings[i]->waitObject, NULL);
+      }
+      thread->changed = FALSE;
+      g_cond_broadcast(&engine.cond);
+    }
+    g_mutex_unlock(&engine.lock);
+
+    res = PylonWaitObjectsWaitForAny(thread->waitObjects, 1000, &index, &ready);
+    if(res != GENAPI_E_OK) {
+      GST_WARNING("Waiting for the cameras failed (%#08x).", (unsigned int) res);
+      g_usleep(G_USEC_PER_SEC / 100);
+      continue;
+    }
+    if(!ready || index == 0) {
+      continue;
+    }
+
+    gst_pylon_grab_ring_retrieve(rings[index - 1]);
+  }
+
+  return NULL;
+}
+
+static void
+gst_pylon_grab_engine_free_thread (GstPylonGrabThread * thread)
+{
+  PylonWaitObjectsDestroy(thread->waitObjects);
+  PylonWaitObjectDestroy(thread->wake);
+  g_ptr_array_free(thread->rings, TRUE);
+  g_free(thread);
+}
+
+/* Starts serving a camera, starting more engine threads if there are less than requested */
+gboolean
+gst_pylon_grab_engine_add (GstPylonGrabRing * ring, guint threads)
+{
+  static gsize debugInitialised = 0;
+  GstPylonGrabThread *thread, *least = NULL;
+  GError *error = NULL;
+  guint i;
+
+  if(g_once_init_enter(&debugInitialised)) {
+    GST_DEBUG_CATEGORY_INIT (gst_pylon_grab_engine_debug_category, "pylongrabengine", 0, "grab engine shared by the pylonsrc elements");
+    g_once_init_leave(&debugInitialised, 1);
+  }
+
+  g_mutex_lock(&engine.lock);
+  threads = CLAMP(threads, 1, GST_PYLON_GRAB_ENGINE_MAX_THREADS);
+  while(engine.numThreads < threads) {
+    thread = g_new0(GstPylonGrabThread, 1);
+    thread->rings = g_ptr_array_new();
+    thread->changed = TRUE;
+    if(PylonWaitObjectsCreate(&thread->waitObjects) != GENAPI_E_OK || PylonWaitObjectCreate(&thread->wake) != GENAPI_E_OK) {
+      GST_ERROR("Couldn't create the wait objects for a grab thread.");
+      g_ptr_array_free(thread->rings, TRUE);
+      g_free(thread);
+      break;
+    }
+
+    thread->thread = g_thread_try_new("pylongrab", gst_pylon_grab_engine_thread, thread, &error);
+    if(!thread->thread) {
+      GST_ERROR("Couldn't start a grab thread: %s", error->message);
+      g_clear_error(&error);
+      gst_pylon_grab_engine_free_thread(thread);
+      break;
+    }
+    engine.threads[engine.numThreads++] = thread;
+    GST_DEBUG("Started grab thread %u.", engine.numThreads);
+  }
+
+  // Give the camera to the thread serving the fewest
+  for(i = 0; i < engine.numThreads; i++) {
+    if(!least || engine.threads[i]->rings->len < least->rings->len) {
+      least = engine.threads[i];
+    }
+  }
+  if(!least || least->rings->len >= MAX_CAMERAS_PER_THREAD) {
+    GST_ERROR("No grab thread can take another camera.");
+    g_mutex_unlock(&engine.lock);
+    return FALSE;
+  }
+
+  g_ptr_array_add(least->rings, ring);
+  ring->thread = least;
+  least->changed = TRUE;
+  PylonWaitObjectSignal(least->wake);
+  engine.numRings++;
+  GST_DEBUG("%u camera(s) served by %u grab thread(s).", engine.numRings, engine.numThreads);
+  g_mutex_unlock(&engine.lock);
+
+  return TRUE;
+}
+
+/* Stops serving a camera. Once this returns the engine no longer touches the ring or the camera's stream grabber. */
+void
+gst_pylon_grab_engine_remove (GstPylonGrabRing * ring)
+{
+  GstPylonGrabThread *thread = ring->thread, *threads[GST_PYLON_GRAB_ENGINE_MAX_THREADS];
+  guint numThreads, i;
+
+  if(!thread) {
+    return;
+  }
+
+  g_mutex_lock(&engine.lock);
+  g_ptr_array_remove(thread->rings, ring);
+  thread->changed = TRUE;
+  PylonWaitObjectSignal(thread->wake);
+  while(thread->changed) {
+    g_cond_wait(&engine.cond, &engine.lock);
+  }
+  ring->thread = NULL;
+  engine.numRings--;
+
+  if(engine.numRings > 0) {
+    g_mutex_unlock(&engine.lock);
+    return;
+  }
+
+  // Nothing left to grab from, so the threads can go
+  numThreads = engine.numThreads;
+  for(i = 0; i < numThreads; i++) {
+    threads[i] = engine.threads[i];
+    threads[i]->quit = TRUE;
+    PylonWaitObjectSignal(threads[i]->wake);
+  }
+  engine.numThreads = 0;
+  g_mutex_unlock(&engine.lock);
+
+  for(i = 0; i < numThreads; i++) {
+    g_thread_join(threads[i]->thread);
+    gst_pylon_grab_engine_free_thread(threads[i]);
+  }
+  GST_DEBUG("Stopped the grab threads.");
+}
@@ -0,0 +1,57 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONGRABENGINE_H_
+#define _GST_PYLONGRABENGINE_H_
+
+#include <gst/gst.h>
+#include "pylonc/PylonC.h"
+
+G_BEGIN_DECLS
+
+#define GST_PYLON_GRAB_ENGINE_MAX_THREADS 16
+
+typedef struct _GstPylonGrabRing GstPylonGrabRing;
+typedef struct _GstPylonGrabThread GstPylonGrabThread;
+
+/* Grab results of one camera, filled by the grab engine (or by pylonsrc itself when it doesn't use the engine) and emptied by the camera's pylonsrc */
+struct _GstPylonGrabRing
+{
+  PYLON_STREAMGRABBER_HANDLE streamGrabber;
+  PYLON_WAITOBJECT_HANDLE waitObject;
+  GstPylonGrabThread *thread; // Engine thread serving the camera, NULL if it isn't added to the engine.
+
+  GMutex lock; // Protects the ring, and keeps the engine and pylonsrc from using the stream grabber at the same time.
+  GCond cond; // Signalled when results are added.
+  PylonGrabResult_t *results;
+  guint head, count, capacity;
+};
+
+void gst_pylon_grab_ring_init (GstPylonGrabRing * ring, PYLON_STREAMGRABBER_HANDLE streamGrabber, PYLON_WAITOBJECT_HANDLE waitObject, guint capacity);
+void gst_pylon_grab_ring_clear (GstPylonGrabRing * ring);
+gboolean gst_pylon_grab_ring_pop (GstPylonGrabRing * ring, PylonGrabResult_t * result, guint timeout, guint * remaining);
+guint gst_pylon_grab_ring_retrieve (GstPylonGrabRing * ring);
+GENAPIC_RESULT gst_pylon_grab_ring_queue (GstPylonGrabRing * ring, PYLON_STREAMBUFFER_HANDLE buffer, const void * context);
+
+gboolean gst_pylon_grab_engine_add (GstPylonGrabRing * ring, guint threads);
+void gst_pylon_grab_engine_remove (GstPylonGrabRing * ring);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,120 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * GstPylonMeta - per frame capture information.
+ *
+ * This file is compiled into every plugin that produces or reads the meta, so
+ * both the API type and the meta info are looked up by name before being
+ * registered, as whichever plugin gets loaded first registers them.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylonmeta.h"
+
+GType
+gst_pylon_meta_api_get_type (void)
+{
+  static volatile GType type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = g_type_from_name ("GstPylonMetaAPI");
+    if (_type == 0) {
+      _type = gst_meta_api_type_register ("GstPylonMetaAPI", tags);
+    }
+    g_once_init_leave (&type, _type);
+  }
+
+  return type;
+}
+
+static gboolean
+gst_pylon_meta_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+  GstPylonMeta *pylonMeta = (GstPylonMeta *) meta;
+
+  pylonMeta->framecounter = 0;
+  pylonMeta->cameratimestamp = 0;
+  pylonMeta->exposurestart = GST_CLOCK_TIME_NONE;
+  pylonMeta->grabtime = GST_CLOCK_TIME_NONE;
+  pylonMeta->chunks = 0;
+  pylonMeta->exposuretime = 0.0;
+  pylonMeta->gain = 0.0;
+  pylonMeta->linestatus = 0;
+  pylonMeta->chunkcounter = 0;
+
+  return TRUE;
+}
+
+static gboolean
+gst_pylon_meta_transform (GstBuffer * dest, GstMeta * meta, GstBuffer * buffer, GQuark type, gpointer data)
+{
+  GstPylonMeta *pylonMeta = (GstPylonMeta *) meta;
+  GstPylonMeta *destMeta;
+
+  // The capture information stays true for any buffer derived from the frame, so it's copied over for all transformations.
+  destMeta = gst_buffer_add_pylon_meta (dest, pylonMeta->framecounter, pylonMeta->cameratimestamp, pylonMeta->exposurestart, pylonMeta->grabtime);
+  if (!destMeta) {
+    return FALSE;
+  }
+
+  destMeta->chunks = pylonMeta->chunks;
+  destMeta->exposuretime = pylonMeta->exposuretime;
+  destMeta->gain = pylonMeta->gain;
+  destMeta->linestatus = pylonMeta->linestatus;
+  destMeta->chunkcounter = pylonMeta->chunkcounter;
+
+  return TRUE;
+}
+
+const GstMetaInfo *
+gst_pylon_meta_get_info (void)
+{
+  static const GstMetaInfo *info = NULL;
+
+  if (g_once_init_enter ((GstMetaInfo **) & info)) {
+    const GstMetaInfo *_info = gst_meta_get_info ("GstPylonMeta");
+    if (_info == NULL) {
+      _info = gst_meta_register (GST_PYLON_META_API_TYPE, "GstPylonMeta", sizeof (GstPylonMeta),
+          gst_pylon_meta_init, (GstMetaFreeFunction) NULL, gst_pylon_meta_transform);
+    }
+    g_once_init_leave ((GstMetaInfo **) & info, (GstMetaInfo *) _info);
+  }
+
+  return info;
+}
+
+GstPylonMeta *
+gst_buffer_add_pylon_meta (GstBuffer * buffer, guint64 framecounter, guint64 cameratimestamp, GstClockTime exposurestart, GstClockTime grabtime)
+{
+  GstPylonMeta *pylonMeta = (GstPylonMeta *) gst_buffer_add_meta (buffer, GST_PYLON_META_INFO, NULL);
+
+  if (pylonMeta) {
+    pylonMeta->framecounter = framecounter;
+    pylonMeta->cameratimestamp = cameratimestamp;
+    pylonMeta->exposurestart = exposurestart;
+    pylonMeta->grabtime = grabtime;
+  }
+
+  return pylonMeta;
+}
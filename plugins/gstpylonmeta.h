@@ -0,0 +1,65 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONMETA_H_
+#define _GST_PYLONMETA_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_PYLON_META_API_TYPE (gst_pylon_meta_api_get_type())
+#define GST_PYLON_META_INFO (gst_pylon_meta_get_info())
+#define gst_buffer_get_pylon_meta(b) ((GstPylonMeta*)gst_buffer_get_meta((b), GST_PYLON_META_API_TYPE))
+
+typedef struct _GstPylonMeta GstPylonMeta;
+
+/* Fields of GstPylonMeta that were read from the frame's chunk data */
+typedef enum {
+  GST_PYLON_META_EXPOSURETIME = (1 << 0),
+  GST_PYLON_META_GAIN = (1 << 1),
+  GST_PYLON_META_LINESTATUS = (1 << 2),
+  GST_PYLON_META_CHUNKCOUNTER = (1 << 3)
+} GstPylonMetaChunks;
+
+/* Capture information pylonsrc attaches to every frame. Times are in the pipeline clock's time. */
+struct _GstPylonMeta
+{
+  GstMeta meta;
+
+  guint64 framecounter; // Camera's frame counter (block ID), gaps mean frames were lost before reaching us.
+  guint64 cameratimestamp; // Camera's timestamp of the frame in camera clock ticks.
+  GstClockTime exposurestart; // Estimated time the exposure of the frame started.
+  GstClockTime grabtime; // Time the frame was retrieved from the stream grabber.
+
+  // Values the camera actually used for the frame, sent along with it as chunk data. Only valid if set in chunks.
+  GstPylonMetaChunks chunks;
+  gdouble exposuretime; // Exposure time in microseconds.
+  gdouble gain; // Gain in dB.
+  guint64 linestatus; // Status of the I/O lines when the frame was taken, one bit per line.
+  guint64 chunkcounter; // Camera's frame counter.
+};
+
+GType gst_pylon_meta_api_get_type (void);
+const GstMetaInfo *gst_pylon_meta_get_info (void);
+GstPylonMeta *gst_buffer_add_pylon_meta (GstBuffer * buffer, guint64 framecounter, guint64 cameratimestamp, GstClockTime exposurestart, GstClockTime grabtime);
+
+G_END_DECLS
+
+#endif
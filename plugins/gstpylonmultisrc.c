@@ -0,0 +1,951 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+/**
+ * SECTION:element-pylonmultisrc
+ *
+ * The pylonmultisrc element captures from several cameras at once and outputs
+ * the frames that were taken together (by the same trigger) as a set.
+ *
+ * Each camera is driven by its own pylonsrc (named camera_SERIAL, so its
+ * properties can be set individually), which grabs in its own thread. The
+ * properties in the settings property are applied to all of them. Frames are
+ * paired up using the cameras' frame counters, and checked against the time
+ * their exposure started so that a camera that missed a trigger or started
+ * late doesn't shift the sets. Frames that end up without a partner are
+ * dropped.
+ *
+ * In the aligned mode every camera gets a src_SERIAL pad, and all frames of a
+ * set are given the same timestamp. In the batched mode the sets are pushed
+ * as buffer lists (one buffer per camera, in the order of the cameras
+ * property) on a single src pad, which requires the cameras to produce the
+ * same caps.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 pylonmultisrc cameras=22000000,22000001 settings="continuous=false, triggersource=line1" name=src src.src_22000000 ! queue ! bayer2rgb ! videoconvert ! xvimagesink src.src_22000001 ! queue ! bayer2rgb ! videoconvert ! xvimagesink
+ * ]|
+ * Shows two hardware triggered cameras side by side.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylonmultisrc.h"
+#include "gstpylonmeta.h"
+#include <gst/gst.h>
+
+#include <string.h> //strcmp
+
+/* debug category */
+GST_DEBUG_CATEGORY_STATIC (gst_pylon_multisrc_debug_category);
+#define GST_CAT_DEFAULT gst_pylon_multisrc_debug_category
+#define GST_MESSAGE_OBJECT(obj, ...) GST_CAT_LEVEL_LOG(GST_CAT_DEFAULT, GST_LEVEL_NONE, obj, __VA_ARGS__)
+
+/* prototypes */
+static void gst_pylon_multisrc_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_pylon_multisrc_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_pylon_multisrc_finalize (GObject * object);
+static GstStateChangeReturn gst_pylon_multisrc_change_state (GstElement * element,
+    GstStateChange transition);
+
+static void gst_pylon_multisrc_sync_finalize (GObject * object);
+static GstStateChangeReturn gst_pylon_multisrc_sync_change_state (GstElement * element,
+    GstStateChange transition);
+static GstFlowReturn gst_pylon_multisrc_sync_chain (GstPad * pad,
+    GstObject * parent, GstBuffer * buf);
+static gboolean gst_pylon_multisrc_sync_sink_event (GstPad * pad,
+    GstObject * parent, GstEvent * event);
+static gboolean gst_pylon_multisrc_sync_sink_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+static gboolean gst_pylon_multisrc_sync_src_query (GstPad * pad,
+    GstObject * parent, GstQuery * query);
+
+/* parameters */
+enum
+{
+  PROP_0,
+  PROP_CAMERAS,
+  PROP_SETTINGS,
+  PROP_MODE,
+  PROP_TOLERANCE,
+  PROP_MAXLAG,
+  PROP_SETS,
+  PROP_DROPPED
+};
+
+#define DEFAULT_MAXLAG 5
+
+/* pad templates */
+static GstStaticPadTemplate gst_pylon_multisrc_aligned_template =
+GST_STATIC_PAD_TEMPLATE ("src_%s",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS_ANY
+    );
+
+static GstStaticPadTemplate gst_pylon_multisrc_batched_template =
+GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS_ANY
+    );
+
+/* class initialisation */
+G_DEFINE_TYPE_WITH_CODE (GstPylonMultisrc, gst_pylon_multisrc, GST_TYPE_BIN,
+  GST_DEBUG_CATEGORY_INIT (gst_pylon_multisrc_debug_category, "pylonmultisrc", 0,
+  "debug category for pylonmultisrc element"));
+G_DEFINE_TYPE (GstPylonMultisrcSync, gst_pylon_multisrc_sync, GST_TYPE_ELEMENT);
+
+static void
+gst_pylon_multisrc_class_init (GstPylonMultisrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &gst_pylon_multisrc_aligned_template);
+  gst_element_class_add_static_pad_template (element_class, &gst_pylon_multisrc_batched_template);
+
+  gst_element_class_set_static_metadata (element_class,
+      "Synchronised multi-camera source", "Source/Video/Device", "Captures from several Basler cameras at once and outputs the frames taken by the same trigger together",
+      "Ingmars Melkis <contact@zingmars.me>");
+
+  gobject_class->set_property = gst_pylon_multisrc_set_property;
+  gobject_class->get_property = gst_pylon_multisrc_get_property;
+  gobject_class->finalize = gst_pylon_multisrc_finalize;
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_pylon_multisrc_change_state);
+
+  g_object_class_install_property (gobject_class, PROP_CAMERAS,
+      g_param_spec_string ("cameras", "Camera serial numbers", "(<serial>,<serial>,...) Serial numbers of the cameras to capture from, separated by commas. Can only be changed while the element is stopped.", "",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_SETTINGS,
+      g_param_spec_string ("settings", "Camera settings", "(<property>=<value>, ...) pylonsrc properties applied to every camera, separated by commas like the fields of caps. Values containing spaces or commas have to be quoted. For example \"continuous=false, triggersource=line1, exposure=5000\". The cameras can also be configured one by one through the camera_<serial> child elements.", "",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MODE,
+      g_param_spec_string ("mode", "Output mode", "(aligned, batched) With \"aligned\" every camera gets its own pad and the frames of a set share the same timestamp. With \"batched\" each set is pushed as a buffer list on a single pad.", "aligned",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TOLERANCE,
+      g_param_spec_uint64 ("tolerance", "Time tolerance", "(Number) Largest difference between the exposure start times of the frames in a set, in nanoseconds. Frames further apart are not considered to belong to the same trigger. 0 uses half of the time between frames.", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MAXLAG,
+      g_param_spec_uint ("maxlag", "Maximum lag", "(Number) Number of frames a camera can get ahead of the others. Its oldest frames are dropped after that.", 1, 1000, DEFAULT_MAXLAG,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_SETS,
+      g_param_spec_uint64 ("sets", "Sets", "(Read only) Number of complete frame sets pushed.", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DROPPED,
+      g_param_spec_uint64 ("dropped", "Dropped frames", "(Read only) Number of frames dropped because the other cameras had no frame to pair them with.", 0, G_MAXUINT64, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+}
+
+static void
+gst_pylon_multisrc_init (GstPylonMultisrc * multisrc)
+{
+  multisrc->cameras = NULL;
+  multisrc->serials = NULL;
+  multisrc->numCameras = 0;
+  multisrc->sources = NULL;
+  multisrc->sync = NULL;
+  multisrc->ghostPads = NULL;
+  multisrc->numGhostPads = 0;
+  multisrc->settings = NULL;
+  multisrc->mode = GST_PYLONMULTISRC_MODE_ALIGNED;
+  multisrc->tolerance = 0;
+  multisrc->maxLag = DEFAULT_MAXLAG;
+}
+
+static void
+gst_pylon_multisrc_finalize (GObject * object)
+{
+  GstPylonMultisrc *multisrc = GST_PYLONMULTISRC (object);
+
+  // The sources themselves are owned by the bin
+  g_free(multisrc->sources);
+  g_strfreev(multisrc->serials);
+  g_free(multisrc->cameras);
+  g_free(multisrc->settings);
+
+  G_OBJECT_CLASS (gst_pylon_multisrc_parent_class)->finalize (object);
+}
+
+/* Sets one of the fields of the settings property on a pylonsrc element */
+static gboolean
+gst_pylon_multisrc_apply_setting (GQuark field, const GValue * value, gpointer user_data)
+{
+  GstElement *source = user_data;
+  const gchar *name = g_quark_to_string(field);
+  gchar *serialized;
+
+  if(!g_object_class_find_property(G_OBJECT_GET_CLASS(source), name) || strcmp(name, "name") == 0 || strcmp(name, "camera") == 0 || strcmp(name, "serial") == 0) {
+    GST_WARNING_OBJECT(source, "Ignoring invalid camera setting \"%s\".", name);
+    return TRUE;
+  }
+
+  // Strings are set as they are, anything else the way it was written
+  if(G_VALUE_HOLDS_STRING(value)) {
+    gst_util_set_object_arg(G_OBJECT(source), name, g_value_get_string(value));
+  } else {
+    serialized = gst_value_serialize(value);
+    gst_util_set_object_arg(G_OBJECT(source), name, serialized);
+    g_free(serialized);
+  }
+  return TRUE;
+}
+
+/* Sets the properties listed in the settings property on one of the pylonsrc elements. They're parsed as the fields of a GstStructure, so values can be quoted. */
+static void
+gst_pylon_multisrc_apply_settings (GstPylonMultisrc * multisrc, GstElement * source)
+{
+  GstStructure *settings;
+  gchar *description;
+
+  if(!multisrc->settings || multisrc->settings[strspn(multisrc->settings, " \t\n")] == '\0') {
+    return;
+  }
+
+  description = g_strdup_printf("settings, %s", multisrc->settings);
+  settings = gst_structure_from_string(description, NULL);
+  g_free(description);
+  if(!settings) {
+    GST_WARNING_OBJECT(multisrc, "Couldn't parse the camera settings \"%s\".", multisrc->settings);
+    return;
+  }
+
+  gst_structure_foreach(settings, gst_pylon_multisrc_apply_setting, source);
+  gst_structure_free(settings);
+}
+
+/* Replaces the pylonsrc elements with one for each of the serial numbers in the cameras property */
+static void
+gst_pylon_multisrc_create_sources (GstPylonMultisrc * multisrc)
+{
+  gchar **serials, *name;
+  GPtrArray *unique;
+  GstElement *source;
+  guint i, j;
+
+  for(i = 0; i < multisrc->numCameras; i++) {
+    gst_bin_remove(GST_BIN(multisrc), multisrc->sources[i]);
+  }
+  g_free(multisrc->sources);
+  g_strfreev(multisrc->serials);
+  multisrc->sources = NULL;
+  multisrc->serials = NULL;
+  multisrc->numCameras = 0;
+
+  if(!multisrc->cameras) {
+    return;
+  }
+
+  unique = g_ptr_array_new();
+  serials = g_strsplit(multisrc->cameras, ",", -1);
+  for(i = 0; serials[i]; i++) {
+    g_strstrip(serials[i]);
+    for(j = 0; j < unique->len && strcmp(g_ptr_array_index(unique, j), serials[i]) != 0; j++);
+    if(serials[i][0] == '\0' || j < unique->len) {
+      continue;
+    }
+    g_ptr_array_add(unique, g_strdup(serials[i]));
+  }
+  g_strfreev(serials);
+  g_ptr_array_add(unique, NULL);
+  multisrc->serials = (gchar **) g_ptr_array_free(unique, FALSE);
+
+  multisrc->sources = g_new0(GstElement *, g_strv_length(multisrc->serials));
+  for(i = 0; multisrc->serials[i]; i++) {
+    name = g_strdup_printf("camera_%s", multisrc->serials[i]);
+    source = gst_element_factory_make("pylonsrc", name);
+    g_free(name);
+    if(!source) {
+      GST_ERROR_OBJECT(multisrc, "Couldn't create a pylonsrc for camera %s.", multisrc->serials[i]);
+      break;
+    }
+
+    g_object_set(source, "serial", multisrc->serials[i], NULL);
+    gst_pylon_multisrc_apply_settings(multisrc, source);
+    gst_bin_add(GST_BIN(multisrc), source);
+    multisrc->sources[i] = source;
+    multisrc->numCameras++;
+  }
+
+  GST_DEBUG_OBJECT(multisrc, "Capturing from %u camera(s).", multisrc->numCameras);
+}
+
+void
+gst_pylon_multisrc_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstPylonMultisrc *multisrc = GST_PYLONMULTISRC (object);
+  guint i;
+
+  switch (property_id) {
+    case PROP_CAMERAS:
+      if(GST_STATE(multisrc) != GST_STATE_NULL) {
+        GST_WARNING_OBJECT(multisrc, "The cameras can only be changed while the element is stopped.");
+        break;
+      }
+      g_free(multisrc->cameras);
+      multisrc->cameras = g_value_dup_string(value);
+      gst_pylon_multisrc_create_sources(multisrc);
+      break;
+    case PROP_SETTINGS:
+      g_free(multisrc->settings);
+      multisrc->settings = g_value_dup_string(value);
+      for(i = 0; i < multisrc->numCameras; i++) {
+        gst_pylon_multisrc_apply_settings(multisrc, multisrc->sources[i]);
+      }
+      break;
+    case PROP_MODE:
+      if(g_ascii_strcasecmp(g_value_get_string(value), "batched") == 0) {
+        multisrc->mode = GST_PYLONMULTISRC_MODE_BATCHED;
+      } else if(g_ascii_strcasecmp(g_value_get_string(value), "aligned") == 0) {
+        multisrc->mode = GST_PYLONMULTISRC_MODE_ALIGNED;
+      } else {
+        GST_WARNING_OBJECT(multisrc, "Invalid parameter value for mode. Available values are aligned/batched, while the value provided was \"%s\".", g_value_get_string(value));
+      }
+      break;
+    case PROP_TOLERANCE:
+      multisrc->tolerance = g_value_get_uint64(value);
+      break;
+    case PROP_MAXLAG:
+      multisrc->maxLag = g_value_get_uint(value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_pylon_multisrc_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstPylonMultisrc *multisrc = GST_PYLONMULTISRC (object);
+  GstPylonMultisrcSync *sync = multisrc->sync ? GST_PYLONMULTISRC_SYNC(multisrc->sync) : NULL;
+
+  switch (property_id) {
+    case PROP_CAMERAS:
+      g_value_set_string(value, multisrc->cameras);
+      break;
+    case PROP_SETTINGS:
+      g_value_set_string(value, multisrc->settings);
+      break;
+    case PROP_MODE:
+      g_value_set_string(value, multisrc->mode == GST_PYLONMULTISRC_MODE_BATCHED ? "batched" : "aligned");
+      break;
+    case PROP_TOLERANCE:
+      g_value_set_uint64(value, multisrc->tolerance);
+      break;
+    case PROP_MAXLAG:
+      g_value_set_uint(value, multisrc->maxLag);
+      break;
+    case PROP_SETS:
+      if(sync) {
+        g_mutex_lock(&sync->lock);
+        g_value_set_uint64(value, sync->sets);
+        g_mutex_unlock(&sync->lock);
+      } else {
+        g_value_set_uint64(value, 0);
+      }
+      break;
+    case PROP_DROPPED:
+      if(sync) {
+        g_mutex_lock(&sync->lock);
+        g_value_set_uint64(value, sync->dropped);
+        g_mutex_unlock(&sync->lock);
+      } else {
+        g_value_set_uint64(value, 0);
+      }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+/* Creates the element that pairs up the frames, links the cameras to it and exposes its outputs */
+static gboolean
+gst_pylon_multisrc_link (GstPylonMultisrc * multisrc)
+{
+  GstElementClass *element_class = GST_ELEMENT_GET_CLASS(multisrc);
+  GstPylonMultisrcSync *sync;
+  GstPad *srcpad, *ghostPad;
+  gchar *name;
+  guint i;
+
+  sync = g_object_new(GST_TYPE_PYLONMULTISRC_SYNC, "name", "sync", NULL);
+  sync->numCameras = multisrc->numCameras;
+  sync->cameras = g_new0(GstPylonMultisrcCamera, sync->numCameras);
+  sync->mode = multisrc->mode;
+  sync->tolerance = multisrc->tolerance;
+  sync->maxLag = multisrc->maxLag;
+
+  for(i = 0; i < sync->numCameras; i++) {
+    GstPylonMultisrcCamera *camera = &sync->cameras[i];
+
+    g_queue_init(&camera->frames);
+    camera->lastTime = GST_CLOCK_TIME_NONE;
+
+    name = g_strdup_printf("sink_%u", i);
+    camera->sinkpad = gst_pad_new(name, GST_PAD_SINK);
+    g_free(name);
+    gst_pad_set_element_private(camera->sinkpad, camera);
+    gst_pad_set_chain_function(camera->sinkpad, GST_DEBUG_FUNCPTR(gst_pylon_multisrc_sync_chain));
+    gst_pad_set_event_function(camera->sinkpad, GST_DEBUG_FUNCPTR(gst_pylon_multisrc_sync_sink_event));
+    gst_pad_set_query_function(camera->sinkpad, GST_DEBUG_FUNCPTR(gst_pylon_multisrc_sync_sink_query));
+    gst_element_add_pad(GST_ELEMENT(sync), camera->sinkpad);
+
+    if(sync->mode == GST_PYLONMULTISRC_MODE_ALIGNED) {
+      name = g_strdup_printf("src_%u", i);
+      camera->srcpad = gst_pad_new(name, GST_PAD_SRC);
+      g_free(name);
+      gst_pad_set_element_private(camera->srcpad, camera);
+      gst_pad_set_query_function(camera->srcpad, GST_DEBUG_FUNCPTR(gst_pylon_multisrc_sync_src_query));
+      gst_element_add_pad(GST_ELEMENT(sync), camera->srcpad);
+    }
+  }
+
+  if(sync->mode == GST_PYLONMULTISRC_MODE_BATCHED) {
+    sync->srcpad = gst_pad_new("src", GST_PAD_SRC);
+    gst_pad_set_query_function(sync->srcpad, GST_DEBUG_FUNCPTR(gst_pylon_multisrc_sync_src_query));
+    gst_element_add_pad(GST_ELEMENT(sync), sync->srcpad);
+  }
+
+  multisrc->sync = GST_ELEMENT(sync);
+  gst_bin_add(GST_BIN(multisrc), multisrc->sync);
+
+  for(i = 0; i < multisrc->numCameras; i++) {
+    srcpad = gst_element_get_static_pad(multisrc->sources[i], "src");
+    if(gst_pad_link(srcpad, sync->cameras[i].sinkpad) != GST_PAD_LINK_OK) {
+      GST_ERROR_OBJECT(multisrc, "Couldn't link camera %s.", multisrc->serials[i]);
+      gst_object_unref(srcpad);
+      return FALSE;
+    }
+    gst_object_unref(srcpad);
+  }
+
+  // Expose the outputs
+  if(sync->mode == GST_PYLONMULTISRC_MODE_BATCHED) {
+    multisrc->ghostPads = g_new0(GstPad *, 1);
+    ghostPad = gst_ghost_pad_new_from_template("src", sync->srcpad, gst_element_class_get_pad_template(element_class, "src"));
+    gst_element_add_pad(GST_ELEMENT(multisrc), ghostPad);
+    multisrc->ghostPads[multisrc->numGhostPads++] = ghostPad;
+  } else {
+    multisrc->ghostPads = g_new0(GstPad *, multisrc->numCameras);
+    for(i = 0; i < multisrc->numCameras; i++) {
+      name = g_strdup_printf("src_%s", multisrc->serials[i]);
+      ghostPad = gst_ghost_pad_new_from_template(name, sync->cameras[i].srcpad, gst_element_class_get_pad_template(element_class, "src_%s"));
+      g_free(name);
+      gst_element_add_pad(GST_ELEMENT(multisrc), ghostPad);
+      multisrc->ghostPads[multisrc->numGhostPads++] = ghostPad;
+    }
+  }
+  gst_element_no_more_pads(GST_ELEMENT(multisrc));
+
+  return TRUE;
+}
+
+/* Removes the outputs and the element that pairs up the frames */
+static void
+gst_pylon_multisrc_unlink (GstPylonMultisrc * multisrc)
+{
+  guint i;
+
+  for(i = 0; i < multisrc->numGhostPads; i++) {
+    gst_element_remove_pad(GST_ELEMENT(multisrc), multisrc->ghostPads[i]);
+  }
+  g_free(multisrc->ghostPads);
+  multisrc->ghostPads = NULL;
+  multisrc->numGhostPads = 0;
+
+  if(multisrc->sync) {
+    gst_element_set_state(multisrc->sync, GST_STATE_NULL);
+    gst_bin_remove(GST_BIN(multisrc), multisrc->sync);
+    multisrc->sync = NULL;
+  }
+}
+
+static GstStateChangeReturn
+gst_pylon_multisrc_change_state (GstElement * element, GstStateChange transition)
+{
+  GstPylonMultisrc *multisrc = GST_PYLONMULTISRC (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if(multisrc->numCameras == 0) {
+        GST_ELEMENT_ERROR(multisrc, RESOURCE, SETTINGS, ("No cameras selected"), ("Set the cameras property to the serial numbers of the cameras."));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      if(!gst_pylon_multisrc_link(multisrc)) {
+        gst_pylon_multisrc_unlink(multisrc);
+        GST_ELEMENT_ERROR(multisrc, CORE, PAD, ("Failed to link the cameras"), (NULL));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_pylon_multisrc_parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if(ret == GST_STATE_CHANGE_FAILURE) {
+        gst_pylon_multisrc_unlink(multisrc);
+      }
+      break;
+    case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_pylon_multisrc_unlink(multisrc);
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+/* Frame synchronisation */
+static void
+gst_pylon_multisrc_sync_class_init (GstPylonMultisrcSyncClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+
+  gst_element_class_set_static_metadata (element_class,
+      "Pylon frame synchroniser", "Generic", "Collects the frames of several cameras into sets (used internally by pylonmultisrc)",
+      "Ingmars Melkis <contact@zingmars.me>");
+
+  gobject_class->finalize = gst_pylon_multisrc_sync_finalize;
+  element_class->change_state = GST_DEBUG_FUNCPTR (gst_pylon_multisrc_sync_change_state);
+}
+
+static void
+gst_pylon_multisrc_sync_init (GstPylonMultisrcSync * sync)
+{
+  g_mutex_init(&sync->lock);
+  g_mutex_init(&sync->pushLock);
+  sync->cameras = NULL;
+  sync->numCameras = 0;
+  sync->srcpad = NULL;
+  sync->eos = FALSE;
+  sync->lastFlow = GST_FLOW_OK;
+  sync->sets = 0;
+  sync->dropped = 0;
+}
+
+/* Empties the queues and forgets how the cameras' frame counters relate. With keepSticky the queued sticky events
+ * other than segments stay, as upstream won't send them again after a flush. Must be called with the lock held. */
+static void
+gst_pylon_multisrc_sync_flush (GstPylonMultisrcSync * sync, gboolean keepSticky)
+{
+  GstMiniObject *item;
+  GQueue kept = G_QUEUE_INIT;
+  guint i;
+
+  for(i = 0; i < sync->numCameras; i++) {
+    while((item = g_queue_pop_head(&sync->cameras[i].frames))) {
+      if(keepSticky && GST_IS_EVENT(item) && GST_EVENT_IS_STICKY(item) && GST_EVENT_TYPE(item) != GST_EVENT_SEGMENT && GST_EVENT_TYPE(item) != GST_EVENT_EOS) {
+        g_queue_push_tail(&kept, item);
+      } else {
+        gst_mini_object_unref(item);
+      }
+    }
+    while((item = g_queue_pop_head(&kept))) {
+      g_queue_push_tail(&sync->cameras[i].frames, item);
+    }
+    sync->cameras[i].started = FALSE;
+    sync->cameras[i].lastTime = GST_CLOCK_TIME_NONE;
+    sync->cameras[i].interval = 0;
+  }
+}
+
+static void
+gst_pylon_multisrc_sync_finalize (GObject * object)
+{
+  GstPylonMultisrcSync *sync = GST_PYLONMULTISRC_SYNC (object);
+
+  gst_pylon_multisrc_sync_flush(sync, FALSE);
+  g_free(sync->cameras);
+  g_mutex_clear(&sync->lock);
+  g_mutex_clear(&sync->pushLock);
+
+  G_OBJECT_CLASS (gst_pylon_multisrc_sync_parent_class)->finalize (object);
+}
+
+static GstStateChangeReturn
+gst_pylon_multisrc_sync_change_state (GstElement * element, GstStateChange transition)
+{
+  GstPylonMultisrcSync *sync = GST_PYLONMULTISRC_SYNC (element);
+  GstStateChangeReturn ret;
+
+  if(transition == GST_STATE_CHANGE_READY_TO_PAUSED) {
+    g_mutex_lock(&sync->lock);
+    gst_pylon_multisrc_sync_flush(sync, FALSE);
+    sync->eos = FALSE;
+    sync->lastFlow = GST_FLOW_OK;
+    sync->sets = 0;
+    sync->dropped = 0;
+    g_mutex_unlock(&sync->lock);
+  }
+
+  ret = GST_ELEMENT_CLASS (gst_pylon_multisrc_sync_parent_class)->change_state (element, transition);
+
+  if(transition == GST_STATE_CHANGE_PAUSED_TO_READY) {
+    g_mutex_lock(&sync->lock);
+    gst_pylon_multisrc_sync_flush(sync, FALSE);
+    g_mutex_unlock(&sync->lock);
+  }
+
+  return ret;
+}
+
+/* Reads the frame counter and the time the exposure of a frame started. Buffers without GstPylonMeta fall back to their offset and timestamp. */
+static void
+gst_pylon_multisrc_sync_frame_info (GstBuffer * buf, gint64 * counter, GstClockTime * time)
+{
+  GstPylonMeta *meta = gst_buffer_get_pylon_meta(buf);
+
+  *counter = (gint64) GST_BUFFER_OFFSET(buf);
+  *time = GST_BUFFER_PTS(buf);
+  if(meta) {
+    *counter = (gint64) ((meta->chunks & GST_PYLON_META_CHUNKCOUNTER) ? meta->chunkcounter : meta->framecounter);
+    if(GST_CLOCK_TIME_IS_VALID(meta->exposurestart)) {
+      *time = meta->exposurestart;
+    } else if(GST_CLOCK_TIME_IS_VALID(meta->grabtime)) {
+      *time = meta->grabtime;
+    }
+  }
+}
+
+static void
+gst_pylon_multisrc_sync_drop (GstPylonMultisrcSync * sync, guint index)
+{
+  GstBuffer *buf = g_queue_pop_head(&sync->cameras[index].frames);
+
+  GST_DEBUG_OBJECT(sync, "Dropping frame %"G_GUINT64_FORMAT" of camera %u, there's no frame from the other cameras to pair it with.", GST_BUFFER_OFFSET(buf), index);
+  gst_buffer_unref(buf);
+  sync->dropped++;
+}
+
+/* Takes the next complete set off the queues. Frames that can't become part of a set anymore are dropped on the way.
+ * Returns FALSE if a frame of the next set hasn't arrived yet, or an event is waiting in front of it. Must be called with the lock held. */
+static gboolean
+gst_pylon_multisrc_sync_collect (GstPylonMultisrcSync * sync, GstBuffer ** set)
+{
+  GstPylonMultisrcCamera *camera;
+  GstBuffer *head;
+  GstClockTime time, earliest, latest, tolerance;
+  gint64 counter, newest;
+  gboolean dropped;
+  guint i;
+
+  while(TRUE) {
+    newest = G_MININT64;
+    earliest = GST_CLOCK_TIME_NONE;
+    latest = 0;
+    for(i = 0; i < sync->numCameras; i++) {
+      camera = &sync->cameras[i];
+      head = g_queue_peek_head(&camera->frames);
+      // An event has to go out before the camera's next frame can be part of a set
+      if(!head || GST_IS_EVENT(head)) {
+        return FALSE;
+      }
+
+      gst_pylon_multisrc_sync_frame_info(head, &counter, &time);
+      newest = MAX(newest, counter - camera->base);
+      if(GST_CLOCK_TIME_IS_VALID(time)) {
+        earliest = GST_CLOCK_TIME_IS_VALID(earliest) ? MIN(earliest, time) : time;
+        latest = MAX(latest, time);
+      }
+    }
+
+    // A gap in the counter means the camera lost frames. The other cameras' frames from those triggers have nothing to pair with.
+    dropped = FALSE;
+    for(i = 0; i < sync->numCameras; i++) {
+      camera = &sync->cameras[i];
+      gst_pylon_multisrc_sync_frame_info(g_queue_peek_head(&camera->frames), &counter, &time);
+      if(counter - camera->base < newest) {
+        gst_pylon_multisrc_sync_drop(sync, i);
+        dropped = TRUE;
+      }
+    }
+    if(dropped) {
+      continue;
+    }
+
+    // The counters agree, but the frames weren't taken at the same time. A camera started after the first trigger, or missed one without counting it.
+    // The early frames belong to a trigger the late cameras don't have a frame from, so they're dropped and their cameras' counters realigned.
+    tolerance = sync->tolerance ? sync->tolerance : sync->cameras[0].interval / 2;
+    if(tolerance > 0 && GST_CLOCK_TIME_IS_VALID(earliest) && latest - earliest > tolerance) {
+      for(i = 0; i < sync->numCameras; i++) {
+        camera = &sync->cameras[i];
+        gst_pylon_multisrc_sync_frame_info(g_queue_peek_head(&camera->frames), &counter, &time);
+        if(GST_CLOCK_TIME_IS_VALID(time) && time + tolerance < latest) {
+          gst_pylon_multisrc_sync_drop(sync, i);
+          camera->base++;
+        }
+      }
+      continue;
+    }
+
+    for(i = 0; i < sync->numCameras; i++) {
+      set[i] = g_queue_pop_head(&sync->cameras[i].frames);
+    }
+    sync->sets++;
+    return TRUE;
+  }
+}
+
+/* Pushes a complete set downstream. Must be called with the push lock held. */
+static GstFlowReturn
+gst_pylon_multisrc_sync_push (GstPylonMultisrcSync * sync, GstBuffer ** set)
+{
+  GstBufferList *list;
+  GstClockTime pts = GST_CLOCK_TIME_NONE;
+  GstFlowReturn ret = GST_FLOW_OK, padRet;
+  guint i, notLinked = 0;
+
+  // Give the whole set the timestamp of its earliest frame, so that the frames are played back together
+  for(i = 0; i < sync->numCameras; i++) {
+    if(GST_BUFFER_PTS_IS_VALID(set[i])) {
+      pts = GST_CLOCK_TIME_IS_VALID(pts) ? MIN(pts, GST_BUFFER_PTS(set[i])) : GST_BUFFER_PTS(set[i]);
+    }
+  }
+  for(i = 0; i < sync->numCameras; i++) {
+    set[i] = gst_buffer_make_writable(set[i]);
+    GST_BUFFER_PTS(set[i]) = pts;
+    GST_BUFFER_DTS(set[i]) = pts;
+  }
+
+  if(sync->mode == GST_PYLONMULTISRC_MODE_BATCHED) {
+    list = gst_buffer_list_new_sized(sync->numCameras);
+    for(i = 0; i < sync->numCameras; i++) {
+      gst_buffer_list_add(list, set[i]);
+    }
+    return gst_pad_push_list(sync->srcpad, list);
+  }
+
+  // Unlinked outputs are fine as long as something is linked
+  for(i = 0; i < sync->numCameras; i++) {
+    padRet = gst_pad_push(sync->cameras[i].srcpad, set[i]);
+    if(padRet == GST_FLOW_NOT_LINKED) {
+      notLinked++;
+    } else if(padRet != GST_FLOW_OK && ret == GST_FLOW_OK) {
+      ret = padRet;
+    }
+  }
+  if(notLinked == sync->numCameras) {
+    ret = GST_FLOW_NOT_LINKED;
+  }
+  return ret;
+}
+
+/* Pad the serialized events of a camera are forwarded to, NULL if they're dropped */
+static GstPad *
+gst_pylon_multisrc_sync_event_pad (GstPylonMultisrcSync * sync, GstPylonMultisrcCamera * camera)
+{
+  // In batched mode the output is described by the first camera's stream
+  if(sync->mode == GST_PYLONMULTISRC_MODE_BATCHED) {
+    return (camera == &sync->cameras[0]) ? sync->srcpad : NULL;
+  }
+  return camera->srcpad;
+}
+
+/* Pushes the events that reached the heads of the queues and the sets that are complete, in the order they were queued in.
+ * Must be called with the push lock held. */
+static GstFlowReturn
+gst_pylon_multisrc_sync_drain (GstPylonMultisrcSync * sync)
+{
+  GstBuffer **set = g_newa(GstBuffer *, sync->numCameras);
+  GstEvent *event;
+  GstPad *pad = NULL;
+  gboolean complete;
+  guint i;
+
+  while(TRUE) {
+    g_mutex_lock(&sync->lock);
+    event = NULL;
+    for(i = 0; i < sync->numCameras && !event; i++) {
+      if(GST_IS_EVENT(g_queue_peek_head(&sync->cameras[i].frames))) {
+        event = g_queue_pop_head(&sync->cameras[i].frames);
+        pad = gst_pylon_multisrc_sync_event_pad(sync, &sync->cameras[i]);
+      }
+    }
+    complete = !event && !sync->eos && gst_pylon_multisrc_sync_collect(sync, set);
+    g_mutex_unlock(&sync->lock);
+
+    if(event) {
+      gst_pad_push_event(pad, event);
+    } else if(complete) {
+      sync->lastFlow = gst_pylon_multisrc_sync_push(sync, set);
+    } else {
+      return sync->lastFlow;
+    }
+  }
+}
+
+static GstFlowReturn
+gst_pylon_multisrc_sync_chain (GstPad * pad, GstObject * parent, GstBuffer * buf)
+{
+  GstPylonMultisrcSync *sync = GST_PYLONMULTISRC_SYNC (parent);
+  GstPylonMultisrcCamera *camera = gst_pad_get_element_private(pad);
+  GstClockTime time;
+  gint64 counter;
+  GstFlowReturn ret;
+
+  // The cameras push from their own threads. Whichever one completes a set pushes it, one at a time so that the sets stay in order.
+  g_mutex_lock(&sync->pushLock);
+  g_mutex_lock(&sync->lock);
+  if(sync->eos) {
+    g_mutex_unlock(&sync->lock);
+    g_mutex_unlock(&sync->pushLock);
+    gst_buffer_unref(buf);
+    return GST_FLOW_EOS;
+  }
+
+  gst_pylon_multisrc_sync_frame_info(buf, &counter, &time);
+  if(!camera->started) {
+    camera->base = counter;
+    camera->started = TRUE;
+  }
+  if(GST_CLOCK_TIME_IS_VALID(time) && GST_CLOCK_TIME_IS_VALID(camera->lastTime) && time > camera->lastTime) {
+    camera->interval = camera->interval ? (camera->interval * 7 + (time - camera->lastTime)) / 8 : time - camera->lastTime;
+  }
+  camera->lastTime = time;
+
+  g_queue_push_tail(&camera->frames, buf);
+  // The last drain pushed the events that were in front of the oldest frame
+  if(g_queue_get_length(&camera->frames) > sync->maxLag && GST_IS_BUFFER(g_queue_peek_head(&camera->frames))) {
+    gst_pylon_multisrc_sync_drop(sync, camera - sync->cameras);
+  }
+  g_mutex_unlock(&sync->lock);
+
+  ret = gst_pylon_multisrc_sync_drain(sync);
+  g_mutex_unlock(&sync->pushLock);
+
+  return ret;
+}
+
+static gboolean
+gst_pylon_multisrc_sync_sink_event (GstPad * pad, GstObject * parent, GstEvent * event)
+{
+  GstPylonMultisrcSync *sync = GST_PYLONMULTISRC_SYNC (parent);
+  GstPylonMultisrcCamera *camera = gst_pad_get_element_private(pad);
+  GstPad *srcpad = gst_pylon_multisrc_sync_event_pad(sync, camera);
+  gboolean wasEos;
+  guint i;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_EOS:
+      // Once one of the cameras stops no more sets can be completed, so all outputs end
+      g_mutex_lock(&sync->pushLock);
+      g_mutex_lock(&sync->lock);
+      wasEos = sync->eos;
+      sync->eos = TRUE;
+      gst_pylon_multisrc_sync_flush(sync, FALSE);
+      g_mutex_unlock(&sync->lock);
+      if(!wasEos) {
+        if(sync->mode == GST_PYLONMULTISRC_MODE_BATCHED) {
+          gst_pad_push_event(sync->srcpad, gst_event_ref(event));
+        } else {
+          for(i = 0; i < sync->numCameras; i++) {
+            gst_pad_push_event(sync->cameras[i].srcpad, gst_event_ref(event));
+          }
+        }
+      }
+      g_mutex_unlock(&sync->pushLock);
+      gst_event_unref(event);
+      return TRUE;
+    case GST_EVENT_FLUSH_STOP:
+      g_mutex_lock(&sync->lock);
+      gst_pylon_multisrc_sync_flush(sync, TRUE);
+      sync->eos = FALSE;
+      sync->lastFlow = GST_FLOW_OK;
+      g_mutex_unlock(&sync->lock);
+      break;
+    default:
+      break;
+  }
+
+  if(!srcpad) {
+    gst_event_unref(event);
+    return TRUE;
+  }
+  if(!GST_EVENT_IS_SERIALIZED(event) || GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+    return gst_pad_push_event(srcpad, event);
+  }
+
+  // Serialized events (caps, segments, tags) go through the camera's queue, so that they reach downstream between the same frames
+  g_mutex_lock(&sync->pushLock);
+  g_mutex_lock(&sync->lock);
+  g_queue_push_tail(&camera->frames, event);
+  g_mutex_unlock(&sync->lock);
+  gst_pylon_multisrc_sync_drain(sync);
+  g_mutex_unlock(&sync->pushLock);
+  return TRUE;
+}
+
+static gboolean
+gst_pylon_multisrc_sync_sink_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstPylonMultisrcSync *sync = GST_PYLONMULTISRC_SYNC (parent);
+  GstPylonMultisrcCamera *camera = gst_pad_get_element_private(pad);
+
+  // Caps and allocation are decided downstream. In batched mode the cameras share the output.
+  return gst_pad_peer_query(sync->mode == GST_PYLONMULTISRC_MODE_BATCHED ? sync->srcpad : camera->srcpad, query);
+}
+
+static gboolean
+gst_pylon_multisrc_sync_src_query (GstPad * pad, GstObject * parent, GstQuery * query)
+{
+  GstPylonMultisrcSync *sync = GST_PYLONMULTISRC_SYNC (parent);
+  GstPylonMultisrcCamera *camera = gst_pad_get_element_private(pad);
+  GstQuery *peerQuery;
+  gboolean live = FALSE, peerLive, answered = FALSE;
+  GstClockTime min = 0, max = GST_CLOCK_TIME_NONE, peerMin, peerMax;
+  guint i;
+
+  if(GST_QUERY_TYPE(query) == GST_QUERY_LATENCY) {
+    // A set is complete only once the slowest camera delivers its frame
+    for(i = 0; i < sync->numCameras; i++) {
+      peerQuery = gst_query_new_latency();
+      if(gst_pad_peer_query(sync->cameras[i].sinkpad, peerQuery)) {
+        gst_query_parse_latency(peerQuery, &peerLive, &peerMin, &peerMax);
+        live |= peerLive;
+        min = MAX(min, peerMin);
+        if(GST_CLOCK_TIME_IS_VALID(peerMax)) {
+          max = GST_CLOCK_TIME_IS_VALID(max) ? MIN(max, peerMax) : peerMax;
+        }
+        answered = TRUE;
+      }
+      gst_query_unref(peerQuery);
+    }
+    if(answered) {
+      gst_query_set_latency(query, live, min, max);
+    }
+    return answered;
+  }
+
+  return gst_pad_peer_query(camera ? camera->sinkpad : sync->cameras[0].sinkpad, query);
+}
@@ -0,0 +1,110 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONMULTISRC_H_
+#define _GST_PYLONMULTISRC_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_PYLONMULTISRC   (gst_pylon_multisrc_get_type())
+#define GST_PYLONMULTISRC(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PYLONMULTISRC,GstPylonMultisrc))
+#define GST_PYLONMULTISRC_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_PYLONMULTISRC,GstPylonMultisrcClass))
+#define GST_IS_PYLONMULTISRC(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PYLONMULTISRC))
+#define GST_IS_PYLONMULTISRC_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_PYLONMULTISRC))
+
+#define GST_TYPE_PYLONMULTISRC_SYNC   (gst_pylon_multisrc_sync_get_type())
+#define GST_PYLONMULTISRC_SYNC(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PYLONMULTISRC_SYNC,GstPylonMultisrcSync))
+
+typedef struct _GstPylonMultisrc GstPylonMultisrc;
+typedef struct _GstPylonMultisrcClass GstPylonMultisrcClass;
+typedef struct _GstPylonMultisrcSync GstPylonMultisrcSync;
+typedef struct _GstPylonMultisrcSyncClass GstPylonMultisrcSyncClass;
+typedef struct _GstPylonMultisrcCamera GstPylonMultisrcCamera;
+
+typedef enum {
+  GST_PYLONMULTISRC_MODE_ALIGNED, // Every camera gets its own pad, the frames of a set share a timestamp.
+  GST_PYLONMULTISRC_MODE_BATCHED // The frames of a set are pushed together as a buffer list on a single pad.
+} GstPylonMultisrcMode;
+
+struct _GstPylonMultisrc
+{
+  GstBin parent;
+
+  gchar *cameras; // Serial numbers of the cameras, separated by commas.
+  gchar **serials;
+  guint numCameras;
+  GstElement **sources; // A pylonsrc for each camera.
+  GstElement *sync; // Pairs up the frames of the sources, exists from READY onwards.
+  GstPad **ghostPads;
+  guint numGhostPads;
+
+  // Plugin parameters
+  gchar *settings;
+  GstPylonMultisrcMode mode;
+  GstClockTime tolerance;
+  guint maxLag;
+};
+
+struct _GstPylonMultisrcClass
+{
+  GstBinClass parent_class;
+};
+
+// Frames of one camera waiting for the rest of their set.
+struct _GstPylonMultisrcCamera
+{
+  GstPad *sinkpad, *srcpad; // srcpad is NULL in batched mode.
+  GQueue frames; // Frames, and the serialized events that came between them.
+  _Bool started;
+  gint64 base; // Frame counter value that belongs to the first set, moved forward when the camera misses a trigger.
+  GstClockTime lastTime, interval; // Capture time of the previous frame and the average time between frames.
+};
+
+// Internal element of pylonmultisrc that collects the frames of all cameras into sets.
+struct _GstPylonMultisrcSync
+{
+  GstElement parent;
+
+  GstPylonMultisrcCamera *cameras;
+  guint numCameras;
+  GstPad *srcpad; // Only used in batched mode.
+  GstPylonMultisrcMode mode;
+  GstClockTime tolerance;
+  guint maxLag;
+
+  GMutex lock; // Protects the queues.
+  GMutex pushLock; // Held while a set is pushed, so that the camera threads push the sets in order.
+  _Bool eos;
+  GstFlowReturn lastFlow; // Result of pushing the last set, returned to all of the cameras.
+  guint64 sets, dropped;
+};
+
+struct _GstPylonMultisrcSyncClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_pylon_multisrc_get_type (void);
+GType gst_pylon_multisrc_sync_get_type (void);
+
+G_END_DECLS
+
+#endif
@@ -0,0 +1,665 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+/**
+ * SECTION:element-pylonshmsink
+ *
+ * The pylonshmsink element publishes frames to any number of local processes
+ * at once, for example a recorder, an inference process and an operator UI
+ * all using the same camera.
+ *
+ * The frames are written into a ring of slots in a memfd, which the readers
+ * map, so none of them copies the frames. Along with every frame its
+ * timestamps, flags and pylonsrc's capture information (GstPylonMeta) are
+ * kept, and the caps are sent to the readers whenever they change. Readers
+ * connect to the socket at socketpath using the pylonshm library (see
+ * pylonshm.h). A slot isn't reused while a reader holds its frame. When no
+ * slot is free, the readers holding the oldest frame are dropped, as are
+ * readers that don't keep up with the notifications, so a slow reader never
+ * holds up the camera. A dropped reader gets no new frames, but the ones it
+ * holds aren't reused until it releases them or hangs up; frames that arrive
+ * while no slot is free are skipped.
+ *
+ * New readers are accepted, and readers that went away are noticed, whenever
+ * a frame arrives.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 pylonsrc ! pylonshmsink socketpath=/tmp/camera0 slots=16
+ * ]|
+ * Publishes the camera's frames for the readers connecting to /tmp/camera0.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpylonshmsink.h"
+#include "gstpylonmeta.h"
+#include "gstpylonalloc.h"
+#include <gst/gst.h>
+
+#include <errno.h>
+#include <string.h> //strcmp
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+/* debug category */
+GST_DEBUG_CATEGORY_STATIC (gst_pylon_shm_sink_debug_category);
+#define GST_CAT_DEFAULT gst_pylon_shm_sink_debug_category
+
+/* prototypes */
+static void gst_pylon_shm_sink_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_pylon_shm_sink_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_pylon_shm_sink_finalize (GObject * object);
+static gboolean gst_pylon_shm_sink_start (GstBaseSink * sink);
+static gboolean gst_pylon_shm_sink_stop (GstBaseSink * sink);
+static gboolean gst_pylon_shm_sink_set_caps (GstBaseSink * sink, GstCaps * caps);
+static GstFlowReturn gst_pylon_shm_sink_render (GstBaseSink * sink, GstBuffer * buffer);
+
+/* parameters */
+enum
+{
+  PROP_0,
+  PROP_SOCKETPATH,
+  PROP_SLOTS,
+  PROP_READERS,
+  PROP_DROPPEDREADERS,
+  PROP_DROPPEDFRAMES
+};
+
+#define DEFAULT_SOCKET_PATH "/tmp/pylonshm"
+#define DEFAULT_SLOTS 8
+
+/* pad templates */
+static GstStaticPadTemplate gst_pylon_shm_sink_sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY
+    );
+
+/* class initialisation */
+G_DEFINE_TYPE_WITH_CODE (GstPylonShmSink, gst_pylon_shm_sink, GST_TYPE_BASE_SINK,
+  GST_DEBUG_CATEGORY_INIT (gst_pylon_shm_sink_debug_category, "pylonshmsink", 0,
+  "debug category for pylonshmsink element"));
+
+static void
+gst_pylon_shm_sink_class_init (GstPylonShmSinkClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (klass);
+  GstBaseSinkClass *base_sink_class = GST_BASE_SINK_CLASS (klass);
+
+  gst_element_class_add_static_pad_template (element_class, &gst_pylon_shm_sink_sink_template);
+
+  gst_element_class_set_static_metadata (element_class,
+      "Shared memory frame publisher", "Sink/Video", "Publishes frames to several local processes at once through shared memory, without copying them for every reader",
+      "Ingmars Melkis <contact@zingmars.me>");
+
+  gobject_class->set_property = gst_pylon_shm_sink_set_property;
+  gobject_class->get_property = gst_pylon_shm_sink_get_property;
+  gobject_class->finalize = gst_pylon_shm_sink_finalize;
+  base_sink_class->start = GST_DEBUG_FUNCPTR (gst_pylon_shm_sink_start);
+  base_sink_class->stop = GST_DEBUG_FUNCPTR (gst_pylon_shm_sink_stop);
+  base_sink_class->set_caps = GST_DEBUG_FUNCPTR (gst_pylon_shm_sink_set_caps);
+  base_sink_class->render = GST_DEBUG_FUNCPTR (gst_pylon_shm_sink_render);
+
+  g_object_class_install_property (gobject_class, PROP_SOCKETPATH,
+      g_param_spec_string ("socketpath", "Socket path", "(<path>) Unix socket the readers connect to. A socket left behind by an earlier run is replaced, but not one another sink still listens on.", DEFAULT_SOCKET_PATH,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_SLOTS,
+      g_param_spec_uint ("slots", "Slots", "(2-64) Number of frames the ring holds. The more slots, the longer the readers can hold on to frames before the slowest of them is dropped.", 2, 64, DEFAULT_SLOTS,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_READERS,
+      g_param_spec_int ("readers", "Readers", "(Read only) Number of readers currently connected.", 0, PYLON_SHM_MAX_READERS, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DROPPEDREADERS,
+      g_param_spec_int ("droppedreaders", "Dropped readers", "(Read only) Number of readers dropped for being too slow.", 0, G_MAXINT, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_DROPPEDFRAMES,
+      g_param_spec_int ("droppedframes", "Dropped frames", "(Read only) Number of frames that weren't published because no slot could be freed for them.", 0, G_MAXINT, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+}
+
+static void
+gst_pylon_shm_sink_init (GstPylonShmSink * sink)
+{
+  guint i;
+
+  sink->listenFd = -1;
+  for(i = 0; i < PYLON_SHM_MAX_READERS; i++) {
+    sink->readers[i].fd = -1;
+    sink->readers[i].dropped = FALSE;
+  }
+  sink->numReaders = 0;
+  sink->memfd = -1;
+  sink->ring = NULL;
+  sink->ringSize = 0;
+  sink->header = NULL;
+  sink->slots = NULL;
+  sink->lastSlot = 0;
+  sink->sequence = 0;
+  sink->caps = NULL;
+  sink->droppedReaders = 0;
+  sink->droppedFrames = 0;
+  sink->socketPath = g_strdup(DEFAULT_SOCKET_PATH);
+  sink->numSlots = DEFAULT_SLOTS;
+
+  // The frames go out as they come, there's nothing to synchronise them to
+  gst_base_sink_set_sync(GST_BASE_SINK(sink), FALSE);
+}
+
+static void
+gst_pylon_shm_sink_finalize (GObject * object)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (object);
+
+  g_free(sink->socketPath);
+  g_free(sink->caps);
+
+  G_OBJECT_CLASS (gst_pylon_shm_sink_parent_class)->finalize (object);
+}
+
+void
+gst_pylon_shm_sink_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (object);
+
+  switch (property_id) {
+    case PROP_SOCKETPATH:
+      g_free(sink->socketPath);
+      sink->socketPath = g_value_dup_string(value);
+      break;
+    case PROP_SLOTS:
+      sink->numSlots = g_value_get_uint(value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_pylon_shm_sink_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (object);
+
+  switch (property_id) {
+    case PROP_SOCKETPATH:
+      g_value_set_string(value, sink->socketPath);
+      break;
+    case PROP_SLOTS:
+      g_value_set_uint(value, sink->numSlots);
+      break;
+    case PROP_READERS:
+      g_value_set_int(value, g_atomic_int_get(&sink->numReaders));
+      break;
+    case PROP_DROPPEDREADERS:
+      g_value_set_int(value, g_atomic_int_get(&sink->droppedReaders));
+      break;
+    case PROP_DROPPEDFRAMES:
+      g_value_set_int(value, g_atomic_int_get(&sink->droppedFrames));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+/* Takes the reader's hold off all of the slots */
+static void
+gst_pylon_shm_sink_release_reader (GstPylonShmSink * sink, guint id)
+{
+  guint i;
+
+  if(!sink->header) {
+    return;
+  }
+  for(i = 0; i < sink->header->numSlots; i++) {
+    __atomic_fetch_and(&sink->slots[i].refs, ~(1ULL << id), __ATOMIC_SEQ_CST);
+  }
+}
+
+/* Forgets a reader that hung up, freeing its id */
+static void
+gst_pylon_shm_sink_remove_reader (GstPylonShmSink * sink, guint id)
+{
+  GstPylonShmReader *reader = &sink->readers[id];
+
+  close(reader->fd);
+  reader->fd = -1;
+  gst_pylon_shm_sink_release_reader(sink, id);
+  if(sink->header) {
+    __atomic_fetch_and(&sink->header->dropped, ~(1ULL << id), __ATOMIC_SEQ_CST);
+  }
+  if(!reader->dropped) {
+    g_atomic_int_add(&sink->numReaders, -1);
+    GST_DEBUG_OBJECT(sink, "Reader %u left.", id);
+  }
+  reader->dropped = FALSE;
+}
+
+/* Stops sending a reader frames. The reader keeps the slots it holds, as it may still be reading them, and its id stays taken, until it hangs up. */
+static void
+gst_pylon_shm_sink_drop_reader (GstPylonShmSink * sink, guint id, const gchar * reason)
+{
+  GstPylonShmReader *reader = &sink->readers[id];
+  PylonShmMessage message = { PYLON_SHM_MSG_DROPPED, 0, 0 };
+
+  if(reader->dropped) {
+    return;
+  }
+  // Makes the reader give up any slot it tries to take from now on
+  if(sink->header) {
+    __atomic_fetch_or(&sink->header->dropped, 1ULL << id, __ATOMIC_SEQ_CST);
+  }
+  send(reader->fd, &message, sizeof(message), MSG_DONTWAIT | MSG_NOSIGNAL);
+  shutdown(reader->fd, SHUT_WR);
+  reader->dropped = TRUE;
+
+  g_atomic_int_add(&sink->numReaders, -1);
+  g_atomic_int_inc(&sink->droppedReaders);
+  GST_WARNING_OBJECT(sink, "Dropped reader %u, %s.", id, reason);
+}
+
+/* Sends a reader a message, with a payload or a file descriptor. Readers that can't take it right away are too slow and get dropped. */
+static gboolean
+gst_pylon_shm_sink_send (GstPylonShmSink * sink, guint id, PylonShmMessage * message, const gchar * payload, gint fd)
+{
+  union {
+    struct cmsghdr header;
+    char bytes[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct iovec iov[2];
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+
+  iov[0].iov_base = message;
+  iov[0].iov_len = sizeof(*message);
+  iov[1].iov_base = (void *) payload;
+  iov[1].iov_len = payload ? message->value : 0;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = payload ? 2 : 1;
+  if(fd >= 0) {
+    memset(&control, 0, sizeof(control));
+    msg.msg_control = control.bytes;
+    msg.msg_controllen = sizeof(control.bytes);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+  }
+
+  if(sendmsg(sink->readers[id].fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+    gst_pylon_shm_sink_drop_reader(sink, id, errno == EAGAIN || errno == EWOULDBLOCK ? "it doesn't keep up with the frames" : g_strerror(errno));
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/* Tells a reader about the ring and the caps */
+static void
+gst_pylon_shm_sink_greet (GstPylonShmSink * sink, guint id)
+{
+  PylonShmMessage message;
+
+  if(sink->memfd >= 0) {
+    message.type = PYLON_SHM_MSG_RING;
+    message.value = id;
+    message.sequence = 0;
+    if(!gst_pylon_shm_sink_send(sink, id, &message, NULL, sink->memfd)) {
+      return;
+    }
+  }
+  if(sink->caps) {
+    message.type = PYLON_SHM_MSG_CAPS;
+    message.value = strlen(sink->caps);
+    message.sequence = 0;
+    gst_pylon_shm_sink_send(sink, id, &message, sink->caps, -1);
+  }
+}
+
+/* Accepts the readers that connected and forgets the ones that hung up */
+static void
+gst_pylon_shm_sink_service (GstPylonShmSink * sink)
+{
+  gchar byte;
+  gint fd;
+  guint id;
+  ssize_t res;
+
+  while((fd = accept4(sink->listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+    for(id = 0; id < PYLON_SHM_MAX_READERS && sink->readers[id].fd >= 0; id++);
+    if(id == PYLON_SHM_MAX_READERS) {
+      GST_WARNING_OBJECT(sink, "Already serving %d readers, turning a new one away.", PYLON_SHM_MAX_READERS);
+      close(fd);
+      continue;
+    }
+    sink->readers[id].fd = fd;
+    sink->readers[id].dropped = FALSE;
+    g_atomic_int_inc(&sink->numReaders);
+    GST_DEBUG_OBJECT(sink, "Reader %u connected.", id);
+    gst_pylon_shm_sink_greet(sink, id);
+  }
+
+  // Readers never send anything, so the socket only becomes readable when they hang up
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if(sink->readers[id].fd < 0) {
+      continue;
+    }
+    res = recv(sink->readers[id].fd, &byte, sizeof(byte), MSG_DONTWAIT);
+    if(res == 0 || (res < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      gst_pylon_shm_sink_remove_reader(sink, id);
+    }
+  }
+}
+
+static void
+gst_pylon_shm_sink_unmap (GstPylonShmSink * sink)
+{
+  if(sink->ring) {
+    munmap(sink->ring, sink->ringSize);
+  }
+  if(sink->memfd >= 0) {
+    close(sink->memfd);
+  }
+  sink->memfd = -1;
+  sink->ring = NULL;
+  sink->ringSize = 0;
+  sink->header = NULL;
+  sink->slots = NULL;
+}
+
+/* Replaces the ring with one whose slots fit frames of the given size. Readers keep the frames they hold in the old one. */
+static gboolean
+gst_pylon_shm_sink_create_ring (GstPylonShmSink * sink, gsize frameSize)
+{
+  gsize pageSize = (gsize) sysconf(_SC_PAGESIZE), slotSize, dataOffset;
+  guint64 dropped = sink->header ? sink->header->dropped : 0;
+  guint id;
+
+  gst_pylon_shm_sink_unmap(sink);
+
+  // Page aligned slots, so that the frames can be mapped and handed to hardware on their own
+  slotSize = (frameSize + pageSize - 1) / pageSize * pageSize;
+  dataOffset = (sizeof(PylonShmHeader) + sink->numSlots * sizeof(PylonShmSlot) + pageSize - 1) / pageSize * pageSize;
+  sink->ringSize = dataOffset + sink->numSlots * slotSize;
+
+  sink->memfd = gst_pylon_memfd_create("pylonshm", FALSE);
+  if(sink->memfd < 0 || ftruncate(sink->memfd, sink->ringSize) != 0) {
+    GST_ERROR_OBJECT(sink, "Couldn't create a %" G_GSIZE_FORMAT " byte ring: %s", sink->ringSize, g_strerror(errno));
+    gst_pylon_shm_sink_unmap(sink);
+    return FALSE;
+  }
+  sink->ring = mmap(NULL, sink->ringSize, PROT_READ | PROT_WRITE, MAP_SHARED, sink->memfd, 0);
+  if(sink->ring == MAP_FAILED) {
+    GST_ERROR_OBJECT(sink, "Couldn't map the ring: %s", g_strerror(errno));
+    sink->ring = NULL;
+    gst_pylon_shm_sink_unmap(sink);
+    return FALSE;
+  }
+
+  sink->header = (PylonShmHeader *) sink->ring;
+  sink->slots = (PylonShmSlot *) (sink->header + 1);
+  sink->header->numSlots = sink->numSlots;
+  sink->header->slotSize = slotSize;
+  sink->header->dataOffset = dataOffset;
+  sink->header->dropped = dropped;
+  __atomic_store_n(&sink->header->magic, PYLON_SHM_MAGIC, __ATOMIC_RELEASE);
+  sink->lastSlot = sink->numSlots - 1;
+  GST_DEBUG_OBJECT(sink, "Created a ring of %u slots of %" G_GSIZE_FORMAT " bytes.", sink->numSlots, slotSize);
+
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if(sink->readers[id].fd >= 0 && !sink->readers[id].dropped) {
+      gst_pylon_shm_sink_greet(sink, id);
+    }
+  }
+  return TRUE;
+}
+
+/* Live readers holding a slot */
+static guint64
+gst_pylon_shm_sink_holders (GstPylonShmSink * sink, guint slot)
+{
+  guint64 refs = __atomic_load_n(&sink->slots[slot].refs, __ATOMIC_SEQ_CST), holders = 0;
+  guint id;
+
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if((refs & (1ULL << id)) && sink->readers[id].fd >= 0 && !sink->readers[id].dropped) {
+      holders |= 1ULL << id;
+    }
+  }
+  return holders;
+}
+
+/* Claims a slot without holders for the next frame. If there is none, the live readers holding the oldest frame are dropped, and their slots come free once they release them or hang up. */
+static gint
+gst_pylon_shm_sink_claim (GstPylonShmSink * sink)
+{
+  guint64 expected, holders = 0;
+  guint i, slot, oldest = 0, id;
+
+  for(i = 1; i <= sink->header->numSlots; i++) {
+    slot = (sink->lastSlot + i) % sink->header->numSlots;
+    expected = 0;
+    if(__atomic_compare_exchange_n(&sink->slots[slot].refs, &expected, PYLON_SHM_WRITER, FALSE, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+      return slot;
+    }
+  }
+
+  // Slots only dropped readers hold are already on their way back
+  for(i = 0; i < sink->header->numSlots; i++) {
+    guint64 slotHolders = gst_pylon_shm_sink_holders(sink, i);
+
+    if(slotHolders && (!holders || sink->slots[i].sequence < sink->slots[oldest].sequence)) {
+      oldest = i;
+      holders = slotHolders;
+    }
+  }
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if(holders & (1ULL << id)) {
+      gst_pylon_shm_sink_drop_reader(sink, id, "it holds on to its frames for too long");
+    }
+  }
+
+  return -1;
+}
+
+/* Finds out whether another sink still listens on the socket at the path. A socket nobody answers on was left behind by an earlier run. */
+static gboolean
+gst_pylon_shm_sink_socket_in_use (struct sockaddr_un * address)
+{
+  gint fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  gboolean inUse;
+
+  if(fd < 0) {
+    return FALSE;
+  }
+  inUse = connect(fd, (struct sockaddr *) address, sizeof(*address)) == 0 || errno != ECONNREFUSED;
+  close(fd);
+  return inUse;
+}
+
+static gboolean
+gst_pylon_shm_sink_start (GstBaseSink * base)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (base);
+  struct sockaddr_un address;
+  struct stat info;
+
+  if(strlen(sink->socketPath) >= sizeof(address.sun_path)) {
+    GST_ELEMENT_ERROR(sink, RESOURCE, SETTINGS, ("Socket path is too long"), ("%s is longer than the %" G_GSIZE_FORMAT " bytes a socket path can have.", sink->socketPath, sizeof(address.sun_path) - 1));
+    return FALSE;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, sink->socketPath);
+
+  // A socket left behind by an earlier run would keep us from binding, but one that another sink listens on is that sink's
+  if(stat(sink->socketPath, &info) == 0 && S_ISSOCK(info.st_mode)) {
+    if(gst_pylon_shm_sink_socket_in_use(&address)) {
+      GST_ELEMENT_ERROR(sink, RESOURCE, BUSY, ("Socket is in use"), ("Another sink is already publishing on %s.", sink->socketPath));
+      return FALSE;
+    }
+    unlink(sink->socketPath);
+  }
+
+  sink->listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if(sink->listenFd < 0 || bind(sink->listenFd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(sink->listenFd, 16) != 0) {
+    GST_ELEMENT_ERROR(sink, RESOURCE, OPEN_READ_WRITE, ("Couldn't open the socket"), ("Couldn't listen on %s: %s", sink->socketPath, g_strerror(errno)));
+    if(sink->listenFd >= 0) {
+      close(sink->listenFd);
+      sink->listenFd = -1;
+    }
+    return FALSE;
+  }
+
+  sink->sequence = 0;
+  g_atomic_int_set(&sink->droppedReaders, 0);
+  g_atomic_int_set(&sink->droppedFrames, 0);
+  GST_DEBUG_OBJECT(sink, "Waiting for readers on %s.", sink->socketPath);
+  return TRUE;
+}
+
+static gboolean
+gst_pylon_shm_sink_stop (GstBaseSink * base)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (base);
+  guint id;
+
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if(sink->readers[id].fd >= 0) {
+      gst_pylon_shm_sink_remove_reader(sink, id);
+    }
+  }
+  g_atomic_int_set(&sink->numReaders, 0);
+  if(sink->listenFd >= 0) {
+    close(sink->listenFd);
+    unlink(sink->socketPath);
+    sink->listenFd = -1;
+  }
+  gst_pylon_shm_sink_unmap(sink);
+  g_free(sink->caps);
+  sink->caps = NULL;
+
+  return TRUE;
+}
+
+static gboolean
+gst_pylon_shm_sink_set_caps (GstBaseSink * base, GstCaps * caps)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (base);
+  PylonShmMessage message;
+  gchar *string = gst_caps_to_string(caps);
+  guint id;
+
+  if(strlen(string) >= PYLON_SHM_MAX_CAPS) {
+    GST_ERROR_OBJECT(sink, "The caps are longer than the %d bytes the readers can take.", PYLON_SHM_MAX_CAPS);
+    g_free(string);
+    return FALSE;
+  }
+  g_free(sink->caps);
+  sink->caps = string;
+
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if(sink->readers[id].fd >= 0 && !sink->readers[id].dropped) {
+      message.type = PYLON_SHM_MSG_CAPS;
+      message.value = strlen(sink->caps);
+      message.sequence = 0;
+      gst_pylon_shm_sink_send(sink, id, &message, sink->caps, -1);
+    }
+  }
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_pylon_shm_sink_render (GstBaseSink * base, GstBuffer * buffer)
+{
+  GstPylonShmSink *sink = GST_PYLONSHMSINK (base);
+  GstPylonMeta *meta = gst_buffer_get_pylon_meta(buffer);
+  PylonShmMessage message;
+  PylonShmSlot *slot;
+  gsize size = gst_buffer_get_size(buffer);
+  gint index;
+  guint id;
+
+  gst_pylon_shm_sink_service(sink);
+
+  if(!sink->header || size > sink->header->slotSize || sink->numSlots != sink->header->numSlots) {
+    if(!gst_pylon_shm_sink_create_ring(sink, size)) {
+      GST_ELEMENT_ERROR(sink, RESOURCE, NO_SPACE_LEFT, ("Couldn't create the shared memory"), ("Couldn't create a ring for frames of %" G_GSIZE_FORMAT " bytes.", size));
+      return GST_FLOW_ERROR;
+    }
+  }
+
+  index = gst_pylon_shm_sink_claim(sink);
+  if(index < 0) {
+    // Readers that were dropped hold on to their slots until they let go of them
+    g_atomic_int_inc(&sink->droppedFrames);
+    GST_DEBUG_OBJECT(sink, "No free slot, dropping the frame.");
+    return GST_FLOW_OK;
+  }
+  slot = &sink->slots[index];
+
+  // Nobody takes the slot while the writer bit is set
+  gst_buffer_extract(buffer, 0, sink->ring + sink->header->dataOffset + index * sink->header->slotSize, size);
+  slot->size = size;
+  slot->pts = GST_BUFFER_PTS(buffer);
+  slot->dts = GST_BUFFER_DTS(buffer);
+  slot->duration = GST_BUFFER_DURATION(buffer);
+  slot->offset = GST_BUFFER_OFFSET(buffer);
+  slot->flags = GST_BUFFER_FLAGS(buffer);
+  slot->metaFields = 0;
+  if(meta) {
+    slot->metaFields = PYLON_SHM_CAPTURE | meta->chunks;
+    slot->framecounter = meta->framecounter;
+    slot->cameratimestamp = meta->cameratimestamp;
+    slot->exposurestart = meta->exposurestart;
+    slot->grabtime = meta->grabtime;
+    slot->exposuretime = meta->exposuretime;
+    slot->gain = meta->gain;
+    slot->linestatus = meta->linestatus;
+    slot->chunkcounter = meta->chunkcounter;
+  }
+  __atomic_store_n(&slot->sequence, ++sink->sequence, __ATOMIC_RELEASE);
+  __atomic_fetch_and(&slot->refs, ~PYLON_SHM_WRITER, __ATOMIC_SEQ_CST);
+  sink->lastSlot = index;
+
+  for(id = 0; id < PYLON_SHM_MAX_READERS; id++) {
+    if(sink->readers[id].fd >= 0 && !sink->readers[id].dropped) {
+      message.type = PYLON_SHM_MSG_FRAME;
+      message.value = index;
+      message.sequence = sink->sequence;
+      gst_pylon_shm_sink_send(sink, id, &message, NULL, -1);
+    }
+  }
+
+  return GST_FLOW_OK;
+}
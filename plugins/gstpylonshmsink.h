@@ -0,0 +1,78 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _GST_PYLONSHMSINK_H_
+#define _GST_PYLONSHMSINK_H_
+
+#include <gst/base/gstbasesink.h>
+#include "pylonshm.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_PYLONSHMSINK   (gst_pylon_shm_sink_get_type())
+#define GST_PYLONSHMSINK(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PYLONSHMSINK,GstPylonShmSink))
+#define GST_PYLONSHMSINK_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_PYLONSHMSINK,GstPylonShmSinkClass))
+#define GST_IS_PYLONSHMSINK(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PYLONSHMSINK))
+#define GST_IS_PYLONSHMSINK_CLASS(klass)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_PYLONSHMSINK))
+
+typedef struct _GstPylonShmSink GstPylonShmSink;
+typedef struct _GstPylonShmSinkClass GstPylonShmSinkClass;
+
+/* A connected reader */
+typedef struct _GstPylonShmReader
+{
+  gint fd; // -1 if the id is free.
+  gboolean dropped; // The reader was dropped, the id is freed once it hangs up.
+} GstPylonShmReader;
+
+struct _GstPylonShmSink
+{
+  GstBaseSink parent;
+
+  gint listenFd;
+  GstPylonShmReader readers[PYLON_SHM_MAX_READERS];
+  gint numReaders; // Readers that aren't dropped, read atomically.
+
+  // Ring the frames are published in
+  gint memfd;
+  guint8 *ring;
+  gsize ringSize;
+  PylonShmHeader *header;
+  PylonShmSlot *slots;
+  guint lastSlot;
+  guint64 sequence;
+  gchar *caps;
+
+  gint droppedReaders, droppedFrames; // Read atomically.
+
+  // Plugin parameters
+  gchar *socketPath;
+  guint numSlots;
+};
+
+struct _GstPylonShmSinkClass
+{
+  GstBaseSinkClass parent_class;
+};
+
+GType gst_pylon_shm_sink_get_type (void);
+
+G_END_DECLS
+
+#endif
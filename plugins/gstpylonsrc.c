@@ -28,6 +28,10 @@
  * gst-launch-1.0 -v pylonsrc ! bayer2rgb ! videoconvert ! xvimagesink
  * ]|
  * Outputs camera output to screen.
+ * |[
+ * gst-launch-1.0 pylonsrc previewfps=5 name=src src. ! queue ! bayer2rgb ! videoconvert ! matroskamux ! filesink location=recording.mkv src.preview ! queue ! bayer2rgb ! videoconvert ! xvimagesink
+ * ]|
+ * Records every frame while showing 5 of them a second.
  * </refsect2>
  */
 
@@ -36,12 +40,19 @@
 #endif
 
 #include "gstpylonsrc.h"
+#include "gstpylonmeta.h"
+#include "gstpylonmultisrc.h"
+#include "gstpylonshmsink.h"
+#include "gstpylondeviceprovider.h"
 #include <gst/gst.h>
+#include <gst/video/video.h>
 
 #include <malloc.h> //malloc
 #include <string.h> //memcpy, strcmp
 #include <inttypes.h> //int64 printing
 #include <unistd.h> //sleep
+#include <errno.h>
+#include <stdio.h> //sscanf
 
 #ifdef HAVE_ORC
 #include <orc/orc.h>
@@ -49,25 +60,73 @@
 #define orc_memcpy(a,b,c) memcpy(a,b,c)
 #endif
 
+#ifdef HAVE_GST_FDMEMORY
+#include <gst/allocators/gstfdmemory.h>
+
+/* A frame pushed downstream in its grab buffer, which goes back to the camera once the GstFdMemory wrapping it is freed */
+typedef struct _GstPylonsrcFrame
+{
+  GstPylonsrc *pylonsrc;
+  PYLON_STREAMBUFFER_HANDLE handle;
+  size_t index;
+  guint generation; // fdGeneration when the frame was pushed.
+} GstPylonsrcFrame;
+
+static GQuark gst_pylonsrc_frame_quark;
+static void gst_pylonsrc_release_frame (gpointer data);
+#endif
+
 /* PylonC */
 _Bool pylonc_reset_camera(GstPylonsrc* pylonsrc);
 _Bool pylonc_connect_camera(GstPylonsrc* pylonsrc);
 void  pylonc_disconnect_camera(GstPylonsrc* pylonsrc);
+void  pylonc_halt_camera(GstPylonsrc* pylonsrc);
+_Bool pylonc_resume_camera(GstPylonsrc* pylonsrc);
+_Bool pylonc_start_acquisition(GstPylonsrc* pylonsrc);
 void  pylonc_print_camera_info(GstPylonsrc* pylonsrc, PYLON_DEVICE_HANDLE deviceHandle, int deviceId);
+int64_t pylonc_set_stream_parameter(GstPylonsrc* pylonsrc, NODEMAP_HANDLE nodeMap, const char* name, int64_t value);
+void  pylonc_free_buffers(GstPylonsrc* pylonsrc);
+_Bool pylonc_plan_bandwidth(GstPylonsrc* pylonsrc, int64_t* throughput, int64_t linkSpeed);
+_Bool pylonc_set_frame_rate(GstPylonsrc* pylonsrc, double fps);
+_Bool pylonc_sample_camera_clock(GstPylonsrc* pylonsrc, GstClockTime* host, GstClockTime* camera, GstClockTime* roundTrip);
+void  pylonc_calibrate_camera_clock(GstPylonsrc* pylonsrc);
+GENAPIC_RESULT pylonc_timed_set_integer(GstPylonsrc* pylonsrc, const char* feature, int64_t value);
+GENAPIC_RESULT pylonc_timed_get_integer(GstPylonsrc* pylonsrc, const char* feature, int64_t* value);
+GENAPIC_RESULT pylonc_timed_get_integer_int32(GstPylonsrc* pylonsrc, const char* feature, int32_t* value);
+GENAPIC_RESULT pylonc_timed_set_float(GstPylonsrc* pylonsrc, const char* feature, double value);
+GENAPIC_RESULT pylonc_timed_get_float(GstPylonsrc* pylonsrc, const char* feature, double* value);
+GENAPIC_RESULT pylonc_timed_get_float_min(GstPylonsrc* pylonsrc, const char* feature, double* value);
+GENAPIC_RESULT pylonc_timed_get_float_max(GstPylonsrc* pylonsrc, const char* feature, double* value);
+GENAPIC_RESULT pylonc_timed_set_boolean(GstPylonsrc* pylonsrc, const char* feature, _Bool value);
+GENAPIC_RESULT pylonc_timed_from_string(GstPylonsrc* pylonsrc, const char* feature, const char* value);
+GENAPIC_RESULT pylonc_timed_to_string(GstPylonsrc* pylonsrc, const char* feature, char* value, size_t* length);
+_Bool pylonc_timed_is_available(GstPylonsrc* pylonsrc, const char* feature);
+_Bool pylonc_timed_is_implemented(GstPylonsrc* pylonsrc, const char* feature);
+_Bool pylonc_timed_is_readable(GstPylonsrc* pylonsrc, const char* feature);
+_Bool pylonc_timed_is_writable(GstPylonsrc* pylonsrc, const char* feature);
 void  pylonc_initialize();
 void  pylonc_terminate();
 
-_Bool deviceConnected = FALSE;
-#define NUM_BUFFERS 10
-unsigned char* buffers[NUM_BUFFERS];
-PYLON_STREAMBUFFER_HANDLE bufferHandle[NUM_BUFFERS];
-
 /* debug category */
 GST_DEBUG_CATEGORY_STATIC (gst_pylonsrc_debug_category);
 #define GST_CAT_DEFAULT gst_pylonsrc_debug_category
 #define GST_MESSAGE_OBJECT(obj, ...) GST_CAT_LEVEL_LOG(GST_CAT_DEFAULT, GST_LEVEL_NONE, obj, __VA_ARGS__)
 #define PYLONC_CHECK_ERROR(obj, res) if (res != GENAPI_E_OK) { char* errMsg; size_t length; GenApiGetLastErrorMessage( NULL, &length ); errMsg = (char*) malloc( length ); GenApiGetLastErrorMessage( errMsg, &length ); GST_CAT_LEVEL_LOG(GST_CAT_DEFAULT, GST_LEVEL_NONE, obj, "PylonC error: %s (%#08x).\n", errMsg, (unsigned int) res); free(errMsg); GenApiGetLastErrorDetail( NULL, &length ); errMsg = (char*) malloc( length ); GenApiGetLastErrorDetail( errMsg, &length ); GST_CAT_LEVEL_LOG(GST_CAT_DEFAULT, GST_LEVEL_NONE, obj, "PylonC error: %s\n", errMsg); free(errMsg); goto error; }
 
+/* Chunks that are read into GstPylonMeta. The frame counter is called differently on GigE and USB3 cameras. */
+static const struct {
+  const char *selector, *feature;
+  GstPylonMetaChunks field;
+} pylonChunks[] = {
+  { "ExposureTime", "ChunkExposureTime", GST_PYLON_META_EXPOSURETIME },
+  { "Gain", "ChunkGain", GST_PYLON_META_GAIN },
+  { "LineStatusAll", "ChunkLineStatusAll", GST_PYLON_META_LINESTATUS },
+  { "Framecounter", "ChunkFramecounter", GST_PYLON_META_CHUNKCOUNTER },
+  { "CounterValue", "ChunkCounterValue", GST_PYLON_META_CHUNKCOUNTER }
+};
+#define NUM_CHUNKS (sizeof(pylonChunks)/sizeof(pylonChunks[0]))
+G_STATIC_ASSERT(NUM_CHUNKS <= MAX_CHUNKS);
+
 /* prototypes */
 static void gst_pylonsrc_set_property (GObject * object,
     guint property_id, const GValue * value, GParamSpec * pspec);
@@ -80,12 +139,45 @@ static gboolean gst_pylonsrc_start (GstBaseSrc * src);
 static gboolean gst_pylonsrc_stop (GstBaseSrc * src);
 static GstCaps *gst_pylonsrc_get_caps (GstBaseSrc * src, 
     GstCaps * filter);
+static GstCaps *gst_pylonsrc_fixate (GstBaseSrc * src, GstCaps * caps);
 static gboolean gst_pylonsrc_set_caps (GstBaseSrc * src, 
     GstCaps * caps);
+static gboolean gst_pylonsrc_decide_allocation (GstBaseSrc * src,
+    GstQuery * query);
+static gboolean gst_pylonsrc_query (GstBaseSrc * src, GstQuery * query);
+static gboolean gst_pylonsrc_event (GstBaseSrc * src, GstEvent * event);
+static GstVideoFormat gst_pylonsrc_video_format (GstPylonsrc * pylonsrc);
+static GstClock *gst_pylonsrc_provide_clock (GstElement * element);
 
 static GstFlowReturn gst_pylonsrc_create (GstPushSrc *src, 
     GstBuffer **buf);
 
+static GstPad *gst_pylonsrc_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps);
+static void gst_pylonsrc_release_pad (GstElement * element, GstPad * pad);
+static GstPadProbeReturn gst_pylonsrc_pad_probe (GstPad * pad,
+    GstPadProbeInfo * info, gpointer user_data);
+static gboolean gst_pylonsrc_copy_sticky_event (GstPad * pad,
+    GstEvent ** event, gpointer user_data);
+static guint gst_pylonsrc_parse_rois (GstPylonsrc * pylonsrc, const gchar * rois,
+    GstPylonsrcRoi * regions);
+static void gst_pylonsrc_restart_monitoring (GstPylonsrc * pylonsrc);
+static void gst_pylonsrc_qos_reset (GstPylonsrc * pylonsrc);
+static void gst_pylonsrc_qos_set_mode (GstPylonsrc * pylonsrc, GstPylonsrcQos mode);
+static gboolean gst_pylonsrc_qos_keep_frame (GstPylonsrc * pylonsrc);
+static GstClockTime gst_pylonsrc_exposure_start (GstPylonsrc * pylonsrc,
+    uint64_t timeStamp, GstClockTime grabTime);
+static gboolean gst_pylonsrc_apply_bandwidth (GstPylonsrc * pylonsrc);
+static gpointer gst_pylonsrc_clock_thread (gpointer data);
+static void gst_pylonsrc_profile_begin (GstPylonsrc * pylonsrc);
+static void gst_pylonsrc_profile_feature (GstPylonsrc * pylonsrc,
+    const char * feature, gint64 begin);
+static void gst_pylonsrc_profile_phase (GstPylonsrc * pylonsrc,
+    GstPylonsrcStartupPhase phase);
+static void gst_pylonsrc_profile_finish (GstPylonsrc * pylonsrc);
+
+static const gchar *qosModeNames[PYLONSRC_QOS_MODES] = { "off", "framerate", "drop", "auto" };
+
 /* parameters */
 enum
 {
@@ -152,7 +244,31 @@ enum
   PROP_TRANSFORMATION12,
   PROP_TRANSFORMATION20,
   PROP_TRANSFORMATION21,
-  PROP_TRANSFORMATION22
+  PROP_TRANSFORMATION22,
+  PROP_CHUNKDATA,
+  PROP_SERIAL,
+  PROP_TRIGGERSOURCE,
+  PROP_GRABTHREADS,
+  PROP_GRABBUFFERS,
+  PROP_LATENCYBUDGET,
+  PROP_BUFFERMEMORY,
+  PROP_RECOMMENDEDBUFFERS,
+  PROP_MAXTRANSFERSIZE,
+  PROP_QUEUEDURBS,
+  PROP_TRANSFERPRIORITY,
+  PROP_BUFFERPAGES,
+  PROP_LOCKBUFFERS,
+  PROP_NUMANODE,
+  PROP_FDMEMORY,
+  PROP_BANDWIDTHPLANNER,
+  PROP_CONTROLLERBANDWIDTH,
+  PROP_PREVIEWEVERY,
+  PROP_PREVIEWFPS,
+  PROP_ROIS,
+  PROP_STRIDEALIGN,
+  PROP_CAMERACLOCK,
+  PROP_WARM,
+  PROP_QOS
 };
 
 /* pad templates */
@@ -163,6 +279,20 @@ GST_STATIC_PAD_TEMPLATE ("src",
     GST_STATIC_CAPS_ANY
 );
 
+static GstStaticPadTemplate gst_pylonsrc_preview_template =
+GST_STATIC_PAD_TEMPLATE ("preview",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS_ANY
+);
+
+static GstStaticPadTemplate gst_pylonsrc_roi_template =
+GST_STATIC_PAD_TEMPLATE ("roi_%u",
+    GST_PAD_SRC,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS_ANY
+);
+
 /* class initialisation */
 G_DEFINE_TYPE_WITH_CODE (GstPylonsrc, gst_pylonsrc, GST_TYPE_PUSH_SRC,
   GST_DEBUG_CATEGORY_INIT (gst_pylonsrc_debug_category, "pylonsrc", 0,
@@ -177,6 +307,10 @@ gst_pylonsrc_class_init (GstPylonsrcClass * klass)
 
   gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS(klass),
       &gst_pylonsrc_src_template);
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS(klass),
+      &gst_pylonsrc_preview_template);
+  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS(klass),
+      &gst_pylonsrc_roi_template);
 
   gst_element_class_set_static_metadata (GST_ELEMENT_CLASS(klass),
       "Basler's Pylon5 for Gstreamer", "Source/Video/Device", "Uses pylon5 to get video from Basler's USB3 Vision cameras for use with Gstreamer",
@@ -186,11 +320,22 @@ gst_pylonsrc_class_init (GstPylonsrcClass * klass)
   gobject_class->get_property = gst_pylonsrc_get_property;
   gobject_class->dispose = gst_pylonsrc_dispose;
   gobject_class->finalize = gst_pylonsrc_finalize;
+  GST_ELEMENT_CLASS(klass)->request_new_pad = GST_DEBUG_FUNCPTR(gst_pylonsrc_request_new_pad);
+  GST_ELEMENT_CLASS(klass)->release_pad = GST_DEBUG_FUNCPTR(gst_pylonsrc_release_pad);
+  GST_ELEMENT_CLASS(klass)->provide_clock = GST_DEBUG_FUNCPTR(gst_pylonsrc_provide_clock);
+
+#ifdef HAVE_GST_FDMEMORY
+  gst_pylonsrc_frame_quark = g_quark_from_static_string("GstPylonsrcFrame");
+#endif
 
   base_src_class->start = GST_DEBUG_FUNCPTR(gst_pylonsrc_start);
   base_src_class->stop = GST_DEBUG_FUNCPTR(gst_pylonsrc_stop);
   base_src_class->get_caps = GST_DEBUG_FUNCPTR(gst_pylonsrc_get_caps);
+  base_src_class->fixate = GST_DEBUG_FUNCPTR(gst_pylonsrc_fixate);
   base_src_class->set_caps = GST_DEBUG_FUNCPTR(gst_pylonsrc_set_caps);
+  base_src_class->decide_allocation = GST_DEBUG_FUNCPTR(gst_pylonsrc_decide_allocation);
+  base_src_class->query = GST_DEBUG_FUNCPTR(gst_pylonsrc_query);
+  base_src_class->event = GST_DEBUG_FUNCPTR(gst_pylonsrc_event);
 
   push_src_class->create = GST_DEBUG_FUNCPTR(gst_pylonsrc_create);
 
@@ -228,7 +373,7 @@ gst_pylonsrc_class_init (GstPylonsrcClass * klass)
       g_param_spec_boolean ("acquisitionframerateenable", "Custom FPS mode", "(true/false) Enables the use of custom fps values. Will be set to true if the fps poperty is set. Running the plugin without specifying this parameter will reset the value stored on the camera to false.", FALSE,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
   g_object_class_install_property (gobject_class, PROP_FPS,
-      g_param_spec_double ("fps", "Framerate", "(Frames per second) Sets the framerate of the video coming from the camera. Setting the value too high might cause the plugin to crash. Note that if your pipeline proves to be too much for your computer then the resulting video won't be in the resolution you set. Setting this parameter will set acquisitionframerateenable to true. The value of this parameter will be saved to the camera, but it will have no effect unless either this or the acquisitionframerateenable parameters are set. Reconnect the camera or use the reset parameter to reset.", 0.0, 1024.0, 0.0,
+      g_param_spec_double ("fps", "Framerate", "(Frames per second) Sets the framerate of the video coming from the camera. Setting the value too high might cause the plugin to crash. Note that if your pipeline proves to be too much for your computer then the resulting video won't be in the resolution you set. Setting this parameter will set acquisitionframerateenable to true. Without this or acquisitionframerateenable, downstream can pick the framerate through the caps instead. The value of this parameter will be saved to the camera, but it will have no effect unless either this or the acquisitionframerateenable parameters are set. Reconnect the camera or use the reset parameter to reset.", 0.0, 1024.0, 0.0,
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
   g_object_class_install_property (gobject_class, PROP_LIGHTSOURCE,
       g_param_spec_string ("lightsource", "Lightsource preset", "(off, 2800k, 5000k, 6500k) Changes the colour balance settings to ones defined by presests. Just pick one that's closest to your environment's lighting. Running the plugin without specifying this parameter will reset the value stored on the camera to \"5000k\"", "5000k",
@@ -392,13 +537,100 @@ gst_pylonsrc_class_init (GstPylonsrcClass * klass)
   g_object_class_install_property (gobject_class, PROP_TRANSFORMATIONSELECTOR,
       g_param_spec_string  ("transformationselector", "Color Transformation Selector", "(RGBRGB, RGBYUV, YUVRGB) Sets the type of color transformation done by the color transformation selectors.", "RGBRGB",
           (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_CHUNKDATA,
+      g_param_spec_boolean ("chunkdata", "Chunk data", "(true/false) Make the camera send the exposure time, gain, I/O line status and frame counter it used for each frame along with the frame, and attach them to the buffers. Useful when the automatic exposure or gain functions are enabled, as these values will differ from the ones set by the plugin.", FALSE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_SERIAL,
+      g_param_spec_string ("serial", "Camera serial number", "(<string>) Selects the camera by its serial number instead of its id. Unlike the ids, the serial numbers don't change when cameras are plugged in or out. Takes precedence over the camera property.", "",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TRIGGERSOURCE,
+      g_param_spec_string ("triggersource", "Trigger source", "(software, line1, line2, line3, line4) Sets what triggers the frames when continuous mode is off. With \"software\" the plugin triggers each frame itself. With one of the I/O lines the camera waits for an external hardware trigger on that line, which is how several cameras can be made to take their pictures at the same time.", "software",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_GRABTHREADS,
+      g_param_spec_uint ("grabthreads", "Grab threads", "(0-16) Number of threads the grab engine shared by all of the cameras in the process uses to wait for frames. Each thread waits for up to 63 cameras at once, and the cameras are spread evenly over the threads. When several cameras ask for a different number of threads, the largest number is used. 0 makes the plugin wait for its camera's frames on its own, which is fine for a single camera.", 0, GST_PYLON_GRAB_ENGINE_MAX_THREADS, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_GRABBUFFERS,
+      g_param_spec_uint ("grabbuffers", "Grab buffers", "(0-256) Number of buffers the camera's frames are grabbed into. More buffers let the plugin fall further behind the camera without losing frames, at the cost of one frame's worth of memory each. 0 picks the number from the framerate and latencybudget, within buffermemory.", 0, MAX_NUM_BUFFERS, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_LATENCYBUDGET,
+      g_param_spec_uint ("latencybudget", "Latency budget", "(Milliseconds) How long the plugin should be able to fall behind the camera without losing frames. Used to pick the number of grab buffers when grabbuffers is 0.", 1, 60000, 100,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_BUFFERMEMORY,
+      g_param_spec_uint ("buffermemory", "Grab buffer memory", "(Megabytes) Most memory the automatically picked and recommended grab buffers may take. At least 2 buffers are always used.", 1, G_MAXUINT, 512,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_RECOMMENDEDBUFFERS,
+      g_param_spec_uint ("recommendedbuffers", "Recommended grab buffers", "(Read only) Number of grab buffers that would have been enough so far, based on how many frames were waiting to be processed at once and whether any frames were lost. Also posted in a \"pylonsrc-buffers\" element message when it changes.", 0, G_MAXUINT, 0,
+          (GParamFlags) (G_PARAM_READABLE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_MAXTRANSFERSIZE,
+      g_param_spec_int ("maxtransfersize", "Maximum transfer size", "(Bytes) Largest USB transfer the frames are split into. Larger transfers mean fewer requests per frame, which helps at high data rates. The value is rounded to what the driver supports and is limited to the size of a frame. 0 keeps the driver's default.", 0, G_MAXINT, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_QUEUEDURBS,
+      g_param_spec_int ("queuedurbs", "Queued USB request blocks", "(Number) Largest number of USB transfers kept queued with the USB controller. Queueing more helps when several cameras share a controller. More than the grab buffers can hold are of no use, so the value is limited to that. 0 keeps the driver's default.", 0, G_MAXINT, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_TRANSFERPRIORITY,
+      g_param_spec_int ("transferpriority", "Transfer loop priority", "(1-99) Realtime priority of the driver thread that handles the USB transfers. Raising it needs the permission to use realtime priorities. 0 keeps the driver's default.", 0, 99, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_BUFFERPAGES,
+      g_param_spec_string ("bufferpages", "Grab buffer pages", "(normal, transparent, huge) Kind of memory pages the grab buffers are made of. Huge pages make copying the frames out of the buffers cheaper. \"transparent\" asks the kernel for transparent huge pages, \"huge\" takes them from the hugetlbfs pool (see /proc/sys/vm/nr_hugepages) and falls back to transparent huge pages when the pool runs out.", "normal",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_LOCKBUFFERS,
+      g_param_spec_boolean ("lockbuffers", "Lock grab buffers", "(true/false) Lock the grab buffers into memory, so that they can never be swapped out. Needs a high enough memory lock limit (ulimit -l), the buffers are left unlocked otherwise.", FALSE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_NUMANODE,
+      g_param_spec_string ("numanode", "NUMA node", "(none, auto, <number>) NUMA node the grab buffers are placed on. \"auto\" uses the node of the USB controller the camera is attached to. Only makes a difference on machines with several NUMA nodes.", "none",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_FDMEMORY,
+      g_param_spec_boolean ("fdmemory", "Push fd backed grab buffers", "(true/false) Back the grab buffers with memfds and push the frames downstream in them as GstFdMemory instead of copying them out. Elements that pass file descriptors to other processes (e.g. unixfdsink, ipcpipelinesink) then share the frames without any copies. A grab buffer only goes back to the camera once downstream is done with its frame, so grabbuffers has to cover the frames held downstream as well.", FALSE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_BANDWIDTHPLANNER,
+      g_param_spec_string ("bandwidthplanner", "USB bandwidth planner", "(off, limit, fail) What to do when the cameras of all of the pylonsrc elements in the process that share this camera's USB host controller need more bandwidth than it has. \"limit\" divides the controller's bandwidth between them and lowers their throughput limits to fit, which lowers their framerate. \"fail\" refuses to start the camera instead. Either way the bandwidth and framerate each camera needs and can get are reported.", "off",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_CONTROLLERBANDWIDTH,
+      g_param_spec_int64 ("controllerbandwidth", "USB controller bandwidth", "(Bytes per second) Bandwidth the camera's USB host controller has for all of its cameras together, used by bandwidthplanner. 0 uses the lowest link speed of the cameras on the controller. When the cameras on a controller disagree, the lowest value is used.", 0,
+          G_MAXINT64, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_PREVIEWEVERY,
+      g_param_spec_uint ("previewevery", "Preview decimation", "(Number) Every how many frames one goes to the preview pad (request it as preview). The preview gets the same buffer as the src pad, so it costs no copy, but a queue should follow it so that it can't hold up the src pad.", 1,
+          G_MAXUINT, 10,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_PREVIEWFPS,
+      g_param_spec_double ("previewfps", "Preview framerate", "(Frames per second) Framerate of the preview pad, picking frames by their timestamps. 0 uses previewevery instead.", 0.0,
+          1024.0, 0.0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_ROIS,
+      g_param_spec_string ("rois", "Regions of interest", "(x,y,width,height;...) Regions of the frame that are pushed on pads of their own, roi_0 for the first region, roi_1 for the second and so on (up to 16). The regions are cut out on the host, they share the frame's memory and describe their rows with GstVideoMeta, so they cost no copies unless downstream doesn't support GstVideoMeta. Regions are kept inside of the frame, and on even pixels for the bayer formats. Can only be changed while no roi pads exist.", "",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_STRIDEALIGN,
+      g_param_spec_uint ("stridealign", "Row alignment", "(Bytes) Start the frames and each of their rows on a multiple of this many bytes (a power of two, e.g. 64), padding the rows while the frames are copied out of the grab buffers, so that SIMD code downstream can use aligned loads at any width. The row stride is described with GstVideoMeta, so the rows are only padded if downstream supports it. 0 leaves the rows as they come from the camera. Has no effect with fdmemory, as the frames aren't copied then.", 0,
+          4096, 0,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_CAMERACLOCK,
+      g_param_spec_boolean ("cameraclock", "Provide the camera's clock", "(true/false) Offer a clock that runs at the rate of the camera's timestamp counter as the pipeline clock, so that the pipeline is slaved to the sensor instead of drifting against it. The clock is calibrated against the host when the camera starts and then about once a second. Needs a camera that can latch its timestamp counter. The frames' exposure start is then read from their timestamps, without it the exposure start is estimated.", FALSE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_WARM,
+      g_param_spec_boolean ("warm", "Keep the camera warm", "(true/false) Keep the camera open, configured and its grab buffers registered while the element is stopped, so that starting again only restarts the acquisition. Changing a property that configures the camera or its grab buffers in the meantime makes the next start configure the camera from scratch, while previewevery, previewfps, rois, cameraclock and qos don't. The camera is closed once the element is freed.", FALSE,
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
+  g_object_class_install_property (gobject_class, PROP_QOS,
+      g_param_spec_string ("qos", "React to QoS", "(off, framerate, drop, auto) What to do when downstream reports that it can't keep up. \"framerate\" lowers the camera's AcquisitionFrameRate, so that the frames that wouldn't be used aren't taken at all. \"drop\" gives the frames downstream has no time for back to the camera before they're copied. \"auto\" lowers the framerate when the camera is free running and supports it, and drops frames otherwise. The rate goes back up step by step once downstream keeps up again. Every change is posted in a pylonsrc-qos element message. Can be changed while the camera runs, and takes with the next frame.", "off",
+          (GParamFlags) (G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)));
 }
 
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
-  return gst_element_register (plugin, "pylonsrc", GST_RANK_NONE,
-      GST_TYPE_PYLONSRC);
+  if(!gst_element_register (plugin, "pylonsrc", GST_RANK_NONE,
+      GST_TYPE_PYLONSRC) || !gst_element_register (plugin, "pylonmultisrc",
+      GST_RANK_NONE, GST_TYPE_PYLONMULTISRC) || !gst_element_register (plugin,
+      "pylonshmsink", GST_RANK_NONE, GST_TYPE_PYLONSHMSINK)) {
+    return FALSE;
+  }
+#if GST_CHECK_VERSION(1, 4, 0)
+  if(!gst_device_provider_register (plugin, "pylondeviceprovider",
+      GST_RANK_PRIMARY, GST_TYPE_PYLON_DEVICE_PROVIDER)) {
+    return FALSE;
+  }
+#endif
+  return TRUE;
 }
 
 static void
@@ -470,7 +702,76 @@ gst_pylonsrc_init (GstPylonsrc *pylonsrc)
   pylonsrc->transformation20 = 999.0;
   pylonsrc->transformation21 = 999.0;
   pylonsrc->transformation22 = 999.0;
-
+  pylonsrc->captureDelay = 0;
+
+  pylonsrc->chunkData = FALSE;
+  pylonsrc->chunkParser = NULL;
+  pylonsrc->serial = "\0";
+  pylonsrc->triggersource = "software\0";
+  pylonsrc->softwareTrigger = FALSE;
+  pylonsrc->deviceConnected = FALSE;
+  pylonsrc->grabThreads = 0;
+  pylonsrc->grabBuffers = 0;
+  pylonsrc->latencyBudget = 100;
+  pylonsrc->bufferMemory = 512;
+  pylonsrc->numBuffers = DEFAULT_NUM_BUFFERS;
+  pylonsrc->recommendedBuffers = 0;
+  pylonsrc->buffers = NULL;
+  pylonsrc->numAllocated = 0;
+  pylonsrc->bufferpages = "normal\0";
+  pylonsrc->lockBuffers = FALSE;
+  pylonsrc->numanode = "none\0";
+  pylonsrc->fdMemory = FALSE;
+  pylonsrc->fdAllocator = NULL;
+  pylonsrc->fdGeneration = 0;
+  pylonsrc->fdHalted = FALSE;
+  g_mutex_init(&pylonsrc->fdLock);
+  pylonsrc->bufferHandle = NULL;
+  pylonsrc->maxTransferSize = 0;
+  pylonsrc->queuedUrbs = 0;
+  pylonsrc->transferPriority = 0;
+  pylonsrc->grabEngine = FALSE;
+  pylonsrc->bandwidthplanner = "off\0";
+  pylonsrc->controllerBandwidth = 0;
+  pylonsrc->bandwidthPlanned = FALSE;
+  pylonsrc->previewPad = NULL;
+  pylonsrc->padProbe = 0;
+  pylonsrc->rois = g_strdup("");
+  pylonsrc->numRois = 0;
+  pylonsrc->strideAlign = 0;
+  pylonsrc->cameraClock = NULL;
+  pylonsrc->clockLatch = NULL;
+  pylonsrc->clockValue = NULL;
+  pylonsrc->timestampFrequency = 0;
+  pylonsrc->clockThread = NULL;
+  g_mutex_init(&pylonsrc->clockLock);
+  g_cond_init(&pylonsrc->clockCond);
+  pylonsrc->clockQuit = FALSE;
+  pylonsrc->startupFeatures = NULL;
+  pylonsrc->numRegistered = 0;
+  pylonsrc->bufferIdle = NULL;
+  pylonsrc->streamGrabberOpen = FALSE;
+  pylonsrc->grabPrepared = FALSE;
+  pylonsrc->acquiring = FALSE;
+  pylonsrc->warm = FALSE;
+  pylonsrc->warmChanged = FALSE;
+  pylonsrc->qos = PYLONSRC_QOS_OFF;
+  pylonsrc->qosMode = PYLONSRC_QOS_OFF;
+  pylonsrc->qosPending = FALSE;
+  pylonsrc->qosFramerate = FALSE;
+  pylonsrc->qosRate = 1.0;
+  pylonsrc->qosDropped = 0;
+  pylonsrc->minFrameRate = 0.0;
+  pylonsrc->maxFrameRate = 0.0;
+  pylonsrc->capsFrameRate = 0.0;
+  g_mutex_init(&pylonsrc->frameRateLock);
+  pylonsrc->outputStride = 0;
+  pylonsrc->videoMetaDownstream = FALSE;
+  memset(pylonsrc->roi, 0, sizeof(pylonsrc->roi));
+  pylonsrc->previewEvery = 10;
+  pylonsrc->previewFps = 0.0;
+  pylonsrc->previewCount = 0;
+  pylonsrc->nextPreview = GST_CLOCK_TIME_NONE;
   // Mark this element as a live source (disable preroll)
   gst_base_src_set_live(GST_BASE_SRC(pylonsrc), TRUE);
   gst_base_src_set_format(GST_BASE_SRC(pylonsrc), GST_FORMAT_TIME);
@@ -487,6 +788,19 @@ gst_pylonsrc_set_property (GObject * object, guint property_id,
   GstPylonsrc *pylonsrc = GST_PYLONSRC (object);
 
   GST_DEBUG_OBJECT (pylonsrc, "Setting a property.");
+  // Properties that only change what the plugin does with the frames don't make a warm camera configure from scratch
+  switch (property_id) {
+    case PROP_PREVIEWEVERY:
+    case PROP_PREVIEWFPS:
+    case PROP_ROIS:
+    case PROP_CAMERACLOCK:
+    case PROP_WARM:
+    case PROP_QOS:
+      break;
+    default:
+      pylonsrc->warmChanged = TRUE;
+      break;
+  }
 
   switch (property_id) {
     case PROP_CAMERA:
@@ -678,6 +992,112 @@ gst_pylonsrc_set_property (GObject * object, guint property_id,
     case PROP_TRANSFORMATION22:
       pylonsrc->transformation22 = g_value_get_double(value);
       break;
+    case PROP_CHUNKDATA:
+      pylonsrc->chunkData = g_value_get_boolean(value);
+      break;
+    case PROP_SERIAL:
+      pylonsrc->serial = g_value_dup_string(value+'\0');
+      break;
+    case PROP_TRIGGERSOURCE:
+      pylonsrc->triggersource = g_value_dup_string(value+'\0');
+      break;
+    case PROP_GRABTHREADS:
+      pylonsrc->grabThreads = g_value_get_uint(value);
+      break;
+    case PROP_GRABBUFFERS:
+      pylonsrc->grabBuffers = g_value_get_uint(value);
+      break;
+    case PROP_LATENCYBUDGET:
+      pylonsrc->latencyBudget = g_value_get_uint(value);
+      break;
+    case PROP_BUFFERMEMORY:
+      pylonsrc->bufferMemory = g_value_get_uint(value);
+      break;
+    case PROP_MAXTRANSFERSIZE:
+      pylonsrc->maxTransferSize = g_value_get_int(value);
+      break;
+    case PROP_QUEUEDURBS:
+      pylonsrc->queuedUrbs = g_value_get_int(value);
+      break;
+    case PROP_TRANSFERPRIORITY:
+      pylonsrc->transferPriority = g_value_get_int(value);
+      break;
+    case PROP_BUFFERPAGES:
+      pylonsrc->bufferpages = g_value_dup_string(value+'\0');
+      break;
+    case PROP_LOCKBUFFERS:
+      pylonsrc->lockBuffers = g_value_get_boolean(value);
+      break;
+    case PROP_NUMANODE:
+      pylonsrc->numanode = g_value_dup_string(value+'\0');
+      break;
+    case PROP_FDMEMORY:
+      pylonsrc->fdMemory = g_value_get_boolean(value);
+      break;
+    case PROP_BANDWIDTHPLANNER:
+      pylonsrc->bandwidthplanner = g_value_dup_string(value+'\0');
+      break;
+    case PROP_CONTROLLERBANDWIDTH:
+      pylonsrc->controllerBandwidth = g_value_get_int64(value);
+      break;
+    case PROP_PREVIEWEVERY:
+      pylonsrc->previewEvery = g_value_get_uint(value);
+      break;
+    case PROP_PREVIEWFPS:
+      pylonsrc->previewFps = g_value_get_double(value);
+      break;
+    case PROP_ROIS: {
+      GstPylonsrcRoi regions[MAX_ROIS];
+      const gchar *rois = g_value_get_string(value);
+      guint n = gst_pylonsrc_parse_rois(pylonsrc, rois, regions), i;
+
+      // The regions belong to their pads while those exist, and are read by the streaming thread
+      GST_OBJECT_LOCK(pylonsrc);
+      for(i = 0; i < MAX_ROIS && !pylonsrc->roi[i].pad; i++);
+      if(i < MAX_ROIS) {
+        GST_OBJECT_UNLOCK(pylonsrc);
+        GST_WARNING_OBJECT(pylonsrc, "Can't change the regions while their pads exist, release the roi pads first.");
+        break;
+      }
+      g_free(pylonsrc->rois);
+      pylonsrc->rois = g_strdup(rois ? rois : "");
+      memcpy(pylonsrc->roi, regions, sizeof(regions));
+      pylonsrc->numRois = n;
+      GST_OBJECT_UNLOCK(pylonsrc);
+      break;
+    }
+    case PROP_STRIDEALIGN:
+      pylonsrc->strideAlign = g_value_get_uint(value);
+      break;
+    case PROP_CAMERACLOCK:
+      // The clock has to be there before the pipeline picks one, so it's made right away
+      if(g_value_get_boolean(value)) {
+        if(!pylonsrc->cameraClock) {
+          pylonsrc->cameraClock = gst_object_ref_sink(g_object_new(GST_TYPE_SYSTEM_CLOCK, "name", "pylonclock", "clock-type", GST_CLOCK_TYPE_MONOTONIC, NULL));
+        }
+        GST_OBJECT_FLAG_SET(pylonsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+      } else {
+        GST_OBJECT_FLAG_UNSET(pylonsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+      }
+      break;
+    case PROP_WARM:
+      pylonsrc->warm = g_value_get_boolean(value);
+      break;
+    case PROP_QOS: {
+      const gchar *mode = g_value_get_string(value);
+      gint i;
+
+      for(i = 0; i < PYLONSRC_QOS_MODES && g_strcmp0(mode, qosModeNames[i]) != 0; i++);
+      if(i == PYLONSRC_QOS_MODES) {
+        GST_WARNING_OBJECT(pylonsrc, "Unknown QoS mode \"%s\", keeping \"%s\".", mode, qosModeNames[pylonsrc->qos]);
+        break;
+      }
+      // The streaming thread picks the new mode up with the next frame
+      GST_OBJECT_LOCK(pylonsrc);
+      pylonsrc->qos = i;
+      GST_OBJECT_UNLOCK(pylonsrc);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -881,6 +1301,82 @@ gst_pylonsrc_get_property (GObject * object, guint property_id,
     case PROP_TRANSFORMATION22:
       g_value_set_double(value, pylonsrc->transformation22);
       break;
+    case PROP_CHUNKDATA:
+      g_value_set_boolean(value, pylonsrc->chunkData);
+      break;
+    case PROP_SERIAL:
+      g_value_set_string(value, pylonsrc->serial);
+      break;
+    case PROP_TRIGGERSOURCE:
+      g_value_set_string(value, pylonsrc->triggersource);
+      break;
+    case PROP_GRABTHREADS:
+      g_value_set_uint(value, pylonsrc->grabThreads);
+      break;
+    case PROP_GRABBUFFERS:
+      g_value_set_uint(value, pylonsrc->grabBuffers);
+      break;
+    case PROP_LATENCYBUDGET:
+      g_value_set_uint(value, pylonsrc->latencyBudget);
+      break;
+    case PROP_BUFFERMEMORY:
+      g_value_set_uint(value, pylonsrc->bufferMemory);
+      break;
+    case PROP_RECOMMENDEDBUFFERS:
+      g_value_set_uint(value, pylonsrc->recommendedBuffers);
+      break;
+    case PROP_MAXTRANSFERSIZE:
+      g_value_set_int(value, pylonsrc->maxTransferSize);
+      break;
+    case PROP_QUEUEDURBS:
+      g_value_set_int(value, pylonsrc->queuedUrbs);
+      break;
+    case PROP_TRANSFERPRIORITY:
+      g_value_set_int(value, pylonsrc->transferPriority);
+      break;
+    case PROP_BUFFERPAGES:
+      g_value_set_string(value, pylonsrc->bufferpages);
+      break;
+    case PROP_LOCKBUFFERS:
+      g_value_set_boolean(value, pylonsrc->lockBuffers);
+      break;
+    case PROP_NUMANODE:
+      g_value_set_string(value, pylonsrc->numanode);
+      break;
+    case PROP_FDMEMORY:
+      g_value_set_boolean(value, pylonsrc->fdMemory);
+      break;
+    case PROP_BANDWIDTHPLANNER:
+      g_value_set_string(value, pylonsrc->bandwidthplanner);
+      break;
+    case PROP_CONTROLLERBANDWIDTH:
+      g_value_set_int64(value, pylonsrc->controllerBandwidth);
+      break;
+    case PROP_PREVIEWEVERY:
+      g_value_set_uint(value, pylonsrc->previewEvery);
+      break;
+    case PROP_PREVIEWFPS:
+      g_value_set_double(value, pylonsrc->previewFps);
+      break;
+    case PROP_ROIS:
+      GST_OBJECT_LOCK(pylonsrc);
+      g_value_set_string(value, pylonsrc->rois);
+      GST_OBJECT_UNLOCK(pylonsrc);
+      break;
+    case PROP_STRIDEALIGN:
+      g_value_set_uint(value, pylonsrc->strideAlign);
+      break;
+    case PROP_CAMERACLOCK:
+      g_value_set_boolean(value, GST_OBJECT_FLAG_IS_SET(pylonsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK));
+      break;
+    case PROP_WARM:
+      g_value_set_boolean(value, pylonsrc->warm);
+      break;
+    case PROP_QOS:
+      GST_OBJECT_LOCK(pylonsrc);
+      g_value_set_string(value, qosModeNames[pylonsrc->qos]);
+      GST_OBJECT_UNLOCK(pylonsrc);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -893,7 +1389,7 @@ gst_pylonsrc_get_caps (GstBaseSrc * src, GstCaps * filter)
 {
   GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
   GST_DEBUG_OBJECT(pylonsrc, "Received a request for caps.");
-  if(!deviceConnected) {
+  if(!pylonsrc->deviceConnected) {
     GST_DEBUG_OBJECT(pylonsrc, "Could not send caps - no camera connected.");
     return gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(src));
   } else {
@@ -928,19 +1424,55 @@ gst_pylonsrc_get_caps (GstBaseSrc * src, GstCaps * filter)
     GstCaps *caps = gst_caps_new_simple (type,
     "format", G_TYPE_STRING, format,
     "width", G_TYPE_INT, pylonsrc->width,
-    "height", G_TYPE_INT, pylonsrc->height,
-    "framerate", GST_TYPE_FRACTION_RANGE, 0, 1, G_MAXINT, 1, NULL);
-    
-    GST_DEBUG_OBJECT(pylonsrc, "The following caps were sent: %s, %s, %"PRId64"x%"PRId64", variable fps.", type, format, pylonsrc->width, pylonsrc->height);
+    "height", G_TYPE_INT, pylonsrc->height, NULL);
+
+    // A free running camera runs at a fixed rate, or at the one downstream picks if it has AcquisitionFrameRate, a triggered one at whatever rate the triggers come at
+    if(pylonsrc->minFrameRate > 0.0) {
+      gint minNum, minDen, maxNum, maxDen;
+
+      gst_util_double_to_fraction(pylonsrc->minFrameRate, &minNum, &minDen);
+      gst_util_double_to_fraction(pylonsrc->maxFrameRate, &maxNum, &maxDen);
+      gst_caps_set_simple(caps, "framerate", GST_TYPE_FRACTION_RANGE, minNum, minDen, maxNum, maxDen, NULL);
+      GST_DEBUG_OBJECT(pylonsrc, "The following caps were sent: %s, %s, %"PRId64"x%"PRId64", %d/%d to %d/%d fps.", type, format, pylonsrc->width, pylonsrc->height, minNum, minDen, maxNum, maxDen);
+    } else if(pylonsrc->continuousMode && pylonsrc->frameRate > 0.0) {
+      gint num, den;
+
+      gst_util_double_to_fraction(pylonsrc->frameRate, &num, &den);
+      gst_caps_set_simple(caps, "framerate", GST_TYPE_FRACTION, num, den, NULL);
+      GST_DEBUG_OBJECT(pylonsrc, "The following caps were sent: %s, %s, %"PRId64"x%"PRId64", %d/%d fps.", type, format, pylonsrc->width, pylonsrc->height, num, den);
+    } else {
+      gst_caps_set_simple(caps, "framerate", GST_TYPE_FRACTION_RANGE, 0, 1, G_MAXINT, 1, NULL);
+      GST_DEBUG_OBJECT(pylonsrc, "The following caps were sent: %s, %s, %"PRId64"x%"PRId64", variable fps.", type, format, pylonsrc->width, pylonsrc->height);
+    }
     return caps;
   }
 }
 
+/* Unless downstream wants otherwise, the camera runs as fast as it can */
+static GstCaps *
+gst_pylonsrc_fixate (GstBaseSrc * src, GstCaps * caps)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
+  gint num, den;
+  guint i;
+
+  if(pylonsrc->minFrameRate > 0.0) {
+    gst_util_double_to_fraction(pylonsrc->maxFrameRate, &num, &den);
+    caps = gst_caps_make_writable(caps);
+    for(i = 0; i < gst_caps_get_size(caps); i++) {
+      gst_structure_fixate_field_nearest_fraction(gst_caps_get_structure(caps, i), "framerate", num, den);
+    }
+  }
+
+  return GST_BASE_SRC_CLASS (gst_pylonsrc_parent_class)->fixate (src, caps);
+}
+
 static gboolean
 gst_pylonsrc_set_caps (GstBaseSrc * src, GstCaps * caps)
 {
   GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
   GstStructure *s = gst_caps_get_structure (caps, 0);
+  gint num, den;
 
   GST_DEBUG_OBJECT (pylonsrc, "Setting caps to %" GST_PTR_FORMAT, caps);
   
@@ -953,6 +1485,35 @@ gst_pylonsrc_set_caps (GstBaseSrc * src, GstCaps * caps)
       goto unsupported_caps; 
     }
   }
+
+  // Have the camera take only as many frames as downstream asked for
+  if(pylonsrc->minFrameRate > 0.0 && gst_structure_get_fraction(s, "framerate", &num, &den) && num > 0 && den > 0) {
+    double fps;
+
+    // set_caps can come from another thread than the one QoS changes the framerate from
+    g_mutex_lock(&pylonsrc->frameRateLock);
+    fps = CLAMP((double) num / den, pylonsrc->minFrameRate, pylonsrc->maxFrameRate);
+    // At the highest rate there's nothing to limit
+    pylonsrc->capsFrameRate = fps < pylonsrc->maxFrameRate ? fps : 0.0;
+    if(!pylonc_set_frame_rate(pylonsrc, pylonsrc->capsFrameRate)) {
+      g_mutex_unlock(&pylonsrc->frameRateLock);
+      GST_ERROR_OBJECT(pylonsrc, "Couldn't set the camera's framerate to %d/%d.", num, den);
+      return FALSE;
+    }
+    // The negotiated rate replaces whatever QoS had lowered it to
+    pylonsrc->qosRate = 1.0;
+    pylonsrc->qosCredit = 0.0;
+    g_mutex_unlock(&pylonsrc->frameRateLock);
+
+    if(pylonsrc->frameRate > 0.0 && ABS(pylonsrc->frameRate - fps) > fps / 100) {
+      GST_WARNING_OBJECT(pylonsrc, "Negotiated %.2lf fps, but the camera runs at %.2lf fps with its current settings.", fps, pylonsrc->frameRate);
+    } else {
+      GST_DEBUG_OBJECT(pylonsrc, "Running the camera at the negotiated %.2lf fps.", fps);
+    }
+
+    // The grab buffers are registered by now, so their number stays the one start() picked for the highest rate. At a lower rate they only cover more than latencybudget, which the latency query reports from the new rate.
+    gst_element_post_message(GST_ELEMENT(pylonsrc), gst_message_new_latency(GST_OBJECT(pylonsrc)));
+  }
   return TRUE;
 
 unsupported_caps:
@@ -960,141 +1521,647 @@ unsupported_caps:
   return FALSE;
 }
 
-/* plugin's code */
+/* Frames are stamped with the time their exposure started, and reach us once they're read out and transferred. They can then wait in the grab buffers until the camera has filled all of them. */
 static gboolean
-gst_pylonsrc_start (GstBaseSrc * src)
+gst_pylonsrc_query (GstBaseSrc * src, GstQuery * query)
 {
-  // Initialise PylonC
   GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
-  pylonc_initialize();
-  GENAPIC_RESULT res;
-  gint i;
-
-  // Select a device
-  size_t numDevices;
-  res = PylonEnumerateDevices( &numDevices );
-  PYLONC_CHECK_ERROR(pylonsrc, res);
-  GST_DEBUG_OBJECT(pylonsrc, "pylonsrc: found %i Basler device(s).", (int)numDevices);  
-  if(numDevices==0) {
-    GST_ERROR_OBJECT(pylonsrc, "No devices connected, canceling initialisation.");
-    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
-    goto error;  
-  } else if (numDevices==1) {
-    if (pylonsrc->cameraId!=9999) {
-      GST_MESSAGE_OBJECT(pylonsrc, "Camera id was set, but was ignored as only one camera was found.");
-    }
-    pylonsrc->cameraId = 0;
-  } else if (numDevices>1 && pylonsrc->cameraId==9999) {
-    GST_MESSAGE_OBJECT(pylonsrc, "Multiple cameras found, and the user didn't specify which camera to use.");
-    GST_MESSAGE_OBJECT(pylonsrc, "Please specify the camera using the CAMERA property.");
-    GST_MESSAGE_OBJECT(pylonsrc, "The camera IDs are as follows: ");
+  GstClockTime minLatency, maxLatency = GST_CLOCK_TIME_NONE;
 
-    for(i=0; i<numDevices; i++) {
-      PYLON_DEVICE_HANDLE deviceHandle;
-      res = PylonCreateDeviceByIndex(i, &deviceHandle);
+  if(GST_QUERY_TYPE(query) != GST_QUERY_LATENCY || !pylonsrc->deviceConnected) {
+    return GST_BASE_SRC_CLASS (gst_pylonsrc_parent_class)->query (src, query);
+  }
 
-      if (res == GENAPI_E_OK) {
-        res = PylonDeviceOpen(deviceHandle, PYLONC_ACCESS_MODE_CONTROL | PYLONC_ACCESS_MODE_STREAM); 
-        PYLONC_CHECK_ERROR(pylonsrc,res);
+  minLatency = pylonsrc->captureDelay;
+  if(pylonsrc->frameRate > 0.0) {
+    maxLatency = minLatency + (GstClockTime) (pylonsrc->numBuffers * GST_SECOND / pylonsrc->frameRate);
+  }
+  GST_DEBUG_OBJECT(pylonsrc, "Reporting a latency of %" GST_TIME_FORMAT " to %" GST_TIME_FORMAT ".", GST_TIME_ARGS(minLatency), GST_TIME_ARGS(maxLatency));
+  gst_query_set_latency(query, TRUE, minLatency, maxLatency);
+  return TRUE;
+}
 
-        pylonc_print_camera_info(pylonsrc, deviceHandle, i);
-      } else {
-        GST_MESSAGE_OBJECT(pylonsrc, "ID:%i, Name: Unavailable, Serial No: Unavailable, Status: In use?", i);
-      }
+static GstClock *
+gst_pylonsrc_provide_clock (GstElement * element)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (element);
 
-      PylonDeviceClose(deviceHandle);
-      PylonDestroyDevice(deviceHandle);
-    }
+  if(!pylonsrc->cameraClock || !GST_OBJECT_FLAG_IS_SET(pylonsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK)) {
+    return NULL;
+  }
+  return GST_CLOCK (gst_object_ref(pylonsrc->cameraClock));
+}
 
-    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera selected"));
-    goto error;
-  } else if ( pylonsrc->cameraId != 9999 && pylonsrc->cameraId > numDevices) {
-    GST_MESSAGE_OBJECT(pylonsrc, "No camera found with id %i.", pylonsrc->cameraId);    
-    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
-    goto error;
+/* Format of the frames for GstVideoMeta. The bayer formats have one byte per pixel like GRAY8. */
+static GstVideoFormat
+gst_pylonsrc_video_format (GstPylonsrc * pylonsrc)
+{
+  if(strcmp(pylonsrc->imageFormat, "rgb8") == 0) {
+    return GST_VIDEO_FORMAT_RGB;
+  } else if(strcmp(pylonsrc->imageFormat, "bgr8") == 0) {
+    return GST_VIDEO_FORMAT_BGR;
+  } else if(strcmp(pylonsrc->imageFormat, "ycbcr422_8") == 0) {
+    return GST_VIDEO_FORMAT_YUY2;
   }
+  return GST_VIDEO_FORMAT_GRAY8;
+}
 
-  // Connect to the camera 
-  _Bool device = pylonc_connect_camera(pylonsrc);
-  if(!device) {
-    GST_ERROR_OBJECT(pylonsrc, "Couldn't initialise the camera");
-    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
-    goto error;
+/* Padded rows need downstream to understand GstVideoMeta */
+static gboolean
+gst_pylonsrc_decide_allocation (GstBaseSrc * src, GstQuery * query)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
+
+  pylonsrc->videoMetaDownstream = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+  if(pylonsrc->strideAlign > 1 && !pylonsrc->videoMetaDownstream) {
+    GST_WARNING_OBJECT(pylonsrc, "Downstream doesn't support GstVideoMeta, so the rows can't be padded to stridealign.");
   }
 
-  if(strcmp(pylonsrc->userid, "") != 0) {
-    if (PylonDeviceFeatureIsWritable(pylonsrc->deviceHandle, "DeviceUserID")) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "DeviceUserID", pylonsrc->userid);
-      PYLONC_CHECK_ERROR(pylonsrc, res);
+  return GST_BASE_SRC_CLASS (gst_pylonsrc_parent_class)->decide_allocation (src, query);
+}
+
+/* preview and ROI pads */
+
+/* Parses a value of the rois property, "x,y,width,height;...", into MAX_ROIS regions without pads. Returns the number of regions. */
+static guint
+gst_pylonsrc_parse_rois (GstPylonsrc * pylonsrc, const gchar * rois, GstPylonsrcRoi * roi)
+{
+  gchar **regions;
+  gint x, y, width, height;
+  guint i, n = 0;
+
+  memset(roi, 0, MAX_ROIS * sizeof(GstPylonsrcRoi));
+  regions = g_strsplit(rois ? rois : "", ";", -1);
+  for(i = 0; regions[i]; i++) {
+    if(g_strstrip(regions[i])[0] == '\0') {
+      continue;
     }
+    if(sscanf(regions[i], "%d,%d,%d,%d", &x, &y, &width, &height) != 4 || x < 0 || y < 0 || width <= 0 || height <= 0) {
+      GST_WARNING_OBJECT(pylonsrc, "Ignoring the region \"%s\", regions are given as x,y,width,height.", regions[i]);
+      continue;
+    }
+    if(n == MAX_ROIS) {
+      GST_WARNING_OBJECT(pylonsrc, "Only the first %d regions are used.", MAX_ROIS);
+      break;
+    }
+    roi[n].x = x;
+    roi[n].y = y;
+    roi[n].width = width;
+    roi[n].height = height;
+    n++;
   }
+  g_strfreev(regions);
+  return n;
+}
 
-  // Print the name of the camera
-  pylonc_print_camera_info(pylonsrc, pylonsrc->deviceHandle, pylonsrc->cameraId);
-
-  // Reset the camera if required.
-  pylonsrc->reset = g_ascii_strdown(pylonsrc->reset, -1);
-  if(strcmp(pylonsrc->reset, "before") == 0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "DeviceReset")) {
-        pylonc_reset_camera(pylonsrc);
-        pylonc_disconnect_camera(pylonsrc);
-        pylonc_terminate();
+/* Whether any preview or ROI pads were requested. Called with the object lock. */
+static _Bool
+gst_pylonsrc_has_extra_pads (GstPylonsrc * pylonsrc)
+{
+  guint i;
 
-        GST_MESSAGE_OBJECT(pylonsrc, "Camera reset. Waiting 6 seconds for it to fully reboot.");
-        sleep(6);
+  if(pylonsrc->previewPad) {
+    return TRUE;
+  }
+  for(i = 0; i < MAX_ROIS; i++) {
+    if(pylonsrc->roi[i].pad) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
 
-        pylonc_initialize();
-        res = PylonEnumerateDevices( &numDevices );
-        PYLONC_CHECK_ERROR(pylonsrc, res);
+static GstPad *
+gst_pylonsrc_request_new_pad (GstElement * element, GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (element);
+  GstPad *pad, *srcpad = GST_BASE_SRC_PAD(pylonsrc);
+  GstPylonsrcRoi *roi = NULL;
+  gchar *padName;
+  guint i;
+
+  GST_OBJECT_LOCK(pylonsrc);
+  if(templ == gst_element_class_get_pad_template(GST_ELEMENT_GET_CLASS(element), "preview")) {
+    if(pylonsrc->previewPad) {
+      GST_OBJECT_UNLOCK(pylonsrc);
+      GST_WARNING_OBJECT(pylonsrc, "There already is a preview pad.");
+      return NULL;
+    }
+    padName = g_strdup("preview");
+  } else {
+    // roi_N is the Nth region of rois, without a number the first region that has no pad yet is used
+    if(!name || sscanf(name, "roi_%u", &i) != 1) {
+      for(i = 0; i < pylonsrc->numRois && pylonsrc->roi[i].pad; i++);
+    }
+    if(i >= pylonsrc->numRois || pylonsrc->roi[i].pad) {
+      gchar *rois = g_strdup(pylonsrc->rois);
 
-        _Bool device = pylonc_connect_camera(pylonsrc);
-        if(!device) {
-          GST_ERROR_OBJECT(pylonsrc, "Couldn't initialise the camera. It looks like the reset failed. Please manually reconnect the camera and try again.");
-          GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
-          goto error;
-        }
-      } else {
-        GST_ERROR_OBJECT(pylonsrc, "Couldn't reset the device - feature not supported. Cancelling startup.");
-        GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera couldn't be reset properly."));
-        goto error;
-      }
+      GST_OBJECT_UNLOCK(pylonsrc);
+      GST_WARNING_OBJECT(pylonsrc, "Couldn't make a pad for %s, there's no such region in rois (\"%s\") or it already has a pad.", name ? name : "another region", rois);
+      g_free(rois);
+      return NULL;
+    }
+    roi = &pylonsrc->roi[i];
+    padName = g_strdup_printf("roi_%u", i);
   }
 
-  // set binning of camera
-  _Bool cameraReportsBinningHorizontal = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "BinningHorizontal");
-  _Bool cameraReportsBinningVertical = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "BinningVertical");
-  if(cameraReportsBinningVertical && cameraReportsBinningHorizontal) {
-    GST_DEBUG_OBJECT(pylonsrc, "Setting horizontal binning to %"PRId64, pylonsrc->binningh);
-    res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "BinningHorizontal", pylonsrc->binningh);
-    PYLONC_CHECK_ERROR(pylonsrc, res);
-    GST_DEBUG_OBJECT(pylonsrc, "Setting vertical binning to %"PRId64, pylonsrc->binningv);
-    res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "BinningVertical", pylonsrc->binningv);
-    PYLONC_CHECK_ERROR(pylonsrc, res);
+  pad = gst_pad_new_from_template(templ, padName);
+  g_free(padName);
+  if(roi) {
+    roi->pad = pad;
+    roi->cropWidth = 0;
+    roi->queried = FALSE;
+    roi->started = FALSE;
+    gst_pad_set_element_private(pad, roi);
+  } else {
+    pylonsrc->previewPad = pad;
+    pylonsrc->previewCount = 0;
+    pylonsrc->nextPreview = GST_CLOCK_TIME_NONE;
   }
+  GST_OBJECT_UNLOCK(pylonsrc);
+
+  // The pad follows the src pad's stream, including when it's requested while running
+  gst_pad_use_fixed_caps(pad);
+  gst_element_add_pad(element, pad);
+  GST_OBJECT_LOCK(pylonsrc);
+  if(pylonsrc->padProbe == 0) {
+    pylonsrc->padProbe = gst_pad_add_probe(srcpad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH, gst_pylonsrc_pad_probe, pylonsrc, NULL);
+  }
+  GST_OBJECT_UNLOCK(pylonsrc);
+  gst_pad_sticky_events_foreach(srcpad, gst_pylonsrc_copy_sticky_event, pad);
 
-  // Get the camera's resolution
-  _Bool cameraReportsWidth = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "Width");
-  _Bool cameraReportsHeight = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "Height");
-  if(!cameraReportsWidth || !cameraReportsHeight) {
-    GST_ERROR_OBJECT(pylonsrc, "The camera doesn't seem to be reporting it's resolution.");    
-    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera isn't reporting it's resolution. (Unsupported device?)"));
-    goto error;
+  return pad;
+}
+
+static void
+gst_pylonsrc_release_pad (GstElement * element, GstPad * pad)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (element);
+  GstPylonsrcRoi *roi = gst_pad_get_element_private(pad);
+  gulong probe = 0;
+
+  GST_OBJECT_LOCK(pylonsrc);
+  if(pad == pylonsrc->previewPad) {
+    pylonsrc->previewPad = NULL;
+  } else if(roi && roi->pad == pad) {
+    roi->pad = NULL;
+  } else {
+    GST_OBJECT_UNLOCK(pylonsrc);
+    return;
+  }
+  if(!gst_pylonsrc_has_extra_pads(pylonsrc)) {
+    probe = pylonsrc->padProbe;
+    pylonsrc->padProbe = 0;
+  }
+  GST_OBJECT_UNLOCK(pylonsrc);
+
+  if(probe) {
+    gst_pad_remove_probe(GST_BASE_SRC_PAD(pylonsrc), probe);
+  }
+  gst_pad_set_active(pad, FALSE);
+  gst_element_remove_pad(element, pad);
+}
+
+/* Caps of the preview, with the framerate lowered to the preview's */
+static GstCaps *
+gst_pylonsrc_preview_caps (GstPylonsrc * pylonsrc, GstCaps * caps)
+{
+  GstStructure *s = gst_caps_get_structure(caps, 0);
+  gint num, den;
+
+  if(!gst_structure_get_fraction(s, "framerate", &num, &den)) {
+    return gst_caps_ref(caps);
+  }
+
+  caps = gst_caps_copy(caps);
+  if(pylonsrc->previewFps > 0.0) {
+    gst_util_double_to_fraction(pylonsrc->previewFps, &num, &den);
+  } else if(num > 0 && den <= G_MAXINT / (gint) MIN(pylonsrc->previewEvery, G_MAXINT)) {
+    den *= pylonsrc->previewEvery;
+  }
+  gst_caps_set_simple(caps, "framerate", GST_TYPE_FRACTION, num, den, NULL);
+  return caps;
+}
+
+/* Fits a region into the frames described by the caps, and returns the caps of its pad */
+static GstCaps *
+gst_pylonsrc_roi_caps (GstPylonsrc * pylonsrc, GstPylonsrcRoi * roi, GstCaps * caps)
+{
+  GstStructure *s = gst_caps_get_structure(caps, 0);
+  const gchar *format = gst_structure_get_string(s, "format");
+  gint frameWidth = 0, frameHeight = 0, alignX = 1, alignY = 1;
+
+  gst_structure_get_int(s, "width", &frameWidth);
+  gst_structure_get_int(s, "height", &frameHeight);
+
+  // The bayer formats have one byte per pixel like GRAY8, but the region has to start on the same colour of the pattern
+  roi->format = GST_VIDEO_FORMAT_GRAY8;
+  roi->bpp = 1;
+  if(gst_structure_has_name(s, "video/x-bayer")) {
+    alignX = 2;
+    alignY = 2;
+  } else if(format) {
+    roi->format = gst_video_format_from_string(format);
+    if(roi->format == GST_VIDEO_FORMAT_YUY2) {
+      roi->bpp = 2;
+      alignX = 2;
+    } else if(roi->format == GST_VIDEO_FORMAT_RGB || roi->format == GST_VIDEO_FORMAT_BGR) {
+      roi->bpp = 3;
+    }
+  }
+
+  // Keep the region inside of the frame
+  roi->cropX = MIN(roi->x, MAX(frameWidth - alignX, 0)) / alignX * alignX;
+  roi->cropY = MIN(roi->y, MAX(frameHeight - alignY, 0)) / alignY * alignY;
+  roi->cropWidth = MAX(MIN(roi->width, frameWidth - roi->cropX) / alignX * alignX, MIN(alignX, frameWidth));
+  roi->cropHeight = MAX(MIN(roi->height, frameHeight - roi->cropY) / alignY * alignY, MIN(alignY, frameHeight));
+  roi->frameStride = frameWidth * roi->bpp;
+  if(roi->cropX != roi->x || roi->cropY != roi->y || roi->cropWidth != roi->width || roi->cropHeight != roi->height) {
+    GST_WARNING_OBJECT(pylonsrc, "The region %d,%d,%d,%d doesn't fit a %dx%d frame, using %d,%d,%d,%d instead.", roi->x, roi->y, roi->width, roi->height, frameWidth, frameHeight, roi->cropX, roi->cropY, roi->cropWidth, roi->cropHeight);
+  }
+  roi->queried = FALSE;
+
+  caps = gst_caps_copy(caps);
+  gst_caps_set_simple(caps, "width", G_TYPE_INT, roi->cropWidth, "height", G_TYPE_INT, roi->cropHeight, NULL);
+  return caps;
+}
+
+/* The version of one of the src pad's events for a preview or ROI pad */
+static GstEvent *
+gst_pylonsrc_pad_event (GstPylonsrc * pylonsrc, GstPad * pad, GstEvent * event)
+{
+  GstPylonsrcRoi *roi = gst_pad_get_element_private(pad);
+  GstCaps *caps;
+
+  if(GST_EVENT_TYPE(event) != GST_EVENT_CAPS) {
+    return gst_event_ref(event);
+  }
+
+  gst_event_parse_caps(event, &caps);
+  caps = roi ? gst_pylonsrc_roi_caps(pylonsrc, roi, caps) : gst_pylonsrc_preview_caps(pylonsrc, caps);
+  event = gst_event_new_caps(caps);
+  gst_caps_unref(caps);
+  return event;
+}
+
+static gboolean
+gst_pylonsrc_copy_sticky_event (GstPad * pad, GstEvent ** event, gpointer user_data)
+{
+  GstPad *extraPad = GST_PAD (user_data);
+  GstEvent *copy;
+
+  copy = gst_pylonsrc_pad_event(GST_PYLONSRC (GST_OBJECT_PARENT (extraPad)), extraPad, *event);
+  gst_pad_store_sticky_event(extraPad, copy);
+  gst_event_unref(copy);
+  return TRUE;
+}
+
+/* Whether a frame goes to the preview, every previewevery'th frame or previewfps frames a second */
+static _Bool
+gst_pylonsrc_preview_take (GstPylonsrc * pylonsrc, GstClockTime pts)
+{
+  GstClockTime period;
+  _Bool take;
+
+  if(pylonsrc->previewFps > 0.0 && GST_CLOCK_TIME_IS_VALID(pts)) {
+    // Keep to the framerate on average, but don't try to catch up after a gap
+    period = (GstClockTime) (GST_SECOND / pylonsrc->previewFps);
+    take = !GST_CLOCK_TIME_IS_VALID(pylonsrc->nextPreview) || pts >= pylonsrc->nextPreview;
+    if(take) {
+      if(!GST_CLOCK_TIME_IS_VALID(pylonsrc->nextPreview) || pts >= pylonsrc->nextPreview + period) {
+        pylonsrc->nextPreview = pts + period;
+      } else {
+        pylonsrc->nextPreview += period;
+      }
+    }
+  } else {
+    take = pylonsrc->previewCount % pylonsrc->previewEvery == 0;
+  }
+  pylonsrc->previewCount++;
+  return take;
+}
+
+/* Asks downstream of a pad whether it understands GstVideoMeta, i.e. rows that are further apart than the width */
+static gboolean
+gst_pylonsrc_query_video_meta (GstPad * pad)
+{
+  GstCaps *caps = gst_pad_get_current_caps(pad);
+  GstQuery *query;
+  gboolean supported;
+
+  if(!caps) {
+    return FALSE;
+  }
+  query = gst_query_new_allocation(caps, FALSE);
+  supported = gst_pad_peer_query(pad, query) && gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+  gst_query_unref(query);
+  gst_caps_unref(caps);
+  return supported;
+}
+
+/* Cuts a region out of a frame. When downstream understands GstVideoMeta the region shares the frame's memory, otherwise its rows are copied. */
+static GstBuffer *
+gst_pylonsrc_crop (GstPylonsrc * pylonsrc, GstPylonsrcRoi * roi, GstPad * pad, GstBuffer * buf)
+{
+  GstVideoMeta *videoMeta = gst_buffer_get_video_meta(buf);
+  GstBuffer *out;
+  GstMapInfo in, map;
+  gsize stride, offset, rowSize, size, i;
+  gsize offsets[GST_VIDEO_MAX_PLANES] = { 0 };
+  gint strides[GST_VIDEO_MAX_PLANES] = { 0 };
+
+  if(roi->cropWidth == 0) {
+    return NULL;
+  }
+
+  // The frame's own rows may be padded
+  stride = videoMeta ? (gsize) videoMeta->stride[0] : roi->frameStride;
+  offset = (videoMeta ? videoMeta->offset[0] : 0) + roi->cropY * stride + roi->cropX * roi->bpp;
+  rowSize = roi->cropWidth * roi->bpp;
+  size = (roi->cropHeight - 1) * stride + rowSize;
+  if(offset + size > gst_buffer_get_size(buf)) {
+    GST_WARNING_OBJECT(pylonsrc, "The frame is too small for the region %d,%d,%d,%d.", roi->cropX, roi->cropY, roi->cropWidth, roi->cropHeight);
+    return NULL;
+  }
+
+  if(!roi->queried || gst_pad_check_reconfigure(pad)) {
+    roi->videoMeta = gst_pylonsrc_query_video_meta(pad);
+    // Downstream only gets the caps along with the first buffer, so it's asked again after that
+    roi->queried = roi->started;
+    GST_DEBUG_OBJECT(pad, "Downstream %s GstVideoMeta, the region is %s.", roi->videoMeta ? "supports" : "doesn't support", roi->videoMeta ? "pushed in the frame's memory" : "copied");
+  }
+
+  if(roi->videoMeta) {
+    // The timestamps are only copied for regions starting at 0
+    out = gst_buffer_copy_region(buf, GST_BUFFER_COPY_METADATA | GST_BUFFER_COPY_MEMORY, offset, size);
+    GST_BUFFER_PTS(out) = GST_BUFFER_PTS(buf);
+    GST_BUFFER_DTS(out) = GST_BUFFER_DTS(buf);
+    GST_BUFFER_DURATION(out) = GST_BUFFER_DURATION(buf);
+    GST_BUFFER_OFFSET(out) = GST_BUFFER_OFFSET(buf);
+    GST_BUFFER_OFFSET_END(out) = GST_BUFFER_OFFSET_END(buf);
+    strides[0] = (gint) stride;
+  } else {
+    out = gst_buffer_new_and_alloc(rowSize * roi->cropHeight);
+    gst_buffer_copy_into(out, buf, GST_BUFFER_COPY_METADATA, 0, -1);
+    gst_buffer_map(buf, &in, GST_MAP_READ);
+    gst_buffer_map(out, &map, GST_MAP_WRITE);
+    for(i = 0; i < (gsize) roi->cropHeight; i++) {
+      memcpy(map.data + i * rowSize, in.data + offset + i * stride, rowSize);
+    }
+    gst_buffer_unmap(out, &map);
+    gst_buffer_unmap(buf, &in);
+    strides[0] = (gint) rowSize;
+  }
+
+  // Describe the region instead of the frame
+  while((videoMeta = gst_buffer_get_video_meta(out))) {
+    gst_buffer_remove_meta(out, (GstMeta *) videoMeta);
+  }
+  gst_buffer_add_video_meta_full(out, GST_VIDEO_FRAME_FLAG_NONE, roi->format, roi->cropWidth, roi->cropHeight, 1, offsets, strides);
+  return out;
+}
+
+/* Passes the src pad's events and frames on to the preview and ROI pads. The preview gets the same buffers as the src pad, and the ROI pads get parts of them, so the frames they skip cost nothing, and neither do the ones they take as long as downstream understands GstVideoMeta. */
+static GstPadProbeReturn
+gst_pylonsrc_pad_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (user_data);
+  GstPad *pads[MAX_ROIS + 1];
+  GstPylonsrcRoi *roi;
+  GstBuffer *buf, *out;
+  GstEvent *event;
+  GstFlowReturn ret;
+  guint numPads = 0, i;
+
+  GST_OBJECT_LOCK(pylonsrc);
+  if(pylonsrc->previewPad) {
+    pads[numPads++] = gst_object_ref(pylonsrc->previewPad);
+  }
+  for(i = 0; i < MAX_ROIS; i++) {
+    if(pylonsrc->roi[i].pad) {
+      pads[numPads++] = gst_object_ref(pylonsrc->roi[i].pad);
+    }
+  }
+  GST_OBJECT_UNLOCK(pylonsrc);
+
+  if(info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    buf = GST_PAD_PROBE_INFO_BUFFER(info);
+    for(i = 0; i < numPads; i++) {
+      roi = gst_pad_get_element_private(pads[i]);
+      if(roi) {
+        out = gst_pylonsrc_crop(pylonsrc, roi, pads[i], buf);
+      } else {
+        out = gst_pylonsrc_preview_take(pylonsrc, GST_BUFFER_PTS(buf)) ? gst_buffer_ref(buf) : NULL;
+      }
+      if(!out) {
+        continue;
+      }
+
+      ret = gst_pad_push(pads[i], out);
+      if(roi) {
+        roi->started = TRUE;
+      }
+      if(ret != GST_FLOW_OK && ret != GST_FLOW_NOT_LINKED && ret != GST_FLOW_FLUSHING) {
+        GST_DEBUG_OBJECT(pads[i], "Pushing returned %s.", gst_flow_get_name(ret));
+      }
+    }
+  } else {
+    event = GST_PAD_PROBE_INFO_EVENT(info);
+    if(GST_EVENT_TYPE(event) == GST_EVENT_STREAM_START || GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP) {
+      pylonsrc->previewCount = 0;
+      pylonsrc->nextPreview = GST_CLOCK_TIME_NONE;
+    }
+    for(i = 0; i < numPads; i++) {
+      gst_pad_push_event(pads[i], gst_pylonsrc_pad_event(pylonsrc, pads[i], event));
+    }
+  }
+
+  for(i = 0; i < numPads; i++) {
+    gst_object_unref(pads[i]);
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+/* plugin's code */
+static gboolean
+gst_pylonsrc_start (GstBaseSrc * src)
+{
+  // Initialise PylonC
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
+  gst_pylonsrc_profile_begin(pylonsrc);
+
+  // A camera kept warm only has to be started again, unless it has to be configured differently
+  if(pylonsrc->deviceConnected) {
+    if(!pylonsrc->warmChanged) {
+      gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_ACQUISITION);
+      if(pylonc_resume_camera(pylonsrc)) {
+        GST_MESSAGE_OBJECT(pylonsrc, "Resumed the warm camera.");
+        gst_pylonsrc_qos_reset(pylonsrc);
+        gst_pylonsrc_profile_finish(pylonsrc);
+        return TRUE;
+      }
+      GST_WARNING_OBJECT(pylonsrc, "Couldn't resume the warm camera, connecting to it again.");
+      gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_ENUMERATE);
+    } else {
+      GST_DEBUG_OBJECT(pylonsrc, "The properties changed while the camera was kept warm, configuring it from scratch.");
+    }
+    pylonc_disconnect_camera(pylonsrc);
+  }
+  pylonc_initialize();
+  GENAPIC_RESULT res;
+  gint i;
+  int64_t throughput = 0, transferSize = pylonsrc->maxTransferSize, queuedUrbs = pylonsrc->queuedUrbs, transferPriority;
+  double readoutTime = 0.0, exposureTime = 0.0;
+  NODEMAP_HANDLE streamNodeMap;
+  gchar *usbfsLimit = NULL;
+  GstPylonAllocParams allocParams;
+
+  // Select a device
+  size_t numDevices;
+  res = PylonEnumerateDevices( &numDevices );
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  GST_DEBUG_OBJECT(pylonsrc, "pylonsrc: found %i Basler device(s).", (int)numDevices);  
+  if(numDevices==0) {
+    GST_ERROR_OBJECT(pylonsrc, "No devices connected, canceling initialisation.");
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
+    goto error;  
+  } else if (strcmp(pylonsrc->serial, "") != 0) {
+    // Look the camera up by its serial number. The device info is available without opening the cameras, so this works even when some of them are already in use.
+    PylonDeviceInfo_t deviceInfo;
+
+    pylonsrc->cameraId = 9999;
+    for(i=0; i<numDevices; i++) {
+      res = PylonGetDeviceInfo(i, &deviceInfo);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+      if(strcmp(deviceInfo.SerialNumber, pylonsrc->serial) == 0) {
+        pylonsrc->cameraId = i;
+        break;
+      }
+    }
+
+    if(pylonsrc->cameraId == 9999) {
+      GST_MESSAGE_OBJECT(pylonsrc, "No camera found with serial number %s.", pylonsrc->serial);
+      GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
+      goto error;
+    }
+  } else if (numDevices==1) {
+    if (pylonsrc->cameraId!=9999) {
+      GST_MESSAGE_OBJECT(pylonsrc, "Camera id was set, but was ignored as only one camera was found.");
+    }
+    pylonsrc->cameraId = 0;
+  } else if (numDevices>1 && pylonsrc->cameraId==9999) {
+    GST_MESSAGE_OBJECT(pylonsrc, "Multiple cameras found, and the user didn't specify which camera to use.");
+    GST_MESSAGE_OBJECT(pylonsrc, "Please specify the camera using the CAMERA property.");
+    GST_MESSAGE_OBJECT(pylonsrc, "The camera IDs are as follows: ");
+
+    for(i=0; i<numDevices; i++) {
+      PYLON_DEVICE_HANDLE deviceHandle;
+      res = PylonCreateDeviceByIndex(i, &deviceHandle);
+
+      if (res == GENAPI_E_OK) {
+        res = PylonDeviceOpen(deviceHandle, PYLONC_ACCESS_MODE_CONTROL | PYLONC_ACCESS_MODE_STREAM); 
+        PYLONC_CHECK_ERROR(pylonsrc,res);
+
+        pylonc_print_camera_info(pylonsrc, deviceHandle, i);
+      } else {
+        GST_MESSAGE_OBJECT(pylonsrc, "ID:%i, Name: Unavailable, Serial No: Unavailable, Status: In use?", i);
+      }
+
+      PylonDeviceClose(deviceHandle);
+      PylonDestroyDevice(deviceHandle);
+    }
+
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera selected"));
+    goto error;
+  } else if ( pylonsrc->cameraId != 9999 && pylonsrc->cameraId > numDevices) {
+    GST_MESSAGE_OBJECT(pylonsrc, "No camera found with id %i.", pylonsrc->cameraId);    
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
+    goto error;
+  }
+
+  // Connect to the camera 
+  gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_OPEN);
+  _Bool device = pylonc_connect_camera(pylonsrc);
+  if(!device) {
+    GST_ERROR_OBJECT(pylonsrc, "Couldn't initialise the camera");
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
+    goto error;
+  }
+
+  if(strcmp(pylonsrc->userid, "") != 0) {
+    if (pylonc_timed_is_writable(pylonsrc, "DeviceUserID")) {
+      res = pylonc_timed_from_string(pylonsrc, "DeviceUserID", pylonsrc->userid);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+    }
+  }
+
+  // Print the name of the camera
+  pylonc_print_camera_info(pylonsrc, pylonsrc->deviceHandle, pylonsrc->cameraId);
+
+  // Reset the camera if required.
+  pylonsrc->reset = g_ascii_strdown(pylonsrc->reset, -1);
+  if(strcmp(pylonsrc->reset, "before") == 0) {
+    if(pylonc_timed_is_available(pylonsrc, "DeviceReset")) {
+        pylonc_reset_camera(pylonsrc);
+        pylonc_disconnect_camera(pylonsrc);
+        pylonc_terminate();
+
+        GST_MESSAGE_OBJECT(pylonsrc, "Camera reset. Waiting 6 seconds for it to fully reboot.");
+        sleep(6);
+
+        pylonc_initialize();
+        res = PylonEnumerateDevices( &numDevices );
+        PYLONC_CHECK_ERROR(pylonsrc, res);
+
+        _Bool device = pylonc_connect_camera(pylonsrc);
+        if(!device) {
+          GST_ERROR_OBJECT(pylonsrc, "Couldn't initialise the camera. It looks like the reset failed. Please manually reconnect the camera and try again.");
+          GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("No camera connected"));
+          goto error;
+        }
+      } else {
+        GST_ERROR_OBJECT(pylonsrc, "Couldn't reset the device - feature not supported. Cancelling startup.");
+        GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera couldn't be reset properly."));
+        goto error;
+      }
+  }
+
+  // set binning of camera
+  gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_CONFIGURE);
+  _Bool cameraReportsBinningHorizontal = pylonc_timed_is_implemented(pylonsrc, "BinningHorizontal");
+  _Bool cameraReportsBinningVertical = pylonc_timed_is_implemented(pylonsrc, "BinningVertical");
+  if(cameraReportsBinningVertical && cameraReportsBinningHorizontal) {
+    GST_DEBUG_OBJECT(pylonsrc, "Setting horizontal binning to %"PRId64, pylonsrc->binningh);
+    res = pylonc_timed_set_integer(pylonsrc, "BinningHorizontal", pylonsrc->binningh);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+    GST_DEBUG_OBJECT(pylonsrc, "Setting vertical binning to %"PRId64, pylonsrc->binningv);
+    res = pylonc_timed_set_integer(pylonsrc, "BinningVertical", pylonsrc->binningv);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+
+  // Get the camera's resolution
+  _Bool cameraReportsWidth = pylonc_timed_is_implemented(pylonsrc, "Width");
+  _Bool cameraReportsHeight = pylonc_timed_is_implemented(pylonsrc, "Height");
+  if(!cameraReportsWidth || !cameraReportsHeight) {
+    GST_ERROR_OBJECT(pylonsrc, "The camera doesn't seem to be reporting it's resolution.");    
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera isn't reporting it's resolution. (Unsupported device?)"));
+    goto error;
   }
 
   // Default height/width
   int64_t width = 0, height = 0;
-  res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "Width", &width);
+  res = pylonc_timed_get_integer(pylonsrc, "Width", &width);
   PYLONC_CHECK_ERROR(pylonsrc, res);
-  res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "Height", &height);
+  res = pylonc_timed_get_integer(pylonsrc, "Height", &height);
   PYLONC_CHECK_ERROR(pylonsrc, res);
   
   // Max Width and Height.
-  cameraReportsWidth = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "WidthMax");
-  cameraReportsHeight = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "HeightMax");
+  cameraReportsWidth = pylonc_timed_is_implemented(pylonsrc, "WidthMax");
+  cameraReportsHeight = pylonc_timed_is_implemented(pylonsrc, "HeightMax");
   if(cameraReportsWidth && cameraReportsHeight) {      
-    res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "WidthMax", &pylonsrc->maxWidth);
+    res = pylonc_timed_get_integer(pylonsrc, "WidthMax", &pylonsrc->maxWidth);
     PYLONC_CHECK_ERROR(pylonsrc, res);
-    res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "HeightMax", &pylonsrc->maxHeight);
+    res = pylonc_timed_get_integer(pylonsrc, "HeightMax", &pylonsrc->maxHeight);
     PYLONC_CHECK_ERROR(pylonsrc, res);
   }
   GST_DEBUG_OBJECT(pylonsrc, "Max resolution is %"PRId64"x%"PRId64".", pylonsrc->maxWidth, pylonsrc->maxHeight);
@@ -1122,27 +2189,27 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Set the final resolution
-  res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "Width", pylonsrc->width);
+  res = pylonc_timed_set_integer(pylonsrc, "Width", pylonsrc->width);
   PYLONC_CHECK_ERROR(pylonsrc, res);
-  res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "Height", pylonsrc->height);
+  res = pylonc_timed_set_integer(pylonsrc, "Height", pylonsrc->height);
   PYLONC_CHECK_ERROR(pylonsrc, res);
   GST_MESSAGE_OBJECT(pylonsrc, "Setting resolution to %" PRId64 "x%" PRId64 ".", pylonsrc->width, pylonsrc->height);
 
   // Set the offset
-  _Bool cameraReportsOffsetX = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "OffsetX");
-  _Bool cameraReportsOffsetY = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "OffsetY");
+  _Bool cameraReportsOffsetX = pylonc_timed_is_implemented(pylonsrc, "OffsetX");
+  _Bool cameraReportsOffsetY = pylonc_timed_is_implemented(pylonsrc, "OffsetY");
   if(!cameraReportsOffsetX || !cameraReportsOffsetY) {
     GST_WARNING_OBJECT(pylonsrc, "The camera doesn't seem to allow setting offsets. Skipping...");
   } else {
     // Check if the user wants to center image first
-    _Bool cameraSupportsCenterX = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "CenterX");
-    _Bool cameraSupportsCenterY = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "CenterY");
+    _Bool cameraSupportsCenterX = pylonc_timed_is_implemented(pylonsrc, "CenterX");
+    _Bool cameraSupportsCenterY = pylonc_timed_is_implemented(pylonsrc, "CenterY");
     if(!cameraSupportsCenterX || !cameraSupportsCenterY) {
       GST_WARNING_OBJECT(pylonsrc, "The camera doesn't seem to allow offset centering. Skipping...");
     } else {
-      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "CenterX", pylonsrc->centerx);
+      res = pylonc_timed_set_boolean(pylonsrc, "CenterX", pylonsrc->centerx);
       PYLONC_CHECK_ERROR(pylonsrc, res);
-      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "CenterY", pylonsrc->centery);
+      res = pylonc_timed_set_boolean(pylonsrc, "CenterY", pylonsrc->centery);
       PYLONC_CHECK_ERROR(pylonsrc, res);
       GST_DEBUG_OBJECT(pylonsrc, "Centering X: %s, Centering Y: %s.", pylonsrc->centerx ? "True" : "False", pylonsrc->centery ? "True" : "False");
 
@@ -1150,7 +2217,7 @@ gst_pylonsrc_start (GstBaseSrc * src)
         int64_t maxoffsetx = pylonsrc->maxWidth - pylonsrc->width;
 
         if(maxoffsetx >= pylonsrc->offsetx) {
-          res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "OffsetX", pylonsrc->offsetx);
+          res = pylonc_timed_set_integer(pylonsrc, "OffsetX", pylonsrc->offsetx);
           PYLONC_CHECK_ERROR(pylonsrc, res);
           GST_DEBUG_OBJECT(pylonsrc, "Setting X offset to %"PRId64, pylonsrc->offsetx);
         } else {
@@ -1163,7 +2230,7 @@ gst_pylonsrc_start (GstBaseSrc * src)
       if(!pylonsrc->centery && pylonsrc->offsety != 99999) {
         int64_t maxoffsety = pylonsrc->maxHeight - pylonsrc->height;
         if(maxoffsety >= pylonsrc->offsety) {
-          res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "OffsetY", pylonsrc->offsety);
+          res = pylonc_timed_set_integer(pylonsrc, "OffsetY", pylonsrc->offsety);
           PYLONC_CHECK_ERROR(pylonsrc, res);
           GST_DEBUG_OBJECT(pylonsrc, "Setting Y offset to %"PRId64, pylonsrc->offsety);
         } else {
@@ -1176,8 +2243,8 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Flip the image
-  _Bool cameraAllowsReverseX = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "ReverseX");
-  _Bool cameraAllowsReverseY = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "ReverseY");
+  _Bool cameraAllowsReverseX = pylonc_timed_is_implemented(pylonsrc, "ReverseX");
+  _Bool cameraAllowsReverseY = pylonc_timed_is_implemented(pylonsrc, "ReverseY");
   if(!cameraAllowsReverseX) {
     pylonsrc->flipx = FALSE;
     GST_WARNING_OBJECT(pylonsrc, "Camera doesn't support reversing the X axis. Skipping...");
@@ -1186,9 +2253,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
       pylonsrc->flipy = FALSE;
       GST_WARNING_OBJECT(pylonsrc, "Camera doesn't support reversing the Y axis. Skipping...");
     } else {
-      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "ReverseX", pylonsrc->flipx);
+      res = pylonc_timed_set_boolean(pylonsrc, "ReverseX", pylonsrc->flipx);
       PYLONC_CHECK_ERROR(pylonsrc, res);
-      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "ReverseY", pylonsrc->flipy);
+      res = pylonc_timed_set_boolean(pylonsrc, "ReverseY", pylonsrc->flipy);
       PYLONC_CHECK_ERROR(pylonsrc, res);
       GST_DEBUG_OBJECT(pylonsrc, "Flipping X: %s, Flipping Y: %s.", pylonsrc->flipx ? "True" : "False", pylonsrc->flipy ? "True" : "False");
     }
@@ -1213,33 +2280,33 @@ gst_pylonsrc_start (GstBaseSrc * src)
     g_string_printf(pixelFormat, "Bayer%s%s", filter->str, &pylonsrc->imageFormat[5]);
     g_string_printf(format, "EnumEntry_PixelFormat_%s", pixelFormat->str);
 
-    if(!PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, format->str)) {
+    if(!pylonc_timed_is_available(pylonsrc, format->str)) {
       GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera doesn't support Bayer%s.", &pylonsrc->imageFormat[5]));
       goto error;
     }
   } else if (strcmp(pylonsrc->imageFormat, "rgb8") == 0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_PixelFormat_RGB8")) {
+    if(pylonc_timed_is_available(pylonsrc, "EnumEntry_PixelFormat_RGB8")) {
       g_string_printf(pixelFormat, "RGB8");
     } else {
       GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera doesn't support RGB 8"));
       goto error;
     } 
   } else if (strcmp(pylonsrc->imageFormat, "bgr8") == 0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_PixelFormat_BGR8")) {
+    if(pylonc_timed_is_available(pylonsrc, "EnumEntry_PixelFormat_BGR8")) {
       g_string_printf(pixelFormat, "RGB8");
     } else {
       GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera doesn't support BGR 8"));
       goto error;
     } 
   } else if (strcmp(pylonsrc->imageFormat, "ycbcr422_8") == 0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_PixelFormat_YCbCr422_8")) {
+    if(pylonc_timed_is_available(pylonsrc, "EnumEntry_PixelFormat_YCbCr422_8")) {
       g_string_printf(pixelFormat, "YCbCr422_8");
     } else {
       GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera doesn't support YCbCr422 8"));
       goto error;
     }
   } else if (strcmp(pylonsrc->imageFormat, "mono8") == 0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_PixelFormat_Mono8")) {
+    if(pylonc_timed_is_available(pylonsrc, "EnumEntry_PixelFormat_Mono8")) {
       g_string_printf(pixelFormat, "Mono8");
     } else {
       GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Camera doesn't support Mono 8"));
@@ -1251,15 +2318,15 @@ gst_pylonsrc_start (GstBaseSrc * src)
     goto error;
   }
   GST_MESSAGE_OBJECT(pylonsrc, "Using %s image format.", pixelFormat->str);
-  res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "PixelFormat", pixelFormat->str);
+  res = pylonc_timed_from_string(pylonsrc, "PixelFormat", pixelFormat->str);
   PYLONC_CHECK_ERROR(pylonsrc, res);
 
   // Output the size of a pixel
-  if(PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, "PixelSize")) {
+  if(pylonc_timed_is_readable(pylonsrc, "PixelSize")) {
     char pixelSize[10];
     size_t siz = sizeof(pixelSize);
 
-    res = PylonDeviceFeatureToString(pylonsrc->deviceHandle, "PixelSize", pixelSize, &siz);
+    res = pylonc_timed_to_string(pylonsrc, "PixelSize", pixelSize, &siz);
     PYLONC_CHECK_ERROR(pylonsrc, res);
     GST_DEBUG_OBJECT(pylonsrc, "Pixel is %s bits large.", pixelSize + 3);
   } else {
@@ -1268,16 +2335,16 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
 
   // Set whether test image will be shown
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "TestImageSelector")) {
+  if(pylonc_timed_is_implemented(pylonsrc, "TestImageSelector")) {
       if(pylonsrc->testImage != 0) {
         GST_MESSAGE_OBJECT(pylonsrc, "Test image mode enabled.");
         char* ImageId = malloc(11);
         snprintf(ImageId, 11, "Testimage%"PRId64, pylonsrc->testImage);
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TestImageSelector", ImageId);
+        res = pylonc_timed_from_string(pylonsrc, "TestImageSelector", ImageId);
         free(ImageId);
         PYLONC_CHECK_ERROR(pylonsrc, res);
       } else {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TestImageSelector", "Off");
+        res = pylonc_timed_from_string(pylonsrc, "TestImageSelector", "Off");
         PYLONC_CHECK_ERROR(pylonsrc, res);
       }
   } else {
@@ -1285,16 +2352,16 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Set sensor readout mode (default: Normal)
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "SensorReadoutMode")) {
+  if(pylonc_timed_is_implemented(pylonsrc, "SensorReadoutMode")) {
     pylonsrc->sensorMode = g_ascii_strdown(pylonsrc->sensorMode, -1);
 
     if(strcmp(pylonsrc->sensorMode, "normal") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Setting the sensor readout mode to normal.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "SensorReadoutMode", "Normal");
+      res = pylonc_timed_from_string(pylonsrc, "SensorReadoutMode", "Normal");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->sensorMode, "fast") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Setting the sensor readout mode to fast.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "SensorReadoutMode", "Fast");
+      res = pylonc_timed_from_string(pylonsrc, "SensorReadoutMode", "Fast");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for sensorreadoutmode. Available values are normal/fast, while the value provided was \"%s\".", pylonsrc->sensorMode);
@@ -1306,14 +2373,14 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Set bandwidth limit mode (default: on)  
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "DeviceLinkThroughputLimitMode")) {
+  if(pylonc_timed_is_implemented(pylonsrc, "DeviceLinkThroughputLimitMode")) {
     if(pylonsrc->limitBandwidth) {
       GST_DEBUG_OBJECT(pylonsrc, "Limiting camera's bandwidth.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "DeviceLinkThroughputLimitMode", "On");
+      res = pylonc_timed_from_string(pylonsrc, "DeviceLinkThroughputLimitMode", "On");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_DEBUG_OBJECT(pylonsrc, "Unlocking camera's bandwidth.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "DeviceLinkThroughputLimitMode", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "DeviceLinkThroughputLimitMode", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     }
   } else {
@@ -1321,14 +2388,14 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Set bandwidth limit
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "DeviceLinkThroughputLimit")) {
+  if(pylonc_timed_is_implemented(pylonsrc, "DeviceLinkThroughputLimit")) {
     if(pylonsrc->maxBandwidth != 0) {
       if(!pylonsrc->limitBandwidth) {
         GST_DEBUG_OBJECT(pylonsrc, "Saving bandwidth limits, but because throughput mode is disabled they will be ignored.");
       }
 
       GST_DEBUG_OBJECT(pylonsrc, "Setting bandwidth limit to %"PRId64" B/s.", pylonsrc->maxBandwidth);
-      res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, "DeviceLinkThroughputLimit", pylonsrc->maxBandwidth);
+      res = pylonc_timed_set_integer(pylonsrc, "DeviceLinkThroughputLimit", pylonsrc->maxBandwidth);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     }
   } else {
@@ -1337,45 +2404,45 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
   // Set framerate
   if(pylonsrc->setFPS || (pylonsrc->fps != 0)) {    
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable")) {
-      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable", TRUE);
+    if(pylonc_timed_is_available(pylonsrc, "AcquisitionFrameRateEnable")) {
+      res = pylonc_timed_set_boolean(pylonsrc, "AcquisitionFrameRateEnable", TRUE);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
-      if(pylonsrc->fps != 0 && PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AcquisitionFrameRate")) {        
+      if(pylonsrc->fps != 0 && pylonc_timed_is_available(pylonsrc, "AcquisitionFrameRate")) {        
         GST_DEBUG_OBJECT(pylonsrc, "Capping framerate to %0.2lf.", pylonsrc->fps);
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AcquisitionFrameRate", pylonsrc->fps);
+        res = pylonc_timed_set_float(pylonsrc, "AcquisitionFrameRate", pylonsrc->fps);
         PYLONC_CHECK_ERROR(pylonsrc, res);
       } else {
         GST_DEBUG_OBJECT(pylonsrc, "Enabled custom framerate limiter. See below for current framerate.");
       }
     }
   } else {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable")) {
-      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable", FALSE);
+    if(pylonc_timed_is_available(pylonsrc, "AcquisitionFrameRateEnable")) {
+      res = pylonc_timed_set_boolean(pylonsrc, "AcquisitionFrameRateEnable", FALSE);
       PYLONC_CHECK_ERROR(pylonsrc, res);
       GST_DEBUG_OBJECT(pylonsrc, "Disabled custom framerate limiter.");
     }
   }
 
   // Set lightsource preset
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "LightSourcePreset")) {
+  if(pylonc_timed_is_available(pylonsrc, "LightSourcePreset")) {
     pylonsrc->lightsource = g_ascii_strdown(pylonsrc->lightsource, -1);
 
     if(strcmp(pylonsrc->lightsource, "off") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Not using a lightsource preset.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "LightSourcePreset", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "LightSourcePreset", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->lightsource, "2800k") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Setting light preset to Tungsten 2800k (Incandescen light).");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "LightSourcePreset", "Tungsten2800K");
+      res = pylonc_timed_from_string(pylonsrc, "LightSourcePreset", "Tungsten2800K");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->lightsource, "5000k") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Setting light preset to Daylight 5000k (Daylight).");      
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "LightSourcePreset", "Daylight5000K");
+      res = pylonc_timed_from_string(pylonsrc, "LightSourcePreset", "Daylight5000K");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->lightsource, "6500k") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Setting light preset to Daylight 6500k (Very bright day).");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "LightSourcePreset", "Daylight6500K");      
+      res = pylonc_timed_from_string(pylonsrc, "LightSourcePreset", "Daylight6500K");      
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for lightsource. Available values are off/2800k/5000k/6500k, while the value provided was \"%s\".", pylonsrc->lightsource);
@@ -1388,18 +2455,18 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
   // Enable/disable automatic exposure
   pylonsrc->autoexposure = g_ascii_strdown(pylonsrc->autoexposure, -1);
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "ExposureAuto")) {
+  if(pylonc_timed_is_available(pylonsrc, "ExposureAuto")) {
     if(strcmp(pylonsrc->autoexposure, "off") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Disabling automatic exposure.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ExposureAuto", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "ExposureAuto", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->autoexposure, "once") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Making the camera only calibrate exposure once.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ExposureAuto", "Once");
+      res = pylonc_timed_from_string(pylonsrc, "ExposureAuto", "Once");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->autoexposure, "continuous") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Making the camera calibrate exposure automatically all the time.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ExposureAuto", "Continuous");
+      res = pylonc_timed_from_string(pylonsrc, "ExposureAuto", "Continuous");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for autoexposure. Available values are off/once/continuous, while the value provided was \"%s\".", pylonsrc->autoexposure);
@@ -1412,18 +2479,18 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
   // Enable/disable automatic gain
   pylonsrc->autogain = g_ascii_strdown(pylonsrc->autogain, -1);
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "GainAuto")) {
+  if(pylonc_timed_is_available(pylonsrc, "GainAuto")) {
     if(strcmp(pylonsrc->autogain, "off") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Disabling automatic gain.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "GainAuto", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "GainAuto", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->autogain, "once") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Making the camera only calibrate it's gain once.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "GainAuto", "Once");
+      res = pylonc_timed_from_string(pylonsrc, "GainAuto", "Once");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->autogain, "continuous") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Making the camera calibrate gain settings automatically.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "GainAuto", "Continuous");
+      res = pylonc_timed_from_string(pylonsrc, "GainAuto", "Continuous");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for autogain. Available values are off/once/continuous, while the value provided was \"%s\".", pylonsrc->autogain);
@@ -1436,18 +2503,18 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
   // Enable/disable automatic white balance
   pylonsrc->autowhitebalance = g_ascii_strdown(pylonsrc->autowhitebalance, -1);
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "BalanceWhiteAuto")) {
+  if(pylonc_timed_is_available(pylonsrc, "BalanceWhiteAuto")) {
     if(strcmp(pylonsrc->autowhitebalance, "off") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Disabling automatic white balance.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "BalanceWhiteAuto", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "BalanceWhiteAuto", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->autowhitebalance, "once") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Making the camera only calibrate it's colour balance once.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "BalanceWhiteAuto", "Once");
+      res = pylonc_timed_from_string(pylonsrc, "BalanceWhiteAuto", "Once");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if (strcmp(pylonsrc->autowhitebalance, "continuous") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Making the camera calibrate white balance settings automatically.");
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "BalanceWhiteAuto", "Continuous");
+      res = pylonc_timed_from_string(pylonsrc, "BalanceWhiteAuto", "Continuous");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for autowhitebalance. Available values are off/once/continuous, while the value provided was \"%s\".", pylonsrc->autowhitebalance);
@@ -1460,8 +2527,8 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
   // Configure automatic exposure and gain settings
   if(pylonsrc->autoexposureupperlimit != 9999999.0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AutoExposureTimeUpperLimit")) {
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AutoExposureTimeUpperLimit", pylonsrc->autoexposureupperlimit);
+    if(pylonc_timed_is_available(pylonsrc, "AutoExposureTimeUpperLimit")) {
+      res = pylonc_timed_set_float(pylonsrc, "AutoExposureTimeUpperLimit", pylonsrc->autoexposureupperlimit);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support changing the auto exposure limits.");
@@ -1474,16 +2541,16 @@ gst_pylonsrc_start (GstBaseSrc * src)
       goto error;
     }
     
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AutoExposureTimeLowerLimit")) {
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AutoExposureTimeLowerLimit", pylonsrc->autoexposurelowerlimit);
+    if(pylonc_timed_is_available(pylonsrc, "AutoExposureTimeLowerLimit")) {
+      res = pylonc_timed_set_float(pylonsrc, "AutoExposureTimeLowerLimit", pylonsrc->autoexposurelowerlimit);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support changing the auto exposure limits.");
     }
   }
   if(pylonsrc->gainlowerlimit != 999.0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AutoGainLowerLimit")) {
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AutoGainLowerLimit", pylonsrc->gainlowerlimit);
+    if(pylonc_timed_is_available(pylonsrc, "AutoGainLowerLimit")) {
+      res = pylonc_timed_set_float(pylonsrc, "AutoGainLowerLimit", pylonsrc->gainlowerlimit);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support changing the auto gain limits.");
@@ -1496,16 +2563,16 @@ gst_pylonsrc_start (GstBaseSrc * src)
       goto error;
     }
 
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AutoGainUpperLimit")) {
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AutoGainUpperLimit", pylonsrc->gainupperlimit);
+    if(pylonc_timed_is_available(pylonsrc, "AutoGainUpperLimit")) {
+      res = pylonc_timed_set_float(pylonsrc, "AutoGainUpperLimit", pylonsrc->gainupperlimit);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support changing the auto gain limits.");
     }
   }
   if(pylonsrc->brightnesstarget != 999.0) {
-    if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AutoTargetBrightness")) {
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AutoTargetBrightness", pylonsrc->brightnesstarget);
+    if(pylonc_timed_is_available(pylonsrc, "AutoTargetBrightness")) {
+      res = pylonc_timed_set_float(pylonsrc, "AutoTargetBrightness", pylonsrc->brightnesstarget);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support changing the brightness target.");
@@ -1515,10 +2582,10 @@ gst_pylonsrc_start (GstBaseSrc * src)
   if(strcmp(pylonsrc->autoprofile, "default") != 0) {
     GST_DEBUG_OBJECT(pylonsrc, "Setting automatic profile to minimise %s.", pylonsrc->autoprofile);
     if(strcmp(pylonsrc->autoprofile, "gain") == 0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "AutoFunctionProfile", "MinimizeGain");
+      res = pylonc_timed_from_string(pylonsrc, "AutoFunctionProfile", "MinimizeGain");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else if(strcmp(pylonsrc->autoprofile, "exposure") == 0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "AutoFunctionProfile", "MinimizeExposureTime");
+      res = pylonc_timed_from_string(pylonsrc, "AutoFunctionProfile", "MinimizeExposureTime");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for autoprofile. Available values are gain/exposure, while the value provided was \"%s\".", pylonsrc->autoprofile);
@@ -1530,12 +2597,12 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Configure colour balance
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "BalanceRatio")) {
+  if(pylonc_timed_is_available(pylonsrc, "BalanceRatio")) {
     if(strcmp(pylonsrc->autowhitebalance, "off") == 0) {
       if (pylonsrc->balancered != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "BalanceRatioSelector", "Red");
+        res = pylonc_timed_from_string(pylonsrc, "BalanceRatioSelector", "Red");
         PYLONC_CHECK_ERROR(pylonsrc, res);
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "BalanceRatio", pylonsrc->balancered);
+        res = pylonc_timed_set_float(pylonsrc, "BalanceRatio", pylonsrc->balancered);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Red balance set to %.2lf", pylonsrc->balancered);
@@ -1544,9 +2611,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
       }
 
       if (pylonsrc->balancegreen != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "BalanceRatioSelector", "Green");
+        res = pylonc_timed_from_string(pylonsrc, "BalanceRatioSelector", "Green");
         PYLONC_CHECK_ERROR(pylonsrc, res);
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "BalanceRatio", pylonsrc->balancegreen);
+        res = pylonc_timed_set_float(pylonsrc, "BalanceRatio", pylonsrc->balancegreen);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Green balance set to %.2lf", pylonsrc->balancegreen);
@@ -1555,9 +2622,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
       }
 
       if (pylonsrc->balanceblue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "BalanceRatioSelector", "Blue");
+        res = pylonc_timed_from_string(pylonsrc, "BalanceRatioSelector", "Blue");
         PYLONC_CHECK_ERROR(pylonsrc, res);
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "BalanceRatio", pylonsrc->balanceblue);
+        res = pylonc_timed_set_float(pylonsrc, "BalanceRatio", pylonsrc->balanceblue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Blue balance set to %.2lf", pylonsrc->balanceblue);
@@ -1570,11 +2637,11 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Configure colour adjustment
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "ColorAdjustmentSelector")) {
+  if(pylonc_timed_is_available(pylonsrc, "ColorAdjustmentSelector")) {
     if (pylonsrc->redhue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Red");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Red");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentHue", pylonsrc->redhue);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentHue", pylonsrc->redhue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Red hue set to %.2lf", pylonsrc->redhue);
@@ -1582,9 +2649,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
         GST_DEBUG_OBJECT(pylonsrc, "Using saved colour red's hue.");
     }
     if (pylonsrc->redsaturation != 999.0) {      
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Red");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Red");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentSaturation", pylonsrc->redsaturation);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentSaturation", pylonsrc->redsaturation);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Red saturation set to %.2lf", pylonsrc->redsaturation);
@@ -1593,9 +2660,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if (pylonsrc->yellowhue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Yellow");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Yellow");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentHue", pylonsrc->yellowhue);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentHue", pylonsrc->yellowhue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Yellow hue set to %.2lf", pylonsrc->yellowhue);
@@ -1603,9 +2670,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
         GST_DEBUG_OBJECT(pylonsrc, "Using saved colour yellow's hue.");
     }
     if (pylonsrc->yellowsaturation != 999.0) {      
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Yellow");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Yellow");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentSaturation", pylonsrc->yellowsaturation);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentSaturation", pylonsrc->yellowsaturation);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Yellow saturation set to %.2lf", pylonsrc->yellowsaturation);
@@ -1614,9 +2681,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if (pylonsrc->greenhue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Green");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Green");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentHue", pylonsrc->greenhue);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentHue", pylonsrc->greenhue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Green hue set to %.2lf", pylonsrc->greenhue);
@@ -1624,9 +2691,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
         GST_DEBUG_OBJECT(pylonsrc, "Using saved colour green's hue.");
     }
     if (pylonsrc->greensaturation != 999.0) {      
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Green");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Green");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentSaturation", pylonsrc->greensaturation);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentSaturation", pylonsrc->greensaturation);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Green saturation set to %.2lf", pylonsrc->greensaturation);
@@ -1635,9 +2702,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if (pylonsrc->cyanhue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Cyan");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Cyan");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentHue", pylonsrc->cyanhue);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentHue", pylonsrc->cyanhue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Cyan hue set to %.2lf", pylonsrc->cyanhue);
@@ -1645,9 +2712,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
         GST_DEBUG_OBJECT(pylonsrc, "Using saved colour cyan's hue.");
     }
     if (pylonsrc->cyansaturation != 999.0) {      
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Cyan");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Cyan");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentSaturation", pylonsrc->cyansaturation);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentSaturation", pylonsrc->cyansaturation);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Cyan saturation set to %.2lf", pylonsrc->cyansaturation);
@@ -1656,9 +2723,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if (pylonsrc->bluehue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Blue");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Blue");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentHue", pylonsrc->bluehue);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentHue", pylonsrc->bluehue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Blue hue set to %.2lf", pylonsrc->bluehue);
@@ -1666,9 +2733,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
         GST_DEBUG_OBJECT(pylonsrc, "Using saved colour blue's hue.");
     }
     if (pylonsrc->bluesaturation != 999.0) {      
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Blue");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Blue");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentSaturation", pylonsrc->bluesaturation);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentSaturation", pylonsrc->bluesaturation);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Blue saturation set to %.2lf", pylonsrc->bluesaturation);
@@ -1677,9 +2744,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if (pylonsrc->magentahue != 999.0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Magenta");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Magenta");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentHue", pylonsrc->magentahue);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentHue", pylonsrc->magentahue);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Magenta hue set to %.2lf", pylonsrc->magentahue);
@@ -1687,9 +2754,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
         GST_DEBUG_OBJECT(pylonsrc, "Using saved colour magenta's hue.");
     }
     if (pylonsrc->magentasaturation != 999.0) {      
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorAdjustmentSelector", "Magenta");
+        res = pylonc_timed_from_string(pylonsrc, "ColorAdjustmentSelector", "Magenta");
         PYLONC_CHECK_ERROR(pylonsrc, res);        
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorAdjustmentSaturation", pylonsrc->magentasaturation);
+        res = pylonc_timed_set_float(pylonsrc, "ColorAdjustmentSaturation", pylonsrc->magentasaturation);
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         GST_DEBUG_OBJECT(pylonsrc, "Magenta saturation set to %.2lf", pylonsrc->magentasaturation);
@@ -1702,16 +2769,16 @@ gst_pylonsrc_start (GstBaseSrc * src)
 
   // Configure colour transformation
   pylonsrc->transformationselector = g_ascii_strdown(pylonsrc->transformationselector, -1);
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "ColorTransformationSelector")) {
+  if(pylonc_timed_is_available(pylonsrc, "ColorTransformationSelector")) {
     if(strcmp(pylonsrc->transformationselector, "default") != 0) {
       if(strcmp(pylonsrc->transformationselector, "rgbrgb") == 0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationSelector", "RGBtoRGB");
+        res = pylonc_timed_from_string(pylonsrc, "ColorTransformationSelector", "RGBtoRGB");
         PYLONC_CHECK_ERROR(pylonsrc, res);
       } else if(strcmp(pylonsrc->transformationselector, "rgbyuv") == 0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationSelector", "RGBtoYUV");
+        res = pylonc_timed_from_string(pylonsrc, "ColorTransformationSelector", "RGBtoYUV");
         PYLONC_CHECK_ERROR(pylonsrc, res);
       } else if(strcmp(pylonsrc->transformationselector, "rgbyuv") == 0) {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationSelector", "YUVtoRGB");
+        res = pylonc_timed_from_string(pylonsrc, "ColorTransformationSelector", "YUVtoRGB");
         PYLONC_CHECK_ERROR(pylonsrc, res);
       } else {
         GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for transformationselector. Available values are: RGBtoRGB, RGBtoYUV, YUVtoRGB. Value provided: \"%s\".", pylonsrc->transformationselector);
@@ -1721,9 +2788,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation00 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationSelector", "Gain00");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationSelector", "Gain00");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValueSelector", pylonsrc->transformation00);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValueSelector", pylonsrc->transformation00);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain00 set to %.2lf", pylonsrc->transformation00);
@@ -1732,9 +2799,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation01 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain01");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain01");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation01);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation01);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain01 set to %.2lf", pylonsrc->transformation01);
@@ -1743,9 +2810,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation02 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain02");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain02");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation02);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation02);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain02 set to %.2lf", pylonsrc->transformation02);
@@ -1754,9 +2821,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation10 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain10");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain10");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation10);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation10);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain10 set to %.2lf", pylonsrc->transformation10);
@@ -1765,9 +2832,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation11 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain11");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain11");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation11);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation11);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain11 set to %.2lf", pylonsrc->transformation11);
@@ -1776,9 +2843,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation12 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain12");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain12");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation12);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation12);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain12 set to %.2lf", pylonsrc->transformation12);
@@ -1787,9 +2854,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation20 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain20");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain20");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation20);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation20);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain20 set to %.2lf", pylonsrc->transformation20);
@@ -1798,9 +2865,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation21 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain21");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain21");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation21);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation21);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain21 set to %.2lf", pylonsrc->transformation21);
@@ -1809,9 +2876,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
     }
 
     if(pylonsrc->transformation22 != 999.0) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "ColorTransformationValueSelector", "Gain22");
+      res = pylonc_timed_from_string(pylonsrc, "ColorTransformationValueSelector", "Gain22");
       PYLONC_CHECK_ERROR(pylonsrc, res);        
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ColorTransformationValue", pylonsrc->transformation22);
+      res = pylonc_timed_set_float(pylonsrc, "ColorTransformationValue", pylonsrc->transformation22);
       PYLONC_CHECK_ERROR(pylonsrc, res);
 
       GST_DEBUG_OBJECT(pylonsrc, "Gain22 set to %.2lf", pylonsrc->transformation22);
@@ -1823,11 +2890,11 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Configure exposure
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "ExposureTime")) {
+  if(pylonc_timed_is_available(pylonsrc, "ExposureTime")) {
     if(strcmp(pylonsrc->autoexposure, "off") == 0) {
       if(pylonsrc->exposure != 0.0) {
         GST_DEBUG_OBJECT(pylonsrc, "Setting exposure to %0.2lf", pylonsrc->exposure);
-        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "ExposureTime", pylonsrc->exposure);
+        res = pylonc_timed_set_float(pylonsrc, "ExposureTime", pylonsrc->exposure);
         PYLONC_CHECK_ERROR(pylonsrc, res);
       } else {
         GST_DEBUG_OBJECT(pylonsrc, "Exposure property not set, using the saved exposure setting.");
@@ -1840,10 +2907,10 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Configure gain
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "Gain")) {
+  if(pylonc_timed_is_available(pylonsrc, "Gain")) {
     if(strcmp(pylonsrc->autogain, "off") == 0) {
       GST_DEBUG_OBJECT(pylonsrc, "Setting gain to %0.2lf", pylonsrc->gain);
-      res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "Gain", pylonsrc->gain);
+      res = pylonc_timed_set_float(pylonsrc, "Gain", pylonsrc->gain);
       PYLONC_CHECK_ERROR(pylonsrc, res);
     } else {
       GST_WARNING_OBJECT(pylonsrc, "Automatic gain has been enabled, skipping setting gain.");
@@ -1853,36 +2920,36 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Configure black level
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "BlackLevel")) {    
+  if(pylonc_timed_is_available(pylonsrc, "BlackLevel")) {    
     GST_DEBUG_OBJECT(pylonsrc, "Setting black level to %0.2lf", pylonsrc->blacklevel);
-    res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "BlackLevel", pylonsrc->blacklevel);
+    res = pylonc_timed_set_float(pylonsrc, "BlackLevel", pylonsrc->blacklevel);
     PYLONC_CHECK_ERROR(pylonsrc, res);
   } else {
     GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support setting black level.");
   }
 
   // Configure gamma correction
-  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "Gamma")) {    
+  if(pylonc_timed_is_available(pylonsrc, "Gamma")) {    
     GST_DEBUG_OBJECT(pylonsrc, "Setting gamma to %0.2lf", pylonsrc->gamma);
-    res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "Gamma", pylonsrc->gamma);
+    res = pylonc_timed_set_float(pylonsrc, "Gamma", pylonsrc->gamma);
     PYLONC_CHECK_ERROR(pylonsrc, res);
   } else {
     GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support setting gamma values.");
   }
 
   // Basler PGI
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "DemosaicingMode")) {
+  if(pylonc_timed_is_implemented(pylonsrc, "DemosaicingMode")) {
     if(pylonsrc->demosaicing || pylonsrc->sharpnessenhancement != 999.0 || pylonsrc->noisereduction != 999.0) {
       if(strncmp("bayer", pylonsrc->imageFormat, 5) != 0) {
         GST_DEBUG_OBJECT(pylonsrc, "Enabling Basler's PGI.");
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "DemosaicingMode", "BaslerPGI");
+        res = pylonc_timed_from_string(pylonsrc, "DemosaicingMode", "BaslerPGI");
         PYLONC_CHECK_ERROR(pylonsrc, res);
 
         // PGI Modules (Noise reduction and Sharpness enhancement).
         if(pylonsrc->noisereduction != 999.0) {
-          if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "NoiseReduction")) {  
+          if(pylonc_timed_is_available(pylonsrc, "NoiseReduction")) {  
             GST_DEBUG_OBJECT(pylonsrc, "Setting PGI noise reduction to %0.2lf", pylonsrc->noisereduction);
-            res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "NoiseReduction", pylonsrc->noisereduction);
+            res = pylonc_timed_set_float(pylonsrc, "NoiseReduction", pylonsrc->noisereduction);
           } else {
             GST_ERROR_OBJECT(pylonsrc, "This camera doesn't support noise reduction.");
           }
@@ -1890,9 +2957,9 @@ gst_pylonsrc_start (GstBaseSrc * src)
           GST_DEBUG_OBJECT(pylonsrc, "Using the stored value for noise reduction.");
         }
         if(pylonsrc->sharpnessenhancement != 999.0) {
-          if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "SharpnessEnhancement")) {    
+          if(pylonc_timed_is_available(pylonsrc, "SharpnessEnhancement")) {    
             GST_DEBUG_OBJECT(pylonsrc, "Setting PGI sharpness enhancement to %0.2lf", pylonsrc->sharpnessenhancement);
-            res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "SharpnessEnhancement", pylonsrc->sharpnessenhancement);
+            res = pylonc_timed_set_float(pylonsrc, "SharpnessEnhancement", pylonsrc->sharpnessenhancement);
           } else {
             GST_ERROR_OBJECT(pylonsrc, "This camera doesn't support sharpness enhancement.");
           }
@@ -1900,7 +2967,7 @@ gst_pylonsrc_start (GstBaseSrc * src)
           GST_DEBUG_OBJECT(pylonsrc, "Using the stored value for noise reduction.");
         }
       } else {
-        res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "DemosaicingMode", "Simple");
+        res = pylonc_timed_from_string(pylonsrc, "DemosaicingMode", "Simple");
         PYLONC_CHECK_ERROR(pylonsrc, res);
       }
     } else {
@@ -1913,16 +2980,16 @@ gst_pylonsrc_start (GstBaseSrc * src)
   // Set camera trigger mode
   GST_DEBUG_OBJECT(pylonsrc, "Setting trigger mode.");
   const char* triggerSelectorValue = "FrameStart";      
-  _Bool isAvailAcquisitionStart = PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_TriggerSelector_AcquisitionStart");
-  _Bool isAvailFrameStart = PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_TriggerSelector_FrameStart");
+  _Bool isAvailAcquisitionStart = pylonc_timed_is_available(pylonsrc, "EnumEntry_TriggerSelector_AcquisitionStart");
+  _Bool isAvailFrameStart = pylonc_timed_is_available(pylonsrc, "EnumEntry_TriggerSelector_FrameStart");
   const char* triggerMode = (pylonsrc->continuousMode) ? "Off" : "On";
 
   // Check to see if the camera implements the acquisition start trigger mode only
   if (isAvailAcquisitionStart && !isAvailFrameStart) {
     // Select the software trigger as the trigger source
-    res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerSelector", "AcquisitionStart");
+    res = pylonc_timed_from_string(pylonsrc, "TriggerSelector", "AcquisitionStart");
     PYLONC_CHECK_ERROR(pylonsrc, res);
-    res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerMode", triggerMode);
+    res = pylonc_timed_from_string(pylonsrc, "TriggerMode", triggerMode);
     PYLONC_CHECK_ERROR(pylonsrc, res);
     triggerSelectorValue = "AcquisitionStart";
   }
@@ -1931,39 +2998,137 @@ gst_pylonsrc_start (GstBaseSrc * src)
     // Camera may have the acquisition start trigger mode and the frame start trigger mode implemented.
     // In this case, the acquisition trigger mode must be switched off.
     if (isAvailAcquisitionStart) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerSelector", "AcquisitionStart");
+      res = pylonc_timed_from_string(pylonsrc, "TriggerSelector", "AcquisitionStart");
       PYLONC_CHECK_ERROR(pylonsrc, res);
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerMode", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "TriggerMode", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     }
     // Disable frame burst start trigger if available
-    if (PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "EnumEntry_TriggerSelector_FrameBurstStart")) {
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerSelector", "FrameBurstStart");
+    if (pylonc_timed_is_available(pylonsrc, "EnumEntry_TriggerSelector_FrameBurstStart")) {
+      res = pylonc_timed_from_string(pylonsrc, "TriggerSelector", "FrameBurstStart");
       PYLONC_CHECK_ERROR(pylonsrc, res);
-      res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerMode", "Off");
+      res = pylonc_timed_from_string(pylonsrc, "TriggerMode", "Off");
       PYLONC_CHECK_ERROR(pylonsrc, res);
     }
     // To trigger each single frame by software or external hardware trigger: Enable the frame start trigger mode
-    res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerSelector", "FrameStart");
+    res = pylonc_timed_from_string(pylonsrc, "TriggerSelector", "FrameStart");
     PYLONC_CHECK_ERROR(pylonsrc, res);
-    res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerMode", triggerMode);
+    res = pylonc_timed_from_string(pylonsrc, "TriggerMode", triggerMode);
     PYLONC_CHECK_ERROR(pylonsrc, res);
   }
 
+  // Choose what triggers the frames
+  pylonsrc->triggersource = g_ascii_strdown(pylonsrc->triggersource, -1);
+  const char* triggerSource;
+  if(strcmp(pylonsrc->triggersource, "software") == 0) {
+    triggerSource = "Software";
+  } else if(strcmp(pylonsrc->triggersource, "line1") == 0) {
+    triggerSource = "Line1";
+  } else if(strcmp(pylonsrc->triggersource, "line2") == 0) {
+    triggerSource = "Line2";
+  } else if(strcmp(pylonsrc->triggersource, "line3") == 0) {
+    triggerSource = "Line3";
+  } else if(strcmp(pylonsrc->triggersource, "line4") == 0) {
+    triggerSource = "Line4";
+  } else {
+    GST_ERROR_OBJECT(pylonsrc, "Invalid parameter value for triggersource. Available values are software/line1/line2/line3/line4, while the value provided was \"%s\".", pylonsrc->triggersource);
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Failed to initialise the camera"), ("Invalid parameters provided"));
+    goto error;
+  }
+  pylonsrc->softwareTrigger = !pylonsrc->continuousMode && strcmp(triggerSource, "Software") == 0;
+
   if(!pylonsrc->continuousMode) {
     // Set the acquisiton selector to FrameTrigger in case it was changed by something else before launching the plugin so we don't request frames when they're still capturing or something.
-    res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "AcquisitionStatusSelector", "FrameTriggerWait"); 
+    res = pylonc_timed_from_string(pylonsrc, "AcquisitionStatusSelector", "FrameTriggerWait"); 
     PYLONC_CHECK_ERROR(pylonsrc, res);
   }
-  GST_DEBUG_OBJECT(pylonsrc, "Using \"%s\" trigger selector. Software trigger mode is %s.", triggerSelectorValue, triggerMode);
-  res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerSelector", triggerSelectorValue);
+  GST_DEBUG_OBJECT(pylonsrc, "Using \"%s\" trigger selector. Trigger mode is %s, the trigger source is %s.", triggerSelectorValue, triggerMode, triggerSource);
+  res = pylonc_timed_from_string(pylonsrc, "TriggerSelector", triggerSelectorValue);
   PYLONC_CHECK_ERROR(pylonsrc, res);
-  res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "TriggerSource", "Software");
+  res = pylonc_timed_from_string(pylonsrc, "TriggerSource", triggerSource);
   PYLONC_CHECK_ERROR(pylonsrc, res);
-  res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, "AcquisitionMode", "Continuous" );
+  res = pylonc_timed_from_string(pylonsrc, "AcquisitionMode", "Continuous" );
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+
+  // Get the size of the image itself. Chunk data gets appended to it, so it has to be disabled first in case it was left on.
+  if(pylonc_timed_is_writable(pylonsrc, "ChunkModeActive")) {
+    res = pylonc_timed_set_boolean(pylonsrc, "ChunkModeActive", FALSE);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+  res = pylonc_timed_get_integer_int32(pylonsrc, "PayloadSize", &pylonsrc->frameSize);
   PYLONC_CHECK_ERROR(pylonsrc, res);
 
+  // Work out how to pad the rows of the frames we push. USB3 cameras don't pad them, so it's done while copying.
+  pylonsrc->outputStride = 0;
+  if(pylonsrc->strideAlign > 1 && pylonsrc->height > 0) {
+    gsize rowSize = pylonsrc->frameSize / pylonsrc->height;
+
+    if(pylonsrc->strideAlign & (pylonsrc->strideAlign - 1)) {
+      pylonsrc->strideAlign = 1u << g_bit_storage(pylonsrc->strideAlign);
+      GST_WARNING_OBJECT(pylonsrc, "stridealign has to be a power of two, using %u.", pylonsrc->strideAlign);
+    }
+#ifdef HAVE_GST_FDMEMORY
+    if(pylonsrc->fdMemory) {
+      GST_WARNING_OBJECT(pylonsrc, "The frames are pushed in the grab buffers with fdmemory, their rows can't be padded to stridealign.");
+    } else
+#endif
+    if(rowSize % pylonsrc->strideAlign != 0) {
+      pylonsrc->outputStride = (rowSize + pylonsrc->strideAlign - 1) / pylonsrc->strideAlign * pylonsrc->strideAlign;
+    }
+    GST_DEBUG_OBJECT(pylonsrc, "Rows are %zu bytes, pushing them %zu bytes apart.", rowSize, pylonsrc->outputStride ? pylonsrc->outputStride : rowSize);
+  }
+
+  // Enable chunk data
+  pylonsrc->chunks = 0;
+  if(pylonsrc->chunkData) {
+    if(pylonc_timed_is_writable(pylonsrc, "ChunkModeActive")) {
+      GstPylonMetaChunks enabled = 0;
+      NODEMAP_HANDLE nodeMap;
+
+      res = pylonc_timed_set_boolean(pylonsrc, "ChunkModeActive", TRUE);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+
+      for(i = 0; i < NUM_CHUNKS; i++) {
+        char entry[64];
+        snprintf(entry, sizeof(entry), "EnumEntry_ChunkSelector_%s", pylonChunks[i].selector);
+        if((enabled & pylonChunks[i].field) || !pylonc_timed_is_available(pylonsrc, entry)) {
+          continue;
+        }
+
+        res = pylonc_timed_from_string(pylonsrc, "ChunkSelector", pylonChunks[i].selector);
+        PYLONC_CHECK_ERROR(pylonsrc, res);
+        res = pylonc_timed_set_boolean(pylonsrc, "ChunkEnable", TRUE);
+        PYLONC_CHECK_ERROR(pylonsrc, res);
+        GST_DEBUG_OBJECT(pylonsrc, "Enabled %s chunk.", pylonChunks[i].selector);
+
+        enabled |= pylonChunks[i].field;
+        pylonsrc->chunks |= 1 << i;
+      }
+
+      // The values are read for every frame, so their nodes are only looked up once
+      res = PylonDeviceGetNodeMap(pylonsrc->deviceHandle, &nodeMap);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+      for(i = 0; i < NUM_CHUNKS; i++) {
+        pylonsrc->chunkNodes[i] = GENAPIC_INVALID_HANDLE;
+        if(pylonsrc->chunks & (1 << i)) {
+          res = GenApiNodeMapGetNode(nodeMap, pylonChunks[i].feature, &pylonsrc->chunkNodes[i]);
+          PYLONC_CHECK_ERROR(pylonsrc, res);
+          if(pylonsrc->chunkNodes[i] == GENAPIC_INVALID_HANDLE) {
+            GST_WARNING_OBJECT(pylonsrc, "The camera sends the %s chunk, but has no %s to read it from.", pylonChunks[i].selector, pylonChunks[i].feature);
+            pylonsrc->chunks &= ~(1 << i);
+          }
+        }
+      }
+
+      res = PylonDeviceCreateChunkParser(pylonsrc->deviceHandle, &pylonsrc->chunkParser);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+    } else {
+      GST_WARNING_OBJECT(pylonsrc, "This camera doesn't support chunk data. The exposure time, gain, line status and frame counter used for each frame will not be available.");
+    }
+  }
+
   // Create a stream grabber
+  gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_GRABBER);
   size_t streams;
   res = PylonDeviceGetNumStreamGrabberChannels(pylonsrc->deviceHandle, &streams);
   PYLONC_CHECK_ERROR(pylonsrc, res);
@@ -1978,54 +3143,177 @@ gst_pylonsrc_start (GstBaseSrc * src)
   PYLONC_CHECK_ERROR(pylonsrc, res);
   res = PylonStreamGrabberOpen(pylonsrc->streamGrabber);
   PYLONC_CHECK_ERROR(pylonsrc, res);
+  pylonsrc->streamGrabberOpen = TRUE;
 
   // Get the wait object
   res = PylonStreamGrabberGetWaitObject(pylonsrc->streamGrabber, &pylonsrc->waitObject);
   PYLONC_CHECK_ERROR(pylonsrc, res);
 
   // Get the size of each frame
-  res = PylonDeviceGetIntegerFeatureInt32(pylonsrc->deviceHandle, "PayloadSize", &pylonsrc->payloadSize);
+  res = pylonc_timed_get_integer_int32(pylonsrc, "PayloadSize", &pylonsrc->payloadSize);
   PYLONC_CHECK_ERROR(pylonsrc, res);
 
-  // Allocate the memory for the frame payloads
-  for(i = 0; i < NUM_BUFFERS; ++i) {
-    buffers[i] = (unsigned char*) malloc(pylonsrc->payloadSize);
-    if (NULL == buffers[i]) {
-      GST_ERROR_OBJECT(pylonsrc, "Memory allocation error.");
-      GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Memory allocation error"), ("Couldn't allocate memory."));
-      goto error;
+  // Get the framerate the camera will run at
+  pylonsrc->frameRate = 0.0;
+  if(pylonc_timed_is_readable(pylonsrc, "ResultingFrameRate")) {
+    res = pylonc_timed_get_float(pylonsrc, "ResultingFrameRate", &pylonsrc->frameRate);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+
+  // Pick the number of grab buffers. Automatically it's enough to cover the latency budget, plus one being filled and one being processed.
+  pylonsrc->maxBuffers = CLAMP((guint64) pylonsrc->bufferMemory * 1000000 / pylonsrc->payloadSize, MIN_NUM_BUFFERS, MAX_NUM_BUFFERS);
+  if(pylonsrc->grabBuffers > 0) {
+    pylonsrc->numBuffers = pylonsrc->grabBuffers;
+  } else if(pylonsrc->frameRate > 0.0) {
+    double frames = pylonsrc->frameRate * pylonsrc->latencyBudget / 1000;
+    pylonsrc->numBuffers = (guint) frames + ((guint) frames < frames ? 1 : 0) + 2;
+    if(pylonsrc->numBuffers > pylonsrc->maxBuffers) {
+      GST_WARNING_OBJECT(pylonsrc, "Covering %u ms at %.0lf fps takes %u buffers, but only %u fit into %u MB.", pylonsrc->latencyBudget, pylonsrc->frameRate, pylonsrc->numBuffers, pylonsrc->maxBuffers, pylonsrc->bufferMemory);
     }
+    pylonsrc->numBuffers = CLAMP(pylonsrc->numBuffers, MIN_NUM_BUFFERS, pylonsrc->maxBuffers);
+  } else {
+    pylonsrc->numBuffers = MIN(DEFAULT_NUM_BUFFERS, pylonsrc->maxBuffers);
   }
-  
-  // Define buffers 
-  res = PylonStreamGrabberSetMaxNumBuffer(pylonsrc->streamGrabber, NUM_BUFFERS);
-  PYLONC_CHECK_ERROR(pylonsrc, res);
-  res = PylonStreamGrabberSetMaxBufferSize(pylonsrc->streamGrabber, pylonsrc->payloadSize);
-  PYLONC_CHECK_ERROR(pylonsrc, res);
 
-  // Prepare the camera for grabbing
-  res = PylonStreamGrabberPrepareGrab(pylonsrc->streamGrabber);
+  gst_pylonsrc_restart_monitoring(pylonsrc);
+
+  // Decide how to allocate the frame payloads
+  if(strcmp(pylonsrc->bufferpages, "transparent") == 0) {
+    allocParams.pages = GST_PYLON_PAGES_TRANSPARENT;
+  } else if(strcmp(pylonsrc->bufferpages, "huge") == 0) {
+    allocParams.pages = GST_PYLON_PAGES_HUGE;
+  } else {
+    if(strcmp(pylonsrc->bufferpages, "normal") != 0) {
+      GST_WARNING_OBJECT(pylonsrc, "Unknown page type \"%s\", using normal pages.", pylonsrc->bufferpages);
+    }
+    allocParams.pages = GST_PYLON_PAGES_NORMAL;
+  }
+  allocParams.lock = pylonsrc->lockBuffers;
+  allocParams.numaNode = -1;
+  allocParams.shared = FALSE;
+  if(pylonsrc->fdMemory) {
+#ifdef HAVE_GST_FDMEMORY
+    allocParams.shared = TRUE;
+    if(!pylonsrc->fdAllocator) {
+      pylonsrc->fdAllocator = gst_fd_allocator_new();
+    }
+#else
+    GST_WARNING_OBJECT(pylonsrc, "The plugin was built without GstFdMemory (gstreamer-allocators-1.0 1.6 or newer), copying the frames out of the grab buffers instead.");
+#endif
+  }
+  if(strcmp(pylonsrc->numanode, "auto") == 0) {
+    // The grab buffers are written by the USB controller, so they should be close to it
+    char serial[256];
+    size_t siz = sizeof(serial);
+    if(pylonc_timed_is_readable(pylonsrc, "DeviceSerialNumber") && pylonc_timed_to_string(pylonsrc, "DeviceSerialNumber", serial, &siz) == GENAPI_E_OK) {
+      allocParams.numaNode = gst_pylon_usb_numa_node(serial);
+    }
+    if(allocParams.numaNode < 0) {
+      GST_DEBUG_OBJECT(pylonsrc, "Couldn't find out which NUMA node the camera's USB controller is on, leaving the placement of the grab buffers to the kernel.");
+    }
+  } else if(strcmp(pylonsrc->numanode, "none") != 0) {
+    allocParams.numaNode = (gint) g_ascii_strtoll(pylonsrc->numanode, NULL, 10);
+  }
+
+  // Allocate the memory for the frame payloads
+  pylonc_free_buffers(pylonsrc);
+  pylonsrc->buffers = g_new0(GstPylonGrabMemory, pylonsrc->numBuffers);
+  pylonsrc->bufferHandle = g_new0(PYLON_STREAMBUFFER_HANDLE, pylonsrc->numBuffers);
+  pylonsrc->bufferIdle = g_new0(gboolean, pylonsrc->numBuffers);
+  // Frames of the previous stream grabber were left behind with fdGeneration
+  g_mutex_lock(&pylonsrc->fdLock);
+  pylonsrc->fdHalted = FALSE;
+  g_mutex_unlock(&pylonsrc->fdLock);
+  for(i = 0; i < pylonsrc->numBuffers; ++i) {
+    if (!gst_pylon_grab_memory_alloc(&pylonsrc->buffers[i], pylonsrc->payloadSize, &allocParams)) {
+      GST_ERROR_OBJECT(pylonsrc, "Memory allocation error.");
+      GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Memory allocation error"), ("Couldn't allocate memory."));
+      goto error;
+    }
+    pylonsrc->numAllocated++;
+  }
+  GST_DEBUG_OBJECT(pylonsrc, "The grab buffers use %s pages, are %slocked and are on NUMA node %d (asked for %s pages, %slocked, node %d).", gst_pylon_pages_get_name(pylonsrc->buffers[0].pages), pylonsrc->buffers[0].locked ? "" : "not ", pylonsrc->buffers[0].numaNode, gst_pylon_pages_get_name(allocParams.pages), allocParams.lock ? "" : "not ", allocParams.numaNode);
+  if(pylonsrc->buffers[0].pages != allocParams.pages || pylonsrc->buffers[0].locked != allocParams.lock || pylonsrc->buffers[0].numaNode != allocParams.numaNode) {
+    GST_WARNING_OBJECT(pylonsrc, "Couldn't allocate the grab buffers the way they were asked for, run with GST_DEBUG=pylonalloc:5 to see why.");
+  }
+  
+  // Define buffers 
+  res = PylonStreamGrabberSetMaxNumBuffer(pylonsrc->streamGrabber, pylonsrc->numBuffers);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  res = PylonStreamGrabberSetMaxBufferSize(pylonsrc->streamGrabber, pylonsrc->payloadSize);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+
+  // Set up the USB transfers. These parameters only exist on the USB3 stream grabber.
+  res = PylonStreamGrabberGetNodeMap(pylonsrc->streamGrabber, &streamNodeMap);
   PYLONC_CHECK_ERROR(pylonsrc, res);
+  if(transferSize > pylonsrc->payloadSize) {
+    GST_WARNING_OBJECT(pylonsrc, "Transfers larger than a frame (%"PRId32" bytes) would only waste memory, limiting the transfer size to that.", pylonsrc->payloadSize);
+    transferSize = pylonsrc->payloadSize;
+  }
+  transferSize = pylonc_set_stream_parameter(pylonsrc, streamNodeMap, "MaxTransferSize", transferSize);
+  if(transferSize > 0) {
+    // Every queued buffer is filled by this many transfers, and the driver can't have more transfers queued than the buffers take
+    int64_t transfersPerFrame = (pylonsrc->payloadSize + transferSize - 1) / transferSize;
+    if(queuedUrbs > transfersPerFrame * pylonsrc->numBuffers) {
+      GST_WARNING_OBJECT(pylonsrc, "%u grab buffers only take %"PRId64" transfers, limiting the queued transfers to that.", pylonsrc->numBuffers, transfersPerFrame * pylonsrc->numBuffers);
+      queuedUrbs = transfersPerFrame * pylonsrc->numBuffers;
+    }
+  }
+  queuedUrbs = pylonc_set_stream_parameter(pylonsrc, streamNodeMap, "NumMaxQueuedUrbs", queuedUrbs);
+  transferPriority = pylonc_set_stream_parameter(pylonsrc, streamNodeMap, "TransferLoopThreadPriority", pylonsrc->transferPriority);
+
+  // Linux limits the memory all of the queued USB transfers in the system can take (16 MB by default)
+  if(transferSize > 0 && queuedUrbs > 0 && g_file_get_contents("/sys/module/usbcore/parameters/usbfs_memory_mb", &usbfsLimit, NULL, NULL)) {
+    int64_t limit = g_ascii_strtoll(usbfsLimit, NULL, 10) * 1024 * 1024;
+    if(limit > 0 && transferSize * queuedUrbs > limit) {
+      GST_WARNING_OBJECT(pylonsrc, "The queued transfers need %"PRId64" bytes, but usbfs_memory_mb only allows %"PRId64" for all cameras together. Transfers will fail unless the limit is raised.", transferSize * queuedUrbs, limit);
+    }
+    g_free(usbfsLimit);
+  }
+
+  GST_DEBUG_OBJECT(pylonsrc, "Grabbing into %u buffers of %"PRId32" bytes (%.1lf MB in total).", pylonsrc->numBuffers, pylonsrc->payloadSize, (double)pylonsrc->numBuffers*pylonsrc->payloadSize/1000000);
+  if(transferSize > 0) {
+    GST_DEBUG_OBJECT(pylonsrc, "Transfers are %"PRId64" bytes big, with up to %"PRId64" of them queued. The transfer loop priority is %"PRId64".", transferSize, queuedUrbs, transferPriority);
+  }
 
-  for(i = 0; i <NUM_BUFFERS; ++i) {
-    res = PylonStreamGrabberRegisterBuffer(pylonsrc->streamGrabber, buffers[i], pylonsrc->payloadSize, &bufferHandle[i]);
+  // Prepare the camera for grabbing
+  res = PylonStreamGrabberPrepareGrab(pylonsrc->streamGrabber);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  pylonsrc->grabPrepared = TRUE;
+
+  for(i = 0; i < pylonsrc->numBuffers; ++i) {
+    res = PylonStreamGrabberRegisterBuffer(pylonsrc->streamGrabber, pylonsrc->buffers[i].data, pylonsrc->payloadSize, &pylonsrc->bufferHandle[i]);
     PYLONC_CHECK_ERROR(pylonsrc, res);
+    pylonsrc->numRegistered++;
   }
   
-  for(i = 0; i <NUM_BUFFERS; ++i) {
+  for(i = 0; i < pylonsrc->numBuffers; ++i) {
     #pragma GCC diagnostic ignored "-Wint-to-pointer-cast" // This line comes from the SDK docs.
-    res = PylonStreamGrabberQueueBuffer(pylonsrc->streamGrabber, bufferHandle[i], (void *) i);
+    res = PylonStreamGrabberQueueBuffer(pylonsrc->streamGrabber, pylonsrc->bufferHandle[i], (void *) i);
     #pragma GCC diagnostic pop
     PYLONC_CHECK_ERROR(pylonsrc, res);
   }
 
+  // Finished frames are collected into a ring, either by the shared grab engine or in create()
+  gst_pylon_grab_ring_init(&pylonsrc->grabRing, pylonsrc->streamGrabber, pylonsrc->waitObject, pylonsrc->numBuffers);
+  if(pylonsrc->grabThreads > 0) {
+    pylonsrc->grabEngine = TRUE;
+    if(!gst_pylon_grab_engine_add(&pylonsrc->grabRing, pylonsrc->grabThreads)) {
+      GST_ERROR_OBJECT(pylonsrc, "Couldn't add the camera to the grab engine.");
+      GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("Grab engine error"), ("Couldn't add the camera to the grab engine."));
+      goto error;
+    }
+    GST_DEBUG_OBJECT(pylonsrc, "Frames will be collected by the grab engine.");
+  }
+
   // Output the bandwidth the camera will actually use [B/s]
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "DeviceLinkCurrentThroughput") && PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "DeviceLinkSpeed")) {
-    int64_t throughput = 0, linkSpeed = 0;
+  gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_CONFIGURE);
+  if(pylonc_timed_is_implemented(pylonsrc, "DeviceLinkCurrentThroughput") && pylonc_timed_is_implemented(pylonsrc, "DeviceLinkSpeed")) {
+    int64_t linkSpeed = 0;
 
-    res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "DeviceLinkCurrentThroughput", &throughput);
+    res = pylonc_timed_get_integer(pylonsrc, "DeviceLinkCurrentThroughput", &throughput);
     PYLONC_CHECK_ERROR(pylonsrc, res);
-    res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "DeviceLinkSpeed", &linkSpeed);
+    res = pylonc_timed_get_integer(pylonsrc, "DeviceLinkSpeed", &linkSpeed);
     PYLONC_CHECK_ERROR(pylonsrc, res);
 
     if(throughput > linkSpeed) {
@@ -2034,16 +3322,19 @@ gst_pylonsrc_start (GstBaseSrc * src)
       goto error;
     }
 
+    // The camera's own link is fast enough, but it may be sharing its USB controller with other cameras
+    if(!pylonc_plan_bandwidth(pylonsrc, &throughput, linkSpeed)) {
+      goto error;
+    }
+
     GST_DEBUG_OBJECT(pylonsrc, "With current settings the camera requires %"PRId64"/%"PRId64" B/s (%.1lf out of %.1lf MB/s) of bandwidth.", throughput, linkSpeed, (double)throughput/1000000, (double)linkSpeed/1000000);
   } else {
     GST_WARNING_OBJECT(pylonsrc, "Couldn't determine link speed.");
   }
 
   // Output sensor readout time [us]
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "SensorReadoutTime")) {
-    double readoutTime = 0.0;
-
-    res = PylonDeviceGetFloatFeature(pylonsrc->deviceHandle, "SensorReadoutTime", &readoutTime);
+  if(pylonc_timed_is_implemented(pylonsrc, "SensorReadoutTime")) {
+    res = pylonc_timed_get_float(pylonsrc, "SensorReadoutTime", &readoutTime);
     PYLONC_CHECK_ERROR(pylonsrc, res);
 
     GST_DEBUG_OBJECT(pylonsrc, "With these settings it will take approximately %.0lf microseconds to grab each frame.", readoutTime);
@@ -2052,35 +3343,461 @@ gst_pylonsrc_start (GstBaseSrc * src)
   }
 
   // Output final frame rate [Hz]
-  if(PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, "ResultingFrameRate")) {
-    double frameRate = 0.0;
+  if(pylonsrc->frameRate > 0.0) {
+    GST_DEBUG_OBJECT(pylonsrc, "The resulting framerate is %.0lf fps.", pylonsrc->frameRate);
+    GST_DEBUG_OBJECT(pylonsrc, "Each frame is %"PRId32" bytes big (%.1lf MB). That's %.1lfMB/s.", pylonsrc->payloadSize, (double)pylonsrc->payloadSize/1000000, (pylonsrc->payloadSize*pylonsrc->frameRate)/1000000);
+  } else {
+    GST_WARNING_OBJECT(pylonsrc, "Couldn't determine the resulting framerate.");
+  }
+
+  // Unless the fps property pins it, downstream can pick the framerate of a free running camera, up to the one it runs at now
+  pylonsrc->minFrameRate = 0.0;
+  pylonsrc->maxFrameRate = pylonsrc->frameRate;
+  pylonsrc->capsFrameRate = 0.0;
+  if(!pylonsrc->setFPS && pylonsrc->fps == 0 && pylonsrc->continuousMode && pylonsrc->frameRate > 0.0 && pylonc_timed_is_writable(pylonsrc, "AcquisitionFrameRateEnable") && pylonc_timed_is_writable(pylonsrc, "AcquisitionFrameRate")) {
+    double minRate, maxRate;
 
-    res = PylonDeviceGetFloatFeature(pylonsrc->deviceHandle, "ResultingFrameRate", &frameRate);
+    res = pylonc_timed_get_float_min(pylonsrc, "AcquisitionFrameRate", &minRate);
     PYLONC_CHECK_ERROR(pylonsrc, res);
+    res = pylonc_timed_get_float_max(pylonsrc, "AcquisitionFrameRate", &maxRate);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+    pylonsrc->maxFrameRate = MIN(pylonsrc->frameRate, maxRate);
+    if(minRate < pylonsrc->maxFrameRate) {
+      pylonsrc->minFrameRate = MAX(minRate, 0.01);
+      GST_DEBUG_OBJECT(pylonsrc, "Downstream can pick a framerate between %.2lf and %.2lf fps.", pylonsrc->minFrameRate, pylonsrc->maxFrameRate);
+    }
+  }
 
-    GST_DEBUG_OBJECT(pylonsrc, "The resulting framerate is %.0lf fps.", frameRate);
-    GST_DEBUG_OBJECT(pylonsrc, "Each frame is %"PRId32" bytes big (%.1lf MB). That's %.1lfMB/s.", pylonsrc->payloadSize, (double)pylonsrc->payloadSize/1000000, (pylonsrc->payloadSize*frameRate)/1000000);
-  } else {
-    GST_WARNING_OBJECT(pylonsrc, "Couldn't determine the resulting framerate.");
+  // Estimate how long it takes for a frame to reach us after its exposure starts, so that we can tell when each frame was taken
+  if(pylonc_timed_is_readable(pylonsrc, "ExposureTime")) {
+    res = pylonc_timed_get_float(pylonsrc, "ExposureTime", &exposureTime);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
   }
+  pylonsrc->captureDelay = (GstClockTime) ((exposureTime + readoutTime) * GST_USECOND);
+  if(throughput > 0) {
+    pylonsrc->captureDelay += gst_util_uint64_scale(pylonsrc->payloadSize, GST_SECOND, throughput);
+  }
+  GST_DEBUG_OBJECT(pylonsrc, "Frames should reach the plugin approximately %.0lf microseconds after their exposure starts.", (double)pylonsrc->captureDelay/GST_USECOND);
 
   // Tell the camera to start recording
-  res = PylonDeviceExecuteCommandFeature(pylonsrc->deviceHandle, "AcquisitionStart");
-  PYLONC_CHECK_ERROR(pylonsrc, res);
-  if(!pylonsrc->continuousMode) {
-    res = PylonDeviceExecuteCommandFeature(pylonsrc->deviceHandle, "TriggerSoftware"); 
-  PYLONC_CHECK_ERROR(pylonsrc, res);
+  gst_pylonsrc_profile_phase(pylonsrc, PYLONSRC_STARTUP_ACQUISITION);
+  if(!pylonc_start_acquisition(pylonsrc)) {
+    goto error;
   }
-  pylonsrc->frameNumber = 0;
+  pylonsrc->warmChanged = FALSE;
+  gst_pylonsrc_qos_reset(pylonsrc);
 
   GST_MESSAGE_OBJECT(pylonsrc, "Initialised successfully.");  
+  gst_pylonsrc_profile_finish(pylonsrc);
   return TRUE;
 
 error:
+  gst_pylonsrc_profile_finish(pylonsrc);
   pylonc_disconnect_camera(pylonsrc);
   return FALSE;
 }
 
+/* Starts monitoring the grab buffers from scratch */
+static void
+gst_pylonsrc_restart_monitoring (GstPylonsrc * pylonsrc)
+{
+  pylonsrc->queueDepth = 0;
+  pylonsrc->peakQueueDepth = 0;
+  pylonsrc->starvedFrames = 0;
+  pylonsrc->lostFrames = 0;
+  pylonsrc->lastBlockId = 0;
+  pylonsrc->recommendedBuffers = pylonsrc->numBuffers;
+  pylonsrc->lastBufferReport = g_get_monotonic_time();
+}
+
+/* Downstream reports how far behind it is in QoS events, create() reacts to them */
+static gboolean
+gst_pylonsrc_event (GstBaseSrc * src, GstEvent * event)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
+
+  if(GST_EVENT_TYPE(event) == GST_EVENT_QOS) {
+    GstQOSType type;
+    gdouble proportion;
+    GstClockTimeDiff diff;
+    GstClockTime timestamp;
+
+    gst_event_parse_qos(event, &type, &proportion, &diff, &timestamp);
+    GST_LOG_OBJECT(pylonsrc, "QoS: proportion %f, diff %" G_GINT64_FORMAT, proportion, diff);
+    GST_OBJECT_LOCK(pylonsrc);
+    pylonsrc->qosProportion = proportion;
+    pylonsrc->qosDiff = diff;
+    pylonsrc->qosPending = TRUE;
+    GST_OBJECT_UNLOCK(pylonsrc);
+  }
+
+  return GST_BASE_SRC_CLASS (gst_pylonsrc_parent_class)->event (src, event);
+}
+
+/* Runs the camera at rate times its normal framerate, or drops frames to the same effect, and reports the change. Called with frameRateLock held. */
+static void
+gst_pylonsrc_qos_apply (GstPylonsrc * pylonsrc, gdouble rate, gdouble proportion)
+{
+  GENAPIC_RESULT res;
+
+  if(pylonsrc->qosFramerate) {
+    if(rate >= 1.0 && pylonsrc->capsFrameRate == 0.0) {
+      // Back to the framerate the camera was configured with
+      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable", pylonsrc->setFPS || pylonsrc->fps != 0);
+      if(res == GENAPI_E_OK && pylonsrc->fps != 0) {
+        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AcquisitionFrameRate", pylonsrc->fps);
+      }
+    } else {
+      res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable", TRUE);
+      if(res == GENAPI_E_OK) {
+        res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AcquisitionFrameRate", pylonsrc->frameRate * rate);
+      }
+    }
+    if(res != GENAPI_E_OK) {
+      GST_WARNING_OBJECT(pylonsrc, "Couldn't change the camera's framerate (%#08x), dropping frames instead.", (unsigned int) res);
+      pylonsrc->qosFramerate = FALSE;
+    }
+  }
+
+  pylonsrc->qosRate = rate;
+  pylonsrc->qosCredit = 0.0;
+  pylonsrc->qosLastChange = g_get_monotonic_time();
+  GST_INFO_OBJECT(pylonsrc, "Downstream runs at %.2f of real time, %s to %.2f fps (%.0f%%). %" G_GUINT64_FORMAT " frames were dropped so far.", 1.0 / proportion, pylonsrc->qosFramerate ? "setting the camera" : "passing frames on", pylonsrc->frameRate * rate, rate * 100, pylonsrc->qosDropped);
+  gst_element_post_message(GST_ELEMENT(pylonsrc), gst_message_new_element(GST_OBJECT(pylonsrc),
+      gst_structure_new("pylonsrc-qos",
+          "method", G_TYPE_STRING, pylonsrc->qosFramerate ? "framerate" : "drop",
+          "rate", G_TYPE_DOUBLE, rate,
+          "framerate", G_TYPE_DOUBLE, pylonsrc->frameRate * rate,
+          "proportion", G_TYPE_DOUBLE, proportion,
+          "dropped", G_TYPE_UINT64, pylonsrc->qosDropped,
+          NULL)));
+}
+
+/* Starts from the full rate, putting back the camera's framerate if a warm camera was slowed down */
+static void
+gst_pylonsrc_qos_reset (GstPylonsrc * pylonsrc)
+{
+  GstPylonsrcQos mode;
+
+  GST_OBJECT_LOCK(pylonsrc);
+  mode = pylonsrc->qos;
+  pylonsrc->qosPending = FALSE;
+  GST_OBJECT_UNLOCK(pylonsrc);
+
+  g_mutex_lock(&pylonsrc->frameRateLock);
+  gst_pylonsrc_qos_set_mode(pylonsrc, mode);
+  g_mutex_unlock(&pylonsrc->frameRateLock);
+  pylonsrc->qosDropped = 0;
+}
+
+/* Starts reacting to QoS in the given mode, from the camera's full framerate. Called with frameRateLock held. */
+static void
+gst_pylonsrc_qos_set_mode (GstPylonsrc * pylonsrc, GstPylonsrcQos mode)
+{
+  if(pylonsrc->qosRate < 1.0) {
+    gst_pylonsrc_qos_apply(pylonsrc, 1.0, 1.0);
+  }
+
+  // Changing the framerate only takes for a free running camera
+  pylonsrc->qosMode = mode;
+  pylonsrc->qosFramerate = FALSE;
+  if(mode == PYLONSRC_QOS_FRAMERATE || mode == PYLONSRC_QOS_AUTO) {
+    pylonsrc->qosFramerate = pylonsrc->continuousMode && pylonsrc->frameRate > 0.0 && PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable") && PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AcquisitionFrameRate");
+    if(!pylonsrc->qosFramerate && mode == PYLONSRC_QOS_FRAMERATE) {
+      GST_WARNING_OBJECT(pylonsrc, "The camera's framerate can't be lowered (it's triggered or has no AcquisitionFrameRate), dropping frames under QoS instead.");
+    }
+  }
+
+  pylonsrc->qosRate = 1.0;
+  pylonsrc->qosCredit = 0.0;
+  pylonsrc->qosLastChange = pylonsrc->qosLastLate = g_get_monotonic_time();
+}
+
+/* Adapts the rate to the last QoS event and decides whether the current frame is kept. The rate drops as soon as downstream is late, and goes back up by a tenth a second once downstream has kept up for a second. */
+static gboolean
+gst_pylonsrc_qos_keep_frame (GstPylonsrc * pylonsrc)
+{
+  gint64 now;
+  gdouble proportion;
+  GstClockTimeDiff diff;
+  gboolean pending, keep = TRUE;
+  GstPylonsrcQos mode;
+
+  GST_OBJECT_LOCK(pylonsrc);
+  mode = pylonsrc->qos;
+  pending = pylonsrc->qosPending;
+  proportion = pylonsrc->qosProportion;
+  diff = pylonsrc->qosDiff;
+  pylonsrc->qosPending = FALSE;
+  GST_OBJECT_UNLOCK(pylonsrc);
+
+  g_mutex_lock(&pylonsrc->frameRateLock);
+  if(mode != pylonsrc->qosMode) {
+    GST_INFO_OBJECT(pylonsrc, "Reacting to QoS with \"%s\" from now on.", qosModeNames[mode]);
+    gst_pylonsrc_qos_set_mode(pylonsrc, mode);
+  }
+  if(mode == PYLONSRC_QOS_OFF) {
+    goto done;
+  }
+
+  now = g_get_monotonic_time();
+  if(pending && (proportion > 1.05 || diff > 0)) {
+    pylonsrc->qosLastLate = now;
+    // Give the previous change some time to reach downstream before slowing down further
+    if(pylonsrc->qosRate > 0.1 && now - pylonsrc->qosLastChange >= G_USEC_PER_SEC / 2) {
+      gst_pylonsrc_qos_apply(pylonsrc, MAX(pylonsrc->qosRate / MAX(proportion, 1.1), 0.1), proportion);
+    }
+  } else if(pylonsrc->qosRate < 1.0 && now - pylonsrc->qosLastLate >= G_USEC_PER_SEC && now - pylonsrc->qosLastChange >= G_USEC_PER_SEC) {
+    gst_pylonsrc_qos_apply(pylonsrc, MIN(pylonsrc->qosRate + 0.1, 1.0), pending ? proportion : 1.0);
+  }
+
+  if(pylonsrc->qosFramerate || pylonsrc->qosRate >= 1.0) {
+    goto done;
+  }
+  pylonsrc->qosCredit += pylonsrc->qosRate;
+  if(pylonsrc->qosCredit >= 1.0) {
+    pylonsrc->qosCredit -= 1.0;
+    goto done;
+  }
+  pylonsrc->qosDropped++;
+  keep = FALSE;
+
+done:
+  g_mutex_unlock(&pylonsrc->frameRateLock);
+  return keep;
+}
+
+/* Time spent in a camera feature while starting */
+typedef struct _GstPylonsrcFeatureTime
+{
+  gchar *name;
+  GstClockTime time;
+  guint calls;
+} GstPylonsrcFeatureTime;
+
+static const gchar *startupPhaseNames[PYLONSRC_STARTUP_PHASES] = { "enumerate", "open", "configure", "grabber", "acquisition" };
+
+static void
+gst_pylonsrc_profile_begin (GstPylonsrc * pylonsrc)
+{
+  gint i;
+
+  if(pylonsrc->startupFeatures) {
+    g_hash_table_destroy(pylonsrc->startupFeatures);
+  }
+  pylonsrc->startupFeatures = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+  for(i = 0; i < PYLONSRC_STARTUP_PHASES; i++) {
+    pylonsrc->startupPhases[i] = 0;
+  }
+  pylonsrc->startupPhase = PYLONSRC_STARTUP_ENUMERATE;
+  pylonsrc->startupBegin = pylonsrc->startupPhaseBegin = g_get_monotonic_time();
+}
+
+static void
+gst_pylonsrc_profile_feature (GstPylonsrc * pylonsrc, const char * feature, gint64 begin)
+{
+  gint64 now = g_get_monotonic_time();
+  GstPylonsrcFeatureTime *entry = g_hash_table_lookup(pylonsrc->startupFeatures, feature);
+
+  if(!entry) {
+    entry = g_new0(GstPylonsrcFeatureTime, 1);
+    entry->name = g_strdup(feature);
+    g_hash_table_insert(pylonsrc->startupFeatures, entry->name, entry);
+  }
+  entry->time += (now - begin) * GST_USECOND;
+  entry->calls++;
+}
+
+/* Ends the current phase of the startup */
+static void
+gst_pylonsrc_profile_phase (GstPylonsrc * pylonsrc, GstPylonsrcStartupPhase phase)
+{
+  gint64 now = g_get_monotonic_time();
+
+  pylonsrc->startupPhases[pylonsrc->startupPhase] += (now - pylonsrc->startupPhaseBegin) * GST_USECOND;
+  pylonsrc->startupPhase = phase;
+  pylonsrc->startupPhaseBegin = now;
+}
+
+static gint
+gst_pylonsrc_compare_feature_times (gconstpointer a, gconstpointer b)
+{
+  const GstPylonsrcFeatureTime *x = *(GstPylonsrcFeatureTime * const *) a, *y = *(GstPylonsrcFeatureTime * const *) b;
+
+  return x->time < y->time ? 1 : (x->time > y->time ? -1 : 0);
+}
+
+/* Logs where the time went while starting, slowest features first, and posts it in a pylonsrc-startup element message */
+static void
+gst_pylonsrc_profile_finish (GstPylonsrc * pylonsrc)
+{
+  GstStructure *structure;
+  GPtrArray *features;
+  GHashTableIter iter;
+  GstPylonsrcFeatureTime *entry;
+  GValue names = G_VALUE_INIT, times = G_VALUE_INIT, calls = G_VALUE_INIT, item = G_VALUE_INIT;
+  GstClockTime total, featuresTotal = 0;
+  guint i;
+
+  if(!pylonsrc->startupFeatures) {
+    return;
+  }
+  gst_pylonsrc_profile_phase(pylonsrc, pylonsrc->startupPhase);
+  total = (g_get_monotonic_time() - pylonsrc->startupBegin) * GST_USECOND;
+
+  features = g_ptr_array_new();
+  g_hash_table_iter_init(&iter, pylonsrc->startupFeatures);
+  while(g_hash_table_iter_next(&iter, NULL, (gpointer*) &entry)) {
+    g_ptr_array_add(features, entry);
+    featuresTotal += entry->time;
+  }
+  g_ptr_array_sort(features, gst_pylonsrc_compare_feature_times);
+
+  structure = gst_structure_new("pylonsrc-startup", "total", G_TYPE_UINT64, total, "features-total", G_TYPE_UINT64, featuresTotal, NULL);
+  GST_DEBUG_OBJECT(pylonsrc, "Starting the camera took %" GST_TIME_FORMAT ", %" GST_TIME_FORMAT " of it in %u features.", GST_TIME_ARGS(total), GST_TIME_ARGS(featuresTotal), features->len);
+  for(i = 0; i < PYLONSRC_STARTUP_PHASES; i++) {
+    GST_DEBUG_OBJECT(pylonsrc, "  %s: %" GST_TIME_FORMAT, startupPhaseNames[i], GST_TIME_ARGS(pylonsrc->startupPhases[i]));
+    gst_structure_set(structure, startupPhaseNames[i], G_TYPE_UINT64, pylonsrc->startupPhases[i], NULL);
+  }
+
+  g_value_init(&names, GST_TYPE_ARRAY);
+  g_value_init(&times, GST_TYPE_ARRAY);
+  g_value_init(&calls, GST_TYPE_ARRAY);
+  for(i = 0; i < features->len; i++) {
+    entry = g_ptr_array_index(features, i);
+    GST_DEBUG_OBJECT(pylonsrc, "  %s: %" GST_TIME_FORMAT " in %u calls", entry->name, GST_TIME_ARGS(entry->time), entry->calls);
+
+    g_value_init(&item, G_TYPE_STRING);
+    g_value_set_string(&item, entry->name);
+    gst_value_array_append_and_take_value(&names, &item);
+    g_value_init(&item, G_TYPE_UINT64);
+    g_value_set_uint64(&item, entry->time);
+    gst_value_array_append_and_take_value(&times, &item);
+    g_value_init(&item, G_TYPE_UINT);
+    g_value_set_uint(&item, entry->calls);
+    gst_value_array_append_and_take_value(&calls, &item);
+  }
+  gst_structure_take_value(structure, "feature-names", &names);
+  gst_structure_take_value(structure, "feature-times", &times);
+  gst_structure_take_value(structure, "feature-calls", &calls);
+  gst_element_post_message(GST_ELEMENT(pylonsrc), gst_message_new_element(GST_OBJECT(pylonsrc), structure));
+
+  g_ptr_array_free(features, TRUE);
+  g_hash_table_destroy(pylonsrc->startupFeatures);
+  pylonsrc->startupFeatures = NULL;
+}
+
+/* Keeps track of how many frames were waiting in the grab buffers, and once a second recommends how many buffers would have been enough */
+static void
+gst_pylonsrc_monitor_buffers (GstPylonsrc * pylonsrc, guint queueDepth, guint64 blockId)
+{
+  gint64 now;
+  guint recommended;
+
+  // With every buffer full the camera had nowhere to put the next frame
+  if(queueDepth >= pylonsrc->numBuffers) {
+    if(pylonsrc->starvedFrames == 0) {
+      GST_WARNING_OBJECT(pylonsrc, "All %u grab buffers were full, the camera might be losing frames.", pylonsrc->numBuffers);
+    }
+    pylonsrc->starvedFrames++;
+  }
+  if(pylonsrc->lastBlockId > 0 && blockId > pylonsrc->lastBlockId + 1) {
+    pylonsrc->lostFrames += blockId - pylonsrc->lastBlockId - 1;
+  }
+  pylonsrc->lastBlockId = blockId;
+  pylonsrc->queueDepth = MAX(pylonsrc->queueDepth, queueDepth);
+  pylonsrc->peakQueueDepth = MAX(pylonsrc->peakQueueDepth, queueDepth);
+
+  now = g_get_monotonic_time();
+  if(now - pylonsrc->lastBufferReport < G_USEC_PER_SEC) {
+    return;
+  }
+
+  // The deepest the queue has been plus some headroom would have been enough. Once frames went missing there's no telling how many more buffers were needed, so ask for twice as many.
+  recommended = pylonsrc->peakQueueDepth + 2;
+  if(pylonsrc->starvedFrames > 0 || pylonsrc->lostFrames > 0) {
+    recommended = MAX(recommended, pylonsrc->numBuffers * 2);
+  }
+  recommended = CLAMP(recommended, MIN_NUM_BUFFERS, pylonsrc->maxBuffers);
+
+  GST_DEBUG_OBJECT(pylonsrc, "Up to %u of %u grab buffers were waiting to be processed in the last second (%u at most so far). %"G_GUINT64_FORMAT" frames found all buffers full and %"G_GUINT64_FORMAT" were lost so far.", pylonsrc->queueDepth, pylonsrc->numBuffers, pylonsrc->peakQueueDepth, pylonsrc->starvedFrames, pylonsrc->lostFrames);
+  if(recommended != pylonsrc->recommendedBuffers) {
+    GST_DEBUG_OBJECT(pylonsrc, "Recommending %u grab buffers instead of %u.", recommended, pylonsrc->recommendedBuffers);
+    pylonsrc->recommendedBuffers = recommended;
+    gst_element_post_message(GST_ELEMENT(pylonsrc), gst_message_new_element(GST_OBJECT(pylonsrc),
+        gst_structure_new("pylonsrc-buffers",
+            "buffers", G_TYPE_UINT, pylonsrc->numBuffers,
+            "recommended", G_TYPE_UINT, recommended,
+            "queue-depth", G_TYPE_UINT, pylonsrc->queueDepth,
+            "peak-queue-depth", G_TYPE_UINT, pylonsrc->peakQueueDepth,
+            "starved", G_TYPE_UINT64, pylonsrc->starvedFrames,
+            "lost", G_TYPE_UINT64, pylonsrc->lostFrames,
+            NULL)));
+  }
+
+  pylonsrc->queueDepth = 0;
+  pylonsrc->lastBufferReport = now;
+}
+
+/* Pipeline clock time at which a frame's exposure started. The camera stamps the frame with its timestamp counter when the exposure starts, and the camera clock maps that counter to the host's monotonic time, so the frame's age is taken off the time it arrived at. Without a calibrated camera clock (cameraclock isn't set, or the camera can't latch its counter) it's estimated from the time the frame arrived at and captureDelay. */
+static GstClockTime
+gst_pylonsrc_exposure_start (GstPylonsrc * pylonsrc, uint64_t timeStamp, GstClockTime grabTime)
+{
+  GstClockTime cameraTime, frameHost, now;
+
+  if(pylonsrc->clockLatch && timeStamp > 0) {
+    cameraTime = gst_util_uint64_scale(timeStamp, GST_SECOND, (guint64) pylonsrc->timestampFrequency);
+    GST_OBJECT_LOCK(pylonsrc->cameraClock);
+    frameHost = gst_clock_unadjust_unlocked(pylonsrc->cameraClock, cameraTime);
+    GST_OBJECT_UNLOCK(pylonsrc->cameraClock);
+    now = gst_clock_get_internal_time(pylonsrc->cameraClock);
+
+    // A frame from the future, or one older than the grab buffers could have held, means the calibration is off
+    if(frameHost <= now && now - frameHost < 10 * GST_SECOND && grabTime >= now - frameHost) {
+      return grabTime - (now - frameHost);
+    }
+    GST_LOG_OBJECT(pylonsrc, "Frame timestamp %" GST_TIME_FORMAT " doesn't fit the camera clock, estimating the exposure start.", GST_TIME_ARGS(cameraTime));
+  }
+
+  if(grabTime > pylonsrc->captureDelay) {
+    return grabTime - pylonsrc->captureDelay;
+  }
+  return GST_CLOCK_TIME_NONE;
+}
+
+/* Sets the throughput limit the bandwidth planner gave the camera while another camera joined or left its controller, and follows it with the framerate, latency and caps */
+static gboolean
+gst_pylonsrc_apply_bandwidth (GstPylonsrc * pylonsrc)
+{
+  GENAPIC_RESULT res;
+
+  if(!pylonsrc->bandwidthPlanned || !gst_pylon_bandwidth_apply_pending(&pylonsrc->bandwidthCamera)) {
+    return TRUE;
+  }
+
+  g_mutex_lock(&pylonsrc->frameRateLock);
+  if(PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, "ResultingFrameRate")) {
+    res = PylonDeviceGetFloatFeature(pylonsrc->deviceHandle, "ResultingFrameRate", &pylonsrc->frameRate);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+  GST_INFO_OBJECT(pylonsrc, "The bandwidth planner changed the camera's throughput limit, it now runs at %.2lf fps.", pylonsrc->frameRate);
+
+  // A framerate downstream picked that the camera no longer reaches can't be kept
+  if(pylonsrc->minFrameRate > 0.0 && (pylonsrc->capsFrameRate == 0.0 || pylonsrc->frameRate < pylonsrc->capsFrameRate)) {
+    pylonsrc->maxFrameRate = MAX(pylonsrc->frameRate, pylonsrc->minFrameRate);
+    pylonsrc->capsFrameRate = 0.0;
+  }
+  g_mutex_unlock(&pylonsrc->frameRateLock);
+
+  gst_element_post_message(GST_ELEMENT(pylonsrc), gst_message_new_latency(GST_OBJECT(pylonsrc)));
+  gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(pylonsrc));
+  return TRUE;
+
+error:
+  g_mutex_unlock(&pylonsrc->frameRateLock);
+  return FALSE;
+}
+
 static GstFlowReturn gst_pylonsrc_create (GstPushSrc *src, GstBuffer **buf)
 {  
   GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
@@ -2089,23 +3806,57 @@ static GstFlowReturn gst_pylonsrc_create (GstPushSrc *src, GstBuffer **buf)
   PylonGrabResult_t grabResult;
   _Bool bufferReady;  
   GstMapInfo mapInfo;
+  GstClock *clock;
+  GstClockTime grabTime = GST_CLOCK_TIME_NONE, exposureStart = GST_CLOCK_TIME_NONE;
+  GstPylonMeta *meta;
+  GstPylonMetaChunks chunks = 0;
+  double chunkExposureTime = 0.0, chunkGain = 0.0;
+  int64_t chunkLineStatus = 0, chunkCounter = 0;
+  size_t i;
+  guint queueDepth = 0;
+
+next:
+  if(pylonsrc->grabEngine) {
+    // The grab engine has already retrieved the frame, wait for it to show up (up to 1 s)
+    if(!gst_pylon_grab_ring_pop(&pylonsrc->grabRing, &grabResult, 1000, &queueDepth)) {
+      GST_MESSAGE_OBJECT(pylonsrc, "Camera couldn't prepare the buffer in time. Probably dead.");
+      goto error;
+    }
+  } else {
+    // Wait for the buffer to be filled  (up to 1 s)  
+    if(pylonsrc->grabRing.count == 0) {
+      res = PylonWaitObjectWait(pylonsrc->waitObject, 1000, &bufferReady);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+      if(!bufferReady) {
+        GST_MESSAGE_OBJECT(pylonsrc, "Camera couldn't prepare the buffer in time. Probably dead.");    
+        goto error;
+      }
+    }
 
-  // Wait for the buffer to be filled  (up to 1 s)  
-  res = PylonWaitObjectWait(pylonsrc->waitObject, 1000, &bufferReady);
-  PYLONC_CHECK_ERROR(pylonsrc, res);
-  if(!bufferReady) {
-    GST_MESSAGE_OBJECT(pylonsrc, "Camera couldn't prepare the buffer in time. Probably dead.");    
-    goto error;
+    // Take all of the finished frames, the ones that aren't processed right away show how far behind the camera we are
+    gst_pylon_grab_ring_retrieve(&pylonsrc->grabRing);
+    if(!gst_pylon_grab_ring_pop(&pylonsrc->grabRing, &grabResult, 0, &queueDepth)) {
+      GST_MESSAGE_OBJECT(pylonsrc, "Couldn't get a buffer from the camera. Basler said this should be impossible. You just proved them wrong. Congratulations!");    
+      goto error;
+    }
   }
+  gst_pylonsrc_monitor_buffers(pylonsrc, queueDepth + 1, grabResult.BlockID);
 
-  res = PylonStreamGrabberRetrieveResult (pylonsrc->streamGrabber, &grabResult, &bufferReady);
-  PYLONC_CHECK_ERROR(pylonsrc, res);
-  if(!bufferReady) {
-    GST_MESSAGE_OBJECT(pylonsrc, "Couldn't get a buffer from the camera. Basler said this should be impossible. You just proved them wrong. Congratulations!");    
+  // Other cameras on the controller may have changed how much bandwidth this one gets
+  if(!gst_pylonsrc_apply_bandwidth(pylonsrc)) {
+    gst_pylon_grab_ring_queue(&pylonsrc->grabRing, grabResult.hBuffer, grabResult.Context);
     goto error;
   }
 
-  if(!pylonsrc->continuousMode) {
+  // Note when the frame arrived, and when its exposure started
+  clock = gst_element_get_clock(GST_ELEMENT(pylonsrc));
+  if(clock) {
+    grabTime = gst_clock_get_time(clock);
+    exposureStart = gst_pylonsrc_exposure_start(pylonsrc, grabResult.TimeStamp, grabTime);
+    gst_object_unref(clock);
+  }
+
+  if(pylonsrc->softwareTrigger) {
       // Trigger the next picture while we process this one
       if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "AcquisitionStatus")) {
       _Bool isReady = FALSE;
@@ -2118,25 +3869,138 @@ static GstFlowReturn gst_pylonsrc_create (GstPushSrc *src, GstBuffer **buf)
     PYLONC_CHECK_ERROR(pylonsrc, res);
   }
 
+  // Frames downstream has no time for are given back to the camera before they're copied
+  if(grabResult.Status == Grabbed && !gst_pylonsrc_qos_keep_frame(pylonsrc)) {
+    res = gst_pylon_grab_ring_queue(&pylonsrc->grabRing, grabResult.hBuffer, grabResult.Context);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+    goto next;
+  }
+
   // Process the current buffer
   bufferIndex = (size_t) grabResult.Context;
   if(grabResult.Status == Grabbed) {        
-    //TODO: See if I can avoid memcopy and record directly into the gst buffer map.
+    // Read the values the camera used for this frame from the chunk data appended to it. These come with the frame, so it costs no extra requests to the camera.
+    if(pylonsrc->chunkParser && grabResult.PayloadType == PayloadType_ChunkData) {
+      res = PylonChunkParserAttachBuffer(pylonsrc->chunkParser, grabResult.pBuffer, (size_t) grabResult.PayloadSize);
+      if(res == GENAPI_E_OK) {
+        for(i = 0; i < NUM_CHUNKS && res == GENAPI_E_OK; i++) {
+          _Bool readable = FALSE;
+
+          if(!(pylonsrc->chunks & (1 << i))) {
+            continue;
+          }
+          res = GenApiNodeIsReadable(pylonsrc->chunkNodes[i], &readable);
+          if(res != GENAPI_E_OK || !readable) {
+            continue;
+          }
 
-    // Copy the image into the buffer that will be passed onto the next GStreamer element
-    *buf = gst_buffer_new_and_alloc(pylonsrc->payloadSize);
-    gst_buffer_map(*buf, &mapInfo, GST_MAP_WRITE);
-    orc_memcpy(mapInfo.data, grabResult.pBuffer, mapInfo.size);
-    gst_buffer_unmap(*buf, &mapInfo);        
+          switch(pylonChunks[i].field) {
+            case GST_PYLON_META_EXPOSURETIME:
+              res = GenApiFloatGetValue(pylonsrc->chunkNodes[i], &chunkExposureTime);
+              break;
+            case GST_PYLON_META_GAIN:
+              res = GenApiFloatGetValue(pylonsrc->chunkNodes[i], &chunkGain);
+              break;
+            case GST_PYLON_META_LINESTATUS:
+              res = GenApiIntegerGetValue(pylonsrc->chunkNodes[i], &chunkLineStatus);
+              break;
+            case GST_PYLON_META_CHUNKCOUNTER:
+              res = GenApiIntegerGetValue(pylonsrc->chunkNodes[i], &chunkCounter);
+              break;
+          }
+          if(res == GENAPI_E_OK) {
+            chunks |= pylonChunks[i].field;
+          }
+        }
 
-    // Release frame's memory
-    res = PylonStreamGrabberQueueBuffer( pylonsrc->streamGrabber, grabResult.hBuffer, (void*) bufferIndex );
-    PYLONC_CHECK_ERROR(pylonsrc, res);
+        // The parser has to be empty for the next frame whether or not the values could be read
+        if(res == GENAPI_E_OK) {
+          res = PylonChunkParserDetachBuffer(pylonsrc->chunkParser);
+        } else {
+          PylonChunkParserDetachBuffer(pylonsrc->chunkParser);
+        }
+      }
+      if(res != GENAPI_E_OK) {
+        // Give the frame back to the camera, nothing else will
+        gst_pylon_grab_ring_queue(&pylonsrc->grabRing, grabResult.hBuffer, grabResult.Context);
+        PYLONC_CHECK_ERROR(pylonsrc, res);
+      }
+    }
+
+#ifdef HAVE_GST_FDMEMORY
+    if(pylonsrc->fdAllocator && pylonsrc->buffers[bufferIndex].fd >= 0) {
+      // Push the image (without any chunk data) in the grab buffer itself, it's queued again once the memory is freed downstream
+      GstPylonsrcFrame *frame;
+      GstMemory *memory;
+      gint fd = dup(pylonsrc->buffers[bufferIndex].fd);
+
+      if(fd < 0) {
+        GST_ERROR_OBJECT(pylonsrc, "Couldn't duplicate the grab buffer's memfd: %s", g_strerror(errno));
+        goto error;
+      }
+      memory = gst_fd_allocator_alloc(pylonsrc->fdAllocator, fd, pylonsrc->frameSize, GST_FD_MEMORY_FLAG_NONE);
+
+      frame = g_slice_new(GstPylonsrcFrame);
+      frame->pylonsrc = gst_object_ref(pylonsrc);
+      frame->handle = grabResult.hBuffer;
+      frame->index = bufferIndex;
+      frame->generation = pylonsrc->fdGeneration;
+      gst_mini_object_set_qdata(GST_MINI_OBJECT(memory), gst_pylonsrc_frame_quark, frame, gst_pylonsrc_release_frame);
+
+      *buf = gst_buffer_new();
+      gst_buffer_append_memory(*buf, memory);
+    } else
+#endif
+    if(pylonsrc->outputStride > 0 && pylonsrc->videoMetaDownstream) {
+      // Copy the image row by row, padding the rows to stridealign
+      GstAllocationParams params;
+      gsize rowSize = pylonsrc->frameSize / pylonsrc->height, offsets[GST_VIDEO_MAX_PLANES] = { 0 };
+      gint strides[GST_VIDEO_MAX_PLANES] = { (gint) pylonsrc->outputStride };
+      const guint8 *row = grabResult.pBuffer;
+
+      gst_allocation_params_init(&params);
+      params.align = pylonsrc->strideAlign - 1;
+      *buf = gst_buffer_new_allocate(NULL, pylonsrc->outputStride * pylonsrc->height, &params);
+      gst_buffer_map(*buf, &mapInfo, GST_MAP_WRITE);
+      for(i = 0; i < (size_t) pylonsrc->height; i++) {
+        orc_memcpy(mapInfo.data + i * pylonsrc->outputStride, row + i * rowSize, rowSize);
+      }
+      gst_buffer_unmap(*buf, &mapInfo);
+      gst_buffer_add_video_meta_full(*buf, GST_VIDEO_FRAME_FLAG_NONE, gst_pylonsrc_video_format(pylonsrc), pylonsrc->width, pylonsrc->height, 1, offsets, strides);
+
+      // Release frame's memory
+      res = gst_pylon_grab_ring_queue(&pylonsrc->grabRing, grabResult.hBuffer, (void*) bufferIndex);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+    } else {
+      // Copy the image (without any chunk data) into the buffer that will be passed onto the next GStreamer element
+      *buf = gst_buffer_new_and_alloc(pylonsrc->frameSize);
+      gst_buffer_map(*buf, &mapInfo, GST_MAP_WRITE);
+      orc_memcpy(mapInfo.data, grabResult.pBuffer, mapInfo.size);
+      gst_buffer_unmap(*buf, &mapInfo);        
+
+      // Release frame's memory
+      res = gst_pylon_grab_ring_queue(&pylonsrc->grabRing, grabResult.hBuffer, (void*) bufferIndex);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+    }
   } else {
     GST_ERROR_OBJECT(pylonsrc, "Error in the image processing loop.");    
     goto error;
   }
 
+  // Attach the capture information, which lets elements down the pipeline measure latency
+  meta = gst_buffer_add_pylon_meta(*buf, grabResult.BlockID, grabResult.TimeStamp, exposureStart, grabTime);
+  meta->chunks = chunks;
+  meta->exposuretime = chunkExposureTime;
+  meta->gain = chunkGain;
+  meta->linestatus = (guint64) chunkLineStatus;
+  meta->chunkcounter = (guint64) chunkCounter;
+
+  // Stamp the frame with the time its exposure started, which the reported latency is counted from. Raw video is never decoded out of order, so the DTS is the same - the base class would otherwise set it to the later time the frame arrived at. Without an exposure start the base class stamps both with the arrival time.
+  if(GST_CLOCK_TIME_IS_VALID(exposureStart) && exposureStart >= gst_element_get_base_time(GST_ELEMENT(pylonsrc))) {
+    GST_BUFFER_PTS(*buf) = exposureStart - gst_element_get_base_time(GST_ELEMENT(pylonsrc));
+    GST_BUFFER_DTS(*buf) = GST_BUFFER_PTS(*buf);
+  }
+
   // Set frame offset
   GST_BUFFER_OFFSET(*buf) = pylonsrc->frameNumber;
   pylonsrc->frameNumber += 1;
@@ -2147,13 +4011,42 @@ error:
   return GST_FLOW_ERROR;
 }
 
+#ifdef HAVE_GST_FDMEMORY
+/* Queues a pushed frame's grab buffer to the camera again, unless the stream grabber it belonged to is gone. While the camera is halted the buffer is left for pylonc_resume_camera to queue. */
+static void
+gst_pylonsrc_release_frame (gpointer data)
+{
+  GstPylonsrcFrame *frame = (GstPylonsrcFrame *) data;
+  GstPylonsrc *pylonsrc = frame->pylonsrc;
+
+  g_mutex_lock(&pylonsrc->fdLock);
+  if(frame->generation == pylonsrc->fdGeneration) {
+    if(pylonsrc->fdHalted) {
+      pylonsrc->bufferIdle[frame->index] = TRUE;
+    } else if(gst_pylon_grab_ring_queue(&pylonsrc->grabRing, frame->handle, (void*) frame->index) != GENAPI_E_OK) {
+      GST_WARNING_OBJECT(pylonsrc, "Couldn't give grab buffer %zu back to the camera.", frame->index);
+    }
+  }
+  g_mutex_unlock(&pylonsrc->fdLock);
+
+  gst_object_unref(pylonsrc);
+  g_slice_free(GstPylonsrcFrame, frame);
+}
+#endif
+
 static gboolean
 gst_pylonsrc_stop (GstBaseSrc * src) 
 {
   GstPylonsrc *pylonsrc = GST_PYLONSRC (src);
   GST_DEBUG_OBJECT (pylonsrc, "stop");
 
-  pylonc_disconnect_camera(pylonsrc);
+  if(pylonsrc->warm && pylonsrc->deviceConnected && pylonsrc->grabPrepared) {
+    pylonc_halt_camera(pylonsrc);
+    GST_DEBUG_OBJECT(pylonsrc, "Keeping the camera warm.");
+  } else {
+    pylonc_disconnect_camera(pylonsrc);
+  }
+  pylonsrc->clockLatch = NULL;
 
   return TRUE;
 }
@@ -2172,6 +4065,24 @@ gst_pylonsrc_finalize (GObject * object)
   GstPylonsrc *pylonsrc = GST_PYLONSRC (object);
   GST_DEBUG_OBJECT (pylonsrc, "finalize");
 
+  // A camera kept warm is still open
+  pylonc_disconnect_camera(pylonsrc);
+  pylonc_free_buffers(pylonsrc);
+  if(pylonsrc->fdAllocator) {
+    gst_object_unref(pylonsrc->fdAllocator);
+  }
+  g_mutex_clear(&pylonsrc->fdLock);
+  g_mutex_clear(&pylonsrc->clockLock);
+  g_mutex_clear(&pylonsrc->frameRateLock);
+  g_cond_clear(&pylonsrc->clockCond);
+  if(pylonsrc->startupFeatures) {
+    g_hash_table_destroy(pylonsrc->startupFeatures);
+  }
+  if(pylonsrc->cameraClock) {
+    gst_object_unref(pylonsrc->cameraClock);
+  }
+  g_free(pylonsrc->rois);
+
   pylonc_terminate();
 
   G_OBJECT_CLASS (gst_pylonsrc_parent_class)->finalize (object);
@@ -2189,18 +4100,194 @@ void  pylonc_terminate() {
 void
 pylonc_disconnect_camera(GstPylonsrc* pylonsrc)
 {
-  if (deviceConnected) {
+  guint i;
+
+  if (pylonsrc->deviceConnected) {
+    // Frames still held downstream mustn't be queued to the stream grabber once it's gone
+    g_mutex_lock(&pylonsrc->fdLock);
+    pylonsrc->fdGeneration++;
+    g_mutex_unlock(&pylonsrc->fdLock);
+
+    // Stop the camera and take all of the buffers back, so that they can be deregistered
+    pylonc_halt_camera(pylonsrc);
+    if(pylonsrc->grabRing.results) {
+      gst_pylon_grab_ring_clear(&pylonsrc->grabRing);
+    }
+    for(i = 0; i < pylonsrc->numRegistered; i++) {
+      PylonStreamGrabberDeregisterBuffer(pylonsrc->streamGrabber, pylonsrc->bufferHandle[i]);
+    }
+    pylonsrc->numRegistered = 0;
+    if(pylonsrc->grabPrepared) {
+      PylonStreamGrabberFinishGrab(pylonsrc->streamGrabber);
+      pylonsrc->grabPrepared = FALSE;
+    }
+    if(pylonsrc->streamGrabberOpen) {
+      PylonStreamGrabberClose(pylonsrc->streamGrabber);
+      pylonsrc->streamGrabberOpen = FALSE;
+    }
+    pylonc_free_buffers(pylonsrc);
+
+    // Give the camera's bandwidth back to the other cameras on its USB controller
+    if(pylonsrc->bandwidthPlanned) {
+      gst_pylon_bandwidth_remove(&pylonsrc->bandwidthCamera);
+      pylonsrc->bandwidthPlanned = FALSE;
+    }
+    g_free(pylonsrc->bandwidthCamera.serial);
+    g_free(pylonsrc->bandwidthCamera.controller);
+    pylonsrc->bandwidthCamera.serial = NULL;
+    pylonsrc->bandwidthCamera.controller = NULL;
+
+    if(pylonsrc->chunkParser) {
+      PylonDeviceDestroyChunkParser(pylonsrc->deviceHandle, pylonsrc->chunkParser);
+      pylonsrc->chunkParser = NULL;
+    }
+
     if(strcmp(pylonsrc->reset, "after") == 0) {
       pylonc_reset_camera(pylonsrc);
     }
 
     PylonDeviceClose(pylonsrc->deviceHandle);
     PylonDestroyDevice(pylonsrc->deviceHandle);
-    deviceConnected = FALSE;
+    pylonsrc->deviceConnected = FALSE;
     GST_DEBUG_OBJECT(pylonsrc, "Camera disconnected.");
   }
 }
 
+/* Marks a buffer given back by the stream grabber as one to queue again */
+static void
+pylonc_buffer_returned(GstPylonsrc* pylonsrc, const PylonGrabResult_t* result)
+{
+  size_t index = (size_t) result->Context;
+
+  if(pylonsrc->bufferIdle && index < pylonsrc->numBuffers) {
+    pylonsrc->bufferIdle[index] = TRUE;
+  }
+}
+
+/* Stops the acquisition and takes back every buffer the stream grabber still has. The stream grabber stays prepared and the buffers registered. */
+void
+pylonc_halt_camera(GstPylonsrc* pylonsrc)
+{
+  PylonGrabResult_t result;
+  _Bool ready;
+
+  // Frames released downstream from now on leave their buffers idle rather than queueing them to the halted stream grabber
+  g_mutex_lock(&pylonsrc->fdLock);
+  pylonsrc->fdHalted = TRUE;
+  g_mutex_unlock(&pylonsrc->fdLock);
+
+  // The clock thread reads the camera's counter until it's told to stop
+  if(pylonsrc->clockThread) {
+    g_mutex_lock(&pylonsrc->clockLock);
+    pylonsrc->clockQuit = TRUE;
+    g_cond_signal(&pylonsrc->clockCond);
+    g_mutex_unlock(&pylonsrc->clockLock);
+    g_thread_join(pylonsrc->clockThread);
+    pylonsrc->clockThread = NULL;
+  }
+
+  if(pylonsrc->acquiring) {
+    PylonDeviceExecuteCommandFeature(pylonsrc->deviceHandle, "AcquisitionStop");
+    pylonsrc->acquiring = FALSE;
+  }
+
+  // Stop the grab engine from touching the stream grabber
+  if(pylonsrc->grabEngine) {
+    gst_pylon_grab_engine_remove(&pylonsrc->grabRing);
+    pylonsrc->grabEngine = FALSE;
+  }
+
+  if(!pylonsrc->grabPrepared) {
+    return;
+  }
+  if(pylonsrc->grabRing.results) {
+    // Frames that were released downstream queue their buffers through the ring
+    g_mutex_lock(&pylonsrc->grabRing.lock);
+    PylonStreamGrabberCancelGrab(pylonsrc->streamGrabber);
+    g_mutex_unlock(&pylonsrc->grabRing.lock);
+    do {
+      while(gst_pylon_grab_ring_pop(&pylonsrc->grabRing, &result, 0, NULL)) {
+        pylonc_buffer_returned(pylonsrc, &result);
+      }
+    } while(gst_pylon_grab_ring_retrieve(&pylonsrc->grabRing) > 0);
+  } else {
+    PylonStreamGrabberCancelGrab(pylonsrc->streamGrabber);
+    while(PylonStreamGrabberRetrieveResult(pylonsrc->streamGrabber, &result, &ready) == GENAPI_E_OK && ready) {
+      pylonc_buffer_returned(pylonsrc, &result);
+    }
+  }
+}
+
+/* Starts a camera that was halted with everything in place again */
+_Bool
+pylonc_resume_camera(GstPylonsrc* pylonsrc)
+{
+  GENAPIC_RESULT res;
+  size_t i;
+
+  if(!pylonsrc->grabPrepared || !pylonsrc->grabRing.results) {
+    return FALSE;
+  }
+
+  gst_pylonsrc_restart_monitoring(pylonsrc);
+  // Frames still held downstream queue their buffers themselves once the camera is no longer halted
+  res = GENAPI_E_OK;
+  g_mutex_lock(&pylonsrc->fdLock);
+  for(i = 0; i < pylonsrc->numBuffers && res == GENAPI_E_OK; i++) {
+    if(pylonsrc->bufferIdle[i]) {
+      res = gst_pylon_grab_ring_queue(&pylonsrc->grabRing, pylonsrc->bufferHandle[i], (void *) i);
+      pylonsrc->bufferIdle[i] = res != GENAPI_E_OK;
+    }
+  }
+  pylonsrc->fdHalted = res != GENAPI_E_OK;
+  g_mutex_unlock(&pylonsrc->fdLock);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+
+  if(pylonsrc->grabThreads > 0) {
+    pylonsrc->grabEngine = TRUE;
+    if(!gst_pylon_grab_engine_add(&pylonsrc->grabRing, pylonsrc->grabThreads)) {
+      GST_ERROR_OBJECT(pylonsrc, "Couldn't add the camera to the grab engine.");
+      pylonsrc->grabEngine = FALSE;
+      goto error;
+    }
+  }
+
+  return pylonc_start_acquisition(pylonsrc);
+
+  error:
+  return FALSE;
+}
+
+/* Tells the camera to start recording */
+_Bool
+pylonc_start_acquisition(GstPylonsrc* pylonsrc)
+{
+  GENAPIC_RESULT res;
+
+  res = PylonDeviceExecuteCommandFeature(pylonsrc->deviceHandle, "AcquisitionStart");
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  pylonsrc->acquiring = TRUE;
+
+  // The pipeline picks its clock on the way to PLAYING, the camera's clock has to tell the camera's time by then. The frames' exposure start is read from it as well, without cameraclock it's estimated from captureDelay instead, which costs neither the calibration nor the clock thread.
+  pylonsrc->clockLatch = NULL;
+  if(pylonsrc->cameraClock && GST_OBJECT_FLAG_IS_SET(pylonsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK)) {
+    pylonc_calibrate_camera_clock(pylonsrc);
+    if(pylonsrc->clockLatch && !pylonsrc->clockThread) {
+      pylonsrc->clockQuit = FALSE;
+      pylonsrc->clockThread = g_thread_new("pylonclock", gst_pylonsrc_clock_thread, pylonsrc);
+    }
+  }
+  if(pylonsrc->softwareTrigger) {
+    res = PylonDeviceExecuteCommandFeature(pylonsrc->deviceHandle, "TriggerSoftware"); 
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+  pylonsrc->frameNumber = 0;
+  return TRUE;
+
+  error:
+  return FALSE;
+}
+
 _Bool
 pylonc_reset_camera(GstPylonsrc* pylonsrc)
 {
@@ -2217,6 +4304,163 @@ pylonc_reset_camera(GstPylonsrc* pylonsrc)
   return FALSE;
 }
 
+/* Frees the grab buffers. They must not be registered with a stream grabber anymore. */
+void
+pylonc_free_buffers(GstPylonsrc* pylonsrc)
+{
+  guint i;
+
+  for(i = 0; i < pylonsrc->numAllocated; i++) {
+    gst_pylon_grab_memory_free(&pylonsrc->buffers[i]);
+  }
+  pylonsrc->numAllocated = 0;
+  g_free(pylonsrc->buffers);
+  g_free(pylonsrc->bufferHandle);
+  g_free(pylonsrc->bufferIdle);
+  pylonsrc->buffers = NULL;
+  pylonsrc->bufferHandle = NULL;
+  pylonsrc->bufferIdle = NULL;
+}
+
+/* Adds the camera to the bandwidth plan of its USB controller, which may lower the camera's throughput limit. throughput and the framerate are updated to what the camera gets. Returns FALSE if the camera can't get the bandwidth it needs and bandwidthplanner is "fail". */
+_Bool
+pylonc_plan_bandwidth(GstPylonsrc* pylonsrc, int64_t* throughput, int64_t linkSpeed)
+{
+  GstPylonBandwidthCamera *camera = &pylonsrc->bandwidthCamera;
+  GENAPIC_RESULT res;
+  char serial[256];
+  size_t siz = sizeof(serial);
+  gchar *report = NULL;
+
+  if(strcmp(pylonsrc->bandwidthplanner, "limit") != 0 && strcmp(pylonsrc->bandwidthplanner, "fail") != 0) {
+    if(strcmp(pylonsrc->bandwidthplanner, "off") != 0) {
+      GST_WARNING_OBJECT(pylonsrc, "Unknown bandwidth planner mode \"%s\", not planning the bandwidth.", pylonsrc->bandwidthplanner);
+    }
+    return TRUE;
+  }
+  if(!pylonc_timed_is_writable(pylonsrc, "DeviceLinkThroughputLimit") || !pylonc_timed_is_readable(pylonsrc, "DeviceSerialNumber")) {
+    GST_WARNING_OBJECT(pylonsrc, "The camera's throughput can't be limited, leaving it out of the bandwidth plan.");
+    return TRUE;
+  }
+  res = pylonc_timed_to_string(pylonsrc, "DeviceSerialNumber", serial, &siz);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+
+  memset(camera, 0, sizeof(*camera));
+  camera->owner = GST_OBJECT(pylonsrc);
+  camera->deviceHandle = pylonsrc->deviceHandle;
+  camera->serial = g_strdup(serial);
+  camera->controller = gst_pylon_usb_controller(serial);
+  camera->need = *throughput;
+  camera->payload = pylonsrc->payloadSize;
+  camera->linkSpeed = linkSpeed;
+  camera->budget = pylonsrc->controllerBandwidth;
+  if(!camera->controller) {
+    GST_WARNING_OBJECT(pylonsrc, "Couldn't find out which USB controller camera %s is attached to, leaving it out of the bandwidth plan.", serial);
+    return TRUE;
+  }
+
+  if(!gst_pylon_bandwidth_add(camera, strcmp(pylonsrc->bandwidthplanner, "fail") == 0, &report)) {
+    GST_ERROR_OBJECT(pylonsrc, "Not enough bandwidth on the USB controller. %s", report);
+    GST_ELEMENT_ERROR(pylonsrc, RESOURCE, FAILED, ("USB3 error"), ("Not enough bandwidth on the USB controller. %s", report));
+    g_free(report);
+    return FALSE;
+  }
+  pylonsrc->bandwidthPlanned = TRUE;
+
+  if(report) {
+    GST_WARNING_OBJECT(pylonsrc, "Not enough bandwidth on the USB controller, the cameras were limited. %s", report);
+    g_free(report);
+
+    res = pylonc_timed_get_integer(pylonsrc, "DeviceLinkCurrentThroughput", throughput);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+    if(pylonc_timed_is_readable(pylonsrc, "ResultingFrameRate")) {
+      res = pylonc_timed_get_float(pylonsrc, "ResultingFrameRate", &pylonsrc->frameRate);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+    }
+  }
+  return TRUE;
+
+error:
+  return FALSE;
+}
+
+/* Limits the camera to fps frames per second, or lets it run as fast as it can if fps is 0. frameRate is updated to the rate the camera gets. */
+_Bool
+pylonc_set_frame_rate(GstPylonsrc* pylonsrc, double fps)
+{
+  GENAPIC_RESULT res;
+
+  res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, "AcquisitionFrameRateEnable", fps > 0.0);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  if(fps > 0.0) {
+    res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, "AcquisitionFrameRate", fps);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+
+  if(PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, "ResultingFrameRate")) {
+    res = PylonDeviceGetFloatFeature(pylonsrc->deviceHandle, "ResultingFrameRate", &pylonsrc->frameRate);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+  }
+  return TRUE;
+
+error:
+  return FALSE;
+}
+
+/* Sets an integer parameter of the stream grabber, rounded into the range the driver allows. A value of 0 keeps the driver's default. Returns the value in effect, or -1 if the stream grabber doesn't have the parameter. */
+int64_t
+pylonc_set_stream_parameter(GstPylonsrc* pylonsrc, NODEMAP_HANDLE nodeMap, const char* name, int64_t value)
+{
+  GENAPIC_RESULT res;
+  NODE_HANDLE node;
+  _Bool writable = FALSE;
+  int64_t min, max, inc, rounded, effective = -1;
+
+  res = GenApiNodeMapGetNode(nodeMap, name, &node);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  if(node == GENAPIC_INVALID_HANDLE) {
+    if(value > 0) {
+      GST_WARNING_OBJECT(pylonsrc, "This camera's stream grabber has no %s parameter, ignoring it.", name);
+    }
+    return -1;
+  }
+
+  if(value > 0) {
+    res = GenApiNodeIsWritable(node, &writable);
+    PYLONC_CHECK_ERROR(pylonsrc, res);
+    if(writable) {
+      res = GenApiIntegerGetMin(node, &min);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+      res = GenApiIntegerGetMax(node, &max);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+      res = GenApiIntegerGetInc(node, &inc);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+
+      // Round up to the next step, unless that's past the maximum
+      rounded = CLAMP(value, min, max);
+      rounded = min + (rounded - min + inc - 1) / inc * inc;
+      if(rounded > max) {
+        rounded -= inc;
+      }
+      if(rounded != value) {
+        GST_WARNING_OBJECT(pylonsrc, "%s can't be %"PRId64" (%"PRId64"-%"PRId64" in steps of %"PRId64"), using %"PRId64" instead.", name, value, min, max, inc, rounded);
+      }
+
+      res = GenApiIntegerSetValue(node, rounded);
+      PYLONC_CHECK_ERROR(pylonsrc, res);
+    } else {
+      GST_WARNING_OBJECT(pylonsrc, "%s can't be changed, ignoring it.", name);
+    }
+  }
+
+  res = GenApiIntegerGetValue(node, &effective);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  return effective;
+
+  error:
+  return -1;
+}
+
 _Bool
 pylonc_connect_camera(GstPylonsrc* pylonsrc)
 {
@@ -2229,7 +4473,7 @@ pylonc_connect_camera(GstPylonsrc* pylonsrc)
   res = PylonDeviceOpen(pylonsrc->deviceHandle, PYLONC_ACCESS_MODE_CONTROL | PYLONC_ACCESS_MODE_STREAM);
   PYLONC_CHECK_ERROR(pylonsrc, res);
 
-  deviceConnected = TRUE;
+  pylonsrc->deviceConnected = TRUE;
   return TRUE;
 
   error:
@@ -2274,6 +4518,273 @@ pylonc_print_camera_info(GstPylonsrc* pylonsrc, PYLON_DEVICE_HANDLE deviceHandle
   }
 }
 
+/* Reads the camera's timestamp counter (in nanoseconds) along with the camera clock's internal time, taken halfway through the request */
+_Bool
+pylonc_sample_camera_clock(GstPylonsrc* pylonsrc, GstClockTime* host, GstClockTime* camera, GstClockTime* roundTrip)
+{
+  GENAPIC_RESULT res;
+  GstClockTime before, after;
+  int64_t ticks;
+
+  before = gst_clock_get_internal_time(pylonsrc->cameraClock);
+  res = PylonDeviceExecuteCommandFeature(pylonsrc->deviceHandle, pylonsrc->clockLatch);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+  after = gst_clock_get_internal_time(pylonsrc->cameraClock);
+  res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, pylonsrc->clockValue, &ticks);
+  PYLONC_CHECK_ERROR(pylonsrc, res);
+
+  *host = before + (after - before) / 2;
+  *camera = gst_util_uint64_scale((guint64) ticks, GST_SECOND, (guint64) pylonsrc->timestampFrequency);
+  *roundTrip = after - before;
+  return TRUE;
+
+  error:
+  return FALSE;
+}
+
+/* Sets the camera clock to the camera's time, using the quickest of a few samples */
+void
+pylonc_calibrate_camera_clock(GstPylonsrc* pylonsrc)
+{
+  GstClockTime host, camera, roundTrip, bestHost = 0, bestCamera = 0, bestRoundTrip = GST_CLOCK_TIME_NONE;
+  guint i;
+
+  // USB3 Vision cameras count in nanoseconds, GigE cameras say how fast they count
+  pylonsrc->clockLatch = NULL;
+  pylonsrc->clockValue = NULL;
+  pylonsrc->timestampFrequency = 1000000000;
+  if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "TimestampLatch") && PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, "TimestampLatchValue")) {
+    pylonsrc->clockLatch = "TimestampLatch";
+    pylonsrc->clockValue = "TimestampLatchValue";
+  } else if(PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, "GevTimestampControlLatch") && PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, "GevTimestampValue")) {
+    pylonsrc->clockLatch = "GevTimestampControlLatch";
+    pylonsrc->clockValue = "GevTimestampValue";
+    if(PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, "GevTimestampTickFrequency")) {
+      PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, "GevTimestampTickFrequency", &pylonsrc->timestampFrequency);
+    }
+  }
+  if(!pylonsrc->clockLatch || pylonsrc->timestampFrequency <= 0) {
+    pylonsrc->clockLatch = NULL;
+    GST_WARNING_OBJECT(pylonsrc, "This camera can't latch its timestamp counter, the camera clock will run at the host's rate.");
+    return;
+  }
+
+  for(i = 0; i < 8; i++) {
+    if(pylonc_sample_camera_clock(pylonsrc, &host, &camera, &roundTrip) && roundTrip < bestRoundTrip) {
+      bestHost = host;
+      bestCamera = camera;
+      bestRoundTrip = roundTrip;
+    }
+  }
+  if(!GST_CLOCK_TIME_IS_VALID(bestRoundTrip)) {
+    pylonsrc->clockLatch = NULL;
+    GST_WARNING_OBJECT(pylonsrc, "Couldn't read the camera's timestamp counter, the camera clock will run at the host's rate.");
+    return;
+  }
+
+  gst_clock_set_calibration(pylonsrc->cameraClock, bestHost, bestCamera, 1, 1);
+  GST_DEBUG_OBJECT(pylonsrc, "The camera clock reads %" GST_TIME_FORMAT " (measured within %" GST_TIME_FORMAT ").", GST_TIME_ARGS(bestCamera), GST_TIME_ARGS(bestRoundTrip));
+}
+
+/* Feature accessors for start(), which add the time each feature takes to the startup report */
+GENAPIC_RESULT
+pylonc_timed_set_integer(GstPylonsrc* pylonsrc, const char* feature, int64_t value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceSetIntegerFeature(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_get_integer(GstPylonsrc* pylonsrc, const char* feature, int64_t* value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceGetIntegerFeature(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_get_integer_int32(GstPylonsrc* pylonsrc, const char* feature, int32_t* value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceGetIntegerFeatureInt32(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_set_float(GstPylonsrc* pylonsrc, const char* feature, double value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceSetFloatFeature(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_get_float(GstPylonsrc* pylonsrc, const char* feature, double* value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceGetFloatFeature(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_get_float_min(GstPylonsrc* pylonsrc, const char* feature, double* value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceGetFloatFeatureMin(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_get_float_max(GstPylonsrc* pylonsrc, const char* feature, double* value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceGetFloatFeatureMax(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_set_boolean(GstPylonsrc* pylonsrc, const char* feature, _Bool value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceSetBooleanFeature(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_from_string(GstPylonsrc* pylonsrc, const char* feature, const char* value)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceFeatureFromString(pylonsrc->deviceHandle, feature, value);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+pylonc_timed_to_string(GstPylonsrc* pylonsrc, const char* feature, char* value, size_t* length)
+{
+  gint64 begin = g_get_monotonic_time();
+  GENAPIC_RESULT res = PylonDeviceFeatureToString(pylonsrc->deviceHandle, feature, value, length);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return res;
+}
+
+_Bool
+pylonc_timed_is_available(GstPylonsrc* pylonsrc, const char* feature)
+{
+  gint64 begin = g_get_monotonic_time();
+  _Bool result = PylonDeviceFeatureIsAvailable(pylonsrc->deviceHandle, feature);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return result;
+}
+
+_Bool
+pylonc_timed_is_implemented(GstPylonsrc* pylonsrc, const char* feature)
+{
+  gint64 begin = g_get_monotonic_time();
+  _Bool result = PylonDeviceFeatureIsImplemented(pylonsrc->deviceHandle, feature);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return result;
+}
+
+_Bool
+pylonc_timed_is_readable(GstPylonsrc* pylonsrc, const char* feature)
+{
+  gint64 begin = g_get_monotonic_time();
+  _Bool result = PylonDeviceFeatureIsReadable(pylonsrc->deviceHandle, feature);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return result;
+}
+
+_Bool
+pylonc_timed_is_writable(GstPylonsrc* pylonsrc, const char* feature)
+{
+  gint64 begin = g_get_monotonic_time();
+  _Bool result = PylonDeviceFeatureIsWritable(pylonsrc->deviceHandle, feature);
+
+  if(pylonsrc->startupFeatures) {
+    gst_pylonsrc_profile_feature(pylonsrc, feature, begin);
+  }
+  return result;
+}
+
+/* Keeps the camera clock in step with the camera while it acquires. Latching the counter is a round trip to the camera, so it's done here rather than in the streaming thread. */
+static gpointer
+gst_pylonsrc_clock_thread (gpointer data)
+{
+  GstPylonsrc *pylonsrc = GST_PYLONSRC (data);
+  GstClockTime host, camera, roundTrip;
+  gdouble rSquared;
+  gint64 next = g_get_monotonic_time() + G_TIME_SPAN_SECOND;
+
+  g_mutex_lock(&pylonsrc->clockLock);
+  while(!pylonsrc->clockQuit) {
+    if(g_cond_wait_until(&pylonsrc->clockCond, &pylonsrc->clockLock, next)) {
+      continue;
+    }
+    next += G_TIME_SPAN_SECOND;
+
+    g_mutex_unlock(&pylonsrc->clockLock);
+    if(pylonc_sample_camera_clock(pylonsrc, &host, &camera, &roundTrip)) {
+      // Samples that took long to read are too far off to be useful
+      if(roundTrip < 2 * GST_MSECOND && gst_clock_add_observation(pylonsrc->cameraClock, host, camera, &rSquared)) {
+        GST_LOG_OBJECT(pylonsrc, "Recalibrated the camera clock (r^2 %f).", rSquared);
+      }
+    }
+    g_mutex_lock(&pylonsrc->clockLock);
+  }
+  g_mutex_unlock(&pylonsrc->clockLock);
+
+  return NULL;
+}
+
 /* GStreamer version definitions. */
 #ifndef VERSION
 #define VERSION "1.1.0"
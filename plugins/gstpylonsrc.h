@@ -22,7 +22,11 @@
 #define _GST_PYLONSRC_H_
 
 #include <gst/base/gstpushsrc.h>
+#include <gst/video/video.h>
 #include "pylonc/PylonC.h"
+#include "gstpylongrabengine.h"
+#include "gstpylonalloc.h"
+#include "gstpylonbandwidth.h"
 
 G_BEGIN_DECLS
 
@@ -32,7 +36,47 @@ G_BEGIN_DECLS
 #define GST_IS_PYLONSRC(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PYLONSRC))
 #define GST_IS_PYLONSRC_CLASS(obj)   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_PYLONSRC))
 
+#define DEFAULT_NUM_BUFFERS 10 // Used when the framerate is unknown.
+#define MIN_NUM_BUFFERS 2 // One being filled by the camera while the other one is processed.
+#define MAX_NUM_BUFFERS 256
+#define MAX_ROIS 16
+#define MAX_CHUNKS 8
+
+/* Steps of starting the camera that are timed separately */
+typedef enum
+{
+  PYLONSRC_STARTUP_ENUMERATE,
+  PYLONSRC_STARTUP_OPEN,
+  PYLONSRC_STARTUP_CONFIGURE,
+  PYLONSRC_STARTUP_GRABBER,
+  PYLONSRC_STARTUP_ACQUISITION,
+  PYLONSRC_STARTUP_PHASES
+} GstPylonsrcStartupPhase;
+
+/* What the plugin does when downstream can't keep up */
+typedef enum
+{
+  PYLONSRC_QOS_OFF,
+  PYLONSRC_QOS_FRAMERATE,
+  PYLONSRC_QOS_DROP,
+  PYLONSRC_QOS_AUTO,
+  PYLONSRC_QOS_MODES
+} GstPylonsrcQos;
+
 typedef struct _GstPylonsrc GstPylonsrc;
+
+/* A region of the frame pushed on a pad of its own */
+typedef struct _GstPylonsrcRoi
+{
+  GstPad *pad; // NULL unless the region's pad was requested.
+  gint x, y, width, height; // The region as it was asked for.
+  gint cropX, cropY, cropWidth, cropHeight; // The region fitted into the frame, cropWidth is 0 until the caps are known.
+  GstVideoFormat format;
+  gint bpp; // Bytes per pixel.
+  gsize frameStride; // Bytes per row of the frame, unless it has a GstVideoMeta.
+  gboolean videoMeta; // Downstream supports GstVideoMeta, so the region can share the frame's memory.
+  gboolean queried, started; // Downstream was asked about GstVideoMeta, and has received a buffer.
+} GstPylonsrcRoi;
 typedef struct _GstPylonsrcClass GstPylonsrcClass;
 
 struct _GstPylonsrc
@@ -40,19 +84,87 @@ struct _GstPylonsrc
   GstPushSrc base_pylonsrc;
   
   gint cameraId;
+  _Bool deviceConnected;
   PYLON_DEVICE_HANDLE deviceHandle; // Handle for the camera.
   PYLON_STREAMGRABBER_HANDLE streamGrabber; // Handler for camera's streams.
   PYLON_WAITOBJECT_HANDLE waitObject; // Handles timing out in the main loop.
+  PYLON_CHUNKPARSER_HANDLE chunkParser; // Reads the chunk data appended to each frame.
+  guint chunks; // Bitmask of the pylonChunks entries enabled on the camera.
+  NODE_HANDLE chunkNodes[MAX_CHUNKS]; // Nodes the enabled chunks are read from, looked up once when the camera starts.
+  GstPylonGrabMemory* buffers; // Memory the camera writes the frames into.
+  PYLON_STREAMBUFFER_HANDLE* bufferHandle;
+  guint numBuffers; // Number of grab buffers in use, picked from grabBuffers or automatically.
+  guint numAllocated; // Number of buffers allocated, numBuffers may have changed since.
+  guint numRegistered; // Number of buffers registered with the stream grabber.
+  gboolean *bufferIdle; // The buffer was taken back from the stream grabber when the camera was halted and has to be queued again.
+  _Bool streamGrabberOpen, grabPrepared, acquiring;
+  gboolean warm; // Keep the camera open and configured while stopped.
+  gboolean warmChanged; // A property changed since the camera was kept warm, so it has to be configured again.
+
+  // QoS
+  GstPylonsrcQos qos; // The qos property, protected by the object lock.
+  GstPylonsrcQos qosMode; // Mode the streaming thread reacts in, follows qos with the next frame.
+  gdouble qosProportion; // Last QoS event, protected by the object lock.
+  GstClockTimeDiff qosDiff;
+  gboolean qosPending;
+  gboolean qosFramerate; // The rate is lowered through AcquisitionFrameRate rather than by dropping frames.
+  gdouble qosRate; // Fraction of the camera's framerate that is used, 1 when downstream keeps up.
+  gdouble qosCredit; // Frames that may be kept before the next one is dropped.
+  gint64 qosLastChange, qosLastLate;
+  guint64 qosDropped;
+  double frameRate; // Framerate the camera will run at, 0 if unknown.
+  double minFrameRate, maxFrameRate; // Framerates downstream can pick from, minFrameRate is 0 if the framerate can't be negotiated.
+  double capsFrameRate; // Framerate that was negotiated, 0 if the camera runs as fast as it can.
+  GMutex frameRateLock; // Serializes AcquisitionFrameRate changes from set_caps and QoS, and protects the framerates and qosRate/qosCredit while they're made.
+
+  // Grab buffer monitoring
+  guint maxBuffers; // Most buffers that fit into bufferMemory.
+  guint queueDepth, peakQueueDepth; // Most frames waiting to be processed at once, in the current report period and overall.
+  guint64 starvedFrames, lostFrames, lastBlockId; // Frames that found all of the buffers full, and frames missing from the block ids.
+  guint recommendedBuffers;
+  gint64 lastBufferReport;
+  GstPylonGrabRing grabRing; // Frames collected by the shared grab engine.
+  _Bool grabEngine; // The grab engine is collecting the frames instead of the streaming thread.
+  GstPylonBandwidthCamera bandwidthCamera; // The camera's share of its USB controller's bandwidth.
+  _Bool bandwidthPlanned; // The camera is part of the bandwidth plan of its controller.
+  GstAllocator *fdAllocator; // Wraps the grab buffers into GstFdMemory when fdmemory is set.
+  GMutex fdLock; // Keeps frames released downstream from being queued while the stream grabber goes away.
+  guint fdGeneration; // Bumped when the stream grabber goes away, frames pushed before that aren't queued anymore.
+  gboolean fdHalted; // The camera was halted, frames released downstream mark their buffers idle instead of queueing them. Protected by fdLock.
+  GstPad *previewPad; // Request pad getting a part of the frames, NULL unless it was requested.
+  gulong padProbe; // Probe on the src pad feeding the preview and ROI pads.
+  GstPylonsrcRoi roi[MAX_ROIS]; // Regions parsed from rois.
+  guint numRois;
+  guint64 previewCount; // Frames seen by the preview since the stream started.
+  GstClockTime nextPreview; // Timestamp from which the next frame goes to the preview when previewfps is set.
 
   int32_t frameSize; // Size of a frame in bytes.
+  gsize outputStride; // Bytes between the rows of the frames pushed downstream, 0 if they aren't padded.
+  gboolean videoMetaDownstream; // Downstream supports GstVideoMeta.
+  GstClock *cameraClock; // Clock following the camera's timestamp counter, NULL unless cameraclock was set.
+  const char *clockLatch, *clockValue; // Features latching and reading the timestamp counter, NULL if the camera can't.
+  int64_t timestampFrequency; // Timestamp counter ticks per second.
+  GThread *clockThread; // Compares the camera clock with the camera once a second while acquiring, NULL without cameraclock or if the camera can't latch its counter.
+  GMutex clockLock;
+  GCond clockCond;
+  gboolean clockQuit; // Tells the clock thread to stop, protected by clockLock.
+
+  // Startup timing
+  GHashTable *startupFeatures; // Time spent in each feature, only while starting.
+  GstClockTime startupPhases[PYLONSRC_STARTUP_PHASES];
+  GstPylonsrcStartupPhase startupPhase;
+  gint64 startupBegin, startupPhaseBegin;
   int32_t payloadSize; // Size of a frame in bytes.
   guint64 frameNumber; // Fun note: At 120fps it will take around 4 billion years to overflow this variable.
+  GstClockTime captureDelay; // Estimated time from the start of a frame's exposure until we retrieve it.
   
   // Plugin parameters
-  _Bool setFPS, continuousMode, limitBandwidth, demosaicing, centerx, centery, flipx, flipy;
-  double fps, exposure, gain, blacklevel, gamma, balancered, balanceblue, balancegreen, redhue, redsaturation, yellowhue, yellowsaturation, greenhue, greensaturation, cyanhue, cyansaturation, bluehue, bluesaturation, magentahue, magentasaturation, sharpnessenhancement, noisereduction, autoexposureupperlimit, autoexposurelowerlimit, gainupperlimit, gainlowerlimit, brightnesstarget, transformation00, transformation01, transformation02, transformation10, transformation11, transformation12, transformation20, transformation21, transformation22;
-  int64_t height, width, binningh, binningv, maxHeight, maxWidth, maxBandwidth, testImage, offsetx, offsety;
-  gchar *imageFormat, *sensorMode, *lightsource, *autoexposure, *autowhitebalance, *autogain, *reset, *autoprofile, *transformationselector, *userid;
+  _Bool setFPS, continuousMode, softwareTrigger, limitBandwidth, demosaicing, centerx, centery, flipx, flipy, chunkData, lockBuffers, fdMemory;
+  double previewFps, fps, exposure, gain, blacklevel, gamma, balancered, balanceblue, balancegreen, redhue, redsaturation, yellowhue, yellowsaturation, greenhue, greensaturation, cyanhue, cyansaturation, bluehue, bluesaturation, magentahue, magentasaturation, sharpnessenhancement, noisereduction, autoexposureupperlimit, autoexposurelowerlimit, gainupperlimit, gainlowerlimit, brightnesstarget, transformation00, transformation01, transformation02, transformation10, transformation11, transformation12, transformation20, transformation21, transformation22;
+  guint grabThreads, grabBuffers, latencyBudget, bufferMemory, previewEvery, strideAlign;
+  gint maxTransferSize, queuedUrbs, transferPriority;
+  int64_t height, width, binningh, binningv, maxHeight, maxWidth, maxBandwidth, controllerBandwidth, testImage, offsetx, offsety;
+  gchar *imageFormat, *sensorMode, *lightsource, *autoexposure, *autowhitebalance, *autogain, *reset, *autoprofile, *transformationselector, *userid, *serial, *triggersource, *bufferpages, *numanode, *bandwidthplanner, *rois;
 };
 
 struct _GstPylonsrcClass
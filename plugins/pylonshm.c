@@ -0,0 +1,348 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Reader side of pylonshmsink, see pylonshm.h. A reader must only be used
+ * from one thread at a time, and its frames have to be released before it is
+ * closed, as the sink hands the reader's id to the next reader once it's gone.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pylonshm.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+typedef struct _PylonShmRing
+{
+  int refcount;
+  uint8_t *base;
+  size_t size;
+  PylonShmHeader *header;
+  PylonShmSlot *slots;
+  uint32_t id; // The reader's id in this ring.
+} PylonShmRing;
+
+typedef struct _PylonShmCaps
+{
+  int refcount;
+  char caps[];
+} PylonShmCaps;
+
+struct _PylonShmReader
+{
+  int fd;
+  PylonShmRing *ring;
+  PylonShmCaps *caps;
+  int dropped;
+};
+
+static void
+pylon_shm_ring_unref (PylonShmRing * ring)
+{
+  if(ring && --ring->refcount == 0) {
+    munmap(ring->base, ring->size);
+    free(ring);
+  }
+}
+
+static void
+pylon_shm_caps_unref (PylonShmCaps * caps)
+{
+  if(caps && --caps->refcount == 0) {
+    free(caps);
+  }
+}
+
+PylonShmReader *
+pylon_shm_reader_open (const char * socketPath)
+{
+  PylonShmReader *reader;
+  struct sockaddr_un address;
+  int fd;
+
+  if(strlen(socketPath) >= sizeof(address.sun_path)) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, socketPath);
+
+  fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+  if(fd < 0) {
+    return NULL;
+  }
+  if(connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+    close(fd);
+    return NULL;
+  }
+
+  reader = calloc(1, sizeof(*reader));
+  if(!reader) {
+    close(fd);
+    return NULL;
+  }
+  reader->fd = fd;
+  return reader;
+}
+
+/* Maps a ring the sink sent */
+static int
+pylon_shm_reader_map (PylonShmReader * reader, int memfd, uint32_t id)
+{
+  PylonShmRing *ring;
+  struct stat info;
+  void *base;
+
+  if(fstat(memfd, &info) != 0 || (size_t) info.st_size < sizeof(PylonShmHeader)) {
+    close(memfd);
+    return -1;
+  }
+  base = mmap(NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+  close(memfd);
+  if(base == MAP_FAILED) {
+    return -1;
+  }
+
+  ring = calloc(1, sizeof(*ring));
+  if(!ring) {
+    munmap(base, info.st_size);
+    return -1;
+  }
+  ring->refcount = 1;
+  ring->base = base;
+  ring->size = info.st_size;
+  ring->header = base;
+  ring->slots = (PylonShmSlot *) (ring->header + 1);
+  ring->id = id;
+  if(ring->header->magic != PYLON_SHM_MAGIC || id >= PYLON_SHM_MAX_READERS || ring->header->dataOffset + ring->header->numSlots * ring->header->slotSize > ring->size) {
+    pylon_shm_ring_unref(ring);
+    return -1;
+  }
+
+  pylon_shm_ring_unref(reader->ring);
+  reader->ring = ring;
+  return 0;
+}
+
+/* Takes the frame in a slot. Returns 1 if the frame is ours, 0 if it's gone already, -1 if we were dropped. */
+static int
+pylon_shm_reader_take (PylonShmRing * ring, uint32_t slot, uint64_t sequence)
+{
+  PylonShmSlot *s = &ring->slots[slot];
+  uint64_t bit = 1ULL << ring->id, refs;
+
+  refs = __atomic_fetch_or(&s->refs, bit, __ATOMIC_SEQ_CST);
+  if(refs & PYLON_SHM_WRITER) {
+    __atomic_fetch_and(&s->refs, ~bit, __ATOMIC_RELEASE);
+    return 0;
+  }
+  if(__atomic_load_n(&ring->header->dropped, __ATOMIC_SEQ_CST) & bit) {
+    __atomic_fetch_and(&s->refs, ~bit, __ATOMIC_RELEASE);
+    return -1;
+  }
+  if(__atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE) != sequence) {
+    __atomic_fetch_and(&s->refs, ~bit, __ATOMIC_RELEASE);
+    return 0;
+  }
+  return 1;
+}
+
+static void
+pylon_shm_reader_fill (PylonShmReader * reader, PylonShmFrame * frame, uint32_t slot)
+{
+  PylonShmRing *ring = reader->ring;
+  PylonShmSlot *s = &ring->slots[slot];
+
+  memset(frame, 0, sizeof(*frame));
+  frame->data = ring->base + ring->header->dataOffset + slot * ring->header->slotSize;
+  frame->size = s->size;
+  frame->caps = reader->caps ? reader->caps->caps : "";
+  frame->sequence = s->sequence;
+  frame->pts = s->pts;
+  frame->dts = s->dts;
+  frame->duration = s->duration;
+  frame->offset = s->offset;
+  frame->flags = s->flags;
+  frame->metaFields = s->metaFields;
+  frame->framecounter = s->framecounter;
+  frame->cameratimestamp = s->cameratimestamp;
+  frame->exposurestart = s->exposurestart;
+  frame->grabtime = s->grabtime;
+  frame->exposuretime = s->exposuretime;
+  frame->gain = s->gain;
+  frame->linestatus = s->linestatus;
+  frame->chunkcounter = s->chunkcounter;
+
+  ring->refcount++;
+  frame->ring = ring;
+  if(reader->caps) {
+    reader->caps->refcount++;
+  }
+  frame->capsRef = reader->caps;
+  frame->slot = slot;
+}
+
+static int64_t
+pylon_shm_now (void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* Waits up to timeout milliseconds (-1 for ever) for the next frame. Returns 1 when a frame was taken, 0 on a timeout, and -1 once the sink went away or dropped the reader. */
+int
+pylon_shm_reader_next (PylonShmReader * reader, PylonShmFrame * frame, int timeout)
+{
+  union {
+    PylonShmMessage message;
+    char bytes[sizeof(PylonShmMessage) + PYLON_SHM_MAX_CAPS];
+  } buffer;
+  union {
+    struct cmsghdr header;
+    char bytes[CMSG_SPACE(sizeof(int))];
+  } control;
+  struct iovec iov = { &buffer, sizeof(buffer) };
+  struct msghdr msg;
+  struct cmsghdr *cmsg;
+  struct pollfd pfd = { reader->fd, POLLIN, 0 };
+  int64_t deadline = timeout >= 0 ? pylon_shm_now() + timeout : -1;
+  PylonShmCaps *caps;
+  ssize_t length;
+  int memfd, res, wait;
+
+  while(!reader->dropped) {
+    wait = deadline < 0 ? -1 : (int) MAX(deadline - pylon_shm_now(), 0);
+    res = poll(&pfd, 1, wait);
+    if(res < 0 && errno == EINTR) {
+      continue;
+    }
+    if(res == 0) {
+      return 0;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.bytes;
+    msg.msg_controllen = sizeof(control.bytes);
+    length = res > 0 ? recvmsg(reader->fd, &msg, MSG_CMSG_CLOEXEC) : -1;
+    if(length < (ssize_t) sizeof(PylonShmMessage)) {
+      reader->dropped = 1;
+      break;
+    }
+
+    switch(buffer.message.type) {
+      case PYLON_SHM_MSG_RING:
+        memfd = -1;
+        for(cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+          if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+          }
+        }
+        if(memfd < 0 || pylon_shm_reader_map(reader, memfd, buffer.message.value) != 0) {
+          reader->dropped = 1;
+        }
+        break;
+      case PYLON_SHM_MSG_CAPS:
+        if(buffer.message.value > length - sizeof(PylonShmMessage)) {
+          break;
+        }
+        caps = malloc(sizeof(PylonShmCaps) + buffer.message.value + 1);
+        if(caps) {
+          caps->refcount = 1;
+          memcpy(caps->caps, buffer.bytes + sizeof(PylonShmMessage), buffer.message.value);
+          caps->caps[buffer.message.value] = '\0';
+          pylon_shm_caps_unref(reader->caps);
+          reader->caps = caps;
+        }
+        break;
+      case PYLON_SHM_MSG_FRAME:
+        if(!reader->ring || buffer.message.value >= reader->ring->header->numSlots) {
+          break;
+        }
+        res = pylon_shm_reader_take(reader->ring, buffer.message.value, buffer.message.sequence);
+        if(res > 0) {
+          pylon_shm_reader_fill(reader, frame, buffer.message.value);
+          return 1;
+        } else if(res < 0) {
+          reader->dropped = 1;
+        }
+        break;
+      case PYLON_SHM_MSG_DROPPED:
+        reader->dropped = 1;
+        break;
+    }
+  }
+
+  return -1;
+}
+
+/* Gives the frame's slot back to the sink */
+void
+pylon_shm_frame_release (PylonShmReader * reader, PylonShmFrame * frame)
+{
+  PylonShmRing *ring = frame->ring;
+
+  (void) reader;
+  if(!ring) {
+    return;
+  }
+  __atomic_fetch_and(&ring->slots[frame->slot].refs, ~(1ULL << ring->id), __ATOMIC_RELEASE);
+  pylon_shm_ring_unref(ring);
+  pylon_shm_caps_unref(frame->capsRef);
+  frame->ring = NULL;
+  frame->capsRef = NULL;
+  frame->data = NULL;
+}
+
+/* The socket the notifications arrive on, to wait for frames in a poll loop */
+int
+pylon_shm_reader_fd (PylonShmReader * reader)
+{
+  return reader->fd;
+}
+
+void
+pylon_shm_reader_close (PylonShmReader * reader)
+{
+  if(!reader) {
+    return;
+  }
+  pylon_shm_ring_unref(reader->ring);
+  pylon_shm_caps_unref(reader->caps);
+  close(reader->fd);
+  free(reader);
+}
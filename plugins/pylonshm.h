@@ -0,0 +1,153 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Reader library for the frames published by pylonshmsink.
+ *
+ * pylonshmsink keeps the frames in a ring of slots in a memfd, which every
+ * reader maps, so that any number of processes can use the frames without
+ * copying them. Readers connect to the sink's socket, receive the memfd and
+ * are then told about every new frame. Taking a frame marks the reader as a
+ * holder of its slot, and the sink doesn't reuse a slot while it has holders.
+ * When the sink runs out of free slots (or a reader doesn't keep up with the
+ * notifications) it drops the slowest reader instead of waiting for it, so a
+ * reader has to release its frames quickly, or copy them. A dropped reader
+ * gets no new frames, but the ones it holds stay intact until it releases
+ * them or closes.
+ *
+ * The library doesn't need GStreamer or GLib, only the C library.
+ *
+ *   PylonShmReader *reader = pylon_shm_reader_open("/tmp/pylonshm");
+ *   PylonShmFrame frame;
+ *
+ *   while(pylon_shm_reader_next(reader, &frame, -1) > 0) {
+ *     process(frame.data, frame.size, frame.caps);
+ *     pylon_shm_frame_release(reader, &frame);
+ *   }
+ *   pylon_shm_reader_close(reader);
+ */
+
+#ifndef _PYLONSHM_H_
+#define _PYLONSHM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PYLON_SHM_NONE UINT64_MAX // Value of the timestamps that aren't set, same as GST_CLOCK_TIME_NONE.
+
+/* Fields of PylonShmFrame's camera metadata that are valid, same as GstPylonMetaChunks */
+enum {
+  PYLON_SHM_EXPOSURETIME = (1 << 0),
+  PYLON_SHM_GAIN = (1 << 1),
+  PYLON_SHM_LINESTATUS = (1 << 2),
+  PYLON_SHM_CHUNKCOUNTER = (1 << 3),
+  PYLON_SHM_CAPTURE = (1 << 16) // The frame came with pylonsrc's capture information (framecounter to grabtime).
+};
+
+typedef struct _PylonShmReader PylonShmReader;
+
+/* A frame taken from the ring. The data, caps and metadata stay valid until the frame is released. */
+typedef struct _PylonShmFrame
+{
+  const void *data;
+  size_t size;
+  const char *caps; // Caps of the frame, as a string.
+  uint64_t sequence; // Number of the frame in the sink, gaps mean the reader missed frames.
+
+  // Timing of the GstBuffer the frame came in, in nanoseconds
+  uint64_t pts, dts, duration;
+  uint64_t offset;
+  uint32_t flags; // GstBufferFlags
+
+  // Capture information of the camera, see GstPylonMeta
+  uint32_t metaFields; // Which of the fields below are valid.
+  uint64_t framecounter, cameratimestamp, exposurestart, grabtime;
+  double exposuretime, gain;
+  uint64_t linestatus, chunkcounter;
+
+  // Private
+  void *ring, *capsRef;
+  uint32_t slot;
+} PylonShmFrame;
+
+PylonShmReader *pylon_shm_reader_open (const char * socketPath);
+int pylon_shm_reader_next (PylonShmReader * reader, PylonShmFrame * frame, int timeout);
+void pylon_shm_frame_release (PylonShmReader * reader, PylonShmFrame * frame);
+int pylon_shm_reader_fd (PylonShmReader * reader);
+void pylon_shm_reader_close (PylonShmReader * reader);
+
+/*
+ * Layout of the ring and the messages sent over the socket, shared with
+ * pylonshmsink.
+ *
+ * A slot's refs has a bit for each reader holding it and PYLON_SHM_WRITER
+ * while the sink fills it. The sink only claims slots without holders. A
+ * reader takes a frame by setting its bit, and gives up when the sink was
+ * filling the slot, has dropped the reader, or already replaced the frame.
+ */
+#define PYLON_SHM_MAGIC 0x314d4853504c5950ULL // "PYLPSHM1"
+#define PYLON_SHM_MAX_READERS 63
+#define PYLON_SHM_WRITER (1ULL << PYLON_SHM_MAX_READERS)
+#define PYLON_SHM_MAX_CAPS 4096
+
+typedef struct _PylonShmHeader
+{
+  uint64_t magic;
+  uint32_t numSlots;
+  uint32_t reserved;
+  uint64_t slotSize; // Room for frame data in each slot.
+  uint64_t dataOffset; // Offset of the first slot's data from the start of the ring, slot i's data is at dataOffset + i * slotSize.
+  uint64_t dropped; // Bit for each reader that was dropped.
+} PylonShmHeader;
+
+typedef struct _PylonShmSlot
+{
+  uint64_t refs;
+  uint64_t sequence; // 0 while the slot is empty.
+  uint64_t size;
+  uint64_t pts, dts, duration, offset;
+  uint32_t flags, metaFields;
+  uint64_t framecounter, cameratimestamp, exposurestart, grabtime;
+  double exposuretime, gain;
+  uint64_t linestatus, chunkcounter;
+} PylonShmSlot; // The slots follow the header.
+
+enum {
+  PYLON_SHM_MSG_RING = 1, // A new ring, its memfd is attached. value is the reader's id.
+  PYLON_SHM_MSG_CAPS, // New caps follow the message, value is their length.
+  PYLON_SHM_MSG_FRAME, // A new frame, value is its slot.
+  PYLON_SHM_MSG_DROPPED // The reader was too slow and was dropped.
+};
+
+typedef struct _PylonShmMessage
+{
+  uint32_t type;
+  uint32_t value;
+  uint64_t sequence;
+} PylonShmMessage;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
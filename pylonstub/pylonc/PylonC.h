@@ -0,0 +1,205 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * In-tree stand-in for Basler's PylonC API.
+ *
+ * Only the subset of the API used by this package is declared here, with the
+ * same names and signatures as the real SDK so the plugins compile unchanged
+ * against either. It is used when configuring with --enable-pylon-stub, see
+ * pylonstub.c for the virtual camera behind it.
+ */
+
+#ifndef _PYLONSTUB_PYLONC_H_
+#define _PYLONSTUB_PYLONC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PYLONSTUB 1
+
+/* Result codes */
+typedef int32_t GENAPIC_RESULT;
+#define GENAPI_E_OK ((GENAPIC_RESULT) 0x00000000)
+#define GENAPI_E_FAIL ((GENAPIC_RESULT) 0xC2000001)
+#define GENAPI_E_INVALID_ARG ((GENAPIC_RESULT) 0xC2000002)
+#define GENAPI_E_NODE_NOT_FOUND ((GENAPIC_RESULT) 0xC2000003)
+#define GENAPI_E_ACCESS_DENIED ((GENAPIC_RESULT) 0xC2000004)
+#define GENAPI_E_INSUFFICIENT_BUFFER ((GENAPIC_RESULT) 0xC2000005)
+
+/* Device access modes */
+#define PYLONC_ACCESS_MODE_MONITOR 0x0
+#define PYLONC_ACCESS_MODE_CONTROL 0x1
+#define PYLONC_ACCESS_MODE_STREAM 0x2
+#define PYLONC_ACCESS_MODE_EVENT 0x4
+#define PYLONC_ACCESS_MODE_EXCLUSIVE 0x8
+
+/* Handles */
+typedef struct _PylonStubDevice* PYLON_DEVICE_HANDLE;
+typedef struct _PylonStubGrabber* PYLON_STREAMGRABBER_HANDLE;
+typedef struct _PylonStubWaitObject* PYLON_WAITOBJECT_HANDLE;
+typedef struct _PylonStubWaitObjects* PYLON_WAITOBJECTS_HANDLE;
+typedef struct _PylonStubStreamBuffer* PYLON_STREAMBUFFER_HANDLE;
+typedef struct _PylonStubChunkParser* PYLON_CHUNKPARSER_HANDLE;
+typedef struct _PylonStubNodeMap* NODEMAP_HANDLE;
+typedef struct _PylonStubNode* NODE_HANDLE;
+#define GENAPIC_INVALID_HANDLE NULL
+
+/* Grab results */
+typedef enum {
+  UndefinedGrabStatus = -1,
+  Idle,
+  Queued,
+  Grabbed,
+  Canceled,
+  Failed
+} EPylonGrabStatus;
+
+typedef enum {
+  PayloadType_Undefined = -1,
+  PayloadType_Image,
+  PayloadType_RawData,
+  PayloadType_File,
+  PayloadType_ChunkData,
+  PayloadType_DeviceSpecific = 0x8000
+} EPylonPayloadType;
+
+typedef int32_t EPylonPixelType;
+
+typedef struct PylonGrabResult_t {
+  const void* Context;
+  PYLON_STREAMBUFFER_HANDLE hBuffer;
+  const void* pBuffer;
+  EPylonGrabStatus Status;
+  EPylonPayloadType PayloadType;
+  EPylonPixelType PixelType;
+  uint64_t TimeStamp;
+  int32_t SizeX;
+  int32_t SizeY;
+  int32_t OffsetX;
+  int32_t OffsetY;
+  int32_t PaddingX;
+  int32_t PaddingY;
+  uint64_t PayloadSize;
+  uint32_t ErrorCode;
+  uint64_t BlockID;
+} PylonGrabResult_t;
+
+typedef struct PylonDeviceInfo_t {
+  char FullName[512];
+  char FriendlyName[128];
+  char VendorName[64];
+  char ModelName[64];
+  char SerialNumber[64];
+  char DeviceClass[64];
+  char DeviceVersion[64];
+  char UserDefinedName[64];
+} PylonDeviceInfo_t;
+
+/* Error reporting */
+GENAPIC_RESULT GenApiGetLastErrorMessage(char* pBuf, size_t* pBufLen);
+GENAPIC_RESULT GenApiGetLastErrorDetail(char* pBuf, size_t* pBufLen);
+
+/* Library */
+GENAPIC_RESULT PylonInitialize(void);
+GENAPIC_RESULT PylonTerminate(void);
+GENAPIC_RESULT PylonEnumerateDevices(size_t* numDevices);
+GENAPIC_RESULT PylonGetDeviceInfo(size_t index, PylonDeviceInfo_t* pDi);
+
+/* Devices */
+GENAPIC_RESULT PylonCreateDeviceByIndex(size_t index, PYLON_DEVICE_HANDLE* phDev);
+GENAPIC_RESULT PylonDestroyDevice(PYLON_DEVICE_HANDLE hDev);
+GENAPIC_RESULT PylonDeviceOpen(PYLON_DEVICE_HANDLE hDev, int accessMode);
+GENAPIC_RESULT PylonDeviceClose(PYLON_DEVICE_HANDLE hDev);
+
+/* Features */
+_Bool PylonDeviceFeatureIsImplemented(PYLON_DEVICE_HANDLE hDev, const char* pName);
+_Bool PylonDeviceFeatureIsAvailable(PYLON_DEVICE_HANDLE hDev, const char* pName);
+_Bool PylonDeviceFeatureIsReadable(PYLON_DEVICE_HANDLE hDev, const char* pName);
+_Bool PylonDeviceFeatureIsWritable(PYLON_DEVICE_HANDLE hDev, const char* pName);
+GENAPIC_RESULT PylonDeviceSetIntegerFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, int64_t value);
+GENAPIC_RESULT PylonDeviceGetIntegerFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, int64_t* pValue);
+GENAPIC_RESULT PylonDeviceGetIntegerFeatureInt32(PYLON_DEVICE_HANDLE hDev, const char* pName, int32_t* pValue);
+GENAPIC_RESULT PylonDeviceSetFloatFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, double value);
+GENAPIC_RESULT PylonDeviceGetFloatFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, double* pValue);
+GENAPIC_RESULT PylonDeviceGetFloatFeatureMin(PYLON_DEVICE_HANDLE hDev, const char* pName, double* pValue);
+GENAPIC_RESULT PylonDeviceGetFloatFeatureMax(PYLON_DEVICE_HANDLE hDev, const char* pName, double* pValue);
+GENAPIC_RESULT PylonDeviceSetBooleanFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, _Bool value);
+GENAPIC_RESULT PylonDeviceGetBooleanFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, _Bool* pValue);
+GENAPIC_RESULT PylonDeviceFeatureFromString(PYLON_DEVICE_HANDLE hDev, const char* pName, const char* pValue);
+GENAPIC_RESULT PylonDeviceFeatureToString(PYLON_DEVICE_HANDLE hDev, const char* pName, char* pBuf, size_t* pBufLen);
+GENAPIC_RESULT PylonDeviceExecuteCommandFeature(PYLON_DEVICE_HANDLE hDev, const char* pName);
+
+/* Stream grabbers */
+GENAPIC_RESULT PylonDeviceGetNumStreamGrabberChannels(PYLON_DEVICE_HANDLE hDev, size_t* pNumChannels);
+GENAPIC_RESULT PylonDeviceGetStreamGrabber(PYLON_DEVICE_HANDLE hDev, size_t index, PYLON_STREAMGRABBER_HANDLE* phStg);
+GENAPIC_RESULT PylonStreamGrabberOpen(PYLON_STREAMGRABBER_HANDLE hStg);
+GENAPIC_RESULT PylonStreamGrabberClose(PYLON_STREAMGRABBER_HANDLE hStg);
+GENAPIC_RESULT PylonStreamGrabberGetWaitObject(PYLON_STREAMGRABBER_HANDLE hStg, PYLON_WAITOBJECT_HANDLE* phWobj);
+GENAPIC_RESULT PylonStreamGrabberSetMaxNumBuffer(PYLON_STREAMGRABBER_HANDLE hStg, size_t numBuffers);
+GENAPIC_RESULT PylonStreamGrabberSetMaxBufferSize(PYLON_STREAMGRABBER_HANDLE hStg, size_t maxSize);
+GENAPIC_RESULT PylonStreamGrabberPrepareGrab(PYLON_STREAMGRABBER_HANDLE hStg);
+GENAPIC_RESULT PylonStreamGrabberFinishGrab(PYLON_STREAMGRABBER_HANDLE hStg);
+GENAPIC_RESULT PylonStreamGrabberRegisterBuffer(PYLON_STREAMGRABBER_HANDLE hStg, void* pBuffer, size_t bufLen, PYLON_STREAMBUFFER_HANDLE* phBuf);
+GENAPIC_RESULT PylonStreamGrabberDeregisterBuffer(PYLON_STREAMGRABBER_HANDLE hStg, PYLON_STREAMBUFFER_HANDLE hBuf);
+GENAPIC_RESULT PylonStreamGrabberQueueBuffer(PYLON_STREAMGRABBER_HANDLE hStg, PYLON_STREAMBUFFER_HANDLE hBuf, const void* pContext);
+GENAPIC_RESULT PylonStreamGrabberRetrieveResult(PYLON_STREAMGRABBER_HANDLE hStg, PylonGrabResult_t* pGrabResult, _Bool* pReady);
+GENAPIC_RESULT PylonStreamGrabberCancelGrab(PYLON_STREAMGRABBER_HANDLE hStg);
+GENAPIC_RESULT PylonStreamGrabberFlushBuffersToOutput(PYLON_STREAMGRABBER_HANDLE hStg);
+GENAPIC_RESULT PylonStreamGrabberGetNodeMap(PYLON_STREAMGRABBER_HANDLE hStg, NODEMAP_HANDLE* phMap);
+
+/* Node maps */
+GENAPIC_RESULT PylonDeviceGetNodeMap(PYLON_DEVICE_HANDLE hDev, NODEMAP_HANDLE* phMap);
+GENAPIC_RESULT GenApiNodeMapGetNode(NODEMAP_HANDLE hMap, const char* pName, NODE_HANDLE* phNode);
+GENAPIC_RESULT GenApiNodeIsReadable(NODE_HANDLE hNode, _Bool* pResult);
+GENAPIC_RESULT GenApiNodeIsWritable(NODE_HANDLE hNode, _Bool* pResult);
+GENAPIC_RESULT GenApiIntegerSetValue(NODE_HANDLE hNode, int64_t value);
+GENAPIC_RESULT GenApiIntegerGetValue(NODE_HANDLE hNode, int64_t* pValue);
+GENAPIC_RESULT GenApiIntegerGetMin(NODE_HANDLE hNode, int64_t* pValue);
+GENAPIC_RESULT GenApiIntegerGetMax(NODE_HANDLE hNode, int64_t* pValue);
+GENAPIC_RESULT GenApiIntegerGetInc(NODE_HANDLE hNode, int64_t* pValue);
+GENAPIC_RESULT GenApiFloatGetValue(NODE_HANDLE hNode, double* pValue);
+
+/* Chunk parsers */
+GENAPIC_RESULT PylonDeviceCreateChunkParser(PYLON_DEVICE_HANDLE hDev, PYLON_CHUNKPARSER_HANDLE* phChunkParser);
+GENAPIC_RESULT PylonDeviceDestroyChunkParser(PYLON_DEVICE_HANDLE hDev, PYLON_CHUNKPARSER_HANDLE hChunkParser);
+GENAPIC_RESULT PylonChunkParserAttachBuffer(PYLON_CHUNKPARSER_HANDLE hChunkParser, const void* pBuffer, size_t BufLen);
+GENAPIC_RESULT PylonChunkParserDetachBuffer(PYLON_CHUNKPARSER_HANDLE hChunkParser);
+
+/* Wait objects */
+GENAPIC_RESULT PylonWaitObjectWait(PYLON_WAITOBJECT_HANDLE hWobj, uint32_t timeout, _Bool* pResult);
+GENAPIC_RESULT PylonWaitObjectCreate(PYLON_WAITOBJECT_HANDLE* phWobj);
+GENAPIC_RESULT PylonWaitObjectDestroy(PYLON_WAITOBJECT_HANDLE hWobj);
+GENAPIC_RESULT PylonWaitObjectSignal(PYLON_WAITOBJECT_HANDLE hWobj);
+GENAPIC_RESULT PylonWaitObjectReset(PYLON_WAITOBJECT_HANDLE hWobj);
+GENAPIC_RESULT PylonWaitObjectsCreate(PYLON_WAITOBJECTS_HANDLE* phWos);
+GENAPIC_RESULT PylonWaitObjectsDestroy(PYLON_WAITOBJECTS_HANDLE hWos);
+GENAPIC_RESULT PylonWaitObjectsAdd(PYLON_WAITOBJECTS_HANDLE hWos, PYLON_WAITOBJECT_HANDLE hWobj, size_t* pIndex);
+GENAPIC_RESULT PylonWaitObjectsRemoveAll(PYLON_WAITOBJECTS_HANDLE hWos);
+GENAPIC_RESULT PylonWaitObjectsWaitForAny(PYLON_WAITOBJECTS_HANDLE hWos, uint32_t timeout, size_t* pIndex, _Bool* pResult);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
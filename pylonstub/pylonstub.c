@@ -0,0 +1,1616 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * A virtual Basler camera implementing the parts of PylonC used by pylonsrc.
+ *
+ * This lets the plugin be built, run and benchmarked on machines without the
+ * Pylon SDK or a camera attached. The virtual camera behaves like a USB3
+ * camera as far as pylonsrc is concerned - features can be read and written
+ * (AcquisitionFrameRate within its limits), the stream grabber fills
+ * registered buffers with a moving test pattern and wait objects block until
+ * the next frame is due. With chunk mode enabled the
+ * exposure time, gain, line status and frame counter are appended to every
+ * frame, and can be read back through a chunk parser like on a real camera.
+ * The frames' TimeStamp and the latched timestamp counter both count the
+ * nanoseconds since the camera was opened on CLOCK_MONOTONIC.
+ * Cameras set to a hardware trigger source behave as if all of them were wired
+ * to the same trigger line, which fires at PYLONSTUB_FPS. The stream grabber
+ * node map holds the USB transfer parameters, which are range checked and
+ * locked while grabbing but don't change how fast frames arrive.
+ *
+ * It is configured through environment variables, read on PylonInitialize():
+ *  PYLONSTUB_CAMERAS      - number of cameras to enumerate (default: 1)
+ *  PYLONSTUB_WIDTH        - sensor width in pixels (default: 1920)
+ *  PYLONSTUB_HEIGHT       - sensor height in pixels (default: 1200)
+ *  PYLONSTUB_FPS          - maximum frame rate, 0 for free-running (default: 60)
+ *  PYLONSTUB_DROP_RATE    - fraction of frames delivered as failed grabs (default: 0)
+ *  PYLONSTUB_TIMEOUT_RATE - fraction of frames that never arrive, making the wait time out (default: 0)
+ *  PYLONSTUB_SEED         - seed for the drop/timeout decisions (default: 1)
+ */
+
+#include "pylonc/PylonC.h"
+
+#include <errno.h>
+#include <float.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STUB_MAX_CAMERAS 16
+#define STUB_MAX_FEATURES 128
+#define STUB_NAME_LENGTH 64
+#define STUB_STRING_LENGTH 64
+#define STUB_PATTERN_PERIOD 256
+
+typedef enum {
+  STUB_INTEGER,
+  STUB_FLOAT,
+  STUB_BOOLEAN,
+  STUB_STRING,
+  STUB_COMMAND
+} StubFeatureType;
+
+typedef struct {
+  char name[STUB_NAME_LENGTH];
+  StubFeatureType type;
+  _Bool writable;
+  int64_t i;
+  double f;
+  double min, max; // Limits of float features
+  char s[STUB_STRING_LENGTH];
+} StubFeature;
+
+struct _PylonStubStreamBuffer {
+  void* data;
+  size_t size;
+  const void* context;
+};
+
+/* Chunk data appended to the end of every frame while chunk mode is active */
+typedef struct {
+  uint32_t magic;
+  uint32_t enabled;
+  double exposureTime, gain;
+  int64_t lineStatus, counterValue;
+} StubChunkData;
+
+#define STUB_CHUNK_MAGIC 0x4B4E4843 // "CHNK"
+
+struct _PylonStubChunkParser {
+  struct _PylonStubDevice* device;
+};
+
+struct _PylonStubWaitObject {
+  struct _PylonStubGrabber* grabber; // NULL for the wait objects created with PylonWaitObjectCreate
+  _Bool signaled;
+};
+
+#define STUB_MAX_WAITOBJECTS 64
+
+struct _PylonStubWaitObjects {
+  PYLON_WAITOBJECT_HANDLE objects[STUB_MAX_WAITOBJECTS];
+  size_t count;
+};
+
+/* Integer node of a stream grabber's node map, writable only while the grabber is open and not grabbing.
+ * Nodes of a device's node map only have device and name set, and stand for the device's feature of that name. */
+struct _PylonStubNode {
+  struct _PylonStubGrabber* grabber;
+  const char* name;
+  int64_t value, min, max, inc;
+  struct _PylonStubDevice* device;
+};
+
+#define STUB_MAX_NODES 3
+
+struct _PylonStubNodeMap {
+  struct _PylonStubNode nodes[STUB_MAX_NODES];
+  struct _PylonStubDevice* device; // Set for a device's node map, which looks its nodes up in the device's features instead
+};
+
+struct _PylonStubGrabber {
+  struct _PylonStubDevice* device;
+  struct _PylonStubWaitObject waitObject;
+  struct _PylonStubNodeMap nodeMap;
+  _Bool open, prepared;
+  size_t maxNumBuffer, maxBufferSize;
+
+  // Registered buffers
+  PYLON_STREAMBUFFER_HANDLE* registered;
+  size_t numRegistered;
+
+  // Buffers waiting to be filled (FIFO)
+  PYLON_STREAMBUFFER_HANDLE* input;
+  size_t inputHead, inputCount;
+
+  // Filled buffers waiting to be retrieved (FIFO)
+  PylonGrabResult_t* output;
+  size_t outputHead, outputCount;
+
+  unsigned char* pattern;
+  size_t patternSize;
+};
+
+struct _PylonStubDevice {
+  size_t index;
+  _Bool open, acquiring;
+  pthread_mutex_t lock;
+  StubFeature features[STUB_MAX_FEATURES];
+  size_t numFeatures;
+  struct _PylonStubNodeMap nodeMap;
+  struct _PylonStubNode featureNodes[STUB_MAX_FEATURES]; // Node of each feature, in the same order
+  struct _PylonStubGrabber grabber;
+
+  uint32_t chunkEnabled, chunkAttached; // Chunks enabled with ChunkEnable, and the ones present in the attached buffer
+  uint64_t frameCounter, pendingTriggers;
+  struct timespec epoch, nextFrame;
+  unsigned int seed;
+};
+
+/* Configuration */
+static int stubCameras = 1;
+static int64_t stubWidth = 1920, stubHeight = 1200;
+static double stubFps = 60.0, stubDropRate = 0.0, stubTimeoutRate = 0.0;
+static unsigned int stubSeed = 1;
+
+static _Bool deviceOpen[STUB_MAX_CAMERAS];
+static pthread_mutex_t stubLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Waiters sleep on stubWake, and are woken up whenever something that could make a frame come sooner happens
+static pthread_once_t stubWakeOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t stubWakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stubWake;
+static unsigned int stubWakeCount = 0;
+static __thread char lastError[256] = "";
+
+static const char* stubEnumEntries[] = {
+  "EnumEntry_PixelFormat_Mono8",
+  "EnumEntry_PixelFormat_BayerRG8", "EnumEntry_PixelFormat_BayerGR8",
+  "EnumEntry_PixelFormat_BayerGB8", "EnumEntry_PixelFormat_BayerBG8",
+  "EnumEntry_PixelFormat_BayerRG10", "EnumEntry_PixelFormat_BayerGR10",
+  "EnumEntry_PixelFormat_BayerGB10", "EnumEntry_PixelFormat_BayerBG10",
+  "EnumEntry_PixelFormat_BayerRG10p", "EnumEntry_PixelFormat_BayerGR10p",
+  "EnumEntry_PixelFormat_BayerGB10p", "EnumEntry_PixelFormat_BayerBG10p",
+  "EnumEntry_PixelFormat_RGB8", "EnumEntry_PixelFormat_BGR8",
+  "EnumEntry_PixelFormat_YCbCr422_8",
+  "EnumEntry_TriggerSelector_FrameStart",
+  "EnumEntry_TriggerSelector_FrameBurstStart",
+  "EnumEntry_ChunkSelector_ExposureTime", "EnumEntry_ChunkSelector_Gain",
+  "EnumEntry_ChunkSelector_LineStatusAll", "EnumEntry_ChunkSelector_CounterValue",
+  NULL
+};
+
+/* Chunk selector entries and the features their values are read from, in StubChunkData.enabled bit order */
+static const char* stubChunks[][2] = {
+  { "ExposureTime", "ChunkExposureTime" },
+  { "Gain", "ChunkGain" },
+  { "LineStatusAll", "ChunkLineStatusAll" },
+  { "CounterValue", "ChunkCounterValue" },
+  { NULL, NULL }
+};
+
+static int64_t stub_pixel_quarter_bytes(PYLON_DEVICE_HANDLE hDev);
+
+/* Helpers */
+static GENAPIC_RESULT
+stub_error(GENAPIC_RESULT res, const char* format, const char* name)
+{
+  snprintf(lastError, sizeof(lastError), format, name);
+  return res;
+}
+
+static double
+stub_env_double(const char* name, double fallback)
+{
+  const char* value = getenv(name);
+  return value ? strtod(value, NULL) : fallback;
+}
+
+static uint64_t
+stub_timespec_ns(const struct timespec* t)
+{
+  return (uint64_t) t->tv_sec * 1000000000ULL + (uint64_t) t->tv_nsec;
+}
+
+static void
+stub_timespec_add_ns(struct timespec* t, uint64_t ns)
+{
+  uint64_t total = stub_timespec_ns(t) + ns;
+  t->tv_sec = total / 1000000000ULL;
+  t->tv_nsec = total % 1000000000ULL;
+}
+
+static void
+stub_timespec_set_ns(struct timespec* t, uint64_t ns)
+{
+  t->tv_sec = (time_t) (ns / 1000000000ULL);
+  t->tv_nsec = (long) (ns % 1000000000ULL);
+}
+
+static void
+stub_wake_init(void)
+{
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&stubWake, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+/* Makes the waiters look at their wait objects again */
+static void
+stub_wake(void)
+{
+  pthread_once(&stubWakeOnce, stub_wake_init);
+  pthread_mutex_lock(&stubWakeLock);
+  stubWakeCount++;
+  pthread_cond_broadcast(&stubWake);
+  pthread_mutex_unlock(&stubWakeLock);
+}
+
+static StubFeature*
+stub_find(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  size_t i;
+  for (i = 0; i < hDev->numFeatures; i++) {
+    if (strcmp(hDev->features[i].name, pName) == 0) {
+      return &hDev->features[i];
+    }
+  }
+  return NULL;
+}
+
+static StubFeature*
+stub_add(PYLON_DEVICE_HANDLE hDev, const char* pName, StubFeatureType type, _Bool writable)
+{
+  StubFeature* feature = &hDev->features[hDev->numFeatures++];
+  memset(feature, 0, sizeof(*feature));
+  snprintf(feature->name, STUB_NAME_LENGTH, "%s", pName);
+  feature->type = type;
+  feature->writable = writable;
+  return feature;
+}
+
+static void
+stub_add_integer(PYLON_DEVICE_HANDLE hDev, const char* pName, int64_t value, _Bool writable)
+{
+  stub_add(hDev, pName, STUB_INTEGER, writable)->i = value;
+}
+
+static void
+stub_add_float_range(PYLON_DEVICE_HANDLE hDev, const char* pName, double value, double min, double max, _Bool writable)
+{
+  StubFeature* feature = stub_add(hDev, pName, STUB_FLOAT, writable);
+  feature->f = value;
+  feature->min = min;
+  feature->max = max;
+}
+
+static void
+stub_add_float(PYLON_DEVICE_HANDLE hDev, const char* pName, double value, _Bool writable)
+{
+  stub_add_float_range(hDev, pName, value, -DBL_MAX, DBL_MAX, writable);
+}
+
+static void
+stub_add_boolean(PYLON_DEVICE_HANDLE hDev, const char* pName, _Bool value, _Bool writable)
+{
+  stub_add(hDev, pName, STUB_BOOLEAN, writable)->i = value;
+}
+
+static void
+stub_add_string(PYLON_DEVICE_HANDLE hDev, const char* pName, const char* value, _Bool writable)
+{
+  snprintf(stub_add(hDev, pName, STUB_STRING, writable)->s, STUB_STRING_LENGTH, "%s", value);
+}
+
+static void
+stub_add_command(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  stub_add(hDev, pName, STUB_COMMAND, 1);
+}
+
+static void
+stub_init_features(PYLON_DEVICE_HANDLE hDev)
+{
+  char serial[STUB_STRING_LENGTH];
+  snprintf(serial, sizeof(serial), "%d", 22000000 + (int) hDev->index);
+
+  // Device information
+  stub_add_string(hDev, "DeviceVendorName", "Basler", 0);
+  stub_add_string(hDev, "DeviceModelName", "acA1920-155uc (stub)", 0);
+  stub_add_string(hDev, "DeviceSerialNumber", serial, 0);
+  stub_add_string(hDev, "DeviceUserID", "", 1);
+  stub_add_command(hDev, "DeviceReset");
+
+  // Image format
+  stub_add_integer(hDev, "WidthMax", stubWidth, 0);
+  stub_add_integer(hDev, "HeightMax", stubHeight, 0);
+  stub_add_integer(hDev, "Width", stubWidth, 1);
+  stub_add_integer(hDev, "Height", stubHeight, 1);
+  stub_add_integer(hDev, "OffsetX", 0, 1);
+  stub_add_integer(hDev, "OffsetY", 0, 1);
+  stub_add_boolean(hDev, "CenterX", 0, 1);
+  stub_add_boolean(hDev, "CenterY", 0, 1);
+  stub_add_boolean(hDev, "ReverseX", 0, 1);
+  stub_add_boolean(hDev, "ReverseY", 0, 1);
+  stub_add_integer(hDev, "BinningHorizontal", 1, 1);
+  stub_add_integer(hDev, "BinningVertical", 1, 1);
+  stub_add_string(hDev, "PixelFormat", "BayerRG8", 1);
+  stub_add_string(hDev, "PixelSize", "Bpp8", 0);
+  stub_add_string(hDev, "TestImageSelector", "Off", 1);
+  stub_add_integer(hDev, "PayloadSize", 0, 0);
+
+  // Acquisition and timing
+  stub_add_string(hDev, "SensorReadoutMode", "Normal", 1);
+  stub_add_float(hDev, "SensorReadoutTime", 0.0, 0);
+  stub_add_boolean(hDev, "AcquisitionFrameRateEnable", 0, 1);
+  stub_add_float_range(hDev, "AcquisitionFrameRate", 100.0, 1.0, 1000000.0, 1);
+  stub_add_float(hDev, "ResultingFrameRate", 0.0, 0);
+  stub_add_string(hDev, "AcquisitionMode", "Continuous", 1);
+  stub_add_string(hDev, "AcquisitionStatusSelector", "FrameTriggerWait", 1);
+  stub_add_boolean(hDev, "AcquisitionStatus", 1, 0);
+  stub_add_string(hDev, "TriggerSelector", "FrameStart", 1);
+  stub_add_string(hDev, "TriggerMode", "Off", 1);
+  stub_add_string(hDev, "TriggerSource", "Software", 1);
+  stub_add_command(hDev, "AcquisitionStart");
+  stub_add_command(hDev, "AcquisitionStop");
+  stub_add_command(hDev, "TriggerSoftware");
+  stub_add_command(hDev, "TimestampLatch");
+  stub_add_integer(hDev, "TimestampLatchValue", 0, 0);
+
+  // Transport layer
+  stub_add_string(hDev, "DeviceLinkThroughputLimitMode", "On", 1);
+  stub_add_integer(hDev, "DeviceLinkThroughputLimit", 360000000, 1);
+  stub_add_integer(hDev, "DeviceLinkCurrentThroughput", 0, 0);
+  stub_add_integer(hDev, "DeviceLinkSpeed", 400000000, 0);
+
+  // Image quality
+  stub_add_string(hDev, "ExposureAuto", "Off", 1);
+  stub_add_string(hDev, "GainAuto", "Off", 1);
+  stub_add_string(hDev, "BalanceWhiteAuto", "Off", 1);
+  stub_add_float(hDev, "ExposureTime", 5000.0, 1);
+  stub_add_float(hDev, "Gain", 0.0, 1);
+  stub_add_float(hDev, "BlackLevel", 0.0, 1);
+  stub_add_float(hDev, "Gamma", 1.0, 1);
+  stub_add_float(hDev, "AutoExposureTimeUpperLimit", 1000000.0, 1);
+  stub_add_float(hDev, "AutoExposureTimeLowerLimit", 105.0, 1);
+  stub_add_float(hDev, "AutoGainUpperLimit", 12.00921, 1);
+  stub_add_float(hDev, "AutoGainLowerLimit", 0.0, 1);
+  stub_add_float(hDev, "AutoTargetBrightness", 0.50196, 1);
+  stub_add_string(hDev, "AutoFunctionProfile", "MinimizeGain", 1);
+  stub_add_string(hDev, "LightSourcePreset", "Daylight5000K", 1);
+  stub_add_string(hDev, "BalanceRatioSelector", "Red", 1);
+  stub_add_float(hDev, "BalanceRatio", 1.0, 1);
+
+  // Chunk data
+  stub_add_boolean(hDev, "ChunkModeActive", 0, 1);
+  stub_add_string(hDev, "ChunkSelector", "ExposureTime", 1);
+  stub_add_boolean(hDev, "ChunkEnable", 0, 1);
+  stub_add_float(hDev, "ChunkExposureTime", 0.0, 0);
+  stub_add_float(hDev, "ChunkGain", 0.0, 0);
+  stub_add_integer(hDev, "ChunkLineStatusAll", 0, 0);
+  stub_add_integer(hDev, "ChunkCounterValue", 0, 0);
+  hDev->chunkEnabled = 0;
+  hDev->chunkAttached = 0;
+}
+
+/* Index of a chunk selector entry or chunk value feature in stubChunks, or -1 */
+static int
+stub_chunk_index(const char* pName, int column)
+{
+  int i;
+  for (i = 0; stubChunks[i][0] != NULL; i++) {
+    if (strcmp(stubChunks[i][column], pName) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Size of the image part of a frame, without chunk data */
+static int64_t
+stub_image_size(PYLON_DEVICE_HANDLE hDev)
+{
+  return stub_find(hDev, "Width")->i * stub_find(hDev, "Height")->i * stub_pixel_quarter_bytes(hDev) / 4;
+}
+
+/* Bytes per pixel times four, so that packed 10 bit formats stay integral. */
+static int64_t
+stub_pixel_quarter_bytes(PYLON_DEVICE_HANDLE hDev)
+{
+  const char* format = stub_find(hDev, "PixelFormat")->s;
+  size_t length = strlen(format);
+
+  if (strcmp(format, "RGB8") == 0 || strcmp(format, "BGR8") == 0) {
+    return 12;
+  } else if (strcmp(format, "YCbCr422_8") == 0) {
+    return 8;
+  } else if (length > 1 && strcmp(format + length - 1, "p") == 0) {
+    return 5;
+  } else if (length > 2 && (strcmp(format + length - 2, "10") == 0 || strcmp(format + length - 2, "12") == 0)) {
+    return 8;
+  }
+  return 4;
+}
+
+/* Recalculates read-only features that depend on the rest of the configuration. */
+static void
+stub_update(PYLON_DEVICE_HANDLE hDev)
+{
+  int64_t payload = stub_image_size(hDev);
+  double rate = stubFps > 0.0 ? stubFps : 1000000.0;
+
+  if (stub_find(hDev, "AcquisitionFrameRateEnable")->i && stub_find(hDev, "AcquisitionFrameRate")->f < rate) {
+    rate = stub_find(hDev, "AcquisitionFrameRate")->f;
+  }
+  if (strcmp(stub_find(hDev, "DeviceLinkThroughputLimitMode")->s, "On") == 0 && payload > 0) {
+    double limited = (double) stub_find(hDev, "DeviceLinkThroughputLimit")->i / payload;
+    if (limited < rate) {
+      rate = limited;
+    }
+  }
+
+  if (stub_find(hDev, "ChunkModeActive")->i) {
+    payload += sizeof(StubChunkData);
+  }
+  stub_find(hDev, "PayloadSize")->i = payload;
+  stub_find(hDev, "ResultingFrameRate")->f = rate;
+  stub_find(hDev, "DeviceLinkCurrentThroughput")->i = (int64_t) (payload * rate);
+  stub_find(hDev, "SensorReadoutTime")->f = 1000000.0 / rate;
+  snprintf(stub_find(hDev, "PixelSize")->s, STUB_STRING_LENGTH, "Bpp%d", (int) (stub_pixel_quarter_bytes(hDev) * 2));
+}
+
+/* Error reporting */
+GENAPIC_RESULT
+GenApiGetLastErrorMessage(char* pBuf, size_t* pBufLen)
+{
+  size_t length = strlen(lastError) + 1;
+
+  if (pBuf == NULL) {
+    *pBufLen = length;
+    return GENAPI_E_OK;
+  }
+  if (*pBufLen < length) {
+    return GENAPI_E_INSUFFICIENT_BUFFER;
+  }
+  memcpy(pBuf, lastError, length);
+  *pBufLen = length;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiGetLastErrorDetail(char* pBuf, size_t* pBufLen)
+{
+  return GenApiGetLastErrorMessage(pBuf, pBufLen);
+}
+
+/* Library */
+GENAPIC_RESULT
+PylonInitialize(void)
+{
+  stubCameras = (int) stub_env_double("PYLONSTUB_CAMERAS", 1);
+  if (stubCameras < 0) {
+    stubCameras = 0;
+  } else if (stubCameras > STUB_MAX_CAMERAS) {
+    stubCameras = STUB_MAX_CAMERAS;
+  }
+  stubWidth = (int64_t) stub_env_double("PYLONSTUB_WIDTH", 1920);
+  stubHeight = (int64_t) stub_env_double("PYLONSTUB_HEIGHT", 1200);
+  stubFps = stub_env_double("PYLONSTUB_FPS", 60.0);
+  stubDropRate = stub_env_double("PYLONSTUB_DROP_RATE", 0.0);
+  stubTimeoutRate = stub_env_double("PYLONSTUB_TIMEOUT_RATE", 0.0);
+  stubSeed = (unsigned int) stub_env_double("PYLONSTUB_SEED", 1);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonTerminate(void)
+{
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonEnumerateDevices(size_t* numDevices)
+{
+  *numDevices = (size_t) stubCameras;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonGetDeviceInfo(size_t index, PylonDeviceInfo_t* pDi)
+{
+  if (index >= (size_t) stubCameras) {
+    return stub_error(GENAPI_E_INVALID_ARG, "No device with index %s.", "requested");
+  }
+
+  memset(pDi, 0, sizeof(*pDi));
+  snprintf(pDi->SerialNumber, sizeof(pDi->SerialNumber), "%d", 22000000 + (int) index);
+  snprintf(pDi->FullName, sizeof(pDi->FullName), "Basler acA1920-155uc (stub) %s", pDi->SerialNumber);
+  snprintf(pDi->FriendlyName, sizeof(pDi->FriendlyName), "acA1920-155uc (%s)", pDi->SerialNumber);
+  snprintf(pDi->VendorName, sizeof(pDi->VendorName), "Basler");
+  snprintf(pDi->ModelName, sizeof(pDi->ModelName), "acA1920-155uc (stub)");
+  snprintf(pDi->DeviceClass, sizeof(pDi->DeviceClass), "BaslerUsb");
+  snprintf(pDi->DeviceVersion, sizeof(pDi->DeviceVersion), "stub");
+  return GENAPI_E_OK;
+}
+
+/* Devices */
+GENAPIC_RESULT
+PylonCreateDeviceByIndex(size_t index, PYLON_DEVICE_HANDLE* phDev)
+{
+  PYLON_DEVICE_HANDLE hDev;
+
+  if (index >= (size_t) stubCameras) {
+    return stub_error(GENAPI_E_INVALID_ARG, "No device with index %s.", "requested");
+  }
+
+  hDev = calloc(1, sizeof(*hDev));
+  hDev->index = index;
+  hDev->seed = stubSeed + (unsigned int) index;
+  hDev->grabber.device = hDev;
+  hDev->grabber.waitObject.grabber = &hDev->grabber;
+  pthread_mutex_init(&hDev->lock, NULL);
+  stub_init_features(hDev);
+  stub_update(hDev);
+
+  *phDev = hDev;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDestroyDevice(PYLON_DEVICE_HANDLE hDev)
+{
+  if (hDev == NULL) {
+    return stub_error(GENAPI_E_INVALID_ARG, "Invalid %s handle.", "device");
+  }
+  if (hDev->open) {
+    PylonDeviceClose(hDev);
+  }
+  pthread_mutex_destroy(&hDev->lock);
+  free(hDev);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDeviceOpen(PYLON_DEVICE_HANDLE hDev, int accessMode)
+{
+  GENAPIC_RESULT res = GENAPI_E_OK;
+  (void) accessMode;
+
+  pthread_mutex_lock(&stubLock);
+  if (deviceOpen[hDev->index]) {
+    res = stub_error(GENAPI_E_ACCESS_DENIED, "The %s is already in use.", "device");
+  } else {
+    deviceOpen[hDev->index] = 1;
+    hDev->open = 1;
+    clock_gettime(CLOCK_MONOTONIC, &hDev->epoch);
+  }
+  pthread_mutex_unlock(&stubLock);
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceClose(PYLON_DEVICE_HANDLE hDev)
+{
+  if (hDev->grabber.open) {
+    PylonStreamGrabberClose(&hDev->grabber);
+  }
+
+  pthread_mutex_lock(&stubLock);
+  if (hDev->open) {
+    deviceOpen[hDev->index] = 0;
+    hDev->open = 0;
+  }
+  pthread_mutex_unlock(&stubLock);
+  return GENAPI_E_OK;
+}
+
+/* Features */
+_Bool
+PylonDeviceFeatureIsImplemented(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  size_t i;
+
+  if (strncmp(pName, "EnumEntry_", 10) == 0) {
+    for (i = 0; stubEnumEntries[i] != NULL; i++) {
+      if (strcmp(stubEnumEntries[i], pName) == 0) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  return stub_find(hDev, pName) != NULL;
+}
+
+_Bool
+PylonDeviceFeatureIsAvailable(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  return PylonDeviceFeatureIsImplemented(hDev, pName);
+}
+
+_Bool
+PylonDeviceFeatureIsReadable(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  StubFeature* feature = stub_find(hDev, pName);
+  int chunk = stub_chunk_index(pName, 1);
+
+  if (chunk >= 0) {
+    return (hDev->chunkAttached & (1u << chunk)) != 0;
+  }
+  return feature != NULL && feature->type != STUB_COMMAND;
+}
+
+_Bool
+PylonDeviceFeatureIsWritable(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  StubFeature* feature = stub_find(hDev, pName);
+  return feature != NULL && feature->writable;
+}
+
+static GENAPIC_RESULT
+stub_lookup(PYLON_DEVICE_HANDLE hDev, const char* pName, StubFeatureType type, _Bool write, StubFeature** pFeature)
+{
+  StubFeature* feature = stub_find(hDev, pName);
+
+  if (feature == NULL) {
+    return stub_error(GENAPI_E_NODE_NOT_FOUND, "Node not existing (file 'PylonC.cpp', node '%s').", pName);
+  }
+  if (feature->type != type) {
+    return stub_error(GENAPI_E_INVALID_ARG, "Node '%s' has a different type.", pName);
+  }
+  if (write && !feature->writable) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "Node '%s' is not writable.", pName);
+  }
+  *pFeature = feature;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDeviceSetIntegerFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, int64_t value)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_INTEGER, 1, &feature);
+
+  if (res == GENAPI_E_OK) {
+    if ((strcmp(pName, "Width") == 0 && (value < 1 || value > stubWidth)) ||
+        (strcmp(pName, "Height") == 0 && (value < 1 || value > stubHeight))) {
+      return stub_error(GENAPI_E_INVALID_ARG, "Value for '%s' is out of range.", pName);
+    }
+    pthread_mutex_lock(&hDev->lock);
+    feature->i = value;
+    stub_update(hDev);
+    pthread_mutex_unlock(&hDev->lock);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetIntegerFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, int64_t* pValue)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_INTEGER, 0, &feature);
+
+  if (res == GENAPI_E_OK) {
+    *pValue = feature->i;
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetIntegerFeatureInt32(PYLON_DEVICE_HANDLE hDev, const char* pName, int32_t* pValue)
+{
+  int64_t value = 0;
+  GENAPIC_RESULT res = PylonDeviceGetIntegerFeature(hDev, pName, &value);
+
+  if (res == GENAPI_E_OK) {
+    *pValue = (int32_t) value;
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceSetFloatFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, double value)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_FLOAT, 1, &feature);
+
+  if (res == GENAPI_E_OK && (value < feature->min || value > feature->max)) {
+    return stub_error(GENAPI_E_INVALID_ARG, "Value out of range for %s.", pName);
+  }
+  if (res == GENAPI_E_OK) {
+    pthread_mutex_lock(&hDev->lock);
+    feature->f = value;
+    stub_update(hDev);
+    pthread_mutex_unlock(&hDev->lock);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetFloatFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, double* pValue)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_FLOAT, 0, &feature);
+
+  if (res == GENAPI_E_OK) {
+    *pValue = feature->f;
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetFloatFeatureMin(PYLON_DEVICE_HANDLE hDev, const char* pName, double* pValue)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_FLOAT, 0, &feature);
+
+  if (res == GENAPI_E_OK) {
+    *pValue = feature->min;
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetFloatFeatureMax(PYLON_DEVICE_HANDLE hDev, const char* pName, double* pValue)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_FLOAT, 0, &feature);
+
+  if (res == GENAPI_E_OK) {
+    *pValue = feature->max;
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceSetBooleanFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, _Bool value)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_BOOLEAN, 1, &feature);
+
+  if (res == GENAPI_E_OK) {
+    pthread_mutex_lock(&hDev->lock);
+    feature->i = value;
+    if (strcmp(pName, "ChunkEnable") == 0) {
+      uint32_t bit = 1u << stub_chunk_index(stub_find(hDev, "ChunkSelector")->s, 0);
+      hDev->chunkEnabled = value ? hDev->chunkEnabled | bit : hDev->chunkEnabled & ~bit;
+    }
+    stub_update(hDev);
+    pthread_mutex_unlock(&hDev->lock);
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetBooleanFeature(PYLON_DEVICE_HANDLE hDev, const char* pName, _Bool* pValue)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_BOOLEAN, 0, &feature);
+
+  if (res == GENAPI_E_OK) {
+    *pValue = feature->i != 0;
+  }
+  return res;
+}
+
+GENAPIC_RESULT
+PylonDeviceFeatureFromString(PYLON_DEVICE_HANDLE hDev, const char* pName, const char* pValue)
+{
+  StubFeature* feature = stub_find(hDev, pName);
+  char entry[STUB_NAME_LENGTH * 2];
+
+  if (feature == NULL) {
+    return stub_error(GENAPI_E_NODE_NOT_FOUND, "Node not existing (file 'PylonC.cpp', node '%s').", pName);
+  }
+  if (!feature->writable) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "Node '%s' is not writable.", pName);
+  }
+
+  if (strcmp(pName, "PixelFormat") == 0 || strcmp(pName, "TriggerSelector") == 0 || strcmp(pName, "ChunkSelector") == 0) {
+    snprintf(entry, sizeof(entry), "EnumEntry_%s_%s", pName, pValue);
+    if (!PylonDeviceFeatureIsImplemented(hDev, entry)) {
+      return stub_error(GENAPI_E_INVALID_ARG, "Feature value '%s' is not supported.", pValue);
+    }
+  }
+
+  pthread_mutex_lock(&hDev->lock);
+  switch (feature->type) {
+    case STUB_INTEGER:
+      feature->i = strtoll(pValue, NULL, 10);
+      break;
+    case STUB_FLOAT:
+      feature->f = strtod(pValue, NULL);
+      break;
+    case STUB_BOOLEAN:
+      feature->i = strcmp(pValue, "1") == 0 || strcmp(pValue, "true") == 0;
+      break;
+    default:
+      snprintf(feature->s, STUB_STRING_LENGTH, "%s", pValue);
+      break;
+  }
+  if (strcmp(pName, "ChunkSelector") == 0) {
+    stub_find(hDev, "ChunkEnable")->i = (hDev->chunkEnabled >> stub_chunk_index(pValue, 0)) & 1;
+  }
+  stub_update(hDev);
+  pthread_mutex_unlock(&hDev->lock);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDeviceFeatureToString(PYLON_DEVICE_HANDLE hDev, const char* pName, char* pBuf, size_t* pBufLen)
+{
+  StubFeature* feature = stub_find(hDev, pName);
+  char value[STUB_STRING_LENGTH];
+  size_t length;
+
+  if (feature == NULL) {
+    return stub_error(GENAPI_E_NODE_NOT_FOUND, "Node not existing (file 'PylonC.cpp', node '%s').", pName);
+  }
+
+  switch (feature->type) {
+    case STUB_INTEGER:
+    case STUB_BOOLEAN:
+      snprintf(value, sizeof(value), "%lld", (long long) feature->i);
+      break;
+    case STUB_FLOAT:
+      snprintf(value, sizeof(value), "%f", feature->f);
+      break;
+    case STUB_STRING:
+      snprintf(value, sizeof(value), "%s", feature->s);
+      break;
+    default:
+      return stub_error(GENAPI_E_INVALID_ARG, "Node '%s' is not readable.", pName);
+  }
+
+  length = strlen(value) + 1;
+  if (pBuf == NULL) {
+    *pBufLen = length;
+    return GENAPI_E_OK;
+  }
+  if (*pBufLen < length) {
+    *pBufLen = length;
+    return stub_error(GENAPI_E_INSUFFICIENT_BUFFER, "Buffer too small for '%s'.", pName);
+  }
+  memcpy(pBuf, value, length);
+  *pBufLen = length;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDeviceExecuteCommandFeature(PYLON_DEVICE_HANDLE hDev, const char* pName)
+{
+  StubFeature* feature;
+  GENAPIC_RESULT res = stub_lookup(hDev, pName, STUB_COMMAND, 1, &feature);
+
+  if (res != GENAPI_E_OK) {
+    return res;
+  }
+
+  pthread_mutex_lock(&hDev->lock);
+  if (strcmp(pName, "AcquisitionStart") == 0) {
+    hDev->acquiring = 1;
+    hDev->pendingTriggers = 0;
+    clock_gettime(CLOCK_MONOTONIC, &hDev->nextFrame);
+  } else if (strcmp(pName, "AcquisitionStop") == 0) {
+    hDev->acquiring = 0;
+  } else if (strcmp(pName, "TriggerSoftware") == 0) {
+    hDev->pendingTriggers++;
+  } else if (strcmp(pName, "TimestampLatch") == 0) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    stub_find(hDev, "TimestampLatchValue")->i = (int64_t) (stub_timespec_ns(&now) - stub_timespec_ns(&hDev->epoch));
+  } else if (strcmp(pName, "DeviceReset") == 0) {
+    hDev->numFeatures = 0;
+    stub_init_features(hDev);
+    stub_update(hDev);
+  }
+  pthread_mutex_unlock(&hDev->lock);
+  stub_wake();
+  return GENAPI_E_OK;
+}
+
+/* Stream grabbers */
+GENAPIC_RESULT
+PylonDeviceGetNumStreamGrabberChannels(PYLON_DEVICE_HANDLE hDev, size_t* pNumChannels)
+{
+  *pNumChannels = hDev->open ? 1 : 0;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDeviceGetStreamGrabber(PYLON_DEVICE_HANDLE hDev, size_t index, PYLON_STREAMGRABBER_HANDLE* phStg)
+{
+  if (index != 0 || !hDev->open) {
+    return stub_error(GENAPI_E_INVALID_ARG, "No %s stream grabber.", "such");
+  }
+  *phStg = &hDev->grabber;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberOpen(PYLON_STREAMGRABBER_HANDLE hStg)
+{
+  // Same defaults and limits as the USB3 stream grabber
+  const struct _PylonStubNode defaults[STUB_MAX_NODES] = {
+    { hStg, "MaxTransferSize", 262144, 1024, 4194304, 1024 },
+    { hStg, "NumMaxQueuedUrbs", 64, 1, 4096, 1 },
+    { hStg, "TransferLoopThreadPriority", 25, 1, 99, 1 }
+  };
+
+  hStg->open = 1;
+  hStg->maxNumBuffer = 16;
+  hStg->maxBufferSize = 0;
+  memcpy(hStg->nodeMap.nodes, defaults, sizeof(defaults));
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberClose(PYLON_STREAMGRABBER_HANDLE hStg)
+{
+  size_t i;
+
+  if (hStg->prepared) {
+    PylonStreamGrabberFinishGrab(hStg);
+  }
+  for (i = 0; i < hStg->numRegistered; i++) {
+    free(hStg->registered[i]);
+  }
+  free(hStg->registered);
+  hStg->registered = NULL;
+  hStg->numRegistered = 0;
+  hStg->open = 0;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberGetWaitObject(PYLON_STREAMGRABBER_HANDLE hStg, PYLON_WAITOBJECT_HANDLE* phWobj)
+{
+  *phWobj = &hStg->waitObject;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberSetMaxNumBuffer(PYLON_STREAMGRABBER_HANDLE hStg, size_t numBuffers)
+{
+  if (hStg->prepared || numBuffers == 0) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "Can't change %s while grabbing.", "MaxNumBuffer");
+  }
+  hStg->maxNumBuffer = numBuffers;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberSetMaxBufferSize(PYLON_STREAMGRABBER_HANDLE hStg, size_t maxSize)
+{
+  if (hStg->prepared) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "Can't change %s while grabbing.", "MaxBufferSize");
+  }
+  hStg->maxBufferSize = maxSize;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberPrepareGrab(PYLON_STREAMGRABBER_HANDLE hStg)
+{
+  size_t i;
+
+  if (!hStg->open) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The %s isn't open.", "stream grabber");
+  }
+
+  // MaxNumBuffer may have changed since the last grab, so handles left over from it are dropped along with their array.
+  for (i = 0; i < hStg->numRegistered; i++) {
+    free(hStg->registered[i]);
+  }
+  free(hStg->registered);
+  hStg->numRegistered = 0;
+  hStg->registered = calloc(hStg->maxNumBuffer, sizeof(PYLON_STREAMBUFFER_HANDLE));
+  hStg->input = calloc(hStg->maxNumBuffer, sizeof(PYLON_STREAMBUFFER_HANDLE));
+  hStg->output = calloc(hStg->maxNumBuffer, sizeof(PylonGrabResult_t));
+  hStg->inputHead = hStg->inputCount = 0;
+  hStg->outputHead = hStg->outputCount = 0;
+
+  // A gradient twice as wide as a row, so that every row of every frame is a single memcpy out of it.
+  hStg->patternSize = hStg->maxBufferSize + STUB_PATTERN_PERIOD;
+  hStg->pattern = malloc(hStg->patternSize);
+  for (i = 0; i < hStg->patternSize; i++) {
+    hStg->pattern[i] = (unsigned char) (i % STUB_PATTERN_PERIOD);
+  }
+
+  hStg->prepared = 1;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberFinishGrab(PYLON_STREAMGRABBER_HANDLE hStg)
+{
+  free(hStg->input);
+  free(hStg->output);
+  free(hStg->pattern);
+  hStg->input = NULL;
+  hStg->output = NULL;
+  hStg->pattern = NULL;
+  hStg->inputCount = hStg->outputCount = 0;
+  hStg->prepared = 0;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberRegisterBuffer(PYLON_STREAMGRABBER_HANDLE hStg, void* pBuffer, size_t bufLen, PYLON_STREAMBUFFER_HANDLE* phBuf)
+{
+  PYLON_STREAMBUFFER_HANDLE hBuf;
+
+  if (!hStg->prepared || hStg->numRegistered >= hStg->maxNumBuffer) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "Can't register any more %s.", "buffers");
+  }
+  if (bufLen > hStg->maxBufferSize) {
+    return stub_error(GENAPI_E_INVALID_ARG, "The %s is larger than MaxBufferSize.", "buffer");
+  }
+
+  hBuf = calloc(1, sizeof(*hBuf));
+  hBuf->data = pBuffer;
+  hBuf->size = bufLen;
+  hStg->registered[hStg->numRegistered++] = hBuf;
+  *phBuf = hBuf;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberDeregisterBuffer(PYLON_STREAMGRABBER_HANDLE hStg, PYLON_STREAMBUFFER_HANDLE hBuf)
+{
+  size_t i;
+
+  for (i = 0; i < hStg->numRegistered; i++) {
+    if (hStg->registered[i] == hBuf) {
+      hStg->registered[i] = hStg->registered[--hStg->numRegistered];
+      free(hBuf);
+      return GENAPI_E_OK;
+    }
+  }
+  return stub_error(GENAPI_E_INVALID_ARG, "Unknown %s handle.", "buffer");
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberQueueBuffer(PYLON_STREAMGRABBER_HANDLE hStg, PYLON_STREAMBUFFER_HANDLE hBuf, const void* pContext)
+{
+  GENAPIC_RESULT res = GENAPI_E_OK;
+
+  pthread_mutex_lock(&hStg->device->lock);
+  if (!hStg->prepared || hStg->inputCount + hStg->outputCount >= hStg->maxNumBuffer) {
+    res = stub_error(GENAPI_E_ACCESS_DENIED, "Can't queue any more %s.", "buffers");
+  } else {
+    hBuf->context = pContext;
+    hStg->input[(hStg->inputHead + hStg->inputCount++) % hStg->maxNumBuffer] = hBuf;
+  }
+  pthread_mutex_unlock(&hStg->device->lock);
+  stub_wake();
+  return res;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberRetrieveResult(PYLON_STREAMGRABBER_HANDLE hStg, PylonGrabResult_t* pGrabResult, _Bool* pReady)
+{
+  pthread_mutex_lock(&hStg->device->lock);
+  *pReady = hStg->outputCount > 0;
+  if (*pReady) {
+    *pGrabResult = hStg->output[hStg->outputHead];
+    hStg->outputHead = (hStg->outputHead + 1) % hStg->maxNumBuffer;
+    hStg->outputCount--;
+  }
+  pthread_mutex_unlock(&hStg->device->lock);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberCancelGrab(PYLON_STREAMGRABBER_HANDLE hStg)
+{
+  pthread_mutex_lock(&hStg->device->lock);
+  while (hStg->inputCount > 0) {
+    PylonGrabResult_t* result = &hStg->output[(hStg->outputHead + hStg->outputCount++) % hStg->maxNumBuffer];
+    PYLON_STREAMBUFFER_HANDLE hBuf = hStg->input[hStg->inputHead];
+
+    memset(result, 0, sizeof(*result));
+    result->hBuffer = hBuf;
+    result->pBuffer = hBuf->data;
+    result->Context = hBuf->context;
+    result->Status = Canceled;
+    hStg->inputHead = (hStg->inputHead + 1) % hStg->maxNumBuffer;
+    hStg->inputCount--;
+  }
+  pthread_mutex_unlock(&hStg->device->lock);
+  stub_wake();
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberFlushBuffersToOutput(PYLON_STREAMGRABBER_HANDLE hStg)
+{
+  return PylonStreamGrabberCancelGrab(hStg);
+}
+
+GENAPIC_RESULT
+PylonStreamGrabberGetNodeMap(PYLON_STREAMGRABBER_HANDLE hStg, NODEMAP_HANDLE* phMap)
+{
+  if (!hStg->open) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The %s isn't open.", "stream grabber");
+  }
+  *phMap = &hStg->nodeMap;
+  return GENAPI_E_OK;
+}
+
+/* Node maps */
+GENAPIC_RESULT
+PylonDeviceGetNodeMap(PYLON_DEVICE_HANDLE hDev, NODEMAP_HANDLE* phMap)
+{
+  if (!hDev->open) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The %s isn't open.", "device");
+  }
+  hDev->nodeMap.device = hDev;
+  *phMap = &hDev->nodeMap;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiNodeMapGetNode(NODEMAP_HANDLE hMap, const char* pName, NODE_HANDLE* phNode)
+{
+  StubFeature* feature;
+  size_t i;
+
+  *phNode = GENAPIC_INVALID_HANDLE;
+  if (hMap->device) {
+    feature = stub_find(hMap->device, pName);
+    if (feature) {
+      *phNode = &hMap->device->featureNodes[feature - hMap->device->features];
+      (*phNode)->device = hMap->device;
+      (*phNode)->name = feature->name;
+    }
+    return GENAPI_E_OK;
+  }
+  for (i = 0; i < STUB_MAX_NODES; i++) {
+    if (strcmp(hMap->nodes[i].name, pName) == 0) {
+      *phNode = &hMap->nodes[i];
+    }
+  }
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiNodeIsReadable(NODE_HANDLE hNode, _Bool* pResult)
+{
+  if (hNode->device) {
+    *pResult = PylonDeviceFeatureIsReadable(hNode->device, hNode->name);
+    return GENAPI_E_OK;
+  }
+  *pResult = hNode->grabber->open;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiNodeIsWritable(NODE_HANDLE hNode, _Bool* pResult)
+{
+  if (hNode->device) {
+    *pResult = PylonDeviceFeatureIsWritable(hNode->device, hNode->name);
+    return GENAPI_E_OK;
+  }
+  *pResult = hNode->grabber->open && !hNode->grabber->prepared;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiIntegerSetValue(NODE_HANDLE hNode, int64_t value)
+{
+  _Bool writable;
+
+  if (hNode->device) {
+    return PylonDeviceSetIntegerFeature(hNode->device, hNode->name, value);
+  }
+  GenApiNodeIsWritable(hNode, &writable);
+  if (!writable) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "Can't change %s while grabbing.", hNode->name);
+  }
+  if (value < hNode->min || value > hNode->max || (value - hNode->min) % hNode->inc != 0) {
+    return stub_error(GENAPI_E_INVALID_ARG, "Value out of range for %s.", hNode->name);
+  }
+  hNode->value = value;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiIntegerGetValue(NODE_HANDLE hNode, int64_t* pValue)
+{
+  if (hNode->device) {
+    return PylonDeviceGetIntegerFeature(hNode->device, hNode->name, pValue);
+  }
+  *pValue = hNode->value;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiIntegerGetMin(NODE_HANDLE hNode, int64_t* pValue)
+{
+  if (hNode->device) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The stub has no limits for '%s'.", hNode->name);
+  }
+  *pValue = hNode->min;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiIntegerGetMax(NODE_HANDLE hNode, int64_t* pValue)
+{
+  if (hNode->device) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The stub has no limits for '%s'.", hNode->name);
+  }
+  *pValue = hNode->max;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiIntegerGetInc(NODE_HANDLE hNode, int64_t* pValue)
+{
+  if (hNode->device) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The stub has no limits for '%s'.", hNode->name);
+  }
+  *pValue = hNode->inc;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+GenApiFloatGetValue(NODE_HANDLE hNode, double* pValue)
+{
+  if (!hNode->device) {
+    return stub_error(GENAPI_E_INVALID_ARG, "Node '%s' has a different type.", hNode->name);
+  }
+  return PylonDeviceGetFloatFeature(hNode->device, hNode->name, pValue);
+}
+
+/* Fills the oldest queued buffer with the next frame. Called with the device lock held. */
+static void
+stub_produce_frame(PYLON_STREAMGRABBER_HANDLE hStg, _Bool failed)
+{
+  PYLON_DEVICE_HANDLE hDev = hStg->device;
+  PYLON_STREAMBUFFER_HANDLE hBuf = hStg->input[hStg->inputHead];
+  PylonGrabResult_t* result = &hStg->output[(hStg->outputHead + hStg->outputCount) % hStg->maxNumBuffer];
+  int64_t width = stub_find(hDev, "Width")->i;
+  int64_t height = stub_find(hDev, "Height")->i;
+  size_t payload = (size_t) stub_find(hDev, "PayloadSize")->i;
+  size_t image = (size_t) stub_image_size(hDev);
+  size_t stride = height > 0 ? image / height : 0;
+  _Bool chunks = stub_find(hDev, "ChunkModeActive")->i != 0;
+  struct timespec now;
+  int64_t y;
+
+  if (payload > hBuf->size) {
+    payload = hBuf->size;
+    failed = 1;
+  }
+
+  memset(result, 0, sizeof(*result));
+  result->hBuffer = hBuf;
+  result->pBuffer = hBuf->data;
+  result->Context = hBuf->context;
+  result->PayloadType = chunks ? PayloadType_ChunkData : PayloadType_Image;
+  result->SizeX = (int32_t) width;
+  result->SizeY = (int32_t) height;
+  result->OffsetX = (int32_t) stub_find(hDev, "OffsetX")->i;
+  result->OffsetY = (int32_t) stub_find(hDev, "OffsetY")->i;
+  result->BlockID = ++hDev->frameCounter;
+
+  if (failed) {
+    result->Status = Failed;
+    result->ErrorCode = 0xE1000014; // The buffer was incompletely grabbed.
+  } else {
+    for (y = 0; y < height && (size_t) (y + 1) * stride <= payload && stride + STUB_PATTERN_PERIOD <= hStg->patternSize; y++) {
+      memcpy((unsigned char*) hBuf->data + y * stride, hStg->pattern + (y + hDev->frameCounter) % STUB_PATTERN_PERIOD, stride);
+    }
+    if (chunks && image + sizeof(StubChunkData) <= payload) {
+      StubChunkData chunk;
+      _Bool autoExposure = strcmp(stub_find(hDev, "ExposureAuto")->s, "Off") != 0;
+      _Bool autoGain = strcmp(stub_find(hDev, "GainAuto")->s, "Off") != 0;
+
+      // Auto functions make the values drift from frame to frame, like they would on a real camera
+      chunk.magic = STUB_CHUNK_MAGIC;
+      chunk.enabled = hDev->chunkEnabled;
+      chunk.exposureTime = stub_find(hDev, "ExposureTime")->f + (autoExposure ? (double) (hDev->frameCounter % 16) * 10.0 : 0.0);
+      chunk.gain = stub_find(hDev, "Gain")->f + (autoGain ? (double) (hDev->frameCounter % 8) * 0.1 : 0.0);
+      chunk.lineStatus = (int64_t) (hDev->frameCounter & 1);
+      chunk.counterValue = (int64_t) hDev->frameCounter;
+      memcpy((unsigned char*) hBuf->data + payload - sizeof(chunk), &chunk, sizeof(chunk));
+    }
+    result->Status = Grabbed;
+    result->PayloadSize = payload;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  result->TimeStamp = stub_timespec_ns(&now) - stub_timespec_ns(&hDev->epoch);
+
+  hStg->inputHead = (hStg->inputHead + 1) % hStg->maxNumBuffer;
+  hStg->inputCount--;
+  hStg->outputCount++;
+}
+
+/* Chunk parsers */
+GENAPIC_RESULT
+PylonDeviceCreateChunkParser(PYLON_DEVICE_HANDLE hDev, PYLON_CHUNKPARSER_HANDLE* phChunkParser)
+{
+  PYLON_CHUNKPARSER_HANDLE hChunkParser = calloc(1, sizeof(*hChunkParser));
+
+  hChunkParser->device = hDev;
+  *phChunkParser = hChunkParser;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonDeviceDestroyChunkParser(PYLON_DEVICE_HANDLE hDev, PYLON_CHUNKPARSER_HANDLE hChunkParser)
+{
+  if (hChunkParser == NULL || hChunkParser->device != hDev) {
+    return stub_error(GENAPI_E_INVALID_ARG, "Invalid %s handle.", "chunk parser");
+  }
+  hDev->chunkAttached = 0;
+  free(hChunkParser);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonChunkParserAttachBuffer(PYLON_CHUNKPARSER_HANDLE hChunkParser, const void* pBuffer, size_t BufLen)
+{
+  PYLON_DEVICE_HANDLE hDev = hChunkParser->device;
+  StubChunkData chunk;
+
+  if (BufLen < sizeof(chunk)) {
+    return stub_error(GENAPI_E_INVALID_ARG, "The %s contains no chunk data.", "buffer");
+  }
+  memcpy(&chunk, (const unsigned char*) pBuffer + BufLen - sizeof(chunk), sizeof(chunk));
+  if (chunk.magic != STUB_CHUNK_MAGIC) {
+    return stub_error(GENAPI_E_INVALID_ARG, "The %s contains no chunk data.", "buffer");
+  }
+
+  pthread_mutex_lock(&hDev->lock);
+  stub_find(hDev, "ChunkExposureTime")->f = chunk.exposureTime;
+  stub_find(hDev, "ChunkGain")->f = chunk.gain;
+  stub_find(hDev, "ChunkLineStatusAll")->i = chunk.lineStatus;
+  stub_find(hDev, "ChunkCounterValue")->i = chunk.counterValue;
+  hDev->chunkAttached = chunk.enabled;
+  pthread_mutex_unlock(&hDev->lock);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonChunkParserDetachBuffer(PYLON_CHUNKPARSER_HANDLE hChunkParser)
+{
+  hChunkParser->device->chunkAttached = 0;
+  return GENAPI_E_OK;
+}
+
+/* Wait objects */
+
+/* Works out when the grabber's next frame is due. Returns 0 if no frame will come until something changes
+ * (not grabbing, no buffers queued or waiting for a software trigger). Called with the device lock held. */
+static _Bool
+stub_next_frame(PYLON_STREAMGRABBER_HANDLE hStg, uint64_t now, uint64_t* due)
+{
+  PYLON_DEVICE_HANDLE hDev = hStg->device;
+  _Bool hardwareTrigger, triggered;
+  uint64_t period;
+
+  hardwareTrigger = strcmp(stub_find(hDev, "TriggerMode")->s, "On") == 0 && strcmp(stub_find(hDev, "TriggerSource")->s, "Software") != 0;
+  triggered = strcmp(stub_find(hDev, "TriggerMode")->s, "Off") == 0 || hDev->pendingTriggers > 0 || hardwareTrigger;
+  if (!hStg->prepared || !hDev->acquiring || hStg->inputCount == 0 || !triggered) {
+    return 0;
+  }
+
+  if (hardwareTrigger && stubFps > 0.0) {
+    // The shared trigger line fires on multiples of its period, so all the cameras on it take their frames at the same time.
+    // A camera that wasn't ready for some of the pulses takes its frame on the latest one.
+    period = (uint64_t) (1000000000.0 / stubFps);
+    *due = (stub_timespec_ns(&hDev->nextFrame) + period - 1) / period * period;
+    if (*due + period <= now) {
+      *due = now / period * period;
+    }
+  } else {
+    // A camera that fell behind doesn't burst out the frames it missed.
+    *due = stub_timespec_ns(&hDev->nextFrame) > now ? stub_timespec_ns(&hDev->nextFrame) : now;
+  }
+  return 1;
+}
+
+/* Takes the frame that was due and schedules the next one. A frame that gets lost holds the grabber back until the
+ * waiter's deadline, so that its wait times out. Called with the device lock held. */
+static void
+stub_take_frame(PYLON_STREAMGRABBER_HANDLE hStg, uint64_t due, uint64_t deadline)
+{
+  PYLON_DEVICE_HANDLE hDev = hStg->device;
+  _Bool hardwareTrigger = strcmp(stub_find(hDev, "TriggerMode")->s, "On") == 0 && strcmp(stub_find(hDev, "TriggerSource")->s, "Software") != 0;
+  double roll;
+
+  stub_timespec_set_ns(&hDev->nextFrame, due);
+  if (hardwareTrigger && stubFps > 0.0) {
+    stub_timespec_add_ns(&hDev->nextFrame, (uint64_t) (1000000000.0 / stubFps));
+  } else if (stubFps > 0.0) {
+    stub_timespec_add_ns(&hDev->nextFrame, (uint64_t) (1000000000.0 / stub_find(hDev, "ResultingFrameRate")->f));
+  }
+  if (hDev->pendingTriggers > 0) {
+    hDev->pendingTriggers--;
+  }
+
+  roll = (double) rand_r(&hDev->seed) / RAND_MAX;
+  if (roll < stubTimeoutRate) {
+    stub_timespec_set_ns(&hDev->nextFrame, deadline);
+    return;
+  }
+  roll = (double) rand_r(&hDev->seed) / RAND_MAX;
+  stub_produce_frame(hStg, roll < stubDropRate);
+}
+
+/* Waits until one of the wait objects is signalled, producing the grabbers' frames as they come due. */
+static GENAPIC_RESULT
+stub_wait_any(PYLON_WAITOBJECT_HANDLE* objects, size_t count, uint32_t timeout, size_t* pIndex, _Bool* pResult)
+{
+  PYLON_STREAMGRABBER_HANDLE hStg;
+  struct timespec now, wakeAt;
+  uint64_t deadline, due, earliest;
+  unsigned int wakeCount;
+  size_t i, next;
+
+  pthread_once(&stubWakeOnce, stub_wake_init);
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  deadline = stub_timespec_ns(&now) + (uint64_t) timeout * 1000000ULL;
+
+  while (1) {
+    pthread_mutex_lock(&stubWakeLock);
+    wakeCount = stubWakeCount;
+    pthread_mutex_unlock(&stubWakeLock);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    earliest = deadline;
+    next = count;
+    for (i = 0; i < count; i++) {
+      hStg = objects[i]->grabber;
+      if (!hStg) {
+        if (objects[i]->signaled) {
+          *pIndex = i;
+          *pResult = 1;
+          return GENAPI_E_OK;
+        }
+        continue;
+      }
+
+      pthread_mutex_lock(&hStg->device->lock);
+      if (hStg->outputCount > 0) {
+        pthread_mutex_unlock(&hStg->device->lock);
+        *pIndex = i;
+        *pResult = 1;
+        return GENAPI_E_OK;
+      }
+      if (stub_next_frame(hStg, stub_timespec_ns(&now), &due) && due < earliest) {
+        earliest = due;
+        next = i;
+      }
+      pthread_mutex_unlock(&hStg->device->lock);
+    }
+
+    if (next < count && earliest <= stub_timespec_ns(&now)) {
+      hStg = objects[next]->grabber;
+      pthread_mutex_lock(&hStg->device->lock);
+      if (stub_next_frame(hStg, stub_timespec_ns(&now), &due) && due <= stub_timespec_ns(&now)) {
+        stub_take_frame(hStg, due, deadline);
+      }
+      pthread_mutex_unlock(&hStg->device->lock);
+      continue;
+    }
+
+    if (stub_timespec_ns(&now) >= deadline) {
+      *pResult = 0;
+      return GENAPI_E_OK;
+    }
+
+    // Sleep until the next frame is due, or until something changes
+    stub_timespec_set_ns(&wakeAt, earliest);
+    pthread_mutex_lock(&stubWakeLock);
+    while (wakeCount == stubWakeCount && pthread_cond_timedwait(&stubWake, &stubWakeLock, &wakeAt) != ETIMEDOUT);
+    pthread_mutex_unlock(&stubWakeLock);
+  }
+}
+
+GENAPIC_RESULT
+PylonWaitObjectWait(PYLON_WAITOBJECT_HANDLE hWobj, uint32_t timeout, _Bool* pResult)
+{
+  size_t index;
+  return stub_wait_any(&hWobj, 1, timeout, &index, pResult);
+}
+
+GENAPIC_RESULT
+PylonWaitObjectCreate(PYLON_WAITOBJECT_HANDLE* phWobj)
+{
+  *phWobj = calloc(1, sizeof(**phWobj));
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectDestroy(PYLON_WAITOBJECT_HANDLE hWobj)
+{
+  if (hWobj->grabber) {
+    return stub_error(GENAPI_E_ACCESS_DENIED, "The %s wait object belongs to a stream grabber.", "given");
+  }
+  free(hWobj);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectSignal(PYLON_WAITOBJECT_HANDLE hWobj)
+{
+  pthread_mutex_lock(&stubWakeLock);
+  hWobj->signaled = 1;
+  pthread_mutex_unlock(&stubWakeLock);
+  stub_wake();
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectReset(PYLON_WAITOBJECT_HANDLE hWobj)
+{
+  pthread_mutex_lock(&stubWakeLock);
+  hWobj->signaled = 0;
+  pthread_mutex_unlock(&stubWakeLock);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectsCreate(PYLON_WAITOBJECTS_HANDLE* phWos)
+{
+  *phWos = calloc(1, sizeof(**phWos));
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectsDestroy(PYLON_WAITOBJECTS_HANDLE hWos)
+{
+  free(hWos);
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectsAdd(PYLON_WAITOBJECTS_HANDLE hWos, PYLON_WAITOBJECT_HANDLE hWobj, size_t* pIndex)
+{
+  if (hWos->count >= STUB_MAX_WAITOBJECTS) {
+    return stub_error(GENAPI_E_INSUFFICIENT_BUFFER, "Too many %s in the set.", "wait objects");
+  }
+  if (pIndex) {
+    *pIndex = hWos->count;
+  }
+  hWos->objects[hWos->count++] = hWobj;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectsRemoveAll(PYLON_WAITOBJECTS_HANDLE hWos)
+{
+  hWos->count = 0;
+  return GENAPI_E_OK;
+}
+
+GENAPIC_RESULT
+PylonWaitObjectsWaitForAny(PYLON_WAITOBJECTS_HANDLE hWos, uint32_t timeout, size_t* pIndex, _Bool* pResult)
+{
+  return stub_wait_any(hWos->objects, hWos->count, timeout, pIndex, pResult);
+}
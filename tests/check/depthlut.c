@@ -0,0 +1,154 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Tests for depthlut, converting a known ramp with and without SIMD. The
+ * AVX2 path converts 16 pixels at a time, and the width leaves a few over so
+ * that the rows' tails are converted one by one.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#include <string.h>
+
+#define WIDTH (16 * 4 + 3)
+#define HEIGHT 100
+#define IN_STRIDE GST_ROUND_UP_4 (WIDTH * 2)
+#define OUT_STRIDE GST_ROUND_UP_4 (WIDTH)
+#define BITDEPTH 12
+
+/* The ramp reaches past the 12 significant bits, so the top of it is clipped */
+static guint16
+ramp (guint x, guint y)
+{
+  return (y * WIDTH + x) * 7;
+}
+
+/* What the default linear curve maps a value to */
+static guint8
+linear (guint16 v)
+{
+  guint high = (1u << BITDEPTH) - 1;
+  gdouble x = v >= high ? 1.0 : (gdouble) v / high;
+
+  return (guint8) CLAMP (x * 255.0 + 0.5, 0.0, 255.0);
+}
+
+static GstHarness *
+setup_depthlut (gboolean simd)
+{
+  GstElement *lut = gst_element_factory_make ("depthlut", NULL);
+  GstHarness *h;
+
+  fail_unless (lut != NULL);
+  g_object_set (lut, "simd", simd, "threads", 4, NULL);
+  h = gst_harness_new_with_element (lut, "sink", "src");
+  gst_object_unref (lut);
+  gst_harness_set_src_caps (h, gst_caps_new_simple ("video/x-raw",
+          "format", G_TYPE_STRING, "GRAY16_LE", "width", G_TYPE_INT, WIDTH,
+          "height", G_TYPE_INT, HEIGHT, "framerate", GST_TYPE_FRACTION, 30, 1,
+          NULL));
+  return h;
+}
+
+static void
+check_ramp (GstHarness * h)
+{
+  GstBuffer *in = gst_buffer_new_allocate (NULL, IN_STRIDE * HEIGHT, NULL);
+  GstBuffer *out;
+  GstMapInfo map;
+  guint x, y;
+
+  fail_unless (gst_buffer_map (in, &map, GST_MAP_WRITE));
+  memset (map.data, 0, map.size);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      GST_WRITE_UINT16_LE (map.data + y * IN_STRIDE + x * 2, ramp (x, y));
+    }
+  }
+  gst_buffer_unmap (in, &map);
+
+  out = gst_harness_push_and_pull (h, in);
+  fail_unless (out != NULL);
+  fail_unless (gst_buffer_map (out, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, OUT_STRIDE * HEIGHT);
+  for (y = 0; y < HEIGHT; y++) {
+    for (x = 0; x < WIDTH; x++) {
+      fail_unless_equals_int (map.data[y * OUT_STRIDE + x],
+          linear (ramp (x, y)));
+    }
+  }
+  gst_buffer_unmap (out, &map);
+  gst_buffer_unref (out);
+}
+
+/* Every pixel is looked up, in the streaming thread's stripe and the pool's */
+GST_START_TEST (test_ramp_scalar)
+{
+  GstHarness *h = setup_depthlut (FALSE);
+
+  check_ramp (h);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* The gathers give the same result, on CPUs without AVX2 this is the scalar path again */
+GST_START_TEST (test_ramp_simd)
+{
+  GstHarness *h = setup_depthlut (TRUE);
+
+  check_ramp (h);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Unsetting the curve leaves a linear one */
+GST_START_TEST (test_no_curve)
+{
+  GstHarness *h = setup_depthlut (FALSE);
+
+  g_object_set (h->element, "curve", "gamma", NULL);
+  g_object_set (h->element, "curve", NULL, NULL);
+  check_ramp (h);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+depthlut_suite (void)
+{
+  Suite *s = suite_create ("depthlut");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_ramp_scalar);
+  tcase_add_test (tc, test_ramp_simd);
+  tcase_add_test (tc, test_no_curve);
+  return s;
+}
+
+GST_CHECK_MAIN (depthlut);
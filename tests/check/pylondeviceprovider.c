@@ -0,0 +1,138 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Tests for pylondeviceprovider, listing the three virtual cameras from
+ * pylonstub through a GstDeviceMonitor.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+
+#define STUB_CAMERAS 3
+
+/* The serials of the pylon devices the monitor lists, in order */
+static GList *
+get_serials (GstDeviceMonitor * monitor)
+{
+  GList *devices = gst_device_monitor_get_devices (monitor), *item;
+  GList *serials = NULL;
+
+  for (item = devices; item; item = item->next) {
+    GstStructure *properties = gst_device_get_properties (item->data);
+
+    if (properties && g_strcmp0 (gst_structure_get_string (properties,
+                "device.api"), "pylon") == 0) {
+      serials = g_list_insert_sorted (serials,
+          g_strdup (gst_structure_get_string (properties, "device.serial")),
+          (GCompareFunc) g_strcmp0);
+    }
+    if (properties) {
+      gst_structure_free (properties);
+    }
+  }
+  g_list_free_full (devices, gst_object_unref);
+  return serials;
+}
+
+/* Starting and stopping a monitor lists every camera, and can be done again */
+GST_START_TEST (test_monitor)
+{
+  GstDeviceMonitor *monitor = gst_device_monitor_new ();
+  guint i;
+
+  gst_device_monitor_add_filter (monitor, "Video/Source", NULL);
+  for (i = 0; i < 2; i++) {
+    GList *serials;
+
+    fail_unless (gst_device_monitor_start (monitor));
+    serials = get_serials (monitor);
+    fail_unless_equals_int (g_list_length (serials), STUB_CAMERAS);
+    fail_unless_equals_string (serials->data, "22000000");
+    fail_unless_equals_string (g_list_last (serials)->data, "22000002");
+    g_list_free_full (serials, g_free);
+
+    // Let the provider's thread poll once before it's stopped
+    g_usleep (G_USEC_PER_SEC * 5 / 2);
+    serials = get_serials (monitor);
+    fail_unless_equals_int (g_list_length (serials), STUB_CAMERAS);
+    g_list_free_full (serials, g_free);
+    gst_device_monitor_stop (monitor);
+  }
+  gst_object_unref (monitor);
+}
+
+GST_END_TEST;
+
+/* A device makes a pylonsrc that opens its camera by serial */
+GST_START_TEST (test_create_element)
+{
+  GstDeviceMonitor *monitor = gst_device_monitor_new ();
+  GList *devices, *item;
+  guint found = 0;
+
+  gst_device_monitor_add_filter (monitor, "Video/Source", NULL);
+  fail_unless (gst_device_monitor_start (monitor));
+  devices = gst_device_monitor_get_devices (monitor);
+  for (item = devices; item; item = item->next) {
+    GstStructure *properties = gst_device_get_properties (item->data);
+    GstElement *element;
+    gchar *serial;
+
+    if (!properties || g_strcmp0 (gst_structure_get_string (properties,
+                "device.api"), "pylon") != 0) {
+      if (properties) {
+        gst_structure_free (properties);
+      }
+      continue;
+    }
+    element = gst_device_create_element (item->data, NULL);
+    fail_unless (element != NULL);
+    g_object_get (element, "serial", &serial, NULL);
+    fail_unless_equals_string (serial, gst_structure_get_string (properties,
+            "device.serial"));
+    g_free (serial);
+    gst_object_unref (element);
+    gst_structure_free (properties);
+    found++;
+  }
+  fail_unless_equals_int (found, STUB_CAMERAS);
+  g_list_free_full (devices, gst_object_unref);
+  gst_device_monitor_stop (monitor);
+  gst_object_unref (monitor);
+}
+
+GST_END_TEST;
+
+static Suite *
+pylondeviceprovider_suite (void)
+{
+  Suite *s = suite_create ("pylondeviceprovider");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_monitor);
+  tcase_add_test (tc, test_create_element);
+  return s;
+}
+
+GST_CHECK_MAIN (pylondeviceprovider);
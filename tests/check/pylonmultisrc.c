@@ -0,0 +1,232 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Tests for pylonmultisrc in aligned mode, with the three virtual cameras
+ * from pylonstub wired to the same hardware trigger line.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include "../../plugins/gstpylonmeta.h"
+
+#define STUB_CAMERAS 3
+#define TRIGGER_FPS 20
+#define SETS 40
+#define MISSED 3 // Triggers the last camera misses without counting them.
+
+typedef struct
+{
+  GstClockTime pts, grabtime;
+  guint64 counter;
+} FrameInfo;
+
+static GMutex lock;
+static GArray *frames[STUB_CAMERAS]; // Frames each output got, in order.
+static guint markerIndex; // Frames the first output got before the marker event.
+static guint64 markerCounter; // Counter of the first camera's frame that followed the marker.
+static guint lastFrames; // Frames of the last camera seen so far.
+
+static GstPadProbeReturn
+record_output (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  guint camera = GPOINTER_TO_UINT (user_data);
+
+  g_mutex_lock (&lock);
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buf = gst_pad_probe_info_get_buffer (info);
+    GstPylonMeta *meta = gst_buffer_get_pylon_meta (buf);
+    FrameInfo frame;
+
+    fail_unless (meta != NULL);
+    frame.pts = GST_BUFFER_PTS (buf);
+    frame.grabtime = meta->grabtime;
+    frame.counter = meta->framecounter;
+    g_array_append_val (frames[camera], frame);
+  } else if (gst_event_has_name (gst_pad_probe_info_get_event (info),
+          "test-marker")) {
+    markerIndex = frames[camera]->len;
+  }
+  g_mutex_unlock (&lock);
+  return GST_PAD_PROBE_OK;
+}
+
+/* Sends a serialized event ahead of the first camera's tenth frame */
+static GstPadProbeReturn
+send_marker (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  static guint seen = 0;
+  GstPylonMeta *meta =
+      gst_buffer_get_pylon_meta (gst_pad_probe_info_get_buffer (info));
+
+  if (++seen == 10) {
+    markerCounter = meta->framecounter;
+    gst_pad_push_event (pad,
+        gst_event_new_custom (GST_EVENT_CUSTOM_DOWNSTREAM,
+            gst_structure_new_empty ("test-marker")));
+  }
+  return GST_PAD_PROBE_OK;
+}
+
+/* After its tenth frame the last camera loses MISSED frames, and counts on as if it had never seen their triggers */
+static GstPadProbeReturn
+miss_triggers (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  GstBuffer *buf;
+  GstPylonMeta *meta;
+
+  lastFrames++;
+  if (lastFrames <= 10) {
+    return GST_PAD_PROBE_OK;
+  }
+  if (lastFrames <= 10 + MISSED) {
+    return GST_PAD_PROBE_DROP;
+  }
+
+  buf = gst_buffer_make_writable (gst_pad_probe_info_get_buffer (info));
+  GST_PAD_PROBE_INFO_DATA (info) = buf;
+  meta = gst_buffer_get_pylon_meta (buf);
+  meta->framecounter -= MISSED;
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+add_camera_probe (GstElement * multisrc, const gchar * name,
+    GstPadProbeCallback callback)
+{
+  GstElement *camera = gst_bin_get_by_name (GST_BIN (multisrc), name);
+  GstPad *pad;
+
+  fail_unless (camera != NULL);
+  pad = gst_element_get_static_pad (camera, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, callback, NULL, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (camera);
+}
+
+/* Frames taken on the same trigger come out together, events stay between the frames they came between, and a camera that missed triggers is realigned */
+GST_START_TEST (test_aligned)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *multisrc = gst_element_factory_make ("pylonmultisrc", NULL);
+  GstClockTime period = GST_SECOND / TRIGGER_FPS, earliest, latest;
+  guint64 sets, dropped;
+  gint64 deadline;
+  guint i, j;
+
+  fail_unless (multisrc != NULL);
+  g_object_set (multisrc, "cameras", "22000000,22000001,22000002", "settings",
+      "continuous=false, triggersource=line1", NULL);
+  gst_bin_add (GST_BIN (pipeline), multisrc);
+  add_camera_probe (multisrc, "camera_22000000", send_marker);
+  add_camera_probe (multisrc, "camera_22000002", miss_triggers);
+
+  // The outputs only exist once the cameras are linked up in READY
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_READY),
+      GST_STATE_CHANGE_SUCCESS);
+  for (i = 0; i < STUB_CAMERAS; i++) {
+    GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+    gchar *name = g_strdup_printf ("src_%u", 22000000 + i);
+    GstPad *pad;
+
+    g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+    gst_bin_add (GST_BIN (pipeline), sink);
+    fail_unless (gst_element_link_pads (multisrc, name, sink, "sink"));
+    g_free (name);
+    pad = gst_element_get_static_pad (sink, "sink");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER |
+        GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, record_output,
+        GUINT_TO_POINTER (i), NULL);
+    gst_object_unref (pad);
+    frames[i] = g_array_new (FALSE, FALSE, sizeof (FrameInfo));
+  }
+  markerIndex = G_MAXUINT;
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+  deadline = g_get_monotonic_time () + 20 * G_USEC_PER_SEC;
+  do {
+    g_usleep (G_USEC_PER_SEC / 10);
+    g_object_get (multisrc, "sets", &sets, NULL);
+  } while (sets < SETS && g_get_monotonic_time () < deadline);
+  g_object_get (multisrc, "dropped", &dropped, NULL);
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  fail_unless (sets >= SETS, "only %" G_GUINT64_FORMAT " sets in 20 seconds",
+      sets);
+
+  // The last set may have been cut off between the outputs
+  for (i = 0; i + 1 < frames[0]->len && i + 1 < frames[STUB_CAMERAS - 1]->len;
+      i++) {
+    FrameInfo *first = &g_array_index (frames[0], FrameInfo, i);
+
+    earliest = latest = first->grabtime;
+    for (j = 1; j < STUB_CAMERAS; j++) {
+      FrameInfo *frame = &g_array_index (frames[j], FrameInfo, i);
+
+      fail_unless_equals_uint64 (frame->pts, first->pts);
+      earliest = MIN (earliest, frame->grabtime);
+      latest = MAX (latest, frame->grabtime);
+    }
+    fail_unless (latest - earliest < period / 2,
+        "set %u has frames %" GST_TIME_FORMAT " apart", i,
+        GST_TIME_ARGS (latest - earliest));
+  }
+
+  // The other two cameras' frames from the missed triggers had no partner
+  fail_unless (dropped >= 2 * MISSED, "only %" G_GUINT64_FORMAT " dropped",
+      dropped);
+
+  fail_unless (markerIndex != G_MAXUINT);
+  for (i = 0; i < frames[0]->len; i++) {
+    FrameInfo *frame = &g_array_index (frames[0], FrameInfo, i);
+
+    if (i < markerIndex) {
+      fail_unless (frame->counter < markerCounter);
+    } else {
+      fail_unless (frame->counter >= markerCounter);
+    }
+  }
+
+  for (i = 0; i < STUB_CAMERAS; i++) {
+    g_array_free (frames[i], TRUE);
+  }
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+static Suite *
+pylonmultisrc_suite (void)
+{
+  Suite *s = suite_create ("pylonmultisrc");
+  TCase *tc = tcase_create ("general");
+
+  // The cameras share a trigger line that fires at a fixed rate, rather than running free like in the other tests
+  g_setenv ("PYLONSTUB_FPS", G_STRINGIFY (TRIGGER_FPS), TRUE);
+  tcase_set_timeout (tc, 60);
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_aligned);
+  return s;
+}
+
+GST_CHECK_MAIN (pylonmultisrc);
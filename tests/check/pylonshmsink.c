@@ -0,0 +1,222 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Tests for pylonshmsink and the pylonshm reader library, with the readers
+ * in the same process as the sink.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
+#include "../../plugins/pylonshm.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define FRAME_SIZE 64
+
+static gchar *socketDir, *socketPath;
+
+static void
+setup (void)
+{
+  socketDir = g_dir_make_tmp ("pylonshmsink-XXXXXX", NULL);
+  fail_unless (socketDir != NULL);
+  socketPath = g_build_filename (socketDir, "socket", NULL);
+}
+
+static void
+teardown (void)
+{
+  g_unlink (socketPath);
+  g_rmdir (socketDir);
+  g_free (socketPath);
+  g_free (socketDir);
+}
+
+static GstHarness *
+setup_pylonshmsink (guint slots)
+{
+  GstElement *sink = gst_element_factory_make ("pylonshmsink", NULL);
+  GstHarness *h;
+
+  fail_unless (sink != NULL);
+  g_object_set (sink, "async", FALSE, "socketpath", socketPath, "slots",
+      slots, NULL);
+  h = gst_harness_new_with_element (sink, "sink", NULL);
+  gst_object_unref (sink);
+  gst_harness_set_src_caps_str (h, "application/x-pylonshm-test");
+  return h;
+}
+
+/* Frames whose every byte is value */
+static void
+push_frame (GstHarness * h, guint8 value)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, FRAME_SIZE, NULL);
+
+  gst_buffer_memset (buf, 0, value, FRAME_SIZE);
+  fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+}
+
+static void
+check_frame (PylonShmFrame * frame, guint8 value)
+{
+  const guint8 *data = frame->data;
+  guint i;
+
+  fail_unless_equals_int (frame->size, FRAME_SIZE);
+  for (i = 0; i < FRAME_SIZE; i++) {
+    fail_unless_equals_int (data[i], value);
+  }
+}
+
+static gint
+get_int (GstHarness * h, const gchar * property)
+{
+  gint value;
+
+  g_object_get (h->element, property, &value, NULL);
+  return value;
+}
+
+/* Readers get the frames in order, with their caps */
+GST_START_TEST (test_frames)
+{
+  GstHarness *h = setup_pylonshmsink (4);
+  PylonShmReader *reader = pylon_shm_reader_open (socketPath);
+  PylonShmFrame frame;
+  guint i;
+
+  fail_unless (reader != NULL);
+  for (i = 1; i <= 10; i++) {
+    push_frame (h, i);
+    fail_unless_equals_int (pylon_shm_reader_next (reader, &frame, 1000), 1);
+    check_frame (&frame, i);
+    fail_unless_equals_int (frame.sequence, i);
+    fail_unless_equals_string (frame.caps, "application/x-pylonshm-test");
+    pylon_shm_frame_release (reader, &frame);
+  }
+  fail_unless_equals_int (get_int (h, "readers"), 1);
+  fail_unless_equals_int (get_int (h, "droppedreaders"), 0);
+
+  pylon_shm_reader_close (reader);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* A reader holding every slot is dropped, but the frames it holds aren't overwritten until it lets go of them */
+GST_START_TEST (test_dropped_reader)
+{
+  GstHarness *h = setup_pylonshmsink (2);
+  PylonShmReader *slow = pylon_shm_reader_open (socketPath), *next;
+  PylonShmFrame first, second, frame;
+
+  fail_unless (slow != NULL);
+  push_frame (h, 1);
+  fail_unless_equals_int (pylon_shm_reader_next (slow, &first, 1000), 1);
+  push_frame (h, 2);
+  fail_unless_equals_int (pylon_shm_reader_next (slow, &second, 1000), 1);
+
+  // Neither slot is free, so the frames are skipped
+  push_frame (h, 3);
+  push_frame (h, 4);
+  fail_unless_equals_int (get_int (h, "droppedreaders"), 1);
+  fail_unless_equals_int (get_int (h, "droppedframes"), 2);
+  fail_unless_equals_int (get_int (h, "readers"), 0);
+  check_frame (&first, 1);
+  check_frame (&second, 2);
+  fail_unless_equals_int (pylon_shm_reader_next (slow, &frame, 1000), -1);
+
+  // Once the reader hangs up its slots are used again
+  pylon_shm_frame_release (slow, &first);
+  pylon_shm_frame_release (slow, &second);
+  pylon_shm_reader_close (slow);
+  next = pylon_shm_reader_open (socketPath);
+  fail_unless (next != NULL);
+  push_frame (h, 5);
+  fail_unless_equals_int (pylon_shm_reader_next (next, &frame, 1000), 1);
+  check_frame (&frame, 5);
+  fail_unless_equals_int (frame.sequence, 3);
+  pylon_shm_frame_release (next, &frame);
+  fail_unless_equals_int (get_int (h, "readers"), 1);
+
+  pylon_shm_reader_close (next);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* A socket left behind is replaced, one another sink publishes on isn't */
+GST_START_TEST (test_socket_in_use)
+{
+  struct sockaddr_un address;
+  GstElement *other;
+  GstHarness *h;
+  gint fd;
+
+  memset (&address, 0, sizeof (address));
+  address.sun_family = AF_UNIX;
+  g_strlcpy (address.sun_path, socketPath, sizeof (address.sun_path));
+  fd = socket (AF_UNIX, SOCK_SEQPACKET, 0);
+  fail_unless (fd >= 0);
+  fail_unless_equals_int (bind (fd, (struct sockaddr *) &address,
+          sizeof (address)), 0);
+  close (fd);
+
+  h = setup_pylonshmsink (4);
+  push_frame (h, 1);
+
+  other = gst_element_factory_make ("pylonshmsink", NULL);
+  g_object_set (other, "socketpath", socketPath, NULL);
+  fail_unless_equals_int (gst_element_set_state (other, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_FAILURE);
+  gst_element_set_state (other, GST_STATE_NULL);
+  gst_object_unref (other);
+
+  // The first sink still has its socket
+  fail_unless (g_file_test (socketPath, G_FILE_TEST_EXISTS));
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+static Suite *
+pylonshmsink_suite (void)
+{
+  Suite *s = suite_create ("pylonshmsink");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_checked_fixture (tc, setup, teardown);
+  tcase_add_test (tc, test_frames);
+  tcase_add_test (tc, test_dropped_reader);
+  tcase_add_test (tc, test_socket_in_use);
+  return s;
+}
+
+GST_CHECK_MAIN (pylonshmsink);
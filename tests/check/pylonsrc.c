@@ -0,0 +1,703 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Tests for pylonsrc, run against the virtual camera from pylonstub. The
+ * Makefile gives it three cameras with 64x48 free running sensors.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/base/gstbasesrc.h>
+#include <gst/video/video.h>
+#include "../../plugins/gstpylonmeta.h"
+#ifdef HAVE_GST_FDMEMORY
+#include <gst/allocators/gstfdmemory.h>
+#endif
+
+#define STUB_WIDTH 64
+#define STUB_HEIGHT 48
+
+static GstHarness *
+setup_pylonsrc (const gchar * format)
+{
+  GstHarness *h = gst_harness_new ("pylonsrc");
+
+  // Only the first of the virtual cameras, unless the test picks another
+  g_object_set (h->element, "camera", 0, "imageformat", format, NULL);
+  gst_harness_use_systemclock (h);
+  return h;
+}
+
+static GstStructure *
+get_current_structure (GstHarness * h)
+{
+  GstCaps *caps = gst_pad_get_current_caps (h->sinkpad);
+  GstStructure *s;
+
+  fail_unless (caps != NULL);
+  fail_unless (gst_caps_is_fixed (caps));
+  s = gst_structure_copy (gst_caps_get_structure (caps, 0));
+  gst_caps_unref (caps);
+  return s;
+}
+
+/* Until the camera is open only the template caps can be given */
+GST_START_TEST (test_caps_before_start)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstCaps *caps = gst_pad_query_caps (GST_BASE_SRC_PAD (h->element), NULL);
+
+  fail_unless (gst_caps_is_any (caps));
+  gst_caps_unref (caps);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Once it is, the caps describe the sensor and the picked format */
+GST_START_TEST (test_caps_formats)
+{
+  const gchar *formats[][3] = {
+    {"mono8", "video/x-raw", "GRAY8"},
+    {"rgb8", "video/x-raw", "RGB"},
+    {"bgr8", "video/x-raw", "BGR"},
+    {"ycbcr422_8", "video/x-raw", "YUY2"},
+    {"bayer8", "video/x-bayer", "rggb"},
+  };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (formats); i++) {
+    GstHarness *h = setup_pylonsrc (formats[i][0]);
+    GstCaps *caps;
+    GstStructure *s;
+    gint width, height;
+
+    gst_harness_play (h);
+    caps = gst_pad_query_caps (GST_BASE_SRC_PAD (h->element), NULL);
+    fail_if (gst_caps_is_any (caps));
+    fail_unless_equals_int (gst_caps_get_size (caps), 1);
+    s = gst_caps_get_structure (caps, 0);
+    fail_unless (gst_structure_has_name (s, formats[i][1]), "%s gave %"
+        GST_PTR_FORMAT, formats[i][0], caps);
+    fail_unless_equals_string (gst_structure_get_string (s, "format"),
+        formats[i][2]);
+    fail_unless (gst_structure_get_int (s, "width", &width));
+    fail_unless (gst_structure_get_int (s, "height", &height));
+    fail_unless_equals_int (width, STUB_WIDTH);
+    fail_unless_equals_int (height, STUB_HEIGHT);
+    fail_unless (gst_structure_has_field (s, "framerate"));
+    gst_caps_unref (caps);
+    gst_harness_teardown (h);
+  }
+}
+
+GST_END_TEST;
+
+/* Downstream can pick anything from the caps, and ends up with fixed ones */
+GST_START_TEST (test_negotiation)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstStructure *s;
+  gint width, height, num, den;
+
+  gst_harness_set_sink_caps_str (h, "video/x-raw, format=(string)GRAY8");
+  gst_harness_play (h);
+  gst_buffer_unref (gst_harness_pull (h));
+
+  s = get_current_structure (h);
+  fail_unless_equals_string (gst_structure_get_string (s, "format"), "GRAY8");
+  fail_unless (gst_structure_get_int (s, "width", &width));
+  fail_unless (gst_structure_get_int (s, "height", &height));
+  fail_unless_equals_int (width, STUB_WIDTH);
+  fail_unless_equals_int (height, STUB_HEIGHT);
+  fail_unless (gst_structure_get_fraction (s, "framerate", &num, &den));
+  fail_unless (den > 0);
+  gst_structure_free (s);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* A free running camera runs at the framerate downstream asks for, within the camera's AcquisitionFrameRate limits */
+GST_START_TEST (test_negotiate_framerate)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstStructure *s;
+  GstClockTime first;
+  GstBuffer *buf;
+  gint num, den;
+  guint i;
+
+  gst_harness_set_sink_caps_str (h,
+      "video/x-raw, format=(string)GRAY8, framerate=(fraction)25/1");
+  gst_harness_play (h);
+  buf = gst_harness_pull (h);
+  first = GST_BUFFER_PTS (buf);
+  gst_buffer_unref (buf);
+
+  s = get_current_structure (h);
+  fail_unless (gst_structure_get_fraction (s, "framerate", &num, &den));
+  fail_unless_equals_int (num, 25);
+  fail_unless_equals_int (den, 1);
+  gst_structure_free (s);
+
+  // The camera really slows down, ten frames take about 400 ms
+  for (i = 0; i < 10; i++) {
+    buf = gst_harness_pull (h);
+    if (i < 9) {
+      gst_buffer_unref (buf);
+    }
+  }
+  fail_unless (GST_BUFFER_PTS (buf) - first > 300 * GST_MSECOND);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Frames are whole, timestamped with the same DTS as PTS, and carry the stub's moving gradient - every pixel is one more than the one to its left and the one above it */
+GST_START_TEST (test_frames)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstClockTime lastPts = GST_CLOCK_TIME_NONE;
+  gint lastOrigin = -1;
+  guint i, x, y;
+
+  gst_harness_play (h);
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    GstMapInfo map;
+
+    fail_unless (buf != NULL);
+    fail_unless (GST_BUFFER_PTS_IS_VALID (buf));
+    fail_unless_equals_uint64 (GST_BUFFER_DTS (buf), GST_BUFFER_PTS (buf));
+    if (GST_CLOCK_TIME_IS_VALID (lastPts)) {
+      fail_unless (GST_BUFFER_PTS (buf) >= lastPts);
+    }
+    lastPts = GST_BUFFER_PTS (buf);
+
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, STUB_WIDTH * STUB_HEIGHT);
+    for (y = 0; y < STUB_HEIGHT; y++) {
+      for (x = 0; x < STUB_WIDTH; x++) {
+        fail_unless_equals_int (map.data[y * STUB_WIDTH + x],
+            (map.data[0] + x + y) & 0xff);
+      }
+    }
+    fail_if (map.data[0] == lastOrigin, "frame %u repeats the last one", i);
+    lastOrigin = map.data[0];
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Chunk data is only read when asked for, and then carries the values the camera used and its counter */
+GST_START_TEST (test_chunkdata)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstBuffer *buf;
+  GstPylonMeta *meta;
+  guint64 lastCounter = 0;
+  guint i;
+
+  gst_harness_play (h);
+  buf = gst_harness_pull (h);
+  meta = gst_buffer_get_pylon_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->chunks, 0);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+
+  h = setup_pylonsrc ("mono8");
+  g_object_set (h->element, "chunkdata", TRUE, NULL);
+  gst_harness_play (h);
+  for (i = 0; i < 5; i++) {
+    buf = gst_harness_pull (h);
+    meta = gst_buffer_get_pylon_meta (buf);
+    fail_unless (meta != NULL);
+    fail_unless (meta->chunks & GST_PYLON_META_EXPOSURETIME);
+    fail_unless (meta->chunks & GST_PYLON_META_CHUNKCOUNTER);
+    fail_unless (meta->exposuretime > 0.0);
+    if (i > 0) {
+      fail_unless (meta->chunkcounter > lastCounter);
+    }
+    lastCounter = meta->chunkcounter;
+    gst_buffer_unref (buf);
+  }
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* The stream grabber is set up again on every start */
+GST_START_TEST (test_restart)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  guint i;
+
+  for (i = 0; i < 3; i++) {
+    gst_harness_play (h);
+    gst_buffer_unref (gst_harness_pull (h));
+    fail_unless_equals_int (gst_element_set_state (h->element, GST_STATE_NULL),
+        GST_STATE_CHANGE_SUCCESS);
+  }
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* A frame held downstream while a warm camera with fdmemory stops gives its grab buffer back once the camera starts again */
+GST_START_TEST (test_warm_fdmemory)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstBuffer *held, *buf;
+  guint i;
+
+  g_object_set (h->element, "warm", TRUE, "fdmemory", TRUE, "grabbuffers", 2,
+      NULL);
+  gst_harness_play (h);
+  held = gst_harness_pull (h);
+  fail_unless (held != NULL);
+  fail_unless_equals_int (gst_element_set_state (h->element, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  while ((buf = gst_harness_try_pull (h))) {
+    gst_buffer_unref (buf);
+  }
+  gst_buffer_unref (held);
+
+  // Holding two frames at once takes both grab buffers
+  gst_harness_play (h);
+  for (i = 0; i < 5; i++) {
+    held = gst_harness_pull (h);
+    buf = gst_harness_pull (h);
+    fail_unless (held != NULL && buf != NULL);
+    gst_buffer_unref (held);
+    gst_buffer_unref (buf);
+  }
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* A region gets a pad of its own with the region's size and pixels, and the regions can't change while it exists */
+GST_START_TEST (test_roi)
+{
+  GstHarness *h = setup_pylonsrc ("mono8"), *roi;
+  GstStructure *s;
+  GstVideoMeta *meta;
+  GstBuffer *buf;
+  GstMapInfo map;
+  const guint8 *pixels;
+  gint width, height, stride, x, y;
+  gchar *rois;
+
+  g_object_set (h->element, "rois", "8,4,16,12", NULL);
+  roi = gst_harness_new_with_element (h->element, NULL, "roi_0");
+  gst_harness_play (h);
+  gst_buffer_unref (gst_harness_pull (h));
+
+  buf = gst_harness_pull (roi);
+  s = get_current_structure (roi);
+  fail_unless (gst_structure_get_int (s, "width", &width));
+  fail_unless (gst_structure_get_int (s, "height", &height));
+  fail_unless_equals_int (width, 16);
+  fail_unless_equals_int (height, 12);
+  gst_structure_free (s);
+
+  // Either the frame's memory with a GstVideoMeta, or the copied rows
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  meta = gst_buffer_get_video_meta (buf);
+  if (meta) {
+    fail_unless_equals_int (meta->width, 16);
+    fail_unless_equals_int (meta->height, 12);
+    pixels = map.data + meta->offset[0];
+    stride = meta->stride[0];
+  } else {
+    fail_unless_equals_int (map.size, 16 * 12);
+    pixels = map.data;
+    stride = 16;
+  }
+  for (y = 0; y < 12; y++) {
+    for (x = 0; x < 16; x++) {
+      fail_unless_equals_int (pixels[y * stride + x],
+          (pixels[0] + x + y) & 0xff);
+    }
+  }
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+
+  g_object_set (h->element, "rois", "0,0,8,8", NULL);
+  g_object_get (h->element, "rois", &rois, NULL);
+  fail_unless_equals_string (rois, "8,4,16,12");
+  g_free (rois);
+
+  gst_harness_teardown (roi);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Pulls frames until the negotiated framerate is below (or back at) fps, returns the framerate */
+static gdouble
+pull_until_framerate (GstHarness * h, gdouble fps, gboolean below)
+{
+  gdouble rate = 0.0;
+  guint i;
+
+  for (i = 0; i < 100; i++) {
+    GstStructure *s;
+    gint num, den;
+
+    gst_buffer_unref (gst_harness_pull (h));
+    s = get_current_structure (h);
+    fail_unless (gst_structure_get_fraction (s, "framerate", &num, &den));
+    gst_structure_free (s);
+    rate = (gdouble) num / den;
+    if (below ? rate < fps - 0.5 : rate > fps - 0.5) {
+      break;
+    }
+  }
+  return rate;
+}
+
+static GstHarness *
+setup_planned_camera (gint camera, const gchar * mode, gint64 bandwidth)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+
+  g_object_set (h->element, "camera", camera, "fps", 100.0,
+      "bandwidthplanner", mode, "controllerbandwidth", bandwidth, NULL);
+  return h;
+}
+
+/* Cameras sharing a USB controller get a fair share of it. The camera that starts is limited right away, the ones already running change from their own streaming threads and renegotiate. Each 64x48 GRAY8 camera needs 307200 B/s at 100 fps. */
+GST_START_TEST (test_bandwidth_planner)
+{
+  GstHarness *first, *second, *third;
+  gdouble share = 300000.0 / (STUB_WIDTH * STUB_HEIGHT);
+
+  g_setenv ("PYLONSRC_USB_TOPOLOGY",
+      "22000000=xhci0,22000001=xhci0,22000002=xhci0", TRUE);
+
+  first = setup_planned_camera (0, "limit", 600000);
+  gst_harness_play (first);
+  fail_unless (pull_until_framerate (first, 100.0, FALSE) > 99.5);
+
+  second = setup_planned_camera (1, "limit", 600000);
+  gst_harness_play (second);
+  gst_buffer_unref (gst_harness_pull (second));
+  fail_unless (ABS (pull_until_framerate (second, 100.0, TRUE) - share) < 0.5);
+  fail_unless (ABS (pull_until_framerate (first, 100.0, TRUE) - share) < 0.5);
+
+  // There's no room for a third camera that would rather fail
+  third = setup_planned_camera (2, "fail", 600000);
+  fail_unless_equals_int (gst_element_set_state (third->element,
+          GST_STATE_PLAYING), GST_STATE_CHANGE_FAILURE);
+  gst_harness_teardown (third);
+
+  // When the second camera leaves, the first gets its bandwidth back
+  gst_harness_teardown (second);
+  fail_unless (pull_until_framerate (first, 100.0, FALSE) > 99.5);
+  gst_harness_teardown (first);
+
+  g_unsetenv ("PYLONSRC_USB_TOPOLOGY");
+}
+
+GST_END_TEST;
+
+/* Pulls frames until a pylonsrc-qos message with the given rate is posted, telling it after every frame that downstream is late if asked to */
+static gboolean
+pull_until_qos_message (GstHarness * h, GstBus * bus, gdouble rate,
+    gboolean late)
+{
+  guint i;
+
+  for (i = 0; i < 300; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    GstMessage *msg;
+
+    if (late) {
+      gst_harness_push_upstream_event (h,
+          gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, 2.0, GST_SECOND / 10,
+              GST_BUFFER_PTS (buf)));
+    }
+    gst_buffer_unref (buf);
+    while ((msg = gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT))) {
+      const GstStructure *s = gst_message_get_structure (msg);
+      gdouble posted;
+      gboolean found = gst_structure_has_name (s, "pylonsrc-qos")
+          && gst_structure_get_double (s, "rate", &posted)
+          && ABS (posted - rate) < 0.01;
+
+      gst_message_unref (msg);
+      if (found) {
+        return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+/* Checks that a mono8 frame carries the stub's gradient */
+static void
+check_gradient (const guint8 * pixels, gint stride)
+{
+  gint x, y;
+
+  for (y = 0; y < STUB_HEIGHT; y++) {
+    for (x = 0; x < STUB_WIDTH; x++) {
+      fail_unless_equals_int (pixels[y * stride + x],
+          (pixels[0] + x + y) & 0xff);
+    }
+  }
+}
+
+/* Two cameras can share a grab engine thread, and one leaving it doesn't hold up the other */
+GST_START_TEST (test_grab_engine)
+{
+  GstHarness *first = setup_pylonsrc ("mono8");
+  GstHarness *second = setup_pylonsrc ("mono8");
+  guint i;
+
+  g_object_set (first->element, "grabthreads", 1, NULL);
+  g_object_set (second->element, "camera", 1, "grabthreads", 1, NULL);
+  gst_harness_play (first);
+  gst_harness_play (second);
+  for (i = 0; i < 10; i++) {
+    gst_buffer_unref (gst_harness_pull (first));
+    gst_buffer_unref (gst_harness_pull (second));
+  }
+
+  gst_harness_teardown (first);
+  for (i = 0; i < 10; i++) {
+    GstBuffer *buf = gst_harness_pull (second);
+
+    fail_unless (buf != NULL);
+    gst_buffer_unref (buf);
+  }
+  gst_harness_teardown (second);
+}
+
+GST_END_TEST;
+
+/* The preview pad gets every previewevery'th frame of the src pad, at a framerate lowered to match */
+GST_START_TEST (test_preview)
+{
+  GstHarness *h = setup_pylonsrc ("mono8"), *preview;
+  GstClockTime pts[9];
+  GstStructure *s;
+  gint num, den, previewNum, previewDen;
+  guint i;
+
+  g_object_set (h->element, "previewevery", 3, NULL);
+  preview = gst_harness_new_with_element (h->element, NULL, "preview");
+  gst_harness_play (h);
+  for (i = 0; i < G_N_ELEMENTS (pts); i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+
+    pts[i] = GST_BUFFER_PTS (buf);
+    gst_buffer_unref (buf);
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (pts) / 3; i++) {
+    GstBuffer *buf = gst_harness_pull (preview);
+
+    fail_unless (buf != NULL);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), pts[i * 3]);
+    gst_buffer_unref (buf);
+  }
+
+  s = get_current_structure (h);
+  fail_unless (gst_structure_get_fraction (s, "framerate", &num, &den));
+  gst_structure_free (s);
+  s = get_current_structure (preview);
+  fail_unless (gst_structure_get_fraction (s, "framerate", &previewNum,
+          &previewDen));
+  gst_structure_free (s);
+  fail_unless_equals_uint64 ((guint64) previewNum * den * 3,
+      (guint64) num * previewDen);
+
+  gst_harness_teardown (preview);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* With fdmemory the frames are pushed in the grab buffers themselves, which go back to the camera once they're freed */
+GST_START_TEST (test_fdmemory)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  guint i;
+
+  g_object_set (h->element, "fdmemory", TRUE, "grabbuffers", 3, NULL);
+  gst_harness_play (h);
+  for (i = 0; i < 20; i++) {
+    GstBuffer *buf = gst_harness_pull (h);
+    GstMapInfo map;
+
+    fail_unless (buf != NULL);
+#ifdef HAVE_GST_FDMEMORY
+    fail_unless (gst_is_fd_memory (gst_buffer_peek_memory (buf, 0)));
+    fail_unless (gst_fd_memory_get_fd (gst_buffer_peek_memory (buf, 0)) >= 0);
+#endif
+    fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+    fail_unless_equals_int (map.size, STUB_WIDTH * STUB_HEIGHT);
+    check_gradient (map.data, STUB_WIDTH);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Rows are only padded to stridealign when downstream understands GstVideoMeta */
+GST_START_TEST (test_stridealign)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstVideoMeta *meta;
+  GstBuffer *buf;
+  GstMapInfo map;
+  const guint8 *pixels;
+
+  g_object_set (h->element, "stridealign", 128, NULL);
+  gst_harness_play (h);
+  buf = gst_harness_pull (h);
+  fail_unless (gst_buffer_get_video_meta (buf) == NULL);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, STUB_WIDTH * STUB_HEIGHT);
+  check_gradient (map.data, STUB_WIDTH);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+
+  h = setup_pylonsrc ("mono8");
+  g_object_set (h->element, "stridealign", 128, NULL);
+  gst_harness_add_propose_allocation_meta (h, GST_VIDEO_META_API_TYPE, NULL);
+  gst_harness_play (h);
+  buf = gst_harness_pull (h);
+  meta = gst_buffer_get_video_meta (buf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->width, STUB_WIDTH);
+  fail_unless_equals_int (meta->height, STUB_HEIGHT);
+  fail_unless_equals_int (meta->stride[0], 128);
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_READ));
+  pixels = map.data + meta->offset[0];
+  fail_unless_equals_int (GPOINTER_TO_SIZE (pixels) % 128, 0);
+  check_gradient (pixels, meta->stride[0]);
+  gst_buffer_unmap (buf, &map);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* The source is live, and can fall behind by as many frames as it has grab buffers */
+GST_START_TEST (test_latency)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstQuery *query = gst_query_new_latency ();
+  GstClockTime min, max;
+  gboolean live;
+
+  g_object_set (h->element, "grabbuffers", 4, NULL);
+  gst_harness_set_sink_caps_str (h,
+      "video/x-raw, format=(string)GRAY8, framerate=(fraction)25/1");
+  gst_harness_play (h);
+  gst_buffer_unref (gst_harness_pull (h));
+
+  fail_unless (gst_pad_query (GST_BASE_SRC_PAD (h->element), query));
+  gst_query_parse_latency (query, &live, &min, &max);
+  fail_unless (live);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (max));
+  fail_unless (ABS ((GstClockTimeDiff) (max - min - 4 * GST_SECOND / 25)) <
+      GST_MSECOND, "latency %" GST_TIME_FORMAT " to %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (min), GST_TIME_ARGS (max));
+  gst_query_unref (query);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Unknown modes are refused, and the mode can be changed while the camera runs */
+GST_START_TEST (test_qos)
+{
+  GstHarness *h = setup_pylonsrc ("mono8");
+  GstBus *bus = gst_bus_new ();
+  gchar *mode;
+
+  g_object_set (h->element, "qos", "bogus", NULL);
+  g_object_get (h->element, "qos", &mode, NULL);
+  fail_unless_equals_string (mode, "off");
+  g_free (mode);
+
+  g_object_set (h->element, "fps", 100.0, NULL);
+  gst_element_set_bus (h->element, bus);
+  gst_harness_play (h);
+  gst_buffer_unref (gst_harness_pull (h));
+
+  // Downstream running at half speed halves the camera's framerate
+  g_object_set (h->element, "qos", "framerate", NULL);
+  fail_unless (pull_until_qos_message (h, bus, 0.5, TRUE));
+
+  // and turning QoS off puts the full framerate back right away
+  g_object_set (h->element, "qos", "off", NULL);
+  fail_unless (pull_until_qos_message (h, bus, 1.0, FALSE));
+
+  gst_harness_teardown (h);
+  gst_object_unref (bus);
+}
+
+GST_END_TEST;
+
+static Suite *
+pylonsrc_suite (void)
+{
+  Suite *s = suite_create ("pylonsrc");
+  TCase *tc = tcase_create ("general");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_caps_before_start);
+  tcase_add_test (tc, test_caps_formats);
+  tcase_add_test (tc, test_negotiation);
+  tcase_add_test (tc, test_negotiate_framerate);
+  tcase_add_test (tc, test_frames);
+  tcase_add_test (tc, test_chunkdata);
+  tcase_add_test (tc, test_restart);
+  tcase_add_test (tc, test_warm_fdmemory);
+  tcase_add_test (tc, test_roi);
+  tcase_add_test (tc, test_bandwidth_planner);
+  tcase_add_test (tc, test_qos);
+  tcase_add_test (tc, test_grab_engine);
+  tcase_add_test (tc, test_preview);
+  tcase_add_test (tc, test_fdmemory);
+  tcase_add_test (tc, test_stridealign);
+  tcase_add_test (tc, test_latency);
+  return s;
+}
+
+GST_CHECK_MAIN (pylonsrc);
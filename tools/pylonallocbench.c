@@ -0,0 +1,192 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Grab buffer allocation benchmark.
+ *
+ * Allocates a set of grab buffers the way pylonsrc does for every
+ * combination of the requested page types and locking, and prints one CSV
+ * row per combination with:
+ *  - what the allocation actually achieved (page type, locked, NUMA node),
+ *  - the time it took to allocate and fault in all of the buffers,
+ *  - copy bandwidth - the frames are copied out of the grab buffers into
+ *    newly allocated GstBuffers, like pylonsrc's create() does,
+ *  - read bandwidth - the grab buffers are read directly, like an element
+ *    downstream of a zero-copy source would.
+ *
+ * No camera is needed. The buffers are filled with a pattern before every
+ * pass to stand in for the camera writing into them, which also pushes the
+ * previous pass out of the caches as long as the buffers are larger than
+ * them. Run it through `make allocbench`, pinned to a CPU (taskset) when
+ * comparing NUMA nodes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../plugins/gstpylonalloc.h"
+
+static gdouble
+bench_mbps (gsize bytes, gint64 elapsed)
+{
+  return elapsed > 0 ? (gdouble) bytes / elapsed : 0.0;
+}
+
+/* Stands in for the camera writing a frame into a grab buffer */
+static void
+bench_fill (GstPylonGrabMemory * buffers, guint count, guint pass)
+{
+  guint i;
+
+  for (i = 0; i < count; i++) {
+    memset (buffers[i].data, (gint) (pass + i), buffers[i].size);
+  }
+}
+
+static void
+bench_run (GstPylonAllocParams * params, gsize size, guint count, guint passes)
+{
+  GstPylonGrabMemory *buffers = g_new0 (GstPylonGrabMemory, count);
+  GstBuffer *buffer;
+  GstMapInfo mapInfo;
+  gint64 start, allocTime, copyTime = 0, readTime = 0;
+  guint64 sum = 0;
+  const guint64 *words;
+  gsize w;
+  guint i, pass, allocated = 0;
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < count; i++) {
+    if (!gst_pylon_grab_memory_alloc (&buffers[i], size, params)) {
+      g_printerr ("Couldn't allocate %u buffers of %" G_GSIZE_FORMAT " bytes.\n", count, size);
+      goto done;
+    }
+    allocated++;
+  }
+  allocTime = g_get_monotonic_time () - start;
+
+  for (pass = 0; pass < passes; pass++) {
+    // Copy out, the way create() does
+    bench_fill (buffers, count, pass);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < count; i++) {
+      buffer = gst_buffer_new_and_alloc (size);
+      gst_buffer_map (buffer, &mapInfo, GST_MAP_WRITE);
+      memcpy (mapInfo.data, buffers[i].data, size);
+      gst_buffer_unmap (buffer, &mapInfo);
+      gst_buffer_unref (buffer);
+    }
+    copyTime += g_get_monotonic_time () - start;
+
+    // Read in place, the way a zero-copy consumer does
+    bench_fill (buffers, count, pass);
+    start = g_get_monotonic_time ();
+    for (i = 0; i < count; i++) {
+      words = (const guint64 *) buffers[i].data;
+      for (w = 0; w < size / sizeof (guint64); w++) {
+        sum += words[w];
+      }
+    }
+    readTime += g_get_monotonic_time () - start;
+  }
+
+  g_print ("%s,%s,%d,%s,%d,%d,%" G_GSIZE_FORMAT ",%u,%.2f,%.0f,%.0f,%" G_GUINT64_FORMAT "\n",
+      gst_pylon_pages_get_name (params->pages), params->lock ? "yes" : "no", params->numaNode,
+      gst_pylon_pages_get_name (buffers[0].pages), buffers[0].locked, buffers[0].numaNode,
+      size, count, (gdouble) allocTime / 1000,
+      bench_mbps ((gsize) size * count * passes, copyTime),
+      bench_mbps ((gsize) size * count * passes, readTime), sum & 0xff);
+
+done:
+  for (i = 0; i < allocated; i++) {
+    gst_pylon_grab_memory_free (&buffers[i]);
+  }
+  g_free (buffers);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *pages = "normal,transparent,huge", *locks = "no,yes";
+  gint64 size = 2448 * 2048;
+  gint count = 10, passes = 20, numaNode = -1;
+  gboolean shared = FALSE;
+  GError *error = NULL;
+  GOptionContext *context;
+  gchar **pageList, **lockList;
+  GstPylonAllocParams params;
+  guint p, l;
+  GOptionEntry entries[] = {
+    {"pages", 'p', 0, G_OPTION_ARG_STRING, &pages, "Comma separated list of page types (normal, transparent, huge)", "LIST"},
+    {"lock", 'l', 0, G_OPTION_ARG_STRING, &locks, "Comma separated list of whether to lock the buffers (no, yes)", "LIST"},
+    {"size", 's', 0, G_OPTION_ARG_INT64, &size, "Size of a frame in bytes", "BYTES"},
+    {"buffers", 'b', 0, G_OPTION_ARG_INT, &count, "Number of grab buffers", "N"},
+    {"passes", 'n', 0, G_OPTION_ARG_INT, &passes, "Number of times every buffer is copied and read", "N"},
+    {"numa-node", 'm', 0, G_OPTION_ARG_INT, &numaNode, "NUMA node to put the buffers on, -1 for none", "NODE"},
+    {"memfd", 'f', 0, G_OPTION_ARG_NONE, &shared, "Back the buffers with memfds, like pylonsrc's fdmemory", NULL},
+    {NULL}
+  };
+
+  context = g_option_context_new ("- grab buffer allocation benchmark");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    g_clear_error (&error);
+    g_option_context_free (context);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (size <= 0 || count <= 0 || passes <= 0) {
+    g_printerr ("The size, buffer count and passes have to be positive.\n");
+    return 1;
+  }
+
+  pageList = g_strsplit (pages, ",", -1);
+  lockList = g_strsplit (locks, ",", -1);
+
+  g_print ("pages,lock,numa_node,got_pages,got_lock,got_numa_node,size,buffers,alloc_ms,copy_mbps,read_mbps,checksum\n");
+  for (p = 0; pageList[p]; p++) {
+    if (strcmp (pageList[p], "transparent") == 0) {
+      params.pages = GST_PYLON_PAGES_TRANSPARENT;
+    } else if (strcmp (pageList[p], "huge") == 0) {
+      params.pages = GST_PYLON_PAGES_HUGE;
+    } else {
+      params.pages = GST_PYLON_PAGES_NORMAL;
+    }
+    for (l = 0; lockList[l]; l++) {
+      params.lock = strcmp (lockList[l], "yes") == 0;
+      params.numaNode = numaNode;
+      params.shared = shared;
+      bench_run (&params, (gsize) size, (guint) count, (guint) passes);
+    }
+  }
+
+  g_strfreev (pageList);
+  g_strfreev (lockList);
+  return 0;
+}
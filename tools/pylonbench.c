@@ -0,0 +1,354 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Frame path microbenchmark for pylonsrc.
+ *
+ * Runs `pylonsrc ! fakesink` for every combination of the requested
+ * resolutions, pixel formats and grab buffer counts and prints one CSV row
+ * per combination with:
+ *  - the achieved framerate,
+ *  - CPU time (user + system) the streaming thread spent per frame,
+ *  - p50/p99 of the time between two buffers leaving pylonsrc, which is the
+ *    time spent in create() plus pushing into fakesink,
+ *  - p50/p99 of the time from fakesink handing the last buffer off to the
+ *    next one leaving pylonsrc, which is the time spent in create() (and the
+ *    little the base classes do around it),
+ *  - heap allocations per frame, counted over every thread in the process.
+ *
+ * The first frames of each run are used to warm up and aren't measured.
+ * It's meant to be run against a build configured with --enable-pylon-stub
+ * through `make bench`, in which case the virtual camera free-runs unless
+ * PYLONSTUB_FPS says otherwise. It works against a real camera as well.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h> //qsort
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h> //getrusage
+
+/* Heap allocation counting.
+ * Every allocation in the process goes through these, as the executable's
+ * symbols take precedence over libc's for all of the loaded libraries. */
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t count, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+
+static volatile guint64 allocations = 0;
+
+#define COUNT_ALLOCATION() __atomic_fetch_add (&allocations, 1, __ATOMIC_RELAXED)
+
+void *
+malloc (size_t size)
+{
+  COUNT_ALLOCATION ();
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t count, size_t size)
+{
+  COUNT_ALLOCATION ();
+  return __libc_calloc (count, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  COUNT_ALLOCATION ();
+  return __libc_realloc (ptr, size);
+}
+
+void *
+memalign (size_t alignment, size_t size)
+{
+  COUNT_ALLOCATION ();
+  return __libc_memalign (alignment, size);
+}
+
+int
+posix_memalign (void **ptr, size_t alignment, size_t size)
+{
+  COUNT_ALLOCATION ();
+  *ptr = __libc_memalign (alignment, size);
+  return *ptr ? 0 : ENOMEM;
+}
+
+/* A single benchmark run */
+typedef struct
+{
+  gint width, height, buffers;
+  const gchar *format;
+  guint frames, warmup;
+
+  guint seen;
+  guint64 last, pushed, start, end;
+  guint64 cpuStart, cpuEnd;
+  guint64 allocStart, allocEnd;
+  guint64 *intervals, *creates;
+} BenchRun;
+
+static guint64
+bench_now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return (guint64) t.tv_sec * GST_SECOND + t.tv_nsec;
+}
+
+static guint64
+bench_thread_cpu (void)
+{
+  struct rusage usage;
+  getrusage (RUSAGE_THREAD, &usage);
+  return (guint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * GST_SECOND +
+      (guint64) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * GST_USECOND;
+}
+
+static int
+bench_compare (const void *a, const void *b)
+{
+  guint64 x = *(const guint64 *) a, y = *(const guint64 *) b;
+  return (x > y) - (x < y);
+}
+
+/* Called in the streaming thread for every buffer pylonsrc pushes. */
+static GstPadProbeReturn
+bench_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BenchRun *run = user_data;
+  guint64 now = bench_now ();
+
+  if (run->seen == run->warmup) {
+    run->start = now;
+    run->cpuStart = bench_thread_cpu ();
+    run->allocStart = allocations;
+  } else if (run->seen > run->warmup) {
+    run->intervals[run->seen - run->warmup - 1] = now - run->last;
+    run->creates[run->seen - run->warmup - 1] = now - run->pushed;
+  }
+
+  if (run->seen == run->frames - 1) {
+    run->end = now;
+    run->cpuEnd = bench_thread_cpu ();
+    run->allocEnd = allocations;
+  }
+
+  run->last = now;
+  run->seen++;
+  return GST_PAD_PROBE_OK;
+}
+
+/* Called by fakesink once it's done with a buffer, right before the push returns to pylonsrc, which then calls create() for the next one. */
+static void
+bench_handoff (GstElement * sink, GstBuffer * buf, GstPad * pad, gpointer user_data)
+{
+  BenchRun *run = user_data;
+
+  run->pushed = bench_now ();
+}
+
+static gboolean
+bench_run (BenchRun * run, gboolean hasBufferProperty, const gchar * extra)
+{
+  GError *error = NULL;
+  GstElement *pipeline, *src, *sink;
+  GstPad *pad;
+  GstBus *bus;
+  GstMessage *msg;
+  gchar *description, *buffers;
+  gboolean ok;
+
+  buffers = hasBufferProperty ? g_strdup_printf ("grabbuffers=%d", run->buffers) : g_strdup ("");
+  description = g_strdup_printf ("pylonsrc name=src num-buffers=%u width=%d height=%d imageformat=%s limitbandwidth=false %s %s ! fakesink name=sink sync=false signal-handoffs=true",
+      run->frames, run->width, run->height, run->format, buffers, extra ? extra : "");
+  pipeline = gst_parse_launch (description, &error);
+  g_free (buffers);
+  g_free (description);
+
+  if (pipeline == NULL) {
+    g_printerr ("Couldn't create the pipeline: %s\n", error->message);
+    g_clear_error (&error);
+    return FALSE;
+  }
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  pad = gst_element_get_static_pad (src, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, bench_probe, run, NULL);
+  gst_object_unref (pad);
+  gst_object_unref (src);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (bench_handoff), run);
+  gst_object_unref (sink);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  ok = GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS && run->seen == run->frames;
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    gst_message_parse_error (msg, &error, NULL);
+    g_printerr ("%dx%d %s: %s\n", run->width, run->height, run->format, error->message);
+    g_clear_error (&error);
+  }
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  return ok;
+}
+
+static void
+bench_report (BenchRun * run)
+{
+  guint measured = run->frames - run->warmup - 1;
+  gdouble seconds = (gdouble) (run->end - run->start) / GST_SECOND;
+
+  qsort (run->intervals, measured, sizeof (guint64), bench_compare);
+  qsort (run->creates, measured, sizeof (guint64), bench_compare);
+
+  g_print ("%d,%d,%s,%d,%u,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f,%.2f\n",
+      run->width, run->height, run->format, run->buffers, measured,
+      measured / seconds,
+      (gdouble) (run->cpuEnd - run->cpuStart) / GST_USECOND / measured,
+      (gdouble) run->intervals[measured / 2] / GST_USECOND,
+      (gdouble) run->intervals[MIN (measured - 1, measured * 99 / 100)] / GST_USECOND,
+      (gdouble) run->creates[measured / 2] / GST_USECOND,
+      (gdouble) run->creates[MIN (measured - 1, measured * 99 / 100)] / GST_USECOND,
+      (gdouble) (run->allocEnd - run->allocStart) / measured);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *resolutions = "640x480,1920x1200,4096x3000";
+  gchar *formats = "mono8,bayer8,rgb8";
+  gchar *bufferCounts = "4,10,32";
+  gchar *extra = NULL;
+  gint frames = 1000, warmup = 50;
+  GOptionEntry entries[] = {
+    {"resolutions", 'r', 0, G_OPTION_ARG_STRING, &resolutions, "Comma separated list of resolutions (WxH)", "LIST"},
+    {"formats", 'f', 0, G_OPTION_ARG_STRING, &formats, "Comma separated list of pylonsrc image formats", "LIST"},
+    {"buffers", 'b', 0, G_OPTION_ARG_STRING, &bufferCounts, "Comma separated list of grab buffer counts", "LIST"},
+    {"frames", 'n', 0, G_OPTION_ARG_INT, &frames, "Frames to measure in each run", "N"},
+    {"warmup", 'w', 0, G_OPTION_ARG_INT, &warmup, "Frames to skip at the start of each run", "N"},
+    {"extra", 'e', 0, G_OPTION_ARG_STRING, &extra, "Extra pylonsrc properties", "PROPERTIES"},
+    {NULL}
+  };
+  GOptionContext *context;
+  GError *error = NULL;
+  GstElementFactory *factory;
+  GstElement *probe;
+  gboolean hasBufferProperty;
+  gchar **resolutionList, **formatList, **bufferList;
+  gint r, f, b, maxWidth = 0, maxHeight = 0, failures = 0;
+
+  context = g_option_context_new ("- pylonsrc frame path benchmark");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+  if (!g_option_context_parse (context, &argc, &argv, &error)) {
+    g_printerr ("%s\n", error->message);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (frames < 2) {
+    g_printerr ("At least 2 frames need to be measured.\n");
+    return 1;
+  }
+
+  factory = gst_element_factory_find ("pylonsrc");
+  if (factory == NULL) {
+    g_printerr ("pylonsrc not found. Is GST_PLUGIN_PATH set?\n");
+    return 1;
+  }
+  probe = gst_element_factory_create (factory, NULL);
+  hasBufferProperty = g_object_class_find_property (G_OBJECT_GET_CLASS (probe), "grabbuffers") != NULL;
+  gst_object_unref (probe);
+  gst_object_unref (factory);
+  if (!hasBufferProperty) {
+    g_printerr ("This pylonsrc has a fixed grab buffer count, the buffer counts will be ignored.\n");
+    bufferCounts = "0";
+  }
+
+  resolutionList = g_strsplit (resolutions, ",", -1);
+  formatList = g_strsplit (formats, ",", -1);
+  bufferList = g_strsplit (bufferCounts, ",", -1);
+
+  // Make sure the virtual camera can do every resolution we ask for, and doesn't throttle us.
+  for (r = 0; resolutionList[r] != NULL; r++) {
+    gint width = 0, height = 0;
+    sscanf (resolutionList[r], "%dx%d", &width, &height);
+    maxWidth = MAX (maxWidth, width);
+    maxHeight = MAX (maxHeight, height);
+  }
+  {
+    gchar *value = g_strdup_printf ("%d", maxWidth);
+    g_setenv ("PYLONSTUB_WIDTH", value, FALSE);
+    g_free (value);
+    value = g_strdup_printf ("%d", maxHeight);
+    g_setenv ("PYLONSTUB_HEIGHT", value, FALSE);
+    g_free (value);
+  }
+  g_setenv ("PYLONSTUB_FPS", "0", FALSE);
+
+  g_print ("width,height,format,buffers,frames,fps,cpu_us_per_frame,interval_p50_us,interval_p99_us,create_p50_us,create_p99_us,allocs_per_frame\n");
+  for (r = 0; resolutionList[r] != NULL; r++) {
+    for (f = 0; formatList[f] != NULL; f++) {
+      for (b = 0; bufferList[b] != NULL; b++) {
+        BenchRun run = { 0 };
+
+        if (sscanf (resolutionList[r], "%dx%d", &run.width, &run.height) != 2) {
+          g_printerr ("Invalid resolution \"%s\".\n", resolutionList[r]);
+          failures++;
+          continue;
+        }
+        run.format = formatList[f];
+        run.buffers = atoi (bufferList[b]);
+        run.frames = frames + warmup;
+        run.warmup = warmup;
+        run.intervals = g_new0 (guint64, frames);
+        run.creates = g_new0 (guint64, frames);
+
+        if (bench_run (&run, hasBufferProperty, extra)) {
+          bench_report (&run);
+        } else {
+          failures++;
+        }
+        g_free (run.intervals);
+        g_free (run.creates);
+      }
+    }
+  }
+
+  g_strfreev (resolutionList);
+  g_strfreev (formatList);
+  g_strfreev (bufferList);
+  return failures ? 1 : 0;
+}
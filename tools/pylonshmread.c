@@ -0,0 +1,114 @@
+/* GStreamer
+ * Copyright (C) 2018 Ingmars Melkis <contact@zingmars.me>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Suite 500,
+ * Boston, MA 02110-1335, USA.
+ */
+
+/*
+ * Example pylonshmsink reader.
+ *
+ * Connects to a pylonshmsink and prints once a second how many frames it
+ * got and how many it missed, along with the caps and the last frame's
+ * capture information. Holding on to every frame for a while (-h) stands in
+ * for a slow reader, to see it being dropped. Run it through `make shmread`,
+ * i.e. `make shmread SHMREAD_FLAGS="-s /tmp/camera0 -h 50"`.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../plugins/pylonshm.h"
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *socketPath = "/tmp/pylonshm";
+  PylonShmReader *reader;
+  PylonShmFrame frame;
+  unsigned long frames = 0, missed = 0;
+  uint64_t lastSequence = 0;
+  double lastReport;
+  int hold = 0, opt, res;
+
+  while((opt = getopt(argc, argv, "s:h:")) != -1) {
+    switch(opt) {
+      case 's':
+        socketPath = optarg;
+        break;
+      case 'h':
+        hold = atoi(optarg);
+        break;
+      default:
+        fprintf(stderr, "Usage: %s [-s socket path] [-h milliseconds to hold every frame for]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  reader = pylon_shm_reader_open(socketPath);
+  if(!reader) {
+    perror(socketPath);
+    return 1;
+  }
+
+  lastReport = now();
+  while((res = pylon_shm_reader_next(reader, &frame, 1000)) >= 0) {
+    if(res > 0) {
+      frames++;
+      if(lastSequence > 0 && frame.sequence > lastSequence + 1) {
+        missed += frame.sequence - lastSequence - 1;
+      }
+      lastSequence = frame.sequence;
+      if(hold > 0) {
+        usleep(hold * 1000);
+      }
+    }
+
+    if(now() - lastReport >= 1.0) {
+      printf("%lu frames, %lu missed", frames, missed);
+      if(res > 0) {
+        printf(", %zu bytes of %s", frame.size, frame.caps);
+        if(frame.metaFields & PYLON_SHM_CAPTURE) {
+          printf(", camera frame %" PRIu64, frame.framecounter);
+        }
+      }
+      printf("\n");
+      fflush(stdout);
+      frames = 0;
+      missed = 0;
+      lastReport = now();
+    }
+
+    if(res > 0) {
+      pylon_shm_frame_release(reader, &frame);
+    }
+  }
+
+  printf("The sink went away or dropped us.\n");
+  pylon_shm_reader_close(reader);
+  return 0;
+}
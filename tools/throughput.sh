@@ -0,0 +1,32 @@
+#!/bin/bash
+# Measures how many frames per second pylonsrc can push into a fakesink.
+# Meant to be run through `make throughput` on a build configured with
+# --enable-pylon-stub, but works with a real camera too.
+#
+# Usage: throughput.sh <plugin directory> [extra pylonsrc properties]
+# Environment: FRAMES (default: 1000) and the PYLONSTUB_* variables.
+
+PLUGINDIR=${1:-plugins/.libs}
+shift
+FRAMES=${FRAMES:-1000}
+
+# Free-run the virtual camera unless asked otherwise, we want to measure the plugin, not the sensor.
+export PYLONSTUB_FPS=${PYLONSTUB_FPS:-0}
+export GST_PLUGIN_PATH="$PLUGINDIR${GST_PLUGIN_PATH:+:$GST_PLUGIN_PATH}"
+
+if ! command -v gst-launch-1.0 > /dev/null ; then
+ echo "gst-launch-1.0 is required to run this benchmark."
+ exit 1
+fi
+
+START=$(date +%s%N)
+if ! gst-launch-1.0 -q pylonsrc num-buffers="$FRAMES" limitbandwidth=false "$@" ! fakesink sync=false ; then
+ echo "The pipeline failed."
+ exit 1
+fi
+END=$(date +%s%N)
+
+awk -v frames="$FRAMES" -v ns="$((END - START))" 'BEGIN {
+  seconds = ns / 1000000000;
+  printf "%d frames in %.3f s: %.1f fps (%.3f ms per frame, including start-up)\n", frames, seconds, frames / seconds, seconds * 1000 / frames;
+}'